@@ -0,0 +1,315 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#define _GNU_SOURCE // pread and pwrite
+
+#include <xt/aio.h>
+#include <xt/error.h>
+#include <xt/file.h>
+#include <xt/socket.h>
+#include <xt/thread.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bench.h"
+
+#define AIO_FILE_SIZE (64 << 20)
+#define AIO_BLOCK 4096
+#define AIO_BLOCKS (AIO_FILE_SIZE / AIO_BLOCK)
+#define AIO_READS 65536
+#define AIO_MAX_DEPTH 64
+
+#define ECHO_CLIENTS 16
+#define ECHO_REQUESTS (1 << 14)
+#define ECHO_SIZE 64
+#define ECHO_GROUP 0
+#define ECHO_BUFFER 4096
+#define ECHO_BUFFERS 64
+#define ECHO_BATCH 64
+
+/* The kind of a request, the buffer it uses and its connection */
+#define ECHO_TAG(kind, buf, conn) ((void*)(uintptr_t)((kind) << 24 | (buf) << 8 | (conn)))
+enum { ECHO_ACCEPT = 1, ECHO_RECV, ECHO_SEND };
+
+static int fd = -1;
+static char (*bufs)[AIO_BLOCK];
+
+struct depth {
+	struct xtAIO aio;
+	unsigned depth;
+};
+
+static unsigned long long random_offset(void)
+{
+	return (unsigned long long)(rand() % AIO_BLOCKS) * AIO_BLOCK;
+}
+
+/*
+Keeps depth random reads in flight until n reads have completed. Every
+completion hands its slot and buffer back to the next read.
+*/
+static void read_depth(void *arg, size_t n)
+{
+	struct depth *d = arg;
+	struct xtAIORequest reqs[AIO_MAX_DEPTH], batch[AIO_MAX_DEPTH];
+	struct xtAIOCompletion cqes[AIO_MAX_DEPTH];
+	size_t issued = 0, done = 0;
+	unsigned count = 0, sent, got;
+	memset(reqs, 0, sizeof reqs);
+	for (unsigned i = 0; i < d->depth; ++i) {
+		reqs[i].op = XT_AIO_READ;
+		reqs[i].fd = fd;
+		reqs[i].buf = bufs[i];
+		reqs[i].len = AIO_BLOCK;
+		reqs[i].userData = &reqs[i];
+		if (issued < n) {
+			reqs[i].offset = random_offset();
+			batch[count++] = reqs[i];
+			++issued;
+		}
+	}
+	while (done < n) {
+		if (count && (xtAIOSubmit(&d->aio, batch, count, &sent) || sent != count))
+			return;
+		if (xtAIOWait(&d->aio, cqes, AIO_MAX_DEPTH, 1, &got))
+			return;
+		done += got;
+		count = 0;
+		for (unsigned i = 0; i < got && issued < n; ++i, ++issued) {
+			struct xtAIORequest *req = cqes[i].userData;
+			req->offset = random_offset();
+			batch[count++] = *req;
+		}
+	}
+	bench_sink = done;
+}
+
+static void read_sync(void *arg, size_t n)
+{
+	size_t sum = 0;
+	(void)arg;
+	for (size_t i = 0; i < n; ++i)
+		sum += pread(fd, bufs[0], AIO_BLOCK, random_offset());
+	bench_sink = sum;
+}
+
+static void bench_depths(unsigned flags, const char *backend)
+{
+	static const unsigned depths[] = {1, 4, 16, 64};
+	struct depth d;
+	char name[64];
+	if (xtAIOCreate(&d.aio, AIO_MAX_DEPTH, AIO_MAX_DEPTH, flags))
+		return;
+	if (!flags && d.aio.backend != XT_AIO_BACKEND_URING) {
+		xtAIODestroy(&d.aio);
+		return;
+	}
+	for (unsigned i = 0; i < sizeof depths / sizeof depths[0]; ++i) {
+		d.depth = depths[i];
+		snprintf(name, sizeof name, "read4k_%s_qd%u", backend, depths[i]);
+		bench_run(name, read_depth, &d, AIO_READS, AIO_BLOCK);
+	}
+	xtAIODestroy(&d.aio);
+}
+
+struct echo_client {
+	xtSocket sock;
+	size_t n;
+};
+
+struct echo {
+	struct xtAIO aio;
+	unsigned sendFlags;
+	struct echo_client clients[ECHO_CLIENTS];
+	int conns[ECHO_CLIENTS];
+	char (*ring)[ECHO_BUFFER];
+	unsigned long long requests;
+};
+
+/* Sends a request and waits for the whole echo, like a blocking RPC client. */
+static void *echo_client(struct xtThread *t, void *arg)
+{
+	struct echo_client *c = arg;
+	char req[ECHO_SIZE] = {0}, resp[ECHO_SIZE];
+	(void)t;
+	for (size_t i = 0; i < c->n; ++i) {
+		uint16_t n;
+		if (xtSocketTCPWrite(c->sock, req, sizeof req, &n))
+			break;
+		for (size_t got = 0; got < sizeof resp; got += n)
+			if (xtSocketTCPRead(c->sock, resp + got, sizeof resp - got, &n))
+				return NULL;
+	}
+	return NULL;
+}
+
+static void echo_prep(struct xtAIORequest *req, int kind, unsigned conn, int fd)
+{
+	memset(req, 0, sizeof *req);
+	req->fd = fd;
+	req->bufGroup = ECHO_GROUP;
+	req->userData = ECHO_TAG(kind, 0, conn);
+	if (kind == ECHO_ACCEPT) {
+		req->op = XT_AIO_ACCEPT;
+		req->flags = XT_AIO_MULTISHOT;
+	} else {
+		req->op = XT_AIO_RECV;
+		req->flags = XT_AIO_MULTISHOT | XT_AIO_BUFFER_SELECT;
+	}
+}
+
+/*
+Serves the clients with one multishot receive per connection. Every request
+is sent back from the buffer that it has been received into, and the buffer
+goes back into the ring once the send has finished.
+*/
+static void echo_requests(void *arg, size_t n)
+{
+	struct echo *e = arg;
+	struct xtThread t[ECHO_CLIENTS];
+	struct xtAIOCompletion cqes[ECHO_BATCH];
+	struct xtAIORequest batch[2 * ECHO_BATCH];
+	size_t sent = 0, expect = n / ECHO_CLIENTS * ECHO_CLIENTS * ECHO_SIZE;
+	unsigned got, count, submitted;
+	for (unsigned i = 0; i < ECHO_CLIENTS; ++i) {
+		e->clients[i].n = n / ECHO_CLIENTS;
+		xtThreadCreate(&t[i], echo_client, &e->clients[i], 0, 0);
+	}
+	while (sent < expect) {
+		if (xtAIOWait(&e->aio, cqes, ECHO_BATCH, 1, &got))
+			break;
+		count = 0;
+		for (unsigned i = 0; i < got; ++i) {
+			uintptr_t tag = (uintptr_t)cqes[i].userData;
+			unsigned conn = tag & 0xff, buf = tag >> 8 & 0xffff;
+			if (tag >> 24 == ECHO_SEND) {
+				if (!(cqes[i].flags & XT_AIO_CQE_NOTIFY))
+					sent += cqes[i].result;
+				if (!(cqes[i].flags & XT_AIO_CQE_MORE))
+					xtAIORecycleBuffer(&e->aio, ECHO_GROUP, buf);
+				continue;
+			}
+			if (cqes[i].result > 0) {
+				struct xtAIORequest *req = &batch[count++];
+				memset(req, 0, sizeof *req);
+				req->op = XT_AIO_SEND;
+				req->flags = e->sendFlags;
+				req->fd = e->conns[conn];
+				req->buf = e->ring[cqes[i].bufId];
+				req->len = cqes[i].result;
+				req->userData = ECHO_TAG(ECHO_SEND, cqes[i].bufId, conn);
+			}
+			// A multishot receive that has run out of buffers is started again
+			if (!(cqes[i].flags & XT_AIO_CQE_MORE) && (cqes[i].result > 0 || cqes[i].error == XT_ENOBUFS))
+				echo_prep(&batch[count++], ECHO_RECV, conn, e->conns[conn]);
+		}
+		if (count && (xtAIOSubmit(&e->aio, batch, count, &submitted) || submitted != count))
+			break;
+	}
+	for (unsigned i = 0; i < ECHO_CLIENTS; ++i)
+		xtThreadJoin(&t[i], NULL);
+	e->requests += n / ECHO_CLIENTS * ECHO_CLIENTS;
+}
+
+static void bench_echo(unsigned flags, unsigned sendFlags, const char *backend)
+{
+	static struct echo e;
+	struct xtAIOCompletion cqe;
+	struct xtAIORequest req;
+	struct xtSockaddr sa;
+	xtSocket server;
+	unsigned connected = 0, accepted = 0, n;
+	unsigned long long syscalls;
+	char name[64];
+
+	memset(&e, 0, sizeof e);
+	e.sendFlags = sendFlags;
+	if (xtAIOCreate(&e.aio, 4 * ECHO_BATCH, 0, flags))
+		return;
+	if (!(flags & XT_AIO_THREADS) && e.aio.backend != XT_AIO_BACKEND_URING)
+		goto destroy;
+	if (!(e.ring = malloc(ECHO_BUFFERS * sizeof *e.ring)) || xtSocketCreate(&server, XT_SOCKET_PROTO_TCP))
+		goto destroy;
+	if (!xtSockaddrFromString(&sa, "127.0.0.1", 0) || xtSocketBindTo(server, &sa) || xtSocketListen(server, ECHO_CLIENTS)
+		|| xtSocketGetLocalSocketAddress(server, &sa)
+		|| xtAIORegisterBufferRing(&e.aio, ECHO_GROUP, e.ring, ECHO_BUFFER, ECHO_BUFFERS))
+		goto close;
+	echo_prep(&req, ECHO_ACCEPT, 0, server);
+	if (xtAIOSubmit(&e.aio, &req, 1, &n))
+		goto close;
+	for (; connected < ECHO_CLIENTS; ++connected) {
+		xtSocket *sock = &e.clients[connected].sock;
+		if (xtSocketCreate(sock, XT_SOCKET_PROTO_TCP))
+			break;
+		if (xtSocketSetTCPNoDelay(*sock, true) || xtSocketConnect(*sock, &sa)) {
+			xtSocketClose(sock);
+			break;
+		}
+	}
+	for (; accepted < connected; ++accepted) {
+		if (xtAIOWait(&e.aio, &cqe, 1, 1, &n) || cqe.error)
+			break;
+		e.conns[accepted] = cqe.result;
+		xtSocketSetTCPNoDelay(cqe.result, true);
+		echo_prep(&req, ECHO_RECV, accepted, cqe.result);
+		if (xtAIOSubmit(&e.aio, &req, 1, &n))
+			break;
+	}
+	snprintf(name, sizeof name, "echo_%s", backend);
+	if (accepted == ECHO_CLIENTS) {
+		syscalls = xtAIOGetSyscalls(&e.aio);
+		bench_run(name, echo_requests, &e, ECHO_REQUESTS, ECHO_SIZE);
+		fprintf(stderr, "%s: %.2f syscalls/request\n", name,
+			(double)(xtAIOGetSyscalls(&e.aio) - syscalls) / e.requests);
+	} else
+		fprintf(stderr, "aio: cannot connect %d clients\n", ECHO_CLIENTS);
+close:
+	// The receives and the accept are canceled before the sockets are closed
+	xtAIODestroy(&e.aio);
+	while (accepted)
+		close(e.conns[--accepted]);
+	while (connected)
+		xtSocketClose(&e.clients[--connected].sock);
+	xtSocketClose(&server);
+	free(e.ring);
+	return;
+destroy:
+	free(e.ring);
+	xtAIODestroy(&e.aio);
+}
+
+void bench_aio(void)
+{
+	char path[256];
+	// Prefer tmpfs, so the scaling is not limited by the disk
+	if (access("/dev/shm", W_OK))
+		xtFileGetTempDir(path, sizeof path - 16);
+	else
+		snprintf(path, sizeof path, "/dev/shm");
+	snprintf(path + strlen(path), 16, "/bench_aio");
+	if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600)) == -1)
+		return;
+	unlink(path);
+	if (!(bufs = malloc(AIO_MAX_DEPTH * sizeof *bufs)))
+		goto end;
+	for (unsigned i = 0; i < AIO_MAX_DEPTH * AIO_BLOCK; ++i)
+		bufs[0][i] = rand();
+	for (unsigned long long off = 0; off < AIO_FILE_SIZE; off += AIO_BLOCK)
+		if (pwrite(fd, bufs[off / AIO_BLOCK % AIO_MAX_DEPTH], AIO_BLOCK, off) != AIO_BLOCK)
+			goto end;
+	bench_run("read4k_pread", read_sync, NULL, AIO_READS, AIO_BLOCK);
+	bench_depths(0, "uring");
+	bench_depths(XT_AIO_THREADS, "threads");
+	if (xtSocketInit()) {
+		bench_echo(XT_AIO_NETWORK, 0, "uring");
+		bench_echo(XT_AIO_NETWORK, XT_AIO_ZEROCOPY, "uring_zc");
+		bench_echo(XT_AIO_THREADS, 0, "threads");
+		xtSocketDestruct();
+	}
+end:
+	free(bufs);
+	close(fd);
+}
@@ -0,0 +1,220 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/error.h>
+#include <xt/thread.h>
+#include <xt/time.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+#define WARMUP_DEFAULT 3
+#define REPS_DEFAULT 15
+
+enum output {
+	OUTPUT_TEXT,
+	OUTPUT_CSV,
+	OUTPUT_JSON
+};
+
+static struct {
+	unsigned warmup, reps;
+	int cpu;
+	enum output output;
+	char **filters;
+	unsigned nfilters;
+} cfg = {WARMUP_DEFAULT, REPS_DEFAULT, -1, OUTPUT_TEXT, NULL, 0};
+
+static const char *group = "";
+static unsigned count;
+
+volatile size_t bench_sink;
+
+static const struct {
+	const char *name;
+	void (*func)(void);
+} groups[] = {
+	{"aio"       , bench_aio       },
+	{"collection", bench_collection},
+	{"crypto"    , bench_crypto    },
+	{"eventloop" , bench_eventloop },
+	{"file"      , bench_file      },
+	{"hash"      , bench_hash      },
+	{"mman"      , bench_mman      },
+	{"pool"      , bench_pool      },
+	{"socket"    , bench_socket    },
+	{"sort"      , bench_sort      },
+	{"string"    , bench_string    },
+};
+
+static int cmp_double(const void *a, const void *b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return x < y ? -1 : x > y;
+}
+
+static int match(const char *name)
+{
+	if (!cfg.nfilters)
+		return 1;
+	for (unsigned i = 0; i < cfg.nfilters; ++i)
+		if (strstr(name, cfg.filters[i]))
+			return 1;
+	return 0;
+}
+
+void bench_group(const char *name)
+{
+	group = name;
+}
+
+int bench_want(const char *name)
+{
+	if (!cfg.nfilters)
+		return 1;
+	// Filters without a group may match a benchmark in any group
+	for (unsigned i = 0; i < cfg.nfilters; ++i)
+		if (!strchr(cfg.filters[i], '/') || !strncmp(cfg.filters[i], name, strlen(name)))
+			return 1;
+	return 0;
+}
+
+void bench_run(const char *name, void (*func)(void *arg, size_t n), void *arg, size_t n, size_t bytes)
+{
+	char full[128];
+	struct xtTimestamp start, end, diff;
+	double *samples, min, median, p99, mbs;
+	snprintf(full, sizeof full, "%s/%s", group, name);
+	if (!match(full))
+		return;
+	if (!(samples = malloc(cfg.reps * sizeof *samples))) {
+		fprintf(stderr, "%s: out of memory\n", full);
+		return;
+	}
+	for (unsigned i = 0; i < cfg.warmup; ++i)
+		func(arg, n);
+	for (unsigned i = 0; i < cfg.reps; ++i) {
+		xtClockGetTime(&start, XT_CLOCK_MONOTONIC);
+		func(arg, n);
+		xtClockGetTime(&end, XT_CLOCK_MONOTONIC);
+		xtTimestampDiff(&diff, &start, &end);
+		samples[i] = (diff.sec * 1000000000.0 + diff.nsec) / n;
+	}
+	qsort(samples, cfg.reps, sizeof *samples, cmp_double);
+	min = samples[0];
+	median = cfg.reps % 2 ? samples[cfg.reps / 2] : (samples[cfg.reps / 2 - 1] + samples[cfg.reps / 2]) / 2;
+	p99 = samples[(cfg.reps * 99 + 99) / 100 - 1];
+	// Bytes per nanosecond equals gigabytes per second
+	mbs = bytes ? bytes / median * 1000 : 0;
+	switch (cfg.output) {
+	case OUTPUT_TEXT:
+		if (bytes)
+			printf("%-36s %12.2f %12.2f %12.2f %10.1f\n", full, min, median, p99, mbs);
+		else
+			printf("%-36s %12.2f %12.2f %12.2f %10s\n", full, min, median, p99, "-");
+		break;
+	case OUTPUT_CSV:
+		printf("%s,%zu,%.2f,%.2f,%.2f,%.1f\n", full, n, min, median, p99, mbs);
+		break;
+	case OUTPUT_JSON:
+		printf(
+			"%s\n\t{\"name\": \"%s\", \"ops\": %zu, \"min_ns\": %.2f, \"median_ns\": %.2f, \"p99_ns\": %.2f, \"mb_s\": %.1f}",
+			count ? "," : "", full, n, min, median, p99, mbs
+		);
+		break;
+	}
+	fflush(stdout);
+	++count;
+	free(samples);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-w warmup] [-r repetitions] [-c cpu] [-f text|csv|json] [filter...]\n"
+		"Runs all benchmarks whose name contains any of the filters.\n"
+		"  -w  Untimed runs before measuring, default %u\n"
+		"  -r  Timed repetitions, default %u\n"
+		"  -c  Pin the benchmark to this CPU\n"
+		"  -f  Output format, default text\n",
+		prog, WARMUP_DEFAULT, REPS_DEFAULT
+	);
+}
+
+static int parse(int argc, char **argv)
+{
+	int i;
+	for (i = 1; i < argc; ++i) {
+		const char *arg = argv[i];
+		if (arg[0] != '-')
+			break;
+		if (!strcmp(arg, "--")) {
+			++i;
+			break;
+		}
+		if (!arg[1] || arg[2] || i + 1 >= argc)
+			return 1;
+		arg = argv[++i];
+		switch (argv[i - 1][1]) {
+		case 'w':
+			cfg.warmup = strtoul(arg, NULL, 10);
+			break;
+		case 'r':
+			cfg.reps = strtoul(arg, NULL, 10);
+			if (!cfg.reps)
+				return 1;
+			break;
+		case 'c':
+			cfg.cpu = atoi(arg);
+			break;
+		case 'f':
+			if (!strcmp(arg, "text"))
+				cfg.output = OUTPUT_TEXT;
+			else if (!strcmp(arg, "csv"))
+				cfg.output = OUTPUT_CSV;
+			else if (!strcmp(arg, "json"))
+				cfg.output = OUTPUT_JSON;
+			else
+				return 1;
+			break;
+		default:
+			return 1;
+		}
+	}
+	cfg.filters = argv + i;
+	cfg.nfilters = argc - i;
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+	if (parse(argc, argv)) {
+		usage(argv[0]);
+		return 1;
+	}
+	if (cfg.cpu >= 0 && (ret = xtThreadSetAffinity(cfg.cpu))) {
+		fprintf(stderr, "Could not pin to CPU %d: %s\n", cfg.cpu, xtGetErrorStr(ret));
+		return 1;
+	}
+	switch (cfg.output) {
+	case OUTPUT_TEXT:
+		printf("%-36s %12s %12s %12s %10s\n", "benchmark", "min ns/op", "median ns/op", "p99 ns/op", "MB/s");
+		break;
+	case OUTPUT_CSV:
+		puts("name,ops,min_ns,median_ns,p99_ns,mb_s");
+		break;
+	case OUTPUT_JSON:
+		printf("[");
+		break;
+	}
+	for (unsigned i = 0; i < sizeof groups / sizeof groups[0]; ++i)
+		if (bench_want(groups[i].name)) {
+			bench_group(groups[i].name);
+			groups[i].func();
+		}
+	if (cfg.output == OUTPUT_JSON)
+		puts("\n]");
+	return 0;
+}
@@ -0,0 +1,43 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+#include <stddef.h>
+
+/**
+ * Receives results that must not be optimized away.
+ */
+extern volatile size_t bench_sink;
+
+/**
+ * Sets the group that the next benchmarks belong to.
+ */
+void bench_group(const char *name);
+/**
+ * Runs \a func a couple of times to warm up and then times every repetition.
+ * Only benchmarks whose full name "group/name" matches a filter are run.
+ * @param func - Performs \a n operations on \a arg.
+ * @param n - The number of operations per repetition.
+ * @param bytes - The bytes processed per operation, or zero if the throughput
+ * is meaningless.
+ */
+void bench_run(const char *name, void (*func)(void *arg, size_t n), void *arg, size_t n, size_t bytes);
+/**
+ * Returns whether any benchmark of the group \a name would be run.
+ */
+int bench_want(const char *name);
+
+void bench_aio(void);
+void bench_collection(void);
+void bench_crypto(void);
+void bench_eventloop(void);
+void bench_file(void);
+void bench_hash(void);
+void bench_mman(void);
+void bench_pool(void);
+void bench_socket(void);
+void bench_sort(void);
+void bench_string(void);
+
+#endif
@@ -0,0 +1,191 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/arena.h>
+#include <xt/hashmap.h>
+#include <xt/list.h>
+#include <xt/queue.h>
+#include <xt/stack.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define MAP_N 100000
+#define COLLECTION_N 1000000
+#define REQUEST_N 10000
+#define REQUEST_ITEMS 32
+
+static size_t *keys;
+
+static size_t key_hash(const void *key)
+{
+	size_t x = *(const size_t*)key;
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdLLU;
+	return x ^ (x >> 33);
+}
+
+static bool key_compare(const void *a, const void *b)
+{
+	return *(const size_t*)a == *(const size_t*)b;
+}
+
+static void hashmap_add(void *arg, size_t n)
+{
+	struct xtHashmap map;
+	(void)arg;
+	if (xtHashmapCreate(&map, 0, key_hash, key_compare))
+		return;
+	for (size_t i = 0; i < n; ++i)
+		xtHashmapAdd(&map, &keys[i], &keys[i]);
+	bench_sink = xtHashmapGetCount(&map);
+	xtHashmapDestroy(&map);
+}
+
+static void hashmap_get(void *arg, size_t n)
+{
+	void *value;
+	size_t found = 0;
+	for (size_t i = 0; i < n; ++i)
+		found += !xtHashmapGetValue(arg, &keys[i], &value);
+	bench_sink = found;
+}
+
+static void hashmap_add_remove(void *arg, size_t n)
+{
+	struct xtHashmap map;
+	(void)arg;
+	if (xtHashmapCreate(&map, n, key_hash, key_compare))
+		return;
+	for (size_t i = 0; i < n; ++i)
+		xtHashmapAdd(&map, &keys[i], &keys[i]);
+	for (size_t i = 0; i < n; ++i)
+		xtHashmapRemove(&map, &keys[i]);
+	bench_sink = xtHashmapGetCount(&map);
+	xtHashmapDestroy(&map);
+}
+
+static void list_add(void *arg, size_t n)
+{
+	struct xtListU list;
+	(void)arg;
+	if (xtListUCreate(&list, 0))
+		return;
+	for (size_t i = 0; i < n; ++i)
+		xtListUAdd(&list, i);
+	bench_sink = xtListUGetCount(&list);
+	xtListUDestroy(&list);
+}
+
+static void list_get(void *arg, size_t n)
+{
+	unsigned value, sum = 0;
+	for (size_t i = 0; i < n; ++i) {
+		xtListUGet(arg, i, &value);
+		sum += value;
+	}
+	bench_sink = sum;
+}
+
+static void stack_push_pop(void *arg, size_t n)
+{
+	struct xtStackU stack;
+	unsigned value, sum = 0;
+	(void)arg;
+	if (xtStackUCreate(&stack, 1024))
+		return;
+	for (size_t i = 0; i < n; ++i)
+		xtStackUPush(&stack, i);
+	while (xtStackUPop(&stack, &value))
+		sum += value;
+	bench_sink = sum;
+	xtStackUDestroy(&stack);
+}
+
+static void queue_push_pop(void *arg, size_t n)
+{
+	struct xtQueueU queue;
+	unsigned value, sum = 0;
+	(void)arg;
+	if (xtQueueUCreate(&queue, 1024))
+		return;
+	for (size_t i = 0; i < n; ++i)
+		xtQueueUPush(&queue, i);
+	while (xtQueueUPop(&queue, &value))
+		sum += value;
+	bench_sink = sum;
+	xtQueueUDestroy(&queue);
+}
+
+/* Builds the structures that a typical request needs and tears them down again */
+static void request(const struct xtAllocator *allocator, bool destroy)
+{
+	struct xtHashmap map;
+	struct xtListP list;
+	struct xtQueueU queue;
+	if (xtHashmapCreateAllocator(&map, REQUEST_ITEMS, key_hash, key_compare, allocator))
+		return;
+	if (xtListPCreateAllocator(&list, 8, allocator) || xtQueueUCreateAllocator(&queue, 8, allocator))
+		return;
+	for (size_t i = 0; i < REQUEST_ITEMS; ++i) {
+		xtHashmapAdd(&map, &keys[i], &keys[i]);
+		xtListPAdd(&list, &keys[i]);
+		xtQueueUPush(&queue, i);
+	}
+	bench_sink = xtHashmapGetCount(&map) + xtListPGetCount(&list);
+	if (destroy) {
+		xtQueueUDestroy(&queue);
+		xtListPDestroy(&list);
+		xtHashmapDestroy(&map);
+	}
+}
+
+static void request_malloc(void *arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; ++i)
+		request(NULL, true);
+}
+
+static void request_arena(void *arg, size_t n)
+{
+	struct xtArena *arena = arg;
+	for (size_t i = 0; i < n; ++i) {
+		request(&arena->allocator, false);
+		xtArenaReset(arena);
+	}
+}
+
+void bench_collection(void)
+{
+	struct xtHashmap map;
+	struct xtListU list;
+	struct xtArena arena;
+	if (!(keys = malloc(MAP_N * sizeof *keys)))
+		return;
+	for (size_t i = 0; i < MAP_N; ++i)
+		keys[i] = i * 2654435761LLU;
+	bench_run("hashmap_add", hashmap_add, NULL, MAP_N, 0);
+	if (!xtHashmapCreate(&map, MAP_N, key_hash, key_compare)) {
+		for (size_t i = 0; i < MAP_N; ++i)
+			xtHashmapAdd(&map, &keys[i], &keys[i]);
+		bench_run("hashmap_get", hashmap_get, &map, MAP_N, 0);
+		xtHashmapDestroy(&map);
+	}
+	bench_run("hashmap_add_remove", hashmap_add_remove, NULL, MAP_N, 0);
+	bench_run("list_add", list_add, NULL, COLLECTION_N, 0);
+	if (!xtListUCreate(&list, COLLECTION_N)) {
+		for (size_t i = 0; i < COLLECTION_N; ++i)
+			xtListUAdd(&list, i);
+		bench_run("list_get", list_get, &list, COLLECTION_N, 0);
+		xtListUDestroy(&list);
+	}
+	bench_run("stack_push_pop", stack_push_pop, NULL, COLLECTION_N, 0);
+	bench_run("queue_push_pop", queue_push_pop, NULL, COLLECTION_N, 0);
+	bench_run("request_malloc", request_malloc, NULL, REQUEST_N, 0);
+	if (!xtArenaCreate(&arena, 0, 0)) {
+		bench_run("request_arena", request_arena, &arena, REQUEST_N, 0);
+		xtArenaDestroy(&arena);
+	}
+	free(keys);
+}
@@ -0,0 +1,73 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/crypto.h>
+
+#include <stdint.h>
+#include <string.h>
+#include "bench.h"
+
+#define CRYPTO_BLOCK 4096
+#define CRYPTO_N 256
+#define BCRYPT_ROUNDS XT_BCRYPT_MIN_LOGROUNDS
+
+static uint8_t block[CRYPTO_BLOCK], dest[CRYPTO_BLOCK];
+static uint32_t words[CRYPTO_BLOCK / sizeof(uint32_t)];
+
+static void serpent_encrypt(void *arg, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		xtSerpentEncrypt(arg, dest, block, sizeof block);
+	bench_sink = dest[0];
+}
+
+static void serpent_decrypt(void *arg, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		xtSerpentDecrypt(arg, dest, block, sizeof block);
+	bench_sink = dest[0];
+}
+
+/* xtBlowfishEncrypt() counts in blocks of 64 bits. */
+static void blowfish_encrypt(void *arg, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		xtBlowfishEncrypt(arg, words, sizeof words / 8);
+	bench_sink = words[0];
+}
+
+static void blowfish_cbc(void *arg, size_t n)
+{
+	uint8_t iv[8] = {0};
+	for (size_t i = 0; i < n; ++i)
+		xtBlowfishEncryptCBC(arg, iv, block, sizeof block);
+	bench_sink = block[0];
+}
+
+static void bcrypt(void *arg, size_t n)
+{
+	char hash[XT_BCRYPT_KEY_LENGTH];
+	for (size_t i = 0; i < n; ++i)
+		xtBcrypt("correct horse battery staple", arg, hash, sizeof hash);
+	bench_sink = hash[0];
+}
+
+void bench_crypto(void)
+{
+	struct xtSerpent serpent;
+	struct xtBlowfish blowfish;
+	uint8_t key[32], seed[XT_BCRYPT_MAXSALT];
+	char salt[XT_BCRYPT_SALT_LENGTH];
+	for (unsigned i = 0; i < sizeof key; ++i)
+		key[i] = seed[i % sizeof seed] = i * 7;
+	memset(block, 0x5a, sizeof block);
+	if (!xtSerpentInit(&serpent, key, sizeof key)) {
+		bench_run("serpent_encrypt", serpent_encrypt, &serpent, CRYPTO_N, CRYPTO_BLOCK);
+		bench_run("serpent_decrypt", serpent_decrypt, &serpent, CRYPTO_N, CRYPTO_BLOCK);
+	}
+	if (!xtBlowfishInit(&blowfish, key, 16)) {
+		bench_run("blowfish_encrypt", blowfish_encrypt, &blowfish, CRYPTO_N, CRYPTO_BLOCK);
+		bench_run("blowfish_cbc", blowfish_cbc, &blowfish, CRYPTO_N, CRYPTO_BLOCK);
+	}
+	if (!xtBcryptGenSalt(BCRYPT_ROUNDS, seed, sizeof seed, salt, sizeof salt))
+		bench_run("bcrypt", bcrypt, salt, 4, 0);
+}
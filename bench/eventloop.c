@@ -0,0 +1,104 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/eventloop.h>
+#include <xt/socket.h>
+#include <xt/thread.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include "bench.h"
+
+#define ECHO_CLIENTS 16
+#define ECHO_REQUESTS (1 << 14)
+#define ECHO_SIZE 64
+
+struct echo_client {
+	xtSocket sock;
+	size_t n;
+};
+
+static void echo_data(struct xtEventLoopConn *conn, const void *buf, size_t len, void *arg)
+{
+	(void)arg;
+	xtEventLoopConnWrite(conn, buf, len);
+}
+
+static void echo_accept(struct xtEventLoopConn *conn, const struct xtSockaddr *peer, void *arg)
+{
+	static const struct xtEventLoopConnCallbacks cb = {echo_data, NULL, NULL};
+	(void)peer;
+	(void)arg;
+	xtEventLoopConnSetCallbacks(conn, &cb, NULL);
+}
+
+/* Sends a request and waits for the whole echo, like a blocking RPC client. */
+static void *echo_client(struct xtThread *t, void *arg)
+{
+	struct echo_client *c = arg;
+	char req[ECHO_SIZE] = {0}, resp[ECHO_SIZE];
+	(void)t;
+	for (size_t i = 0; i < c->n; ++i) {
+		uint16_t n;
+		if (xtSocketTCPWrite(c->sock, req, sizeof req, &n))
+			break;
+		for (size_t got = 0; got < sizeof resp; got += n)
+			if (xtSocketTCPRead(c->sock, resp + got, sizeof resp - got, &n))
+				return NULL;
+	}
+	return NULL;
+}
+
+static void echo_requests(void *arg, size_t n)
+{
+	struct echo_client *clients = arg;
+	struct xtThread t[ECHO_CLIENTS];
+	for (unsigned i = 0; i < ECHO_CLIENTS; ++i) {
+		clients[i].n = n / ECHO_CLIENTS;
+		xtThreadCreate(&t[i], echo_client, &clients[i], 0, 0);
+	}
+	for (unsigned i = 0; i < ECHO_CLIENTS; ++i)
+		xtThreadJoin(&t[i], NULL);
+}
+
+static void echo_loops(unsigned loops)
+{
+	struct echo_client clients[ECHO_CLIENTS];
+	struct xtEventLoop loop;
+	struct xtSockaddr sa;
+	unsigned connected = 0;
+	char name[32];
+	if (xtEventLoopCreate(&loop, loops, 256))
+		return;
+	if (!xtSockaddrFromString(&sa, "127.0.0.1", 0) || xtEventLoopListen(&loop, &sa, 64, echo_accept, NULL)) {
+		fprintf(stderr, "eventloop: cannot listen on loopback\n");
+		goto destroy;
+	}
+	for (; connected < ECHO_CLIENTS; ++connected) {
+		xtSocket *sock = &clients[connected].sock;
+		if (xtSocketCreate(sock, XT_SOCKET_PROTO_TCP))
+			break;
+		if (xtSocketSetTCPNoDelay(*sock, true) || xtSocketConnect(*sock, &sa)) {
+			xtSocketClose(sock);
+			break;
+		}
+	}
+	snprintf(name, sizeof name, "echo_l%u", loops);
+	if (connected == ECHO_CLIENTS)
+		bench_run(name, echo_requests, clients, ECHO_REQUESTS, ECHO_SIZE);
+	else
+		fprintf(stderr, "eventloop: cannot connect %d clients\n", ECHO_CLIENTS);
+	while (connected)
+		xtSocketClose(&clients[--connected].sock);
+destroy:
+	xtEventLoopDestroy(&loop);
+}
+
+void bench_eventloop(void)
+{
+	static const unsigned loops[] = {1, 4, 16};
+	if (!xtSocketInit())
+		return;
+	for (unsigned i = 0; i < sizeof loops / sizeof loops[0]; ++i)
+		echo_loops(loops[i]);
+	xtSocketDestruct();
+}
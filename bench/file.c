@@ -0,0 +1,128 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/error.h>
+#include <xt/file.h>
+#include <xt/mman.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+#define FILE_SIZE (256 << 20)
+#define FILE_SPARSE_SIZE (1ULL << 32)
+#define FILE_SPARSE_DATA (1 << 20)
+#define FILE_SCAN_CHUNK (64 << 10)
+
+static char src[1024], dst[1024];
+
+static void copy_xt(void *arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; ++i)
+		bench_sink = xtFileCopy(src, dst);
+}
+
+/* The stdio loop that xtFileCopy() used before. */
+static void copy_stdio(void *arg, size_t n)
+{
+	char buf[8192];
+	size_t len;
+	(void)arg;
+	for (size_t i = 0; i < n; ++i) {
+		FILE *in = fopen(src, "rb"), *out = fopen(dst, "w+");
+		if (in && out)
+			while ((len = fread(buf, 1, sizeof buf, in)) && fwrite(buf, len, 1, out) == 1)
+				;
+		if (out)
+			fclose(out);
+		if (in)
+			fclose(in);
+	}
+}
+
+static size_t sum_words(const unsigned long long *data, size_t n)
+{
+	unsigned long long sum = 0;
+	for (size_t i = 0; i < n; ++i)
+		sum += data[i];
+	return sum;
+}
+
+/* Reads the whole file through a buffer and sums its words. */
+static void scan_fread(void *arg, size_t n)
+{
+	static unsigned long long buf[FILE_SCAN_CHUNK / sizeof(unsigned long long)];
+	size_t sum = 0, len;
+	(void)arg;
+	for (size_t i = 0; i < n; ++i) {
+		FILE *f = fopen(src, "rb");
+		if (!f)
+			return;
+		while ((len = fread(buf, 1, sizeof buf, f)))
+			sum += sum_words(buf, len / sizeof *buf);
+		fclose(f);
+	}
+	bench_sink = sum;
+}
+
+/* Maps the whole file and sums its words, optionally prefaulting it first. */
+static void scan_mapped(void *arg, size_t n)
+{
+	struct xtMappedFile mf;
+	size_t sum = 0;
+	for (size_t i = 0; i < n; ++i) {
+		if (xtMappedFileOpen(&mf, src, 0, arg ? XT_MAPPED_FILE_POPULATE : 0))
+			return;
+		xtMappedFileAdvise(&mf, 0, 0, XT_MAPPED_FILE_SEQUENTIAL);
+		sum += sum_words(mf.data, mf.size / sizeof(unsigned long long));
+		xtMappedFileClose(&mf);
+	}
+	bench_sink = sum;
+}
+
+static int make_file(unsigned long long size, size_t data)
+{
+	char *buf;
+	FILE *f;
+	int ret = XT_ENOMEM;
+	if (!(buf = malloc(data)))
+		return ret;
+	for (size_t i = 0; i < data; ++i)
+		buf[i] = rand();
+	if ((ret = xtFileTempFile(src, sizeof src, &f)))
+		goto end;
+	// Data at the start and the end with a hole in between
+	if (fwrite(buf, data / 2, 1, f) != 1
+		|| fseek(f, size - data / 2, SEEK_SET)
+		|| fwrite(buf + data / 2, data - data / 2, 1, f) != 1)
+		ret = XT_EIO;
+	fclose(f);
+end:
+	free(buf);
+	return ret;
+}
+
+void bench_file(void)
+{
+	char tmp[256];
+	if (xtFileGetTempDir(tmp, sizeof tmp))
+		return;
+	snprintf(dst, sizeof dst, "%s/bench_copy", tmp);
+	if (make_file(FILE_SIZE, FILE_SIZE)) {
+		fprintf(stderr, "file: cannot create %s\n", src);
+		return;
+	}
+	bench_run("copy_xt", copy_xt, NULL, 1, FILE_SIZE);
+	bench_run("copy_stdio", copy_stdio, NULL, 1, FILE_SIZE);
+	bench_run("scan_fread", scan_fread, NULL, 1, FILE_SIZE);
+	bench_run("scan_mapped", scan_mapped, NULL, 1, FILE_SIZE);
+	bench_run("scan_mapped_populate", scan_mapped, src, 1, FILE_SIZE);
+	xtFileRemove(src);
+	// The throughput of sparse copies counts the holes
+	if (!make_file(FILE_SPARSE_SIZE, FILE_SPARSE_DATA)) {
+		bench_run("copy_sparse_xt", copy_xt, NULL, 1, FILE_SPARSE_SIZE);
+		xtFileRemove(src);
+	}
+	xtFileRemove(dst);
+}
@@ -0,0 +1,41 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/hash.h>
+
+#include <stdint.h>
+#include "bench.h"
+
+#define HASH_BLOCK 4096
+#define HASH_N 1024
+
+static uint8_t block[HASH_BLOCK];
+
+static void crc32(void *arg, size_t n)
+{
+	uint32_t crc = 0;
+	(void)arg;
+	for (size_t i = 0; i < n; ++i)
+		crc = xtHashCRC32(crc, block, sizeof block);
+	bench_sink = crc;
+}
+
+static void digest(void *arg, size_t n)
+{
+	struct xtHash ctx;
+	xtHashInit(&ctx, *(enum xtHashAlgorithm*)arg);
+	for (size_t i = 0; i < n; ++i)
+		xtHashUpdate(&ctx, block, sizeof block);
+	xtHashDigest(&ctx);
+	bench_sink = ctx.hash[0];
+}
+
+void bench_hash(void)
+{
+	enum xtHashAlgorithm md5 = XT_HASH_MD5, sha256 = XT_HASH_SHA256, sha512 = XT_HASH_SHA512;
+	for (unsigned i = 0; i < sizeof block; ++i)
+		block[i] = i * 131;
+	bench_run("crc32", crc32, NULL, HASH_N, HASH_BLOCK);
+	bench_run("md5", digest, &md5, HASH_N, HASH_BLOCK);
+	bench_run("sha256", digest, &sha256, HASH_N, HASH_BLOCK);
+	bench_run("sha512", digest, &sha512, HASH_N, HASH_BLOCK);
+}
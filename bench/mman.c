@@ -0,0 +1,50 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/mman.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+#define CHASE_SIZE (256 << 20)
+#define CHASE_SLOTS (CHASE_SIZE / sizeof(size_t))
+#define CHASE_STEPS (1 << 22)
+
+/*
+Links all slots in one random cycle (Sattolo's algorithm), so every load
+depends on the previous one and most of them miss the TLB.
+*/
+static void chase_init(size_t *slots)
+{
+	for (size_t i = 0; i < CHASE_SLOTS; ++i)
+		slots[i] = i;
+	for (size_t i = CHASE_SLOTS - 1; i > 0; --i) {
+		size_t j = ((size_t)rand() * RAND_MAX + rand()) % i, tmp = slots[i];
+		slots[i] = slots[j];
+		slots[j] = tmp;
+	}
+}
+
+static void chase(void *arg, size_t n)
+{
+	const size_t *slots = arg;
+	size_t pos = 0;
+	for (size_t i = 0; i < n; ++i)
+		pos = slots[pos];
+	bench_sink = pos;
+}
+
+void bench_mman(void)
+{
+	size_t *slots;
+	if ((slots = malloc(CHASE_SIZE))) {
+		chase_init(slots);
+		bench_run("chase_malloc", chase, slots, CHASE_STEPS, sizeof *slots);
+		free(slots);
+	}
+	if ((slots = xtHugeAlloc(CHASE_SIZE))) {
+		chase_init(slots);
+		bench_run("chase_huge", chase, slots, CHASE_STEPS, sizeof *slots);
+		xtHugeFree(slots, CHASE_SIZE);
+	}
+}
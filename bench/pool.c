@@ -0,0 +1,74 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/pool.h>
+#include <xt/thread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+#define POOL_OBJECT_SIZE 64
+#define POOL_BATCH 64
+#define POOL_OPS (1 << 20)
+#define POOL_MAX_THREADS 16
+
+struct pool_run {
+	struct xtPool *pool;
+	unsigned threads;
+	size_t n;
+};
+
+/*
+Every thread allocates a batch of objects, touches them and frees them
+again, which is the pattern of short lived connection or request objects.
+*/
+static void *pool_worker(struct xtThread *t, void *arg)
+{
+	const struct pool_run *run = arg;
+	void *objs[POOL_BATCH];
+	size_t n = run->n / run->threads;
+	(void)t;
+	for (size_t done = 0; done < n; done += POOL_BATCH) {
+		for (unsigned i = 0; i < POOL_BATCH; ++i)
+			*(size_t*)(objs[i] = run->pool ? xtPoolAlloc(run->pool) : malloc(POOL_OBJECT_SIZE)) = i;
+		for (unsigned i = 0; i < POOL_BATCH; ++i)
+			if (run->pool)
+				xtPoolFree(run->pool, objs[i]);
+			else
+				free(objs[i]);
+	}
+	if (run->pool)
+		xtPoolThreadDetach(run->pool);
+	return NULL;
+}
+
+static void pool_threads(void *arg, size_t n)
+{
+	struct pool_run *run = arg;
+	struct xtThread t[POOL_MAX_THREADS];
+	run->n = n;
+	for (unsigned i = 0; i < run->threads; ++i)
+		xtThreadCreate(&t[i], pool_worker, run, 0, 0);
+	for (unsigned i = 0; i < run->threads; ++i)
+		xtThreadJoin(&t[i], NULL);
+}
+
+void bench_pool(void)
+{
+	static const unsigned threads[] = {1, 4, 16};
+	struct xtPool pool;
+	struct pool_run run;
+	char name[64];
+	if (xtPoolCreate(&pool, "bench", POOL_OBJECT_SIZE, 0))
+		return;
+	for (unsigned i = 0; i < sizeof threads / sizeof threads[0]; ++i) {
+		run.threads = threads[i];
+		run.pool = NULL;
+		snprintf(name, sizeof name, "malloc_t%u", threads[i]);
+		bench_run(name, pool_threads, &run, POOL_OPS, 0);
+		run.pool = &pool;
+		snprintf(name, sizeof name, "xtpool_t%u", threads[i]);
+		bench_run(name, pool_threads, &run, POOL_OPS, 0);
+	}
+	xtPoolDestroy(&pool);
+}
@@ -0,0 +1,280 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/socket.h>
+#include <xt/thread.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "bench.h"
+
+#define SOCKET_CHUNK 32768
+#define SOCKET_N 2048
+#define SOCKET_BIG (1 << 20)
+#define SOCKET_HEAD 256
+#define UDP_SIZE 64
+#define UDP_N (1 << 16)
+#define POLL_SOCKETS 4096
+#define POLL_N 64
+
+static char chunk[SOCKET_CHUNK], big[SOCKET_BIG];
+
+/* Drains the connection until the writer closes it. */
+static void *reader(struct xtThread *t, void *arg)
+{
+	static char buf[SOCKET_BIG];
+	size_t n, total = 0;
+	(void)t;
+	while (!xtSocketTCPReadEx(*(xtSocket*)arg, buf, sizeof buf, &n))
+		total += n;
+	bench_sink = total;
+	return NULL;
+}
+
+static void tcp_write(void *arg, size_t n)
+{
+	xtSocket sock = *(xtSocket*)arg;
+	uint16_t sent;
+	for (size_t i = 0; i < n; ++i)
+		for (size_t off = 0; off < sizeof chunk; off += sent)
+			if (xtSocketTCPWrite(sock, chunk + off, sizeof chunk - off, &sent))
+				return;
+}
+
+/* One call per buffer instead of one per 64 KiB. */
+static void tcp_writeall(void *arg, size_t n)
+{
+	xtSocket sock = *(xtSocket*)arg;
+	size_t sent;
+	for (size_t i = 0; i < n; ++i)
+		if (xtSocketTCPWriteAll(sock, big, sizeof big, &sent, 0))
+			return;
+}
+
+/* A small header followed by its body, like a framed message. */
+static void tcp_write_framed(void *arg, size_t n)
+{
+	xtSocket sock = *(xtSocket*)arg;
+	size_t sent;
+	for (size_t i = 0; i < n; ++i)
+		if (xtSocketTCPWriteAll(sock, chunk, SOCKET_HEAD, &sent, 0)
+			|| xtSocketTCPWriteAll(sock, chunk + SOCKET_HEAD, sizeof chunk - SOCKET_HEAD, &sent, 0))
+			return;
+}
+
+static void tcp_writev_framed(void *arg, size_t n)
+{
+	xtSocket sock = *(xtSocket*)arg;
+	struct xtSocketIOVec iov[2];
+	size_t sent;
+	iov[0].base = chunk;
+	iov[0].len = SOCKET_HEAD;
+	iov[1].base = chunk + SOCKET_HEAD;
+	iov[1].len = sizeof chunk - SOCKET_HEAD;
+	for (size_t i = 0; i < n; ++i)
+		if (xtSocketTCPWritevAll(sock, iov, 2, &sent, 0))
+			return;
+}
+
+struct udp_pair {
+	xtSocket tx, rx;
+	struct xtSockaddr dest;
+	struct xtSocketUDPMessage msgs[XT_SOCKET_UDP_BATCH];
+	char data[XT_SOCKET_UDP_BATCH][UDP_SIZE];
+	/* Coalesced datagrams of udp_gro */
+	char big[XT_SOCKET_UDP_BATCH * UDP_SIZE];
+};
+
+/* One system call per datagram on both ends. */
+static void udp_single(void *arg, size_t n)
+{
+	struct udp_pair *p = arg;
+	uint16_t len;
+	for (size_t i = 0; i < n; ++i)
+		if (xtSocketUDPWrite(p->tx, p->data[0], UDP_SIZE, &len, &p->dest)
+			|| xtSocketUDPRead(p->rx, p->data[0], UDP_SIZE, &len, NULL))
+			return;
+}
+
+static bool udp_drain(struct udp_pair *p, unsigned count)
+{
+	for (unsigned i = 0; i < count; ++i) {
+		p->msgs[i].buf = p->data[i];
+		p->msgs[i].buflen = UDP_SIZE;
+		p->msgs[i].addr = NULL;
+	}
+	for (unsigned got = 0, read; got < count; got += read)
+		if (xtSocketUDPReadBatch(p->rx, p->msgs + got, count - got, &read))
+			return false;
+	return true;
+}
+
+/* Up to XT_SOCKET_UDP_BATCH datagrams per system call on both ends. */
+static void udp_batch(void *arg, size_t n)
+{
+	struct udp_pair *p = arg;
+	for (size_t i = 0; i < n;) {
+		unsigned count = n - i < XT_SOCKET_UDP_BATCH ? n - i : XT_SOCKET_UDP_BATCH, sent;
+		for (unsigned j = 0; j < count; ++j) {
+			p->msgs[j].buf = p->data[j];
+			p->msgs[j].buflen = UDP_SIZE;
+			p->msgs[j].addr = &p->dest;
+			p->msgs[j].segmentSize = 0;
+		}
+		if (xtSocketUDPWriteBatch(p->tx, p->msgs, count, &sent) || !udp_drain(p, sent))
+			return;
+		i += sent;
+	}
+}
+
+/* The kernel splits one send into datagrams, which are read in batches or coalesced again. */
+static void udp_segments(struct udp_pair *p, size_t n, bool gro)
+{
+	for (size_t i = 0; i < n;) {
+		unsigned count = n - i < XT_SOCKET_UDP_BATCH ? n - i : XT_SOCKET_UDP_BATCH, sent;
+		p->msgs[0].buf = p->big;
+		p->msgs[0].buflen = count * UDP_SIZE;
+		p->msgs[0].addr = &p->dest;
+		p->msgs[0].segmentSize = UDP_SIZE;
+		if (xtSocketUDPWriteBatch(p->tx, p->msgs, 1, &sent))
+			return;
+		if (!gro) {
+			if (!udp_drain(p, count))
+				return;
+		} else {
+			for (size_t got = 0; got < count * UDP_SIZE; got += p->msgs[0].len) {
+				unsigned read;
+				p->msgs[0].buf = p->big;
+				p->msgs[0].buflen = sizeof p->big;
+				p->msgs[0].addr = NULL;
+				if (xtSocketUDPReadBatch(p->rx, p->msgs, 1, &read))
+					return;
+			}
+		}
+		i += count;
+	}
+}
+
+static void udp_gso(void *arg, size_t n)
+{
+	udp_segments(arg, n, false);
+}
+
+static void udp_gro(void *arg, size_t n)
+{
+	udp_segments(arg, n, true);
+}
+
+static void bench_udp(void)
+{
+	static struct udp_pair p;
+	struct xtSockaddr src;
+	if (xtSocketCreate(&p.tx, XT_SOCKET_PROTO_UDP))
+		return;
+	if (xtSocketCreate(&p.rx, XT_SOCKET_PROTO_UDP))
+		goto close_tx;
+	if (!xtSockaddrFromString(&p.dest, "127.0.0.1", 0) || !xtSockaddrFromString(&src, "127.0.0.1", 0)
+		|| xtSocketBindTo(p.rx, &p.dest) || xtSocketGetLocalSocketAddress(p.rx, &p.dest) || xtSocketBindTo(p.tx, &src)) {
+		fprintf(stderr, "socket: cannot bind udp sockets\n");
+		goto close_rx;
+	}
+	// One operation is one datagram, so the packets per second are 1e9 / ns/op
+	bench_run("udp_single", udp_single, &p, UDP_N, UDP_SIZE);
+	bench_run("udp_batch", udp_batch, &p, UDP_N, UDP_SIZE);
+	bench_run("udp_gso", udp_gso, &p, UDP_N, UDP_SIZE);
+	if (!xtSocketSetUDPGRO(p.rx, true))
+		bench_run("udp_gro", udp_gro, &p, UDP_N, UDP_SIZE);
+close_rx:
+	xtSocketClose(&p.rx);
+close_tx:
+	xtSocketClose(&p.tx);
+}
+
+struct poll_churn {
+	struct xtSocketPoll *poll;
+	xtSocket socks[POLL_SOCKETS];
+};
+
+/* Removes a socket and adds it again, newest first. */
+static void poll_churn(void *arg, size_t n)
+{
+	struct poll_churn *c = arg;
+	for (size_t i = 0; i < n; ++i) {
+		xtSocket *sock = &c->socks[POLL_SOCKETS - 1 - i % POLL_SOCKETS];
+		xtSocketPollRemove(c->poll, *sock);
+		xtSocketPollAdd(c->poll, *sock, sock, XT_POLLIN);
+	}
+}
+
+static void bench_poll(void)
+{
+	static struct poll_churn c;
+	size_t opened = 0;
+	if (xtSocketPollCreate(&c.poll, POLL_SOCKETS))
+		return;
+	for (; opened < POLL_SOCKETS; ++opened)
+		if (xtSocketCreate(&c.socks[opened], XT_SOCKET_PROTO_UDP)
+			|| xtSocketPollAdd(c.poll, c.socks[opened], &c.socks[opened], XT_POLLIN))
+			break;
+	if (opened == POLL_SOCKETS)
+		bench_run("poll_churn", poll_churn, &c, POLL_N * POLL_SOCKETS, 0);
+	else
+		fprintf(stderr, "socket: cannot open %d sockets\n", POLL_SOCKETS);
+	while (opened)
+		xtSocketClose(&c.socks[--opened]);
+	xtSocketPollDestroy(&c.poll);
+}
+
+static int loopback(xtSocket *client, xtSocket *server)
+{
+	xtSocket listener;
+	struct xtSockaddr sa, peer;
+	int ret;
+	if ((ret = xtSocketCreate(&listener, XT_SOCKET_PROTO_TCP)))
+		return ret;
+	if (!xtSockaddrFromString(&sa, "127.0.0.1", 0)) {
+		ret = 1;
+		goto close_listener;
+	}
+	if ((ret = xtSocketBindTo(listener, &sa))
+		|| (ret = xtSocketListen(listener, 1))
+		|| (ret = xtSocketGetLocalSocketAddress(listener, &sa)))
+		goto close_listener;
+	if ((ret = xtSocketCreate(client, XT_SOCKET_PROTO_TCP)))
+		goto close_listener;
+	if ((ret = xtSocketConnect(*client, &sa))
+		|| (ret = xtSocketTCPAccept(listener, server, &peer)))
+		xtSocketClose(client);
+close_listener:
+	xtSocketClose(&listener);
+	return ret;
+}
+
+void bench_socket(void)
+{
+	struct xtThread t;
+	xtSocket client, server;
+	if (!xtSocketInit())
+		return;
+	bench_poll();
+	bench_udp();
+	if (loopback(&client, &server)) {
+		fprintf(stderr, "socket: cannot connect over loopback\n");
+		goto destruct;
+	}
+	if (xtThreadCreate(&t, reader, &server, 0, 0))
+		goto close;
+	bench_run("tcp_loopback", tcp_write, &client, SOCKET_N, SOCKET_CHUNK);
+	bench_run("tcp_writeall", tcp_writeall, &client, SOCKET_N * SOCKET_CHUNK / SOCKET_BIG, SOCKET_BIG);
+	bench_run("tcp_framed", tcp_write_framed, &client, SOCKET_N, SOCKET_CHUNK);
+	bench_run("tcp_writev_framed", tcp_writev_framed, &client, SOCKET_N, SOCKET_CHUNK);
+	xtSocketClose(&client);
+	xtThreadJoin(&t, NULL);
+	xtSocketClose(&server);
+	goto destruct;
+close:
+	xtSocketClose(&server);
+	xtSocketClose(&client);
+destruct:
+	xtSocketDestruct();
+}
@@ -0,0 +1,591 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/os.h>
+#include <xt/sort.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+/* Quadratic algorithms get a smaller input so a run completes in time. */
+#define SORT_N 100000
+#define SORT_SMALL_N 2000
+#define SORT_RECORD_N 10000
+#define SORT_PARALLEL_N (1 << 22)
+#define SORT_TOP_N 10000000
+#define SORT_TOP_K 100
+#define SORTED_N (1 << 20)
+#define SORTED_SMALL_N 1000
+#define SORTED_LISTS 16
+#define URL_LEN 64
+
+static const struct {
+	const char *name;
+	enum xtSortType type;
+	int quadratic;
+} algorithms[] = {
+	{"bubble", XT_SORT_BUBBLE, 1},
+	{"heap"  , XT_SORT_HEAP  , 0},
+	{"insert", XT_SORT_INSERT, 1},
+	{"quick" , XT_SORT_QUICK , 0},
+	{"select", XT_SORT_SELECT, 1},
+	{"radix" , XT_SORT_RADIX , 0},
+	{"pdq"   , XT_SORT_PDQ   , 0},
+	{"tim"   , XT_SORT_TIM   , 0},
+	{"auto"  , XT_SORT_AUTO  , 0},
+};
+
+enum pattern {
+	PATTERN_SORTED,
+	PATTERN_REVERSED,
+	PATTERN_FEW_UNIQUE,
+	PATTERN_RUNS,
+	PATTERN_MAX
+};
+
+static const char *pattern_names[] = {"sorted", "reversed", "few_unique", "runs"};
+
+static int *source, *work;
+static const char **strsource, **strwork;
+static char (*strings)[16];
+static enum xtSortType type;
+
+static int cmp_int(const void *a, const void *b)
+{
+	int x = *(const int*)a, y = *(const int*)b;
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Every repetition sorts a fresh copy of the same random input. The copy is
+ * part of the measurement, but it is negligible compared to the sort.
+ */
+
+static void sort_u(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(work, source, n * sizeof *work);
+	bench_sink = xtSortU((unsigned*)work, n, type, true);
+}
+
+static void sort_d(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(work, source, n * sizeof *work);
+	bench_sink = xtSortD(work, n, type, true);
+}
+
+static void sort_p(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(work, source, n * sizeof *work);
+	bench_sink = xtSortP(work, n, type, cmp_int, true, sizeof *work);
+}
+
+static void sort_pattern(void *arg, size_t n)
+{
+	const int *input = arg;
+	memcpy(work, input, n * sizeof *work);
+	bench_sink = xtSortU((unsigned*)work, n, type, true);
+}
+
+struct pair {
+	int key, value;
+};
+
+struct wide {
+	long long key, value;
+};
+
+/* Large enough for XT_SORT_AUTO to sort it indirectly. */
+struct record {
+	int key;
+	char payload[1020];
+};
+
+static struct pair *pairs, *pairwork;
+static struct wide *wides, *widework;
+static struct record *records, *recordwork;
+
+static int cmp_pair(const void *a, const void *b)
+{
+	const struct pair *x = a, *y = b;
+	return x->key < y->key ? -1 : x->key > y->key;
+}
+
+static int cmp_wide(const void *a, const void *b)
+{
+	const struct wide *x = a, *y = b;
+	return x->key < y->key ? -1 : x->key > y->key;
+}
+
+static int cmp_record(const void *a, const void *b)
+{
+	const struct record *x = a, *y = b;
+	return x->key < y->key ? -1 : x->key > y->key;
+}
+
+#define XT_SORT_TYPE struct pair
+#define XT_SORT_NAME pair_sort
+#define XT_SORT_LESS(a, b) ((a).key < (b).key)
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE struct wide
+#define XT_SORT_NAME wide_sort
+#define XT_SORT_LESS(a, b) ((a).key < (b).key)
+#include <xt/sort_template.h>
+
+static void sort_pair(void *arg, size_t n)
+{
+	memcpy(pairwork, pairs, n * sizeof *pairwork);
+	if (arg)
+		bench_sink = xtSortP(pairwork, n, *(enum xtSortType*)arg, cmp_pair, true, sizeof *pairwork);
+	else
+		pair_sort(pairwork, n);
+}
+
+static void qsort_pair(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(pairwork, pairs, n * sizeof *pairwork);
+	qsort(pairwork, n, sizeof *pairwork, cmp_pair);
+}
+
+static void sort_wide(void *arg, size_t n)
+{
+	memcpy(widework, wides, n * sizeof *widework);
+	if (arg)
+		bench_sink = xtSortP(widework, n, *(enum xtSortType*)arg, cmp_wide, true, sizeof *widework);
+	else
+		wide_sort(widework, n);
+}
+
+static void qsort_wide(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(widework, wides, n * sizeof *widework);
+	qsort(widework, n, sizeof *widework, cmp_wide);
+}
+
+static void sort_record(void *arg, size_t n)
+{
+	memcpy(recordwork, records, n * sizeof *recordwork);
+	bench_sink = xtSortP(recordwork, n, *(enum xtSortType*)arg, cmp_record, true, sizeof *recordwork);
+}
+
+static void qsort_record(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(recordwork, records, n * sizeof *recordwork);
+	qsort(recordwork, n, sizeof *recordwork, cmp_record);
+}
+
+/* Compares the generic sort on structs against inlined comparisons and qsort. */
+static void bench_elements(void)
+{
+	enum xtSortType pdq = XT_SORT_PDQ, autosort = XT_SORT_AUTO;
+	pairs = malloc(SORT_N * sizeof *pairs);
+	pairwork = malloc(SORT_N * sizeof *pairwork);
+	wides = malloc(SORT_N * sizeof *wides);
+	widework = malloc(SORT_N * sizeof *widework);
+	records = calloc(SORT_RECORD_N, sizeof *records);
+	recordwork = malloc(SORT_RECORD_N * sizeof *recordwork);
+	if (!pairs || !pairwork || !wides || !widework || !records || !recordwork)
+		goto end;
+	for (size_t i = 0; i < SORT_N; ++i) {
+		pairs[i].key = wides[i].key = source[i];
+		pairs[i].value = wides[i].value = i;
+	}
+	for (size_t i = 0; i < SORT_RECORD_N; ++i)
+		records[i].key = source[i];
+	bench_run("pdq_p8", sort_pair, &pdq, SORT_N, 0);
+	bench_run("template_p8", sort_pair, NULL, SORT_N, 0);
+	bench_run("qsort_p8", qsort_pair, NULL, SORT_N, 0);
+	bench_run("pdq_p16", sort_wide, &pdq, SORT_N, 0);
+	bench_run("template_p16", sort_wide, NULL, SORT_N, 0);
+	bench_run("qsort_p16", qsort_wide, NULL, SORT_N, 0);
+	bench_run("pdq_p1024", sort_record, &pdq, SORT_RECORD_N, 0);
+	bench_run("auto_p1024", sort_record, &autosort, SORT_RECORD_N, 0);
+	bench_run("qsort_p1024", qsort_record, NULL, SORT_RECORD_N, 0);
+end:
+	free(recordwork);
+	free(records);
+	free(widework);
+	free(wides);
+	free(pairwork);
+	free(pairs);
+}
+
+static unsigned long long *llsource, *llwork;
+static double *lfsource, *lfwork;
+
+static void sort_llu(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(llwork, llsource, n * sizeof *llwork);
+	bench_sink = xtSortLLU(llwork, n, type, true);
+}
+
+static void sort_lf(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(lfwork, lfsource, n * sizeof *lfwork);
+	bench_sink = xtSortLF(lfwork, n, type, true);
+}
+
+static void radix_wide(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(widework, wides, n * sizeof *widework);
+	bench_sink = xtSortRadix(widework, n, sizeof *widework, 0, XT_SORT_KEY_LLD, true, 1);
+}
+
+/* 64 bit keys and (key, payload) records, which radix sort is meant for. */
+static void bench_wide(void)
+{
+	static const enum xtSortType wide_types[] = {XT_SORT_RADIX, XT_SORT_PDQ};
+	static const char *wide_names[] = {"radix", "pdq"};
+	char name[64];
+	llsource = malloc(SORT_N * sizeof *llsource);
+	llwork = malloc(SORT_N * sizeof *llwork);
+	lfsource = malloc(SORT_N * sizeof *lfsource);
+	lfwork = malloc(SORT_N * sizeof *lfwork);
+	wides = malloc(SORT_N * sizeof *wides);
+	widework = malloc(SORT_N * sizeof *widework);
+	if (!llsource || !llwork || !lfsource || !lfwork || !wides || !widework)
+		goto end;
+	for (size_t i = 0; i < SORT_N; ++i) {
+		// Timestamps in nanoseconds spread over a day
+		llsource[i] = 1500000000000000000ULL + (unsigned long long)rand() * 40000;
+		lfsource[i] = (source[i] - RAND_MAX / 2) / 1e3;
+		wides[i].key = llsource[i];
+		wides[i].value = i;
+	}
+	for (unsigned i = 0; i < sizeof wide_types / sizeof wide_types[0]; ++i) {
+		type = wide_types[i];
+		snprintf(name, sizeof name, "%s_llu", wide_names[i]);
+		bench_run(name, sort_llu, NULL, SORT_N, 0);
+		snprintf(name, sizeof name, "%s_lf", wide_names[i]);
+		bench_run(name, sort_lf, NULL, SORT_N, 0);
+	}
+	bench_run("radix_kv16", radix_wide, NULL, SORT_N, 0);
+end:
+	free(widework);
+	free(wides);
+	free(lfwork);
+	free(lfsource);
+	free(llwork);
+	free(llsource);
+}
+
+static int *bigsource, *bigwork;
+
+static void sort_parallel(void *arg, size_t n)
+{
+	memcpy(bigwork, bigsource, n * sizeof *bigwork);
+	bench_sink = xtSortParallelD(bigwork, n, true, *(unsigned*)arg);
+}
+
+static void radix_parallel(void *arg, size_t n)
+{
+	memcpy(bigwork, bigsource, n * sizeof *bigwork);
+	bench_sink = xtSortRadix(bigwork, n, sizeof *bigwork, 0, XT_SORT_KEY_D, true, *(unsigned*)arg);
+}
+
+/* Prints the speedup curves of the parallel sorts from one thread up to one per logical core. */
+static void bench_parallel(void)
+{
+	struct xtCPUInfo info;
+	char name[64];
+	unsigned threads, cores;
+	bigsource = malloc(SORT_PARALLEL_N * sizeof *bigsource);
+	bigwork = malloc(SORT_PARALLEL_N * sizeof *bigwork);
+	if (!bigsource || !bigwork)
+		goto end;
+	for (size_t i = 0; i < SORT_PARALLEL_N; ++i)
+		bigsource[i] = rand();
+	xtCPUGetInfo(&info);
+	cores = info.logicalCores ? info.logicalCores : 1;
+	for (threads = 1;; threads *= 2) {
+		if (threads > cores)
+			threads = cores;
+		snprintf(name, sizeof name, "parallel_d_t%u", threads);
+		bench_run(name, sort_parallel, &threads, SORT_PARALLEL_N, 0);
+		snprintf(name, sizeof name, "radix_d_t%u", threads);
+		bench_run(name, radix_parallel, &threads, SORT_PARALLEL_N, 0);
+		if (threads == cores)
+			break;
+	}
+end:
+	free(bigwork);
+	free(bigsource);
+}
+
+static void top_partial(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(bigwork, bigsource, n * sizeof *bigwork);
+	bench_sink = xtPartialSortD(bigwork, n, SORT_TOP_K, false);
+}
+
+static void top_sort(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(bigwork, bigsource, n * sizeof *bigwork);
+	bench_sink = xtSortD(bigwork, n, XT_SORT_PDQ, false);
+}
+
+static void select_median(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(bigwork, bigsource, n * sizeof *bigwork);
+	bench_sink = xtSelectNthD(bigwork, n, n / 2, true);
+}
+
+/* Compares finding the best SORT_TOP_K of SORT_TOP_N scores to sorting them all. */
+static void bench_select(void)
+{
+	bigsource = malloc(SORT_TOP_N * sizeof *bigsource);
+	bigwork = malloc(SORT_TOP_N * sizeof *bigwork);
+	if (!bigsource || !bigwork)
+		goto end;
+	for (size_t i = 0; i < SORT_TOP_N; ++i)
+		bigsource[i] = rand();
+	bench_run("top100_partial_d", top_partial, NULL, SORT_TOP_N, 0);
+	bench_run("top100_sort_d", top_sort, NULL, SORT_TOP_N, 0);
+	bench_run("select_median_d", select_median, NULL, SORT_TOP_N, 0);
+end:
+	free(bigwork);
+	free(bigsource);
+}
+
+static unsigned *seta, *setb, *setout;
+static size_t seta_n, setb_n;
+
+static int cmp_uint(const void *a, const void *b)
+{
+	unsigned x = *(const unsigned*)a, y = *(const unsigned*)b;
+	return x < y ? -1 : x > y;
+}
+
+static void lower_bound(void *arg, size_t n)
+{
+	size_t sum = 0;
+	(void)arg;
+	for (size_t i = 0; i < n; ++i)
+		sum += xtLowerBoundU(seta, seta_n, setb[i]);
+	bench_sink = sum;
+}
+
+static void bsearch_u(void *arg, size_t n)
+{
+	size_t sum = 0;
+	(void)arg;
+	for (size_t i = 0; i < n; ++i)
+		sum += bsearch(&setb[i], seta, seta_n, sizeof *seta, cmp_uint) != NULL;
+	bench_sink = sum;
+}
+
+static void intersect_u(void *arg, size_t n)
+{
+	(void)arg;
+	bench_sink = xtIntersectU(setout, seta, n, setb, n);
+}
+
+static void intersect_p(void *arg, size_t n)
+{
+	(void)arg;
+	bench_sink = xtIntersectP(setout, seta, n, setb, n, cmp_uint, sizeof *seta);
+}
+
+/* Counts the elements of the short list, which is what galloping costs scale with. */
+static void intersect_skewed(void *arg, size_t n)
+{
+	(void)arg;
+	bench_sink = xtIntersectU(setout, setb, n, seta, seta_n);
+}
+
+static void union_u(void *arg, size_t n)
+{
+	(void)arg;
+	bench_sink = xtUnionU(setout, seta, n, setb, n);
+}
+
+static void merge_u(void *arg, size_t n)
+{
+	const unsigned *lists[SORTED_LISTS];
+	size_t counts[SORTED_LISTS];
+	(void)arg;
+	for (unsigned i = 0; i < SORTED_LISTS; ++i) {
+		lists[i] = seta + i * (n / SORTED_LISTS);
+		counts[i] = n / SORTED_LISTS;
+	}
+	bench_sink = xtMergeU(setout, lists, counts, SORTED_LISTS);
+}
+
+static void merge_sort_u(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(setout, seta, n * sizeof *setout);
+	bench_sink = xtSortU(setout, n, XT_SORT_PDQ, true);
+}
+
+/* Sets of about half of the numbers below 2 * SORTED_N, so half of their elements match. */
+static void bench_sorted(void)
+{
+	seta = malloc(SORTED_N * sizeof *seta);
+	setb = malloc(SORTED_N * sizeof *setb);
+	setout = malloc(2 * SORTED_N * sizeof *setout);
+	if (!seta || !setb || !setout)
+		goto end;
+	for (unsigned x = 0; seta_n < SORTED_N || setb_n < SORTED_N; ++x) {
+		if (seta_n < SORTED_N && rand() % 2)
+			seta[seta_n++] = x;
+		if (setb_n < SORTED_N && rand() % 2)
+			setb[setb_n++] = x;
+	}
+	bench_run("lower_bound_u", lower_bound, NULL, SORTED_N, 0);
+	bench_run("bsearch_u", bsearch_u, NULL, SORTED_N, 0);
+	bench_run("intersect_u", intersect_u, NULL, SORTED_N, 0);
+	bench_run("intersect_p", intersect_p, NULL, SORTED_N, 0);
+	bench_run("intersect_skewed_u", intersect_skewed, NULL, SORTED_SMALL_N, 0);
+	bench_run("union_u", union_u, NULL, SORTED_N, 0);
+	// Every list is sorted, but their concatenation is not
+	for (size_t i = 0; i < SORTED_N; ++i)
+		seta[i] = (unsigned)rand();
+	for (unsigned i = 0; i < SORTED_LISTS; ++i)
+		xtSortU(seta + i * (SORTED_N / SORTED_LISTS), SORTED_N / SORTED_LISTS, XT_SORT_PDQ, true);
+	bench_run("merge16_u", merge_u, NULL, SORTED_N, 0);
+	bench_run("merge16_sort_u", merge_sort_u, NULL, SORTED_N, 0);
+end:
+	free(setout);
+	free(setb);
+	free(seta);
+}
+
+static void sort_str(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(strwork, strsource, n * sizeof *strwork);
+	bench_sink = xtSortStr(strwork, n, type, true);
+}
+
+static char (*urls)[URL_LEN];
+static size_t *urllen, *urllenwork;
+
+static void sort_url(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(strwork, strsource, n * sizeof *strwork);
+	bench_sink = xtSortStr(strwork, n, type, true);
+}
+
+static void sort_url_len(void *arg, size_t n)
+{
+	(void)arg;
+	memcpy(strwork, strsource, n * sizeof *strwork);
+	memcpy(urllenwork, urllen, n * sizeof *urllenwork);
+	bench_sink = xtSortStrLen(strwork, urllenwork, n, true);
+}
+
+/* Strings with long common prefixes, which strcmp() has to skip every time */
+static void bench_urls(void)
+{
+	static const char *hosts[] = {
+		"https://www.example.com/articles/",
+		"https://www.example.com/images/",
+		"https://cdn.example.net/static/",
+		"http://www.example.org/",
+	};
+	urls = malloc(SORT_N * sizeof *urls);
+	urllen = malloc(SORT_N * sizeof *urllen);
+	urllenwork = malloc(SORT_N * sizeof *urllenwork);
+	if (!urls || !urllen || !urllenwork)
+		goto end;
+	for (size_t i = 0; i < SORT_N; ++i) {
+		snprintf(urls[i], sizeof urls[i], "%s%u/%x.html", hosts[rand() % 4], (unsigned)rand() % 100, (unsigned)rand());
+		urllen[i] = strlen(urls[i]);
+		strsource[i] = urls[i];
+	}
+	type = XT_SORT_PDQ;
+	bench_run("url_pdq_str", sort_url, NULL, SORT_N, 0);
+	type = XT_SORT_AUTO;
+	bench_run("url_auto_str", sort_url, NULL, SORT_N, 0);
+	bench_run("url_len_str", sort_url_len, NULL, SORT_N, 0);
+end:
+	free(urllenwork);
+	free(urllen);
+	free(urls);
+}
+
+void bench_sort(void)
+{
+	char name[64];
+	int *patterned = NULL;
+	size_t n;
+	source = malloc(SORT_N * sizeof *source);
+	work = malloc(SORT_N * sizeof *work);
+	strsource = malloc(SORT_N * sizeof *strsource);
+	strwork = malloc(SORT_N * sizeof *strwork);
+	strings = malloc(SORT_N * sizeof *strings);
+	if (!source || !work || !strsource || !strwork || !strings)
+		goto end;
+	srand(42);
+	for (size_t i = 0; i < SORT_N; ++i) {
+		source[i] = rand();
+		snprintf(strings[i], sizeof strings[i], "%x", (unsigned)rand());
+		strsource[i] = strings[i];
+	}
+	for (unsigned i = 0; i < sizeof algorithms / sizeof algorithms[0]; ++i) {
+		type = algorithms[i].type;
+		n = algorithms[i].quadratic ? SORT_SMALL_N : SORT_N;
+		// Make sure the algorithm is supported for the element type
+		memcpy(work, source, SORT_SMALL_N * sizeof *work);
+		snprintf(name, sizeof name, "%s_u", algorithms[i].name);
+		bench_run(name, sort_u, NULL, n, 0);
+		snprintf(name, sizeof name, "%s_d", algorithms[i].name);
+		bench_run(name, sort_d, NULL, n, 0);
+		if (!xtSortP(work, SORT_SMALL_N, type, cmp_int, true, sizeof *work)) {
+			snprintf(name, sizeof name, "%s_p", algorithms[i].name);
+			bench_run(name, sort_p, NULL, n, 0);
+		}
+		memcpy(strwork, strsource, SORT_SMALL_N * sizeof *strwork);
+		if (!xtSortStr(strwork, SORT_SMALL_N, type, true)) {
+			snprintf(name, sizeof name, "%s_str", algorithms[i].name);
+			bench_run(name, sort_str, NULL, n, 0);
+		}
+	}
+	bench_elements();
+	bench_wide();
+	bench_parallel();
+	bench_select();
+	bench_sorted();
+	bench_urls();
+	// Inputs with patterns that the O(n log n) algorithms may handle differently
+	if (!(patterned = malloc(SORT_N * sizeof *patterned)))
+		goto end;
+	for (unsigned p = 0; p < PATTERN_MAX; ++p) {
+		for (size_t i = 0; i < SORT_N; ++i)
+			switch (p) {
+			case PATTERN_SORTED  : patterned[i] = i; break;
+			case PATTERN_REVERSED: patterned[i] = SORT_N - i; break;
+			case PATTERN_RUNS    : patterned[i] = i % (SORT_N / 16); break;
+			default              : patterned[i] = source[i] % 16; break;
+			}
+		for (unsigned i = 0; i < sizeof algorithms / sizeof algorithms[0]; ++i) {
+			if (algorithms[i].quadratic)
+				continue;
+			type = algorithms[i].type;
+			snprintf(name, sizeof name, "%s_u_%s", algorithms[i].name, pattern_names[p]);
+			bench_run(name, sort_pattern, patterned, SORT_N, 0);
+		}
+	}
+end:
+	free(patterned);
+	free(strings);
+	free(strwork);
+	free(strsource);
+	free(work);
+	free(source);
+}
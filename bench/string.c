@@ -0,0 +1,73 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/string.h>
+
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+
+#define BASE64_BLOCK 3072
+#define BASE64_N 256
+#define FORMAT_N 100000
+
+static char raw[BASE64_BLOCK], encoded[BASE64_BLOCK * 2], decoded[BASE64_BLOCK];
+static char buf[256];
+
+static void base64_encode(void *arg, size_t n)
+{
+	(void)arg;
+	for (size_t i = 0; i < n; ++i)
+		xtBase64Encode(encoded, sizeof encoded, raw, sizeof raw);
+	bench_sink = encoded[0];
+}
+
+static void base64_decode(void *arg, size_t n)
+{
+	size_t len = strlen(encoded);
+	(void)arg;
+	for (size_t i = 0; i < n; ++i)
+		xtBase64Decode(decoded, sizeof decoded, encoded, len);
+	bench_sink = decoded[0];
+}
+
+static void xt_snprintf(void *arg, size_t n)
+{
+	int len = 0;
+	(void)arg;
+	for (size_t i = 0; i < n; ++i)
+		len += xtsnprintf(buf, sizeof buf, "[%s] %-10s %5d %x %.3f", "INFO", "request", (int)i, (unsigned)i, i * .5);
+	bench_sink = len;
+}
+
+static void libc_snprintf(void *arg, size_t n)
+{
+	int len = 0;
+	(void)arg;
+	for (size_t i = 0; i < n; ++i)
+		len += snprintf(buf, sizeof buf, "[%s] %-10s %5d %x %.3f", "INFO", "request", (int)i, (unsigned)i, i * .5);
+	bench_sink = len;
+}
+
+static void format_render(void *arg, size_t n)
+{
+	int len = 0;
+	for (size_t i = 0; i < n; ++i)
+		len += xtFormatRender(buf, sizeof buf, arg, "INFO", "request", (int)i, (unsigned)i, i * .5);
+	bench_sink = len;
+}
+
+void bench_string(void)
+{
+	struct xtFormat *fmt;
+	for (unsigned i = 0; i < sizeof raw; ++i)
+		raw[i] = i * 31;
+	xtBase64Encode(encoded, sizeof encoded, raw, sizeof raw);
+	bench_run("base64_encode", base64_encode, NULL, BASE64_N, BASE64_BLOCK);
+	bench_run("base64_decode", base64_decode, NULL, BASE64_N, BASE64_BLOCK);
+	bench_run("xtsnprintf", xt_snprintf, NULL, FORMAT_N, 0);
+	bench_run("snprintf", libc_snprintf, NULL, FORMAT_N, 0);
+	if (!xtFormatCreate(&fmt, "[%s] %-10s %5d %x %.3f")) {
+		bench_run("xtFormatRender", format_render, fmt, FORMAT_N, 0);
+		xtFormatDestroy(&fmt);
+	}
+}
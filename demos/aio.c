@@ -0,0 +1,354 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/aio.h>
+#include <xt/error.h>
+#include <xt/file.h>
+#include <xt/socket.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "utils.h"
+
+#define BLOCK 4096
+#define BLOCKS 16
+#define RING_GROUP 1
+#define RING_SIZE 64
+#define RING_COUNT 8
+
+static struct stats stats;
+
+static char path[256];
+static char out[BLOCKS][BLOCK], in[BLOCKS][BLOCK];
+static char ring[RING_COUNT][RING_SIZE];
+static int tags[4];
+
+static int wait_all(struct xtAIO *aio, unsigned n, long long result)
+{
+	struct xtAIOCompletion cqes[BLOCKS];
+	unsigned got;
+	for (unsigned done = 0; done < n; done += got) {
+		if (xtAIOWait(aio, cqes, BLOCKS, 1, &got))
+			return 1;
+		for (unsigned i = 0; i < got; ++i)
+			if (cqes[i].error || (result >= 0 && cqes[i].result != result))
+				return 1;
+	}
+	return 0;
+}
+
+static void read_write(struct xtAIO *aio, const char *name)
+{
+	struct xtAIORequest reqs[BLOCKS];
+	struct xtAIOCompletion cqe;
+	unsigned n;
+	int fd = -1;
+	char msg[64];
+
+	// Open the file asynchronously as well
+	memset(reqs, 0, sizeof reqs);
+	reqs[0].op = XT_AIO_OPENAT;
+	reqs[0].fd = XT_AIO_CWD;
+	reqs[0].path = path;
+	reqs[0].openFlags = O_RDWR | O_CREAT | O_TRUNC;
+	reqs[0].mode = 0600;
+	if (xtAIOSubmit(aio, reqs, 1, &n) || n != 1 || xtAIOWait(aio, &cqe, 1, 1, &n) || n != 1 || cqe.error) {
+		snprintf(msg, sizeof msg, "%s: openat", name);
+		FAIL(msg);
+		return;
+	}
+	fd = cqe.result;
+
+	for (unsigned i = 0; i < BLOCKS; ++i) {
+		memset(out[i], 'a' + i, BLOCK);
+		reqs[i].op = XT_AIO_WRITE;
+		reqs[i].fd = fd;
+		reqs[i].buf = out[i];
+		reqs[i].len = BLOCK;
+		reqs[i].offset = i * BLOCK;
+		reqs[i].userData = out[i];
+	}
+	snprintf(msg, sizeof msg, "%s: write", name);
+	if (xtAIOSubmit(aio, reqs, BLOCKS, &n) || n != BLOCKS || wait_all(aio, BLOCKS, BLOCK)) {
+		FAIL(msg);
+		goto close;
+	}
+	PASS(msg);
+
+	reqs[0].op = XT_AIO_FSYNC;
+	reqs[0].flags = XT_AIO_DATASYNC;
+	snprintf(msg, sizeof msg, "%s: fsync", name);
+	if (xtAIOSubmit(aio, reqs, 1, &n) || wait_all(aio, 1, 0))
+		FAIL(msg);
+	else
+		PASS(msg);
+
+	// Read the blocks back in reverse order
+	for (unsigned i = 0; i < BLOCKS; ++i) {
+		reqs[i].op = XT_AIO_READ;
+		reqs[i].flags = 0;
+		reqs[i].buf = in[i];
+		reqs[i].offset = (BLOCKS - 1 - i) * BLOCK;
+	}
+	memset(in, 0, sizeof in);
+	snprintf(msg, sizeof msg, "%s: read", name);
+	if (xtAIOSubmit(aio, reqs, BLOCKS, &n) || n != BLOCKS || wait_all(aio, BLOCKS, BLOCK)) {
+		FAIL(msg);
+		goto close;
+	}
+	for (unsigned i = 0; i < BLOCKS; ++i)
+		if (memcmp(in[i], out[BLOCKS - 1 - i], BLOCK)) {
+			FAIL(msg);
+			goto close;
+		}
+	PASS(msg);
+
+	// Registered files and buffers
+	void *bufs[1] = {in};
+	size_t lens[1] = {sizeof in};
+	snprintf(msg, sizeof msg, "%s: fixed file and buffer", name);
+	if (xtAIORegisterFiles(aio, &fd, 1) || xtAIORegisterBuffers(aio, bufs, lens, 1)) {
+		FAIL(msg);
+		goto close;
+	}
+	memset(in, 0, sizeof in);
+	for (unsigned i = 0; i < BLOCKS; ++i) {
+		reqs[i].flags = XT_AIO_FIXED_FILE | XT_AIO_FIXED_BUFFER;
+		reqs[i].fd = 0;
+		reqs[i].bufIndex = 0;
+		reqs[i].offset = i * BLOCK;
+	}
+	if (xtAIOSubmit(aio, reqs, BLOCKS, &n) || n != BLOCKS || wait_all(aio, BLOCKS, BLOCK)
+		|| memcmp(in, out, sizeof in))
+		FAIL(msg);
+	else
+		PASS(msg);
+	xtAIORegisterFiles(aio, NULL, 0);
+	xtAIORegisterBuffers(aio, NULL, NULL, 0);
+
+	// A read past the end of the file
+	reqs[0].flags = 0;
+	reqs[0].fd = fd;
+	reqs[0].offset = sizeof out;
+	snprintf(msg, sizeof msg, "%s: end of file", name);
+	if (xtAIOSubmit(aio, reqs, 1, &n) || wait_all(aio, 1, 0))
+		FAIL(msg);
+	else
+		PASS(msg);
+
+	reqs[0].op = XT_AIO_CLOSE;
+	snprintf(msg, sizeof msg, "%s: close", name);
+	if (xtAIOSubmit(aio, reqs, 1, &n) || wait_all(aio, 1, 0))
+		FAIL(msg);
+	else {
+		PASS(msg);
+		fd = -1;
+	}
+close:
+	if (fd != -1)
+		close(fd);
+	xtFileRemove(path);
+}
+
+static void limits(struct xtAIO *aio, const char *name)
+{
+	struct xtAIORequest reqs[BLOCKS * 4];
+	struct xtAIOCompletion cqes[BLOCKS * 4];
+	unsigned n, total = 0, got;
+	char msg[64];
+
+	memset(reqs, 0, sizeof reqs);
+	// The queues only hold as many requests as there may be in flight
+	snprintf(msg, sizeof msg, "%s: full queue", name);
+	while (!xtAIOSubmit(aio, reqs, BLOCKS * 4, &n))
+		total += n;
+	if (total < BLOCKS || xtAIOPending(aio) != total
+		|| xtAIOWait(aio, cqes, BLOCKS * 4, total, &got) || got != total)
+		FAIL(msg);
+	else
+		PASS(msg);
+
+	reqs[1].op = XT_AIO_CANCEL + 1;
+	snprintf(msg, sizeof msg, "%s: invalid operation", name);
+	if (xtAIOSubmit(aio, reqs, 2, &n) == XT_EINVAL && !n && !xtAIOPending(aio))
+		PASS(msg);
+	else
+		FAIL(msg);
+
+	reqs[0].op = XT_AIO_READ;
+	reqs[0].fd = -1;
+	snprintf(msg, sizeof msg, "%s: bad file", name);
+	if (!xtAIOSubmit(aio, reqs, 1, &n) && !xtAIOWait(aio, cqes, 1, 1, &got)
+		&& got == 1 && cqes[0].error == XT_EBADF)
+		PASS(msg);
+	else
+		FAIL(msg);
+}
+
+static bool wait_one(struct xtAIO *aio, struct xtAIOCompletion *cqe)
+{
+	unsigned n;
+	return !xtAIOWait(aio, cqe, 1, 1, &n) && n == 1;
+}
+
+static bool submit_one(struct xtAIO *aio, enum xtAIOOp op, unsigned flags, int fd, void *buf, size_t len, void *userData)
+{
+	struct xtAIORequest req;
+	unsigned n;
+	memset(&req, 0, sizeof req);
+	req.op = op;
+	req.flags = flags;
+	req.fd = fd;
+	req.bufGroup = RING_GROUP;
+	req.buf = buf;
+	req.len = len;
+	req.userData = userData;
+	return !xtAIOSubmit(aio, &req, 1, &n) && n == 1;
+}
+
+/* Receives a ping on \a conn and sends it back from the buffer ring. */
+static bool echo(struct xtAIO *aio, xtSocket client, xtSocket conn)
+{
+	struct xtAIOCompletion cqe;
+	char reply[4];
+	uint16_t n;
+	if (xtSocketTCPWrite(client, "ping", 4, &n) || !wait_one(aio, &cqe) || cqe.userData != &tags[1] || cqe.error
+		|| cqe.result != 4 || (cqe.flags & (XT_AIO_CQE_MORE | XT_AIO_CQE_BUFFER)) != (XT_AIO_CQE_MORE | XT_AIO_CQE_BUFFER)
+		|| cqe.bufId >= RING_COUNT || memcmp(ring[cqe.bufId], "ping", 4))
+		return false;
+	// The buffer may only be reused after the last completion of the send
+	unsigned bufId = cqe.bufId;
+	if (!submit_one(aio, XT_AIO_SEND, XT_AIO_ZEROCOPY, conn, ring[bufId], 4, &tags[2]))
+		return false;
+	do {
+		if (!wait_one(aio, &cqe) || cqe.userData != &tags[2] || cqe.error)
+			return false;
+		if (!(cqe.flags & XT_AIO_CQE_NOTIFY) && cqe.result != 4)
+			return false;
+	} while (cqe.flags & XT_AIO_CQE_MORE);
+	return !xtAIORecycleBuffer(aio, RING_GROUP, bufId)
+		&& !xtSocketTCPRead(client, reply, sizeof reply, &n) && n == 4 && !memcmp(reply, "ping", 4);
+}
+
+static void network(struct xtAIO *aio, const char *name)
+{
+	struct xtAIOCompletion cqe;
+	struct xtSockaddr sa;
+	xtSocket server, clients[2], conns[2];
+	unsigned connected = 0, accepted = 0;
+	char msg[64];
+
+	snprintf(msg, sizeof msg, "%s: multishot accept", name);
+	if (xtSocketCreate(&server, XT_SOCKET_PROTO_TCP)) {
+		FAIL(msg);
+		return;
+	}
+	if (!xtSockaddrFromString(&sa, "127.0.0.1", 0) || xtSocketBindTo(server, &sa) || xtSocketListen(server, 4)
+		|| xtSocketGetLocalSocketAddress(server, &sa)
+		|| xtAIORegisterBufferRing(aio, RING_GROUP, ring, RING_SIZE, RING_COUNT)
+		|| !submit_one(aio, XT_AIO_ACCEPT, XT_AIO_MULTISHOT, server, NULL, 0, &tags[0])) {
+		FAIL(msg);
+		goto close;
+	}
+	for (; connected < 2; ++connected) {
+		if (xtSocketCreate(&clients[connected], XT_SOCKET_PROTO_TCP))
+			break;
+		if (xtSocketConnect(clients[connected], &sa)) {
+			xtSocketClose(&clients[connected]);
+			break;
+		}
+	}
+	// One request accepts both connections
+	for (; accepted < connected; ++accepted) {
+		if (!wait_one(aio, &cqe) || cqe.userData != &tags[0] || cqe.error || !(cqe.flags & XT_AIO_CQE_MORE))
+			break;
+		conns[accepted] = cqe.result;
+	}
+	if (connected < 2 || accepted < 2) {
+		FAIL(msg);
+		goto disconnect;
+	}
+	PASS(msg);
+
+	// The completions of the cancel and the canceled request come in any order
+	unsigned canceled = 0;
+	snprintf(msg, sizeof msg, "%s: cancel", name);
+	if (submit_one(aio, XT_AIO_CANCEL, 0, server, NULL, 0, &tags[3])) {
+		for (unsigned i = 0; i < 2 && wait_one(aio, &cqe); ++i)
+			if (cqe.userData == &tags[0] && cqe.error == XT_ECANCELED && !(cqe.flags & XT_AIO_CQE_MORE))
+				canceled |= 1;
+			else if (cqe.userData == &tags[3] && !cqe.error && cqe.result == 1)
+				canceled |= 2;
+	}
+	if (canceled != 3)
+		FAIL(msg);
+	else
+		PASS(msg);
+
+	snprintf(msg, sizeof msg, "%s: multishot recv and zero-copy send", name);
+	if (!submit_one(aio, XT_AIO_RECV, XT_AIO_MULTISHOT | XT_AIO_BUFFER_SELECT, conns[0], NULL, 0, &tags[1])
+		|| !submit_one(aio, XT_AIO_RECV, XT_AIO_MULTISHOT | XT_AIO_BUFFER_SELECT, conns[1], NULL, 0, NULL)) {
+		FAIL(msg);
+		goto disconnect;
+	}
+	// More buffers are consumed than the ring holds
+	bool ok = true;
+	for (unsigned i = 0; ok && i < 2 * RING_COUNT; ++i)
+		ok = echo(aio, clients[0], conns[0]);
+	if (!ok)
+		FAIL(msg);
+	else
+		PASS(msg);
+
+	// The receive of the other connection is canceled by xtAIODestroy()
+	snprintf(msg, sizeof msg, "%s: end of stream", name);
+	xtSocketClose(&clients[0]);
+	--connected;
+	if (!wait_one(aio, &cqe) || cqe.userData != &tags[1] || cqe.error || cqe.result || cqe.flags & XT_AIO_CQE_MORE)
+		FAIL(msg);
+	else
+		PASS(msg);
+disconnect:
+	while (accepted)
+		close(conns[--accepted]);
+	while (connected)
+		xtSocketClose(&clients[--connected]);
+close:
+	xtSocketClose(&server);
+}
+
+static void backend(unsigned flags, const char *name)
+{
+	struct xtAIO aio;
+	char msg[64];
+	snprintf(msg, sizeof msg, "xtAIOCreate() - %s", name);
+	if (xtAIOCreate(&aio, BLOCKS, 2, flags)) {
+		FAIL(msg);
+		return;
+	}
+	if (!(flags & XT_AIO_THREADS) && aio.backend != XT_AIO_BACKEND_URING)
+		SKIP(msg);
+	else
+		PASS(msg);
+	read_write(&aio, name);
+	limits(&aio, name);
+	network(&aio, name);
+	xtAIODestroy(&aio);
+}
+
+int main(void)
+{
+	stats_init(&stats, "aio");
+	puts("-- AIO TEST");
+	if (xtFileGetTempDir(path, sizeof path - 16))
+		return 1;
+	strcat(path, "/aio_test");
+	if (!xtSocketInit())
+		return 1;
+	backend(XT_AIO_NETWORK, "io_uring");
+	backend(XT_AIO_THREADS, "threads");
+	xtSocketDestruct();
+	stats_info(&stats);
+	return stats_status(&stats);
+}
@@ -0,0 +1,258 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/arena.h>
+#include <xt/error.h>
+#include <xt/hashmap.h>
+#include <xt/list.h>
+#include <xt/queue.h>
+#include <xt/socket.h>
+#include <xt/stack.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "utils.h"
+
+#define CHUNK_SIZE 4096
+#define ITEMS 1000
+
+static struct stats stats;
+
+static size_t key_hash(const void *key)
+{
+	return *(const size_t*)key;
+}
+
+static bool key_compare(const void *a, const void *b)
+{
+	return *(const size_t*)a == *(const size_t*)b;
+}
+
+static void create(void)
+{
+	struct xtArena arena;
+	if (xtArenaCreate(&arena, 0, 3) == XT_EINVAL)
+		PASS("xtArenaCreate() - invalid alignment");
+	else
+		FAIL("xtArenaCreate() - invalid alignment");
+	if (xtArenaCreate(&arena, 0, 0) || xtArenaGetSize(&arena) != XT_ARENA_CHUNK_DEFAULT) {
+		FAIL("xtArenaCreate()");
+		return;
+	}
+	PASS("xtArenaCreate()");
+	xtArenaDestroy(&arena);
+}
+
+static void alloc(struct xtArena *arena)
+{
+	unsigned char *ptrs[64];
+	int ret = 0;
+
+	for (unsigned i = 0; i < 64; ++i) {
+		if (!(ptrs[i] = xtArenaAlloc(arena, i * 7 + 1))) {
+			FAIL("xtArenaAlloc()");
+			return;
+		}
+		ret |= (uintptr_t)ptrs[i] % XT_ARENA_ALIGN_DEFAULT != 0;
+		memset(ptrs[i], i, i * 7 + 1);
+	}
+	// No allocation may overlap another one, even across chunks
+	for (unsigned i = 0; i < 64; ++i)
+		for (unsigned j = 0; j < i * 7 + 1; ++j)
+			ret |= ptrs[i][j] != i;
+	if (ret)
+		FAIL("xtArenaAlloc()");
+	else
+		PASS("xtArenaAlloc()");
+
+	ret = 0;
+	for (size_t align = 1; align <= 4096; align *= 2) {
+		void *ptr = xtArenaAllocAligned(arena, 3, align);
+		ret |= !ptr || (uintptr_t)ptr % align != 0;
+	}
+	ret |= xtArenaAllocAligned(arena, 3, 48) != NULL;
+	if (ret)
+		FAIL("xtArenaAllocAligned()");
+	else
+		PASS("xtArenaAllocAligned()");
+
+	// Bigger than a chunk, so it gets a mapped chunk of its own
+	unsigned char *big = xtArenaAlloc(arena, XT_ARENA_MMAP_THRESHOLD);
+	if (!big || xtArenaGetSize(arena) < XT_ARENA_MMAP_THRESHOLD + CHUNK_SIZE)
+		FAIL("xtArenaAlloc() - big");
+	else {
+		memset(big, 0xab, XT_ARENA_MMAP_THRESHOLD);
+		PASS("xtArenaAlloc() - big");
+	}
+}
+
+static void resize(struct xtArena *arena)
+{
+	char *ptr, *other, *grown;
+	ptr = xtArenaAlloc(arena, 16);
+	strcpy(ptr, "arena");
+	// The last allocation grows in place
+	if (!(grown = xtArenaRealloc(arena, ptr, 16, 256)) || grown != ptr)
+		FAIL("xtArenaRealloc() - in place");
+	else
+		PASS("xtArenaRealloc() - in place");
+	other = xtArenaAlloc(arena, 16);
+	if (!(grown = xtArenaRealloc(arena, ptr, 256, 512)) || grown == ptr || strcmp(grown, "arena") || grown == other)
+		FAIL("xtArenaRealloc() - copy");
+	else
+		PASS("xtArenaRealloc() - copy");
+	// Freeing the last allocation gives back its memory
+	ptr = arena->allocator.alloc(arena->allocator.arg, 64);
+	arena->allocator.free(arena->allocator.arg, ptr, 64);
+	if (xtArenaAlloc(arena, 64) != ptr)
+		FAIL("xtAllocator - free");
+	else
+		PASS("xtAllocator - free");
+}
+
+static void mark(struct xtArena *arena)
+{
+	struct xtArenaMark pos;
+	size_t size;
+	void *ptr;
+
+	xtArenaGetMark(arena, &pos);
+	size = xtArenaGetSize(arena);
+	ptr = xtArenaAlloc(arena, 8);
+	for (unsigned i = 0; i < 16; ++i)
+		xtArenaAlloc(arena, CHUNK_SIZE / 2);
+	xtArenaRewind(arena, &pos);
+	if (xtArenaGetSize(arena) != size || xtArenaAlloc(arena, 8) != ptr)
+		FAIL("xtArenaRewind()");
+	else
+		PASS("xtArenaRewind()");
+
+	xtArenaReset(arena);
+	if (xtArenaGetSize(arena) != CHUNK_SIZE)
+		FAIL("xtArenaReset()");
+	else
+		PASS("xtArenaReset()");
+}
+
+static void collections(struct xtArena *arena)
+{
+	static size_t keys[ITEMS];
+	const struct xtAllocator *allocator = &arena->allocator;
+	struct xtHashmap map;
+	struct xtListZU list;
+	struct xtStackU stack;
+	struct xtQueueU queue;
+	unsigned value;
+	size_t sum;
+	int ret = 0;
+
+	if (xtHashmapCreateAllocator(&map, 16, key_hash, key_compare, allocator)
+		|| xtListZUCreateAllocator(&list, 16, allocator)
+		|| xtStackUCreateAllocator(&stack, 16, allocator)
+		|| xtQueueUCreateAllocator(&queue, 16, allocator)) {
+		FAIL("xt*CreateAllocator()");
+		return;
+	}
+	for (size_t i = 0; i < ITEMS; ++i) {
+		keys[i] = i;
+		ret |= xtHashmapAdd(&map, &keys[i], &keys[i]);
+		ret |= xtListZUAdd(&list, i);
+		ret |= xtStackUPush(&stack, i);
+		ret |= xtQueueUPush(&queue, i);
+	}
+	for (size_t i = 0; i < ITEMS; ++i) {
+		void *found;
+		ret |= xtHashmapGetValue(&map, &keys[i], &found) || found != &keys[i];
+		ret |= xtListZUGet(&list, i, &sum) || sum != i;
+	}
+	sum = 0;
+	while (xtStackUPop(&stack, &value))
+		sum += value;
+	for (size_t i = 0; xtQueueUPop(&queue, &value); ++i)
+		ret |= value != i;
+	if (ret || sum != ITEMS * (ITEMS - 1) / 2)
+		FAIL("xt*CreateAllocator()");
+	else
+		PASS("xt*CreateAllocator()");
+	// Destroying is optional, resetting the arena releases everything
+	xtHashmapDestroy(&map);
+	xtArenaReset(arena);
+}
+
+/* Counts the bytes that are in use, so leaks and wrong sizes show up */
+struct counted {
+	struct xtArena *arena;
+	size_t used;
+};
+
+static void *counted_alloc(void *arg, size_t size)
+{
+	struct counted *c = arg;
+	c->used += size;
+	return xtArenaAlloc(c->arena, size);
+}
+
+static void *counted_realloc(void *arg, void *ptr, size_t oldSize, size_t size)
+{
+	struct counted *c = arg;
+	c->used += size - oldSize;
+	return xtArenaRealloc(c->arena, ptr, oldSize, size);
+}
+
+static void counted_free(void *arg, void *ptr, size_t size)
+{
+	struct counted *c = arg;
+	if (ptr)
+		c->used -= size;
+}
+
+static void arena_poll(struct xtArena *arena)
+{
+	struct counted c = {arena, 0};
+	const struct xtAllocator allocator = {counted_alloc, counted_realloc, counted_free, &c};
+	struct xtSocketPoll *p;
+	xtSocket sock;
+	int ret;
+	if (!xtSocketInit()) {
+		SKIP("xtSocketPollCreateAllocator()");
+		return;
+	}
+	if (xtSocketPollCreateAllocator(&p, 16, &allocator)) {
+		FAIL("xtSocketPollCreateAllocator()");
+		goto destruct;
+	}
+	if (xtSocketCreate(&sock, XT_SOCKET_PROTO_UDP)) {
+		SKIP("xtSocketPollCreateAllocator()");
+		xtSocketPollDestroy(&p);
+		goto destruct;
+	}
+	ret = !c.used || xtSocketPollAdd(p, sock, NULL, XT_POLLIN) || xtSocketPollGetCount(p) != 1;
+	xtSocketPollDestroy(&p);
+	if (ret || c.used)
+		FAIL("xtSocketPollCreateAllocator()");
+	else
+		PASS("xtSocketPollCreateAllocator()");
+	xtSocketClose(&sock);
+	xtArenaReset(arena);
+destruct:
+	xtSocketDestruct();
+}
+
+int main(void)
+{
+	struct xtArena arena;
+	stats_init(&stats, "arena");
+	puts("-- ARENA TEST");
+	create();
+	if (xtArenaCreate(&arena, CHUNK_SIZE, 0))
+		FAIL("xtArenaCreate() - small chunks");
+	else {
+		alloc(&arena);
+		resize(&arena);
+		mark(&arena);
+		collections(&arena);
+		arena_poll(&arena);
+		xtArenaDestroy(&arena);
+	}
+	stats_info(&stats);
+	return stats_status(&stats);
+}
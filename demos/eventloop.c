@@ -0,0 +1,248 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/error.h>
+#include <xt/eventloop.h>
+#include <xt/socket.h>
+#include <xt/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+#define LOOPS 2
+#define CLIENTS 8
+#define BIG_SIZE (1 << 20)
+
+static struct stats stats;
+static struct xtEventLoop loop;
+
+static unsigned accepted, closed, drained, wrongLoop, posted, ticks, once;
+static int postedLoops[LOOPS];
+static struct xtEventLoopTimer interval, oneshot;
+
+static unsigned get(const unsigned *counter)
+{
+	return __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+}
+
+static void inc(unsigned *counter)
+{
+	__atomic_add_fetch(counter, 1, __ATOMIC_RELEASE);
+}
+
+/* Waits up to a second for \a counter to reach \a value */
+static bool wait_for(const unsigned *counter, unsigned value)
+{
+	for (unsigned ms = 0; ms < 1000; ++ms) {
+		if (get(counter) >= value)
+			return true;
+		xtSleepMS(1);
+	}
+	return get(counter) >= value;
+}
+
+static void echo_data(struct xtEventLoopConn *conn, const void *buf, size_t len, void *arg)
+{
+	(void)arg;
+	xtEventLoopConnWrite(conn, buf, len);
+}
+
+static void echo_drain(struct xtEventLoopConn *conn, void *arg)
+{
+	(void)conn;
+	(void)arg;
+	inc(&drained);
+}
+
+static void echo_close(struct xtEventLoopConn *conn, int error, void *arg)
+{
+	(void)conn;
+	(void)error;
+	(void)arg;
+	inc(&closed);
+}
+
+static void echo_accept(struct xtEventLoopConn *conn, const struct xtSockaddr *peer, void *arg)
+{
+	static const struct xtEventLoopConnCallbacks cb = {echo_data, echo_drain, echo_close};
+	(void)peer;
+	(void)arg;
+	if (xtEventLoopGetCurrent(&loop) != (int)xtEventLoopConnGetIndex(conn))
+		inc(&wrongLoop);
+	// A small send buffer makes big echoes queue up
+	xtSocketSetSoSendBufferSize(xtEventLoopConnGetSocket(conn), 4096);
+	xtEventLoopConnSetCallbacks(conn, &cb, NULL);
+	inc(&accepted);
+}
+
+static int client_connect(xtSocket *sock, const struct xtSockaddr *sa, unsigned rcvbuf)
+{
+	int ret;
+	if ((ret = xtSocketCreate(sock, XT_SOCKET_PROTO_TCP)))
+		return ret;
+	if ((rcvbuf && (ret = xtSocketSetSoReceiveBufferSize(*sock, rcvbuf)))
+		|| (ret = xtSocketConnect(*sock, sa)))
+		xtSocketClose(sock);
+	return ret;
+}
+
+static bool read_exact(xtSocket sock, char *buf, size_t len)
+{
+	for (size_t pos = 0; pos < len;) {
+		uint16_t n;
+		if (xtSocketTCPRead(sock, buf + pos, len - pos > 65535 ? 65535 : len - pos, &n))
+			return false;
+		pos += n;
+	}
+	return true;
+}
+
+static bool write_all(xtSocket sock, const char *buf, size_t len)
+{
+	for (size_t pos = 0; pos < len;) {
+		uint16_t n;
+		if (xtSocketTCPWrite(sock, buf + pos, len - pos > 65535 ? 65535 : len - pos, &n))
+			return false;
+		pos += n;
+	}
+	return true;
+}
+
+static void echo(const struct xtSockaddr *sa)
+{
+	xtSocket socks[CLIENTS];
+	char msg[32], reply[32];
+	unsigned i, connected = 0;
+	int ret = 0;
+
+	for (; connected < CLIENTS; ++connected)
+		if (client_connect(&socks[connected], sa, connected ? 0 : 4096))
+			break;
+	for (i = 0; i < connected; ++i) {
+		size_t len = snprintf(msg, sizeof msg, "hello %u", i);
+		ret |= !write_all(socks[i], msg, len) || !read_exact(socks[i], reply, len) || memcmp(msg, reply, len);
+	}
+	if (connected < CLIENTS || ret || !wait_for(&accepted, CLIENTS) || get(&wrongLoop))
+		FAIL("xtEventLoopListen() - echo");
+	else
+		PASS("xtEventLoopListen() - echo");
+
+	// The socket buffers fill up, so the echo gets queued
+	char *big = malloc(BIG_SIZE), *back = malloc(BIG_SIZE);
+	if (!big || !back || !connected) {
+		SKIP("xtEventLoopConnWrite() - queued");
+	} else {
+		for (i = 0; i < BIG_SIZE; ++i)
+			big[i] = i * 7;
+		if (!write_all(socks[0], big, BIG_SIZE) || !read_exact(socks[0], back, BIG_SIZE)
+			|| memcmp(big, back, BIG_SIZE) || !wait_for(&drained, 1))
+			FAIL("xtEventLoopConnWrite() - queued");
+		else
+			PASS("xtEventLoopConnWrite() - queued");
+	}
+	free(back);
+	free(big);
+
+	// Leave one connection open for xtEventLoopDestroy()
+	for (i = 1; i < connected; ++i)
+		xtSocketClose(&socks[i]);
+	if (!wait_for(&closed, connected - 1))
+		FAIL("xtEventLoopConnCallbacks - close");
+	else
+		PASS("xtEventLoopConnCallbacks - close");
+}
+
+static void post_main(void *arg)
+{
+	postedLoops[(size_t)arg] = xtEventLoopGetCurrent(&loop);
+	inc(&posted);
+}
+
+static void interval_main(struct xtEventLoopTimer *timer, void *arg)
+{
+	(void)arg;
+	inc(&ticks);
+	if (get(&ticks) == 3)
+		xtEventLoopTimerStop(timer);
+}
+
+static void oneshot_main(struct xtEventLoopTimer *timer, void *arg)
+{
+	(void)timer;
+	(void)arg;
+	inc(&once);
+}
+
+static void timers_main(void *arg)
+{
+	(void)arg;
+	xtEventLoopTimerStart(&loop, &interval, 5, 5, interval_main, NULL);
+	xtEventLoopTimerStart(&loop, &oneshot, 20, 0, oneshot_main, NULL);
+}
+
+static void tasks(void)
+{
+	struct xtEventLoopTimer timer;
+	int ret = 0;
+	for (size_t i = 0; i < LOOPS; ++i)
+		ret |= xtEventLoopPost(&loop, i, post_main, (void*)i);
+	ret |= xtEventLoopPost(&loop, LOOPS, post_main, NULL) != XT_EINVAL;
+	if (ret || !wait_for(&posted, LOOPS) || postedLoops[0] != 0 || postedLoops[1] != 1 || xtEventLoopGetCurrent(&loop) != -1)
+		FAIL("xtEventLoopPost()");
+	else
+		PASS("xtEventLoopPost()");
+
+	memset(&timer, 0, sizeof timer);
+	if (xtEventLoopTimerStart(&loop, &timer, 1, 0, oneshot_main, NULL) != XT_EINVAL)
+		FAIL("xtEventLoopTimerStart() - no reactor");
+	else
+		PASS("xtEventLoopTimerStart() - no reactor");
+	if (xtEventLoopPost(&loop, 1, timers_main, NULL) || !wait_for(&ticks, 3) || !wait_for(&once, 1))
+		FAIL("xtEventLoopTimerStart()");
+	else {
+		// The interval timer has stopped itself
+		xtSleepMS(30);
+		if (get(&ticks) != 3 || get(&once) != 1)
+			FAIL("xtEventLoopTimerStop()");
+		else
+			PASS("xtEventLoopTimerStart()");
+	}
+	if (xtEventLoopTimerStop(&interval) != XT_EINVAL)
+		FAIL("xtEventLoopTimerStop() - no reactor");
+	else
+		PASS("xtEventLoopTimerStop() - no reactor");
+}
+
+int main(void)
+{
+	struct xtSockaddr sa;
+	stats_init(&stats, "eventloop");
+	puts("-- EVENTLOOP TEST");
+	if (!xtSocketInit()) {
+		FAIL("xtSocketInit()");
+		goto end;
+	}
+	if (xtEventLoopCreate(&loop, LOOPS, 64) || xtEventLoopGetCount(&loop) != LOOPS) {
+		FAIL("xtEventLoopCreate()");
+		goto destruct;
+	}
+	PASS("xtEventLoopCreate()");
+	if (!xtSockaddrFromString(&sa, "127.0.0.1", 0) || xtEventLoopListen(&loop, &sa, 16, echo_accept, NULL)) {
+		FAIL("xtEventLoopListen()");
+	} else {
+		PASS("xtEventLoopListen()");
+		echo(&sa);
+	}
+	tasks();
+	xtEventLoopDestroy(&loop);
+	if (get(&closed) != get(&accepted))
+		FAIL("xtEventLoopDestroy()");
+	else
+		PASS("xtEventLoopDestroy()");
+destruct:
+	xtSocketDestruct();
+end:
+	stats_info(&stats);
+	return stats_status(&stats);
+}
+
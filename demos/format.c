@@ -0,0 +1,263 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/error.h>
+#include <xt/os.h>
+#include <xt/string.h>
+#include <xt/time.h>
+
+#include <limits.h>
+#include <locale.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "utils.h"
+
+static struct stats stats;
+
+#define CMP_INT(fmt, val) cmp(fmt, xtsnprintf(buf, sizeof buf, fmt, val), snprintf(ref, sizeof ref, fmt, val))
+
+static char buf[256], ref[256];
+
+static void cmp(const char *fmt, int ret, int refret)
+{
+	char name[64];
+	snprintf(name, sizeof name, "xtsnprintf() - \"%s\"", fmt);
+	if (ret != refret || strcmp(buf, ref)) {
+		FAIL(name);
+		fprintf(stderr, "expected \"%s\" (%d), but got \"%s\" (%d)\n", ref, refret, buf, ret);
+	} else
+		PASS(name);
+}
+
+static void integers(void)
+{
+	CMP_INT("%d", 0);
+	CMP_INT("%d", INT_MIN);
+	CMP_INT("%d", INT_MAX);
+	CMP_INT("%+d", 42);
+	CMP_INT("% d", 42);
+	CMP_INT("%-8d|", -42);
+	CMP_INT("%08d", -42);
+	CMP_INT("%8.4d", -42);
+	CMP_INT("%.0d", 0);
+	CMP_INT("%u", UINT_MAX);
+	CMP_INT("%#x", 0xcafebabe);
+	CMP_INT("%#X", 0xcafebabe);
+	CMP_INT("%#x", 0);
+	CMP_INT("%#o", 8);
+	CMP_INT("%#.0o", 0);
+	CMP_INT("%#010x", 255);
+	CMP_INT("%hhd", 300);
+	CMP_INT("%hu", 70000);
+	CMP_INT("%ld", LONG_MIN);
+	CMP_INT("%lld", LLONG_MIN);
+	CMP_INT("%llu", ULLONG_MAX);
+	CMP_INT("%llo", ULLONG_MAX);
+	CMP_INT("%zu", (size_t)~0);
+}
+
+static void others(void)
+{
+	CMP_INT("%c|", 'x');
+	CMP_INT("%-3c|", 'x');
+	CMP_INT("%s", "hello");
+	CMP_INT("%10s|", "hello");
+	CMP_INT("%-10s|", "hello");
+	CMP_INT("%.3s", "hello");
+	CMP_INT("%e", 1e300);
+	CMP_INT("%.17g", 0.1);
+	CMP_INT("%+010.3f", -3.14159);
+	CMP_INT("%p", (void*)buf);
+	cmp("%*d|%-*d", xtsnprintf(buf, sizeof buf, "%*d|%-*d", 5, 1, 5, 2), snprintf(ref, sizeof ref, "%*d|%-*d", 5, 1, 5, 2));
+	cmp("%.*s", xtsnprintf(buf, sizeof buf, "%.*s", 2, "abc"), snprintf(ref, sizeof ref, "%.*s", 2, "abc"));
+	cmp("100%%", xtsnprintf(buf, sizeof buf, "100%%"), snprintf(ref, sizeof ref, "100%%"));
+}
+
+static void grouping_cmp(void)
+{
+	// ISO C has no ' flag, so these are not literals to keep -pedantic quiet
+	const char *fmtd = "%'d", *fmtw = "%'-14d|", *fmtu = "%'u", *fmtll = "%'lld";
+	cmp(fmtd, xtsnprintf(buf, sizeof buf, fmtd, -1234567), snprintf(ref, sizeof ref, fmtd, -1234567));
+	cmp(fmtw, xtsnprintf(buf, sizeof buf, fmtw, 1234567), snprintf(ref, sizeof ref, fmtw, 1234567));
+	cmp(fmtu, xtsnprintf(buf, sizeof buf, fmtu, UINT_MAX), snprintf(ref, sizeof ref, fmtu, UINT_MAX));
+	cmp(fmtll, xtsnprintf(buf, sizeof buf, fmtll, LLONG_MIN), snprintf(ref, sizeof ref, fmtll, LLONG_MIN));
+}
+
+static void grouping(void)
+{
+	grouping_cmp();
+	// The C locale has no thousands separator, so try one that does
+	if (!setlocale(LC_NUMERIC, "en_US.UTF-8")) {
+		SKIP("xtsnprintf() - grouping in en_US.UTF-8");
+		return;
+	}
+	grouping_cmp();
+	setlocale(LC_NUMERIC, "C");
+}
+
+static void truncation(void)
+{
+	char small[8];
+	int ret = xtsnprintf(small, sizeof small, "%s=%d", "value", 123456);
+	if (ret == 12 && !strcmp(small, "value=1"))
+		PASS("xtsnprintf() - truncation");
+	else
+		FAIL("xtsnprintf() - truncation");
+	int n = 0;
+	xtsnprintf(buf, sizeof buf, "abc%ndef", &n);
+	if (n == 3)
+		PASS("xtsnprintf() - %n");
+	else
+		FAIL("xtsnprintf() - %n");
+}
+
+static void compiled(void)
+{
+	struct xtFormat *fmt;
+	static const char *formats[] = {
+		"plain text", "%d|%5u|%-5x|", "100%% %s %c %%", "%q%d", "%*d|%.*s|", "%hhd %lld %.2f"
+	};
+	union xtFormatArg args[4];
+	int ret, refret;
+	if (xtFormatCreate(&fmt, "%1$d") == XT_EINVAL)
+		PASS("xtFormatCreate() - positional");
+	else
+		FAIL("xtFormatCreate() - positional");
+	for (unsigned i = 0; i < sizeof formats / sizeof formats[0]; ++i) {
+		if (xtFormatCreate(&fmt, formats[i])) {
+			FAIL("xtFormatCreate()");
+			continue;
+		}
+		switch (i) {
+		case 0:
+			ret = xtFormatRender(buf, sizeof buf, fmt);
+			refret = xtsnprintf(ref, sizeof ref, formats[i]);
+			break;
+		case 1:
+			ret = xtFormatRender(buf, sizeof buf, fmt, -1, 2u, 255u);
+			refret = xtsnprintf(ref, sizeof ref, formats[i], -1, 2u, 255u);
+			break;
+		case 2:
+			ret = xtFormatRender(buf, sizeof buf, fmt, "abc", 'x');
+			refret = xtsnprintf(ref, sizeof ref, formats[i], "abc", 'x');
+			break;
+		case 3:
+			ret = xtFormatRender(buf, sizeof buf, fmt, 7);
+			refret = xtsnprintf(ref, sizeof ref, formats[i], 7);
+			break;
+		case 4:
+			ret = xtFormatRender(buf, sizeof buf, fmt, -4, 1, 2, "abc");
+			refret = xtsnprintf(ref, sizeof ref, formats[i], -4, 1, 2, "abc");
+			break;
+		default:
+			ret = xtFormatRender(buf, sizeof buf, fmt, 300, -5LL, 3.14159);
+			refret = xtsnprintf(ref, sizeof ref, formats[i], 300, -5LL, 3.14159);
+			break;
+		}
+		cmp(formats[i], ret, refret);
+		xtFormatDestroy(&fmt);
+	}
+	// Argument array
+	xtFormatCreate(&fmt, "%*d|%hhu|%s");
+	args[0].i = 4;
+	args[1].i = 42;
+	args[2].u = 257;
+	args[3].p = "str";
+	ret = xtFormatRenderArgs(buf, sizeof buf, fmt, args, 4);
+	if (xtFormatGetArgCount(fmt) == 4 && ret == 10 && !strcmp(buf, "  42|1|str"))
+		PASS("xtFormatRenderArgs()");
+	else
+		FAIL("xtFormatRenderArgs()");
+	if (xtFormatRenderArgs(buf, sizeof buf, fmt, args, 3) < 0)
+		PASS("xtFormatRenderArgs() - too few arguments");
+	else
+		FAIL("xtFormatRenderArgs() - too few arguments");
+	xtFormatDestroy(&fmt);
+	for (unsigned i = 0; i < 2; ++i) {
+		XT_FORMAT_STATIC(sfmt, "[%s] %d");
+		static const struct xtFormat *first;
+		if (!i)
+			first = sfmt;
+		if (sfmt && sfmt == first && xtFormatRender(buf, sizeof buf, sfmt, "x", (int)i) == 5)
+			PASS("XT_FORMAT_STATIC");
+		else
+			FAIL("XT_FORMAT_STATIC");
+	}
+}
+
+#define BENCH_N 1000000
+
+static void bench(const char *name, int xt)
+{
+	struct xtTimestamp then, now;
+	char tbuf[64];
+	xtClockGetTime(&then, XT_CLOCK_MONOTONIC);
+	for (unsigned i = 0; i < BENCH_N; ++i) {
+		if (!strcmp(name, "int")) {
+			if (xt)
+				xtsnprintf(buf, sizeof buf, "%d %u %x", (int)i, i * 7, i);
+			else
+				snprintf(buf, sizeof buf, "%d %u %x", (int)i, i * 7, i);
+		} else if (!strcmp(name, "str")) {
+			if (xt)
+				xtsnprintf(buf, sizeof buf, "[%s] %-10s %5d", "INFO", "request", (int)i);
+			else
+				snprintf(buf, sizeof buf, "[%s] %-10s %5d", "INFO", "request", (int)i);
+		} else {
+			if (xt)
+				xtsnprintf(buf, sizeof buf, "%llu %.3f", (unsigned long long)i * 1000003, i * .5);
+			else
+				snprintf(buf, sizeof buf, "%llu %.3f", (unsigned long long)i * 1000003, i * .5);
+		}
+	}
+	xtClockGetTime(&now, XT_CLOCK_MONOTONIC);
+	xtFormatTimeDuration(tbuf, sizeof tbuf, "%G", &then, &now);
+	struct xtTimestamp diff;
+	xtTimestampDiff(&diff, &then, &now);
+	unsigned long long ns = diff.sec * 1000000000LLU + diff.nsec;
+	xtprintf("%-4s %-10s: %3llu ns/call (%s)\n", name, xt ? "xtsnprintf" : "snprintf", ns / BENCH_N, tbuf);
+}
+
+static void bench_log(bool compiled)
+{
+	struct xtTimestamp then, now, diff;
+	xtClockGetTime(&then, XT_CLOCK_MONOTONIC);
+	for (unsigned i = 0; i < BENCH_N; ++i) {
+		if (compiled) {
+			XT_FORMAT_STATIC(fmt, "%s [%-5s] %s:%u: request %llu took %u us\n");
+			xtFormatRender(buf, sizeof buf, fmt, "2018-01-01 12:00:00", "INFO", "socket.c", 120u, (unsigned long long)i, i & 0xffff);
+		} else
+			xtsnprintf(buf, sizeof buf, "%s [%-5s] %s:%u: request %llu took %u us\n", "2018-01-01 12:00:00", "INFO", "socket.c", 120u, (unsigned long long)i, i & 0xffff);
+	}
+	xtClockGetTime(&now, XT_CLOCK_MONOTONIC);
+	xtTimestampDiff(&diff, &then, &now);
+	unsigned long long ns = diff.sec * 1000000000LLU + diff.nsec;
+	xtprintf("log  %-10s: %3llu ns/call\n", compiled ? "xtFormat" : "xtsnprintf", ns / BENCH_N);
+}
+
+int main(void)
+{
+	stats_init(&stats, "format");
+	srand(time(NULL));
+	puts("-- FORMAT TEST");
+	integers();
+	others();
+	grouping();
+	truncation();
+	compiled();
+	xtConsoleFillLine("-");
+	puts("-- FORMAT BENCHMARK");
+	bench("int", 1);
+	bench("int", 0);
+	bench("str", 1);
+	bench("str", 0);
+	bench("mix", 1);
+	bench("mix", 0);
+	bench_log(false);
+	bench_log(true);
+	stats_info(&stats);
+	return stats_status(&stats);
+}
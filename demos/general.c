@@ -100,6 +100,94 @@ static void fileTest(void)
 	}
 }
 
+#define COPY_HOLE (8 << 20)
+
+static int copyProgress(unsigned long long copied, unsigned long long total, void *arg)
+{
+	unsigned long long *last = arg;
+	if (copied < last[0] || copied > total)
+		last[1] = 1;
+	if (copied == total)
+		++last[3];
+	last[0] = copied;
+	return last[2] != 0;
+}
+
+static bool copySame(FILE *a, FILE *b)
+{
+	char bufa[4096], bufb[4096];
+	size_t na, nb;
+	rewind(a);
+	rewind(b);
+	do {
+		na = fread(bufa, 1, sizeof bufa, a);
+		nb = fread(bufb, 1, sizeof bufb, b);
+		if (na != nb || memcmp(bufa, bufb, na))
+			return false;
+	} while (na);
+	return true;
+}
+
+static void fileCopyTest(void)
+{
+	FILE *src, *dst, *empty, *copy = NULL;
+	char srcPath[1024], dstPath[1024], emptyPath[1024];
+	unsigned long long last[4] = {0, 0, 0, 0};
+	struct xtFileInfo info;
+	if (xtFileTempFile(srcPath, sizeof srcPath, &src)) {
+		SKIP("xtFileCopyProgress()");
+		return;
+	}
+	if (xtFileTempFile(dstPath, sizeof dstPath, &dst)) {
+		SKIP("xtFileCopyProgress()");
+		goto close;
+	}
+	// A sparse file with data on both sides of a hole
+	fputs("head", src);
+	fseek(src, COPY_HOLE, SEEK_SET);
+	fputs("tail", src);
+	fflush(src);
+	if (xtFileCopyProgress(srcPath, dstPath, copyProgress, last) == 0
+		&& xtFileGetInfo(&info, dstPath) == 0 && info.size == COPY_HOLE + 4
+		&& last[0] == COPY_HOLE + 4 && !last[1] && last[3] == 1
+		&& (copy = fopen(dstPath, "rb")) && copySame(src, copy))
+		PASS("xtFileCopyProgress()");
+	else
+		FAIL("xtFileCopyProgress()");
+	if (copy)
+		fclose(copy);
+	last[0] = 0;
+	last[2] = 1;
+	if (xtFileCopyProgress(srcPath, dstPath, copyProgress, last) == XT_ECANCELED)
+		PASS("xtFileCopyProgress() - stop");
+	else
+		FAIL("xtFileCopyProgress() - stop");
+	// The destination is longer than the source
+	fseek(dst, 2 * COPY_HOLE, SEEK_SET);
+	fputs("garbage", dst);
+	fflush(dst);
+	if (xtFileCopyByHandle(src, dst) == 0 && copySame(src, dst))
+		PASS("xtFileCopyByHandle()");
+	else
+		FAIL("xtFileCopyByHandle()");
+	// An empty source takes another path, which must truncate as well
+	if (xtFileTempFile(emptyPath, sizeof emptyPath, &empty)) {
+		SKIP("xtFileCopyByHandle() - empty");
+	} else {
+		if (xtFileCopyByHandle(empty, dst) == 0 && xtFileGetInfo(&info, dstPath) == 0 && !info.size)
+			PASS("xtFileCopyByHandle() - empty");
+		else
+			FAIL("xtFileCopyByHandle() - empty");
+		fclose(empty);
+		xtFileRemove(emptyPath);
+	}
+	fclose(dst);
+	xtFileRemove(dstPath);
+close:
+	fclose(src);
+	xtFileRemove(srcPath);
+}
+
 static void osTest(void)
 {
 	char sbuf[256];
@@ -281,6 +369,55 @@ static void timeTest(void)
 		PASS("xtFormatTimePrecise()");
 	else
 		FAIL("xtFormatTimePrecise()");
+
+	struct xtTimestamp then, diff;
+	unsigned long long cycles = xtCycles(), ns;
+	xtClockGetTime(&then, XT_CLOCK_MONOTONIC);
+	xtSleepMS(50);
+	cycles = xtCycles() - cycles;
+	xtClockGetTime(&ts, XT_CLOCK_MONOTONIC);
+	// The first conversion calibrates, so do it after the measurement
+	cycles = xtCyclesToNs(cycles);
+	xtTimestampDiff(&diff, &then, &ts);
+	ns = diff.sec * 1000000000LLU + diff.nsec;
+	// Allow some slack for the time between both readings
+	if (cycles > ns * 95 / 100 && cycles < ns * 105 / 100)
+		PASS("xtCyclesToNs()");
+	else
+		FAIL("xtCyclesToNs()");
+	printf("Cycle counter: %s\n", xtCyclesIsTSC() ? "TSC" : "XT_CLOCK_MONOTONIC");
+}
+
+#define CLOCK_BENCH_N 1000000
+
+static void clockBench(void)
+{
+	static const char *names[] = {
+		"XT_CLOCK_MONOTONIC", "XT_CLOCK_MONOTONIC_COARSE", "XT_CLOCK_MONOTONIC_RAW",
+		"XT_CLOCK_REALTIME", "XT_CLOCK_REALTIME_COARSE", "XT_CLOCK_REALTIME_NOW"
+	};
+	struct xtTimestamp ts, then, now, diff;
+	volatile unsigned long long sink;
+	unsigned n;
+	xtConsoleFillLine("-");
+	puts("-- CLOCK BENCHMARK");
+	for (unsigned i = 0; i <= XT_CLOCK_REALTIME_NOW; ++i) {
+		// Getting the GMT offset is way too slow for a million samples
+		n = i == XT_CLOCK_REALTIME_NOW ? CLOCK_BENCH_N / 100 : CLOCK_BENCH_N;
+		xtClockGetTime(&then, XT_CLOCK_MONOTONIC);
+		for (unsigned j = 0; j < n; ++j)
+			xtClockGetTime(&ts, i);
+		xtClockGetTime(&now, XT_CLOCK_MONOTONIC);
+		xtTimestampDiff(&diff, &then, &now);
+		printf("%-25s: %llu ns/call\n", names[i], (diff.sec * 1000000000LLU + diff.nsec) / n);
+	}
+	xtClockGetTime(&then, XT_CLOCK_MONOTONIC);
+	for (unsigned j = 0; j < CLOCK_BENCH_N; ++j)
+		sink = xtCycles();
+	xtClockGetTime(&now, XT_CLOCK_MONOTONIC);
+	xtTimestampDiff(&diff, &then, &now);
+	(void)sink;
+	printf("%-25s: %llu ns/call\n", "xtCycles", (diff.sec * 1000000000LLU + diff.nsec) / CLOCK_BENCH_N);
 }
 
 static void socketTest(void)
@@ -359,6 +496,7 @@ int main(void)
 	xtConsoleFillLine("-");
 	puts("-- FILE TEST");
 	fileTest();
+	fileCopyTest();
 	xtConsoleFillLine("-");
 	puts("-- OS TEST");
 	osTest();
@@ -375,6 +513,7 @@ int main(void)
 	xtConsoleFillLine("-");
 	puts("-- TIME TEST");
 	timeTest();
+	clockBench();
 	xtConsoleFillLine("-");
 	puts("-- SOCKET TEST");
 	socketTest();
@@ -0,0 +1,185 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/error.h>
+#include <xt/histogram.h>
+#include <xt/string.h>
+#include <xt/time.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "utils.h"
+
+static struct stats stats;
+
+static bool near(unsigned long long value, unsigned long long expected)
+{
+	unsigned long long diff = value > expected ? value - expected : expected - value;
+	// Three significant digits
+	return diff * 1000 <= expected;
+}
+
+static void create(void)
+{
+	struct xtHistogram h;
+	if (xtHistogramCreate(&h, 0, 6) == XT_EINVAL)
+		PASS("xtHistogramCreate() - digits");
+	else
+		FAIL("xtHistogramCreate() - digits");
+	if (xtHistogramCreate(&h, 0, 0)) {
+		FAIL("xtHistogramCreate()");
+		return;
+	}
+	PASS("xtHistogramCreate()");
+	if (!xtHistogramGetCount(&h) && !xtHistogramGetPercentile(&h, 50) && !xtHistogramGetMean(&h))
+		PASS("xtHistogram - empty");
+	else
+		FAIL("xtHistogram - empty");
+	xtHistogramDestroy(&h);
+}
+
+static void percentiles(void)
+{
+	struct xtHistogram h;
+	bool good = true;
+	if (xtHistogramCreate(&h, 1000000000, 3)) {
+		FAIL("xtHistogramCreate()");
+		return;
+	}
+	for (unsigned long long i = 1; i <= 100000; ++i)
+		xtHistogramRecord(&h, i * 1000);
+	if (xtHistogramGetCount(&h) == 100000 && xtHistogramGetMin(&h) == 1000 && xtHistogramGetMax(&h) == 100000000)
+		PASS("xtHistogramRecord()");
+	else
+		FAIL("xtHistogramRecord()");
+	if (xtHistogramGetMean(&h) == 50000500.0)
+		PASS("xtHistogramGetMean()");
+	else
+		FAIL("xtHistogramGetMean()");
+	good &= near(xtHistogramGetPercentile(&h, 50), 50000000);
+	good &= near(xtHistogramGetPercentile(&h, 90), 90000000);
+	good &= near(xtHistogramGetPercentile(&h, 99), 99000000);
+	good &= near(xtHistogramGetPercentile(&h, 99.9), 99900000);
+	good &= xtHistogramGetPercentile(&h, 100) == 100000000;
+	good &= xtHistogramGetPercentile(&h, 0) == 1000;
+	if (good)
+		PASS("xtHistogramGetPercentile()");
+	else
+		FAIL("xtHistogramGetPercentile()");
+	// Values beyond the highest trackable value are clamped
+	xtHistogramRecordN(&h, 5000000000LLU, 100000);
+	if (xtHistogramGetMax(&h) == 5000000000LLU && xtHistogramGetPercentile(&h, 75) >= 1000000000)
+		PASS("xtHistogramRecordN() - clamped");
+	else
+		FAIL("xtHistogramRecordN() - clamped");
+	xtHistogramReset(&h);
+	if (!xtHistogramGetCount(&h) && !xtHistogramGetPercentile(&h, 50))
+		PASS("xtHistogramReset()");
+	else
+		FAIL("xtHistogramReset()");
+	xtHistogramDestroy(&h);
+}
+
+static void merge(void)
+{
+	struct xtHistogram a, b, c;
+	if (xtHistogramCreate(&a, 0, 2)) {
+		FAIL("xtHistogramCreate()");
+		return;
+	}
+	if (xtHistogramCreate(&b, 0, 2)) {
+		FAIL("xtHistogramCreate()");
+		goto destroy_a;
+	}
+	if (xtHistogramCreate(&c, 0, 3)) {
+		FAIL("xtHistogramCreate()");
+		goto destroy_b;
+	}
+	for (unsigned i = 0; i < 100; ++i) {
+		xtHistogramRecord(&a, 10);
+		xtHistogramRecord(&b, 1000);
+	}
+	if (!xtHistogramMerge(&a, &b) && xtHistogramGetCount(&a) == 200
+		&& xtHistogramGetMin(&a) == 10 && xtHistogramGetMax(&a) == 1000
+		&& xtHistogramGetPercentile(&a, 50) == 10 && xtHistogramGetPercentile(&a, 51) == 1000)
+		PASS("xtHistogramMerge()");
+	else
+		FAIL("xtHistogramMerge()");
+	if (xtHistogramMerge(&a, &c) == XT_EINVAL)
+		PASS("xtHistogramMerge() - digits");
+	else
+		FAIL("xtHistogramMerge() - digits");
+	xtHistogramDestroy(&c);
+destroy_b:
+	xtHistogramDestroy(&b);
+destroy_a:
+	xtHistogramDestroy(&a);
+}
+
+static void format(void)
+{
+	struct xtHistogram h;
+	char buf[128];
+	if (xtHistogramCreate(&h, 0, 3)) {
+		FAIL("xtHistogramCreate()");
+		return;
+	}
+	xtHistogramRecord(&h, 850);
+	xtHistogramRecord(&h, 12300);
+	xtHistogramRecord(&h, 4560000);
+	xtHistogramRecord(&h, 1200000000);
+	if (xtHistogramFormat(buf, sizeof buf, "n=%c min=%m max=%M 100%%", &h) && !strcmp(buf, "n=4 min=850ns max=1.20s 100%"))
+		PASS("xtHistogramFormat()");
+	else
+		FAIL("xtHistogramFormat()");
+	if (xtHistogramFormat(buf, sizeof buf, "%p50|%p75.0", &h) && !strcmp(buf, "12.30us|4.56ms"))
+		PASS("xtHistogramFormat() - percentiles");
+	else
+		FAIL("xtHistogramFormat() - percentiles");
+	if (!xtHistogramFormat(buf, 8, "min=%m max=%M", &h) && !xtHistogramFormat(buf, sizeof buf, "%x", &h))
+		PASS("xtHistogramFormat() - failure");
+	else
+		FAIL("xtHistogramFormat() - failure");
+	xtHistogramDestroy(&h);
+}
+
+#define BENCH_N 10000000
+
+static void bench(void)
+{
+	struct xtHistogram h;
+	struct xtTimestamp then, now, diff;
+	char buf[128];
+	unsigned long long start;
+	if (xtHistogramCreate(&h, 0, 0))
+		return;
+	xtClockGetTime(&then, XT_CLOCK_MONOTONIC);
+	for (unsigned i = 0; i < BENCH_N; ++i)
+		xtHistogramRecord(&h, i * 2654435761LLU % 100000000);
+	xtClockGetTime(&now, XT_CLOCK_MONOTONIC);
+	xtTimestampDiff(&diff, &then, &now);
+	xtprintf("xtHistogramRecord: %.2f ns/call\n", (diff.sec * 1000000000.0 + diff.nsec) / BENCH_N);
+	xtHistogramReset(&h);
+	// Measure the cost of instrumenting with the cycle counter
+	for (unsigned i = 0; i < BENCH_N / 10; ++i) {
+		start = xtCycles();
+		xtHistogramRecord(&h, xtCycles() - start);
+	}
+	xtHistogramFormat(buf, sizeof buf, "min=%m p50=%p50 p99=%p99 p99.9=%p99.9 max=%M", &h);
+	xtprintf("xtCycles delta (cycles as ns): %s\n", buf);
+	xtHistogramDestroy(&h);
+}
+
+int main(void)
+{
+	stats_init(&stats, "histogram");
+	puts("-- HISTOGRAM TEST");
+	create();
+	percentiles();
+	merge();
+	format();
+	puts("-- HISTOGRAM BENCHMARK");
+	bench();
+	stats_info(&stats);
+	return stats_status(&stats);
+}
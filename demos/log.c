@@ -0,0 +1,191 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/error.h>
+#include <xt/log.h>
+#include <xt/string.h>
+#include <xt/thread.h>
+#include <xt/time.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "utils.h"
+
+static struct stats stats;
+
+#define THREADS 4
+#define THREAD_MESSAGES 1000
+
+static char line[1024];
+
+static unsigned count_lines(FILE *f, const char *needle)
+{
+	unsigned n = 0;
+	rewind(f);
+	while (fgets(line, sizeof line, f))
+		if (strstr(line, needle))
+			++n;
+	return n;
+}
+
+static FILE *start(enum xtLogLevel level, size_t ringSize)
+{
+	FILE *f = tmpfile();
+	if (!f || xtLogStart(f, level, ringSize)) {
+		FAIL("xtLogStart()");
+		if (f)
+			fclose(f);
+		return NULL;
+	}
+	return f;
+}
+
+static void stop(FILE *f)
+{
+	xtLogStop();
+	fclose(f);
+}
+
+static void basic(void)
+{
+	char str[16];
+	FILE *f = start(XT_LOG_INFO, 0);
+	if (!f)
+		return;
+	strcpy(str, "original");
+	xtLogInfo("hello %s %d %5.2f|%-4c|", str, -42, 3.14159, 'x');
+	// Strings are copied, so this must not show up
+	strcpy(str, "modified");
+	xtLogDebug("filtered");
+	xtLog((enum xtLogLevel)(XT_LOG_FATAL + 1), "invalid");
+	xtLogError("error %s", "message");
+	xtLogFlush();
+	rewind(f);
+	if (fgets(line, sizeof line, f) && strstr(line, " INFO  hello original -42  3.14|x   |\n"))
+		PASS("xtLogInfo()");
+	else
+		FAIL("xtLogInfo()");
+	if (!count_lines(f, "filtered"))
+		PASS("xtLogSetLevel()");
+	else
+		FAIL("xtLogSetLevel()");
+	if (!count_lines(f, "invalid"))
+		PASS("xtLog() - invalid level");
+	else
+		FAIL("xtLog() - invalid level");
+	if (count_lines(f, " ERROR error message") == 1)
+		PASS("xtLogError()");
+	else
+		FAIL("xtLogError()");
+	if (xtLogStart(f, XT_LOG_INFO, 0) == XT_EALREADY)
+		PASS("xtLogStart() - already running");
+	else
+		FAIL("xtLogStart() - already running");
+	stop(f);
+}
+
+static void *worker(struct xtThread *t, void *arg)
+{
+	(void)t;
+	for (unsigned i = 0; i < THREAD_MESSAGES; ++i)
+		xtLogInfo("thread %u message %u", (unsigned)(size_t)arg, i);
+	xtLogThreadDetach();
+	return NULL;
+}
+
+static void threads(void)
+{
+	struct xtThread t[THREADS];
+	unsigned i;
+	FILE *f = start(XT_LOG_TRACE, 1 << 20);
+	if (!f)
+		return;
+	for (i = 0; i < THREADS; ++i)
+		if (xtThreadCreate(&t[i], worker, (void*)(size_t)i, 0, 0)) {
+			FAIL("xtThreadCreate()");
+			break;
+		}
+	while (i)
+		xtThreadJoin(&t[--i], NULL);
+	xtLogFlush();
+	if (count_lines(f, " message ") == THREADS * THREAD_MESSAGES)
+		PASS("xtLog() - threads");
+	else
+		FAIL("xtLog() - threads");
+	stop(f);
+}
+
+static void limits(void)
+{
+	FILE *f = start(XT_LOG_TRACE, 4096);
+	if (!f)
+		return;
+	// A small ring must drop messages when it is flooded
+	for (unsigned i = 0; i < 10000; ++i)
+		xtLogInfo("flood %u %s", i, "0123456789abcdef0123456789abcdef");
+	xtLogFlush();
+	if (count_lines(f, "messages dropped"))
+		PASS("xtLog() - dropped");
+	else
+		FAIL("xtLog() - dropped");
+	stop(f);
+	if (!(f = start(XT_LOG_TRACE, 0)))
+		return;
+	xtLogSetRateLimit(10);
+	for (unsigned i = 0; i < 100; ++i)
+		xtLogInfo("limited %u", i);
+	xtLogSetRateLimit(0);
+	xtLogFlush();
+	if (count_lines(f, "limited") <= 20 && count_lines(f, "messages suppressed"))
+		PASS("xtLogSetRateLimit()");
+	else
+		FAIL("xtLogSetRateLimit()");
+	stop(f);
+}
+
+#define BENCH_BURSTS 50
+#define BENCH_BURST 4096
+
+/*
+ * Every burst fits in the ring and is written before the next one starts, so
+ * only the caller side is timed and nothing is dropped.
+ */
+static void bench(void)
+{
+	struct xtTimestamp then, now, diff;
+	unsigned long long ns = 0;
+	FILE *f = start(XT_LOG_INFO, 1 << 20);
+	if (!f)
+		return;
+	// The first call allocates and touches the ring of this thread
+	xtLogInfo("warmup");
+	xtLogFlush();
+	for (unsigned i = 0; i < BENCH_BURSTS; ++i) {
+		xtClockGetTime(&then, XT_CLOCK_MONOTONIC);
+		for (unsigned j = 0; j < BENCH_BURST; ++j)
+			xtLogInfo("request %u from %s took %u us", j, "127.0.0.1", j & 0xfff);
+		xtClockGetTime(&now, XT_CLOCK_MONOTONIC);
+		xtTimestampDiff(&diff, &then, &now);
+		ns += diff.sec * 1000000000LLU + diff.nsec;
+		xtLogFlush();
+	}
+	xtprintf("xtLogInfo: %llu ns/call\n", ns / (BENCH_BURSTS * BENCH_BURST));
+	if (!count_lines(f, "messages dropped"))
+		PASS("xtLogInfo() - benchmark");
+	else
+		FAIL("xtLogInfo() - benchmark");
+	stop(f);
+}
+
+int main(void)
+{
+	stats_init(&stats, "log");
+	puts("-- LOG TEST");
+	basic();
+	threads();
+	limits();
+	puts("-- LOG BENCHMARK");
+	bench();
+	stats_info(&stats);
+	return stats_status(&stats);
+}
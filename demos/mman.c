@@ -1,8 +1,12 @@
 /* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
 
+// os_macros.h must be first in order to make it work
+#include <xt/os_macros.h>
+#include <xt/error.h>
 #include <xt/file.h>
 #include <xt/mman.h>
 #include <xt/string.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -99,6 +103,153 @@ fail:
 		xtmunmap(map, size);
 }
 
+static void mapped_file(void)
+{
+	struct xtMappedFile mf;
+	char path[256];
+	unsigned char *data;
+	int ret;
+
+	if (xtFileGetTempDir(path, sizeof path - 16)) {
+		SKIP("xtMappedFileOpen()");
+		return;
+	}
+	strcat(path, "/mapped_test");
+	if (xtMappedFileOpen(&mf, path, 3 * PAGE_SIZE, XT_MAPPED_FILE_WRITE | XT_MAPPED_FILE_CREATE)) {
+		FAIL("xtMappedFileOpen() - create");
+		return;
+	}
+	PASS("xtMappedFileOpen() - create");
+	data = mf.data;
+	for (size_t i = 0; i < mf.size; ++i)
+		data[i] = i % 251;
+
+	/* Grow the file, the old contents must be preserved */
+	if (xtMappedFileResize(&mf, PAGE_ALLOC_SIZE) || mf.size != PAGE_ALLOC_SIZE) {
+		FAIL("xtMappedFileResize() - grow");
+		goto close;
+	}
+	data = mf.data;
+	ret = 0;
+	for (size_t i = 0; i < 3 * PAGE_SIZE; ++i)
+		ret |= data[i] != i % 251;
+	for (size_t i = 3 * PAGE_SIZE; i < mf.size; ++i)
+		ret |= data[i] != 0;
+	if (ret)
+		FAIL("xtMappedFileResize() - grow");
+	else
+		PASS("xtMappedFileResize() - grow");
+	memset(data + 3 * PAGE_SIZE, 0xab, mf.size - 3 * PAGE_SIZE);
+
+	ret = 0;
+	for (unsigned i = XT_MAPPED_FILE_NORMAL; i <= XT_MAPPED_FILE_WILLNEED; ++i)
+		ret |= xtMappedFileAdvise(&mf, 100, PAGE_SIZE, i);
+	if (ret)
+		FAIL("xtMappedFileAdvise()");
+	else
+		PASS("xtMappedFileAdvise()");
+	if (xtMappedFilePrefault(&mf, 0, 0) == 0 && xtMappedFileSync(&mf, true) == 0)
+		PASS("xtMappedFilePrefault() & xtMappedFileSync()");
+	else
+		FAIL("xtMappedFilePrefault() & xtMappedFileSync()");
+	/* Dropped pages of a shared mapping are read back from the file */
+	if (xtMappedFileAdvise(&mf, 0, 0, XT_MAPPED_FILE_DONTNEED) || data[5] != 5 || data[mf.size - 1] != 0xab)
+		FAIL("xtMappedFileAdvise() - dontneed");
+	else
+		PASS("xtMappedFileAdvise() - dontneed");
+
+	if (xtMappedFileResize(&mf, 2 * PAGE_SIZE) || xtMappedFileClose(&mf)) {
+		FAIL("xtMappedFileResize() - shrink");
+		goto remove;
+	}
+	if (xtMappedFileOpen(&mf, path, 0, XT_MAPPED_FILE_POPULATE)) {
+		FAIL("xtMappedFileOpen() - read only");
+		goto remove;
+	}
+	data = mf.data;
+	if (mf.size != 2 * PAGE_SIZE || data[2 * PAGE_SIZE - 1] != (2 * PAGE_SIZE - 1) % 251)
+		FAIL("xtMappedFileOpen() - read only");
+	else
+		PASS("xtMappedFileOpen() - read only");
+	if (xtMappedFileResize(&mf, 4 * PAGE_SIZE) == XT_EINVAL)
+		PASS("xtMappedFileResize() - past end of read only file");
+	else
+		FAIL("xtMappedFileResize() - past end of read only file");
+	xtMappedFileClose(&mf);
+	if (xtMappedFileOpen(&mf, path, 4 * PAGE_SIZE, 0) == XT_EINVAL)
+		PASS("xtMappedFileOpen() - past end of read only file");
+	else
+		FAIL("xtMappedFileOpen() - past end of read only file");
+
+	/* Empty files are not mapped at all */
+	if (xtMappedFileOpen(&mf, path, 0, XT_MAPPED_FILE_WRITE)
+		|| xtMappedFileResize(&mf, 0) || mf.data || mf.size
+		|| xtMappedFileResize(&mf, PAGE_SIZE) || !mf.data
+		|| xtMappedFilePrefault(&mf, 0, 0))
+		FAIL("xtMappedFileResize() - empty");
+	else
+		PASS("xtMappedFileResize() - empty");
+close:
+	xtMappedFileClose(&mf);
+remove:
+	xtFileRemove(path);
+}
+
+static void huge_pages(void)
+{
+	size_t size = 3 * PAGE_ALLOC_SIZE;
+	unsigned char *map;
+	int ret;
+
+	map = xtmmap(NULL, size, XT_MMAN_PROT_READ | XT_MMAN_PROT_WRITE,
+		XT_MMAN_MAP_ANONYMOUS | XT_MMAN_MAP_PRIVATE | XT_MMAN_MAP_POPULATE | XT_MMAN_MAP_NORESERVE, -1, 0);
+	if (map == XT_MMAN_MAP_FAILED) {
+		FAIL("xtmmap() - populate");
+		return;
+	}
+	PASS("xtmmap() - populate");
+	ret = 0;
+	for (int i = XT_MMAN_MADV_NORMAL; i <= XT_MMAN_MADV_NOHUGEPAGE; ++i)
+		ret |= xtmadvise(map, size, i);
+	if (ret)
+		FAIL("xtmadvise()");
+	else
+		PASS("xtmadvise()");
+	if (xtmadvise(map, size, XT_MMAN_MADV_NOHUGEPAGE + 1) == -1)
+		PASS("xtmadvise() - invalid advice");
+	else
+		FAIL("xtmadvise() - invalid advice");
+	xtmunmap(map, size);
+
+	/* Must work even if no huge pages have been reserved */
+	size = 5 * 1024 * 1024 + 123;
+	map = xtHugeAlloc(size);
+	if (!map) {
+		FAIL("xtHugeAlloc()");
+		return;
+	}
+	ret = 0;
+	for (size_t i = 0; i < size; i += PAGE_SIZE)
+		ret |= map[i];
+	memset(map, 0xcd, size);
+	ret |= map[size - 1] != 0xcd;
+#if XT_IS_LINUX
+	ret |= (uintptr_t)map % (2 * 1024 * 1024) != 0;
+#endif
+	if (ret)
+		FAIL("xtHugeAlloc()");
+	else
+		PASS("xtHugeAlloc()");
+	xtHugeFree(map, size);
+#if XT_IS_LINUX
+	// The whole mapping must be gone, which fails for unmapped memory
+	if (xtmsync(map, PAGE_SIZE, XT_MMAN_MS_ASYNC) == -1)
+		PASS("xtHugeFree()");
+	else
+		FAIL("xtHugeFree()");
+#endif
+}
+
 int main(int argc, char **argv)
 {
 	stats_init(&stats, "mman");
@@ -110,6 +261,8 @@ int main(int argc, char **argv)
 		map_self(argv[0]);
 	simulate_page_alloc();
 	simulate_page_resize();
+	mapped_file();
+	huge_pages();
 
 	stats_info(&stats);
 	return stats_status(&stats);
@@ -0,0 +1,197 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+// os_macros.h must be first in order to make it work
+#include <xt/os_macros.h>
+#include <xt/error.h>
+#include <xt/socket.h>
+#include <stdio.h>
+#include "utils.h"
+
+#define CHURN 64
+
+static struct stats stats;
+
+static int udp_bound(xtSocket *sock, struct xtSockaddr *sa)
+{
+	int ret;
+	if ((ret = xtSocketCreate(sock, XT_SOCKET_PROTO_UDP)))
+		return ret;
+	if (!xtSockaddrFromString(sa, "127.0.0.1", 0)
+		|| (ret = xtSocketBindTo(*sock, sa))
+		|| (ret = xtSocketGetLocalSocketAddress(*sock, sa))) {
+		xtSocketClose(sock);
+		return ret ? ret : XT_EINVAL;
+	}
+	return 0;
+}
+
+static size_t wait_ready(struct xtSocketPoll *p)
+{
+	size_t ready;
+	if (xtSocketPollWait(p, 0, &ready))
+		return (size_t)-1;
+	return ready;
+}
+
+static void events(struct xtSocketPoll *p, xtSocket sock, xtSocket sender, const struct xtSockaddr *sa)
+{
+	static int tag;
+	uint16_t n;
+	char buf[4];
+
+	if (xtSocketPollAdd(p, sock, &tag, XT_POLLIN) || xtSocketPollGetCount(p) != 1) {
+		FAIL("xtSocketPollAdd()");
+		return;
+	}
+	PASS("xtSocketPollAdd()");
+	if (xtSocketPollAdd(p, sock, &tag, XT_POLLIN) == XT_EEXIST)
+		PASS("xtSocketPollAdd() - twice");
+	else
+		FAIL("xtSocketPollAdd() - twice");
+
+	xtSocketUDPWrite(sender, "poll", 4, &n, sa);
+	// Level triggered, the datagram is reported until it is read
+	if (wait_ready(p) != 1 || xtSocketPollGetReadySocket(p, 0) != sock
+		|| xtSocketPollGetReadyData(p, 0) != &tag || !(xtSocketPollGetReadyEvent(p, 0) & XT_POLLIN)
+		|| wait_ready(p) != 1)
+		FAIL("xtSocketPollWait()");
+	else
+		PASS("xtSocketPollWait()");
+
+	if (xtSocketPollMod(p, sock, XT_POLLIN | XT_POLLET) || wait_ready(p) != 1 || wait_ready(p) != 0)
+		FAIL("xtSocketPollMod() - XT_POLLET");
+	else
+		PASS("xtSocketPollMod() - XT_POLLET");
+
+	if (xtSocketPollMod(p, sock, XT_POLLIN | XT_POLLONESHOT) || wait_ready(p) != 1 || wait_ready(p) != 0)
+		FAIL("xtSocketPollMod() - XT_POLLONESHOT");
+	else if (xtSocketPollMod(p, sock, XT_POLLIN | XT_POLLONESHOT) || wait_ready(p) != 1)
+		FAIL("xtSocketPollMod() - rearm");
+	else
+		PASS("xtSocketPollMod() - XT_POLLONESHOT");
+	xtSocketUDPRead(sock, buf, sizeof buf, &n, NULL);
+
+	if (xtSocketPollRemove(p, sock) || xtSocketPollGetCount(p) != 0)
+		FAIL("xtSocketPollRemove()");
+	else
+		PASS("xtSocketPollRemove()");
+	if (xtSocketPollRemove(p, sock) == XT_ENOENT && xtSocketPollMod(p, sock, XT_POLLIN) == XT_EINVAL)
+		PASS("xtSocketPollRemove() - twice");
+	else
+		FAIL("xtSocketPollRemove() - twice");
+
+	// Sockets with exclusive wakeups cannot be modified
+	if (xtSocketPollAdd(p, sock, NULL, XT_POLLIN | XT_POLLEXCLUSIVE)
+		|| !xtSocketPollMod(p, sock, XT_POLLIN)
+		|| xtSocketPollRemove(p, sock))
+		FAIL("xtSocketPollAdd() - XT_POLLEXCLUSIVE");
+	else
+		PASS("xtSocketPollAdd() - XT_POLLEXCLUSIVE");
+	// Exclusive wakeups do not support EPOLLRDHUP, so XT_POLLHUP must not ask for it
+	if (xtSocketPollAdd(p, sock, NULL, XT_POLLIN | XT_POLLHUP | XT_POLLEXCLUSIVE)
+		|| xtSocketPollRemove(p, sock))
+		FAIL("xtSocketPollAdd() - XT_POLLHUP | XT_POLLEXCLUSIVE");
+	else
+		PASS("xtSocketPollAdd() - XT_POLLHUP | XT_POLLEXCLUSIVE");
+}
+
+static void churn(void)
+{
+	struct xtSocketPoll *p;
+	xtSocket socks[CHURN], extra;
+	struct xtSockaddr sa;
+	unsigned opened = 0;
+	int ret = 0;
+
+	if (xtSocketPollCreate(&p, CHURN)) {
+		FAIL("xtSocketPollCreate() - churn");
+		return;
+	}
+	for (; opened < CHURN; ++opened)
+		if (udp_bound(&socks[opened], &sa))
+			break;
+	if (opened < CHURN || xtSocketCreate(&extra, XT_SOCKET_PROTO_UDP)) {
+		SKIP("xtSocketPollAdd() - churn");
+		goto close;
+	}
+	for (unsigned i = 0; i < CHURN; ++i)
+		ret |= xtSocketPollAdd(p, socks[i], &socks[i], XT_POLLIN);
+	ret |= xtSocketPollAdd(p, extra, NULL, XT_POLLIN) != XT_ENOBUFS;
+	// Free every other slot and fill the holes again
+	for (unsigned round = 0; round < 8; ++round) {
+		for (unsigned i = round % 2; i < CHURN; i += 2)
+			ret |= xtSocketPollRemove(p, socks[i]);
+		ret |= xtSocketPollGetCount(p) != CHURN / 2;
+		for (unsigned i = round % 2; i < CHURN; i += 2)
+			ret |= xtSocketPollAdd(p, socks[i], &socks[i], XT_POLLIN);
+	}
+	ret |= xtSocketPollGetCount(p) != CHURN;
+	for (size_t i = 0; i < CHURN; ++i)
+		ret |= xtSocketPollGetData(p, i) != NULL
+			&& *(xtSocket*)xtSocketPollGetData(p, i) != xtSocketPollGetSocket(p, i);
+	if (ret)
+		FAIL("xtSocketPollAdd() - churn");
+	else
+		PASS("xtSocketPollAdd() - churn");
+
+#if XT_IS_LINUX
+	// A closed socket leaves the poll, so its descriptor may be added again
+	xtSocketClose(&socks[0]);
+	if (udp_bound(&socks[0], &sa)) {
+		SKIP("xtSocketPollAdd() - reused descriptor");
+	} else if (xtSocketPollAdd(p, socks[0], &socks[0], XT_POLLIN) || xtSocketPollGetCount(p) != CHURN
+		|| xtSocketPollRemove(p, socks[0]) || xtSocketPollGetCount(p) != CHURN - 1)
+		FAIL("xtSocketPollAdd() - reused descriptor");
+	else
+		PASS("xtSocketPollAdd() - reused descriptor");
+#endif
+	xtSocketClose(&extra);
+close:
+	while (opened)
+		xtSocketClose(&socks[--opened]);
+	xtSocketPollDestroy(&p);
+}
+
+int main(void)
+{
+	struct xtSocketPoll *p;
+	struct xtSockaddr sa, other;
+	xtSocket sock, sender;
+	stats_init(&stats, "poll");
+	puts("-- POLL TEST");
+	if (!xtSocketInit()) {
+		FAIL("xtSocketInit()");
+		goto end;
+	}
+	if (xtSocketPollCreate(&p, 16)) {
+		FAIL("xtSocketPollCreate()");
+		goto destruct;
+	}
+	PASS("xtSocketPollCreate()");
+	if (udp_bound(&sock, &sa)) {
+		FAIL("xtSocketCreate()");
+		goto destroy;
+	}
+	if (udp_bound(&sender, &other)) {
+		FAIL("xtSocketCreate()");
+		goto close;
+	}
+#if XT_IS_LINUX
+	events(p, sock, sender, &sa);
+#else
+	// Windows ignores the poll options
+	(void)events;
+	SKIP("xtSocketPollMod() - XT_POLLET");
+#endif
+	churn();
+	xtSocketClose(&sender);
+close:
+	xtSocketClose(&sock);
+destroy:
+	xtSocketPollDestroy(&p);
+destruct:
+	xtSocketDestruct();
+end:
+	stats_info(&stats);
+	return stats_status(&stats);
+}
@@ -0,0 +1,193 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#include <xt/error.h>
+#include <xt/pool.h>
+#include <xt/proc.h>
+#include <xt/thread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "utils.h"
+
+#define OBJECT_SIZE 48
+#define OBJECTS 1000
+#define THREADS 4
+#define ROUNDS 2000
+#define BATCH 100
+
+static struct stats stats;
+
+struct worker {
+	struct xtPool *pool;
+	void **objs;
+	unsigned id;
+	int ret;
+};
+
+static void single(struct xtPool *pool)
+{
+	static unsigned char *objs[OBJECTS];
+	struct xtPoolStats st;
+	size_t objects;
+	int ret = 0;
+
+	for (unsigned i = 0; i < OBJECTS; ++i) {
+		if (!(objs[i] = xtPoolAlloc(pool))) {
+			FAIL("xtPoolAlloc()");
+			return;
+		}
+		ret |= (uintptr_t)objs[i] % 16 != 0;
+		memset(objs[i], i, OBJECT_SIZE);
+	}
+	for (unsigned i = 0; i < OBJECTS; ++i)
+		for (unsigned j = 0; j < OBJECT_SIZE; ++j)
+			ret |= objs[i][j] != (unsigned char)i;
+	if (ret)
+		FAIL("xtPoolAlloc()");
+	else
+		PASS("xtPoolAlloc()");
+
+	for (unsigned i = 0; i < OBJECTS; ++i)
+		xtPoolFree(pool, objs[i]);
+	xtPoolFree(pool, NULL);
+	xtPoolGetStats(pool, &st);
+	objects = st.objects;
+	if (strcmp(st.name, "demo") || st.objectSize != OBJECT_SIZE || st.inUse
+		|| st.allocs != OBJECTS || st.frees != OBJECTS || st.objects < OBJECTS)
+		FAIL("xtPoolGetStats()");
+	else
+		PASS("xtPoolGetStats()");
+
+	// Freed objects are recycled
+	for (unsigned i = 0; i < OBJECTS; ++i)
+		objs[i] = xtPoolAlloc(pool);
+	for (unsigned i = 0; i < OBJECTS; ++i)
+		xtPoolFree(pool, objs[i]);
+	xtPoolGetStats(pool, &st);
+	if (st.objects != objects || st.inUse)
+		FAIL("xtPoolFree()");
+	else
+		PASS("xtPoolFree()");
+}
+
+static void *worker_main(struct xtThread *t, void *arg)
+{
+	struct worker *w = arg;
+	unsigned *objs[BATCH];
+	(void)t;
+	for (unsigned round = 0; round < ROUNDS; ++round) {
+		for (unsigned i = 0; i < BATCH; ++i) {
+			if (!(objs[i] = xtPoolAlloc(w->pool))) {
+				w->ret = 1;
+				return NULL;
+			}
+			objs[i][0] = w->id;
+			objs[i][1] = i;
+		}
+		for (unsigned i = 0; i < BATCH; ++i) {
+			w->ret |= objs[i][0] != w->id || objs[i][1] != i;
+			xtPoolFree(w->pool, objs[i]);
+		}
+	}
+	// Free the objects that another thread has allocated
+	if (w->objs)
+		for (unsigned i = 0; i < OBJECTS; ++i)
+			xtPoolFree(w->pool, w->objs[i]);
+	xtPoolThreadDetach(w->pool);
+	return NULL;
+}
+
+static void threads(struct xtPool *pool)
+{
+	static void *objs[OBJECTS];
+	struct xtThread t[THREADS];
+	struct worker w[THREADS];
+	struct xtPoolStats st;
+	int ret = 0;
+
+	for (unsigned i = 0; i < OBJECTS; ++i)
+		objs[i] = xtPoolAlloc(pool);
+	for (unsigned i = 0; i < THREADS; ++i) {
+		w[i].pool = pool;
+		w[i].objs = i ? NULL : objs;
+		w[i].id = i;
+		w[i].ret = 0;
+		if (xtThreadCreate(&t[i], worker_main, &w[i], 0, 0)) {
+			FAIL("xtPoolAlloc() - threads");
+			return;
+		}
+	}
+	for (unsigned i = 0; i < THREADS; ++i) {
+		xtThreadJoin(&t[i], NULL);
+		ret |= w[i].ret;
+	}
+	xtPoolGetStats(pool, &st);
+	if (ret || st.inUse || st.allocs != st.frees)
+		FAIL("xtPoolAlloc() - threads");
+	else
+		PASS("xtPoolAlloc() - threads");
+	xtPoolThreadDetach(pool);
+	xtPoolGetStats(pool, &st);
+	if (st.inUse || st.fullMagazines + st.emptyMagazines < THREADS * 2)
+		FAIL("xtPoolThreadDetach()");
+	else
+		PASS("xtPoolThreadDetach()");
+}
+
+static void report(struct xtPool *pool)
+{
+	struct xtPoolStats all[16], st;
+	struct xtProcMemoryInfo info;
+	size_t n;
+	bool found = false;
+
+	xtPoolGetStats(pool, &st);
+	n = xtPoolGetAllStats(all, 16);
+	for (size_t i = 0; i < n && i < 16; ++i)
+		found |= !strcmp(all[i].name, "demo") && all[i].size == st.size;
+	if (!found || xtPoolGetTotalSize() < st.size)
+		FAIL("xtPoolGetAllStats()");
+	else
+		PASS("xtPoolGetAllStats()");
+	if (xtProcGetMemoryInfo(xtProcGetCurrentPID(), &info) || info.pool != xtPoolGetTotalSize())
+		FAIL("xtProcGetMemoryInfo() - pool");
+	else
+		PASS("xtProcGetMemoryInfo() - pool");
+}
+
+int main(void)
+{
+	struct xtPool pool, other;
+	void *obj;
+	stats_init(&stats, "pool");
+	puts("-- POOL TEST");
+
+	if (xtPoolCreate(&pool, "demo", OBJECT_SIZE, 24) == XT_EINVAL)
+		PASS("xtPoolCreate() - invalid alignment");
+	else
+		FAIL("xtPoolCreate() - invalid alignment");
+	if (xtPoolCreate(&pool, "demo", OBJECT_SIZE, 0)) {
+		FAIL("xtPoolCreate()");
+		goto end;
+	}
+	PASS("xtPoolCreate()");
+	single(&pool);
+	threads(&pool);
+	report(&pool);
+	// Destroy without detaching, the stale cache must not be reused
+	obj = xtPoolAlloc(&pool);
+	xtPoolDestroy(&pool);
+	if (xtPoolCreate(&other, "other", 8, 0) || !(obj = xtPoolAlloc(&other))) {
+		FAIL("xtPoolDestroy()");
+		goto end;
+	}
+	xtPoolFree(&other, obj);
+	xtPoolDestroy(&other);
+	if (xtPoolGetTotalSize())
+		FAIL("xtPoolDestroy()");
+	else
+		PASS("xtPoolDestroy()");
+end:
+	stats_info(&stats);
+	return stats_status(&stats);
+}
@@ -0,0 +1,360 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+// os_macros.h must be first in order to make it work
+#include <xt/os_macros.h>
+#include <xt/error.h>
+#include <xt/socket.h>
+#include <xt/thread.h>
+#include <xt/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+
+#define BIG_SIZE (1 << 20)
+
+static struct stats stats;
+
+static char *big, *back;
+
+struct reader {
+	xtSocket sock;
+	size_t n;
+	int ret;
+};
+
+static void *reader_main(struct xtThread *t, void *arg)
+{
+	struct reader *r = arg;
+	(void)t;
+	r->ret = xtSocketTCPReadExact(r->sock, back, BIG_SIZE, &r->n);
+	return NULL;
+}
+
+static int loopback(xtSocket *client, xtSocket *server)
+{
+	xtSocket listener;
+	struct xtSockaddr sa, peer;
+	int ret;
+	if ((ret = xtSocketCreate(&listener, XT_SOCKET_PROTO_TCP)))
+		return ret;
+	if (!xtSockaddrFromString(&sa, "127.0.0.1", 0)) {
+		ret = XT_EINVAL;
+		goto close_listener;
+	}
+	if ((ret = xtSocketBindTo(listener, &sa))
+		|| (ret = xtSocketListen(listener, 1))
+		|| (ret = xtSocketGetLocalSocketAddress(listener, &sa)))
+		goto close_listener;
+	if ((ret = xtSocketCreate(client, XT_SOCKET_PROTO_TCP)))
+		goto close_listener;
+	if ((ret = xtSocketConnect(*client, &sa))
+		|| (ret = xtSocketTCPAccept(listener, server, &peer)))
+		xtSocketClose(client);
+close_listener:
+	xtSocketClose(&listener);
+	return ret;
+}
+
+/* Sends the big buffer while another thread reads it back. */
+static void big_write(xtSocket client, xtSocket server, bool all, const char *msg)
+{
+	struct xtThread t;
+	struct reader r;
+	size_t sent = 0, n;
+	int ret = 0;
+	r.sock = server;
+	memset(back, 0, BIG_SIZE);
+	if (xtThreadCreate(&t, reader_main, &r, 0, 0)) {
+		SKIP(msg);
+		return;
+	}
+	if (all)
+		ret = xtSocketTCPWriteAll(client, big, BIG_SIZE, &sent, 0);
+	else
+		// A blocking write sends more than 65535 bytes at once
+		for (; !ret && sent < BIG_SIZE; sent += n)
+			if (!(ret = xtSocketTCPWriteEx(client, big + sent, BIG_SIZE - sent, &n, 0)) && n <= 65535)
+				ret = XT_EINVAL;
+	xtThreadJoin(&t, NULL);
+	if (ret || sent != BIG_SIZE || r.ret || r.n != BIG_SIZE || memcmp(big, back, BIG_SIZE))
+		FAIL(msg);
+	else
+		PASS(msg);
+}
+
+static void vectored(xtSocket client, xtSocket server)
+{
+	static const char head[] = "HTTP/1.1 200 OK\r\n\r\n", body[] = "hello";
+	char in[sizeof head + sizeof body], part[8];
+	struct xtSocketIOVec iov[2];
+	size_t n;
+
+	iov[0].base = (void*)head;
+	iov[0].len = sizeof head - 1;
+	iov[1].base = (void*)body;
+	iov[1].len = sizeof body - 1;
+	if (xtSocketTCPWritev(client, iov, 2, &n, 0) || n != sizeof head + sizeof body - 2
+		|| xtSocketTCPReadExact(server, in, n, &n) || memcmp(in, head, sizeof head - 1)
+		|| memcmp(in + sizeof head - 1, body, sizeof body - 1))
+		FAIL("xtSocketTCPWritev()");
+	else
+		PASS("xtSocketTCPWritev()");
+
+	if (xtSocketTCPWriteAll(client, in, 0, &n, 0) || n
+		|| xtSocketTCPWritevAll(client, NULL, 0, &n, 0) || n)
+		FAIL("xtSocketTCPWriteAll() - nothing");
+	else
+		PASS("xtSocketTCPWriteAll() - nothing");
+
+	// The headers end up in the first buffer and the body in the second one
+	if (xtSocketTCPWritevAll(client, iov, 2, &n, 0)) {
+		FAIL("xtSocketTCPReadv()");
+		return;
+	}
+	memset(in, 0, sizeof in);
+	iov[0].base = in;
+	iov[1].base = part;
+	iov[1].len = sizeof part;
+	// Loopback delivers a write this small in one piece
+	if (xtSocketTCPReadv(server, iov, 2, &n) || n != sizeof head + sizeof body - 2
+		|| memcmp(in, head, sizeof head - 1) || memcmp(part, body, sizeof body - 1))
+		FAIL("xtSocketTCPReadv()");
+	else
+		PASS("xtSocketTCPReadv()");
+}
+
+static void options(xtSocket client, xtSocket server)
+{
+	char in[8];
+	size_t n;
+	bool flag = false;
+#if XT_IS_LINUX
+	// The corked write is only sent once the cork is removed
+	if (xtSocketSetTCPCork(client, true) || xtSocketGetTCPCork(client, &flag) || !flag
+		|| xtSocketTCPWriteEx(client, "cork", 4, &n, XT_SOCKET_MSG_MORE) || n != 4
+		|| xtSocketTCPWriteEx(client, "ed", 2, &n, 0) || xtSocketSetTCPCork(client, false)
+		|| xtSocketTCPReadExact(server, in, 6, &n) || memcmp(in, "corked", 6))
+		FAIL("xtSocketSetTCPCork()");
+	else
+		PASS("xtSocketSetTCPCork()");
+
+	// Loopback copies the data anyway, but still reports the completion
+	uint32_t completed = 0;
+	int ret = XT_EAGAIN;
+	if (xtSocketSetSoZeroCopy(client, true)
+		|| xtSocketTCPWriteEx(client, big, BIG_SIZE / 16, &n, XT_SOCKET_MSG_ZEROCOPY)
+		|| xtSocketTCPReadExact(server, back, n, &n)) {
+		FAIL("xtSocketTCPZeroCopyPoll()");
+		return;
+	}
+	for (unsigned ms = 0; ret == XT_EAGAIN && ms < 1000; ++ms)
+		if ((ret = xtSocketTCPZeroCopyPoll(client, &completed)) == XT_EAGAIN)
+			xtSleepMS(1);
+	if (ret || completed != 1 || xtSocketTCPWriteAll(client, big, 1, &n, XT_SOCKET_MSG_ZEROCOPY) != XT_EINVAL)
+		FAIL("xtSocketTCPZeroCopyPoll()");
+	else
+		PASS("xtSocketTCPZeroCopyPoll()");
+#else
+	(void)server;
+	(void)in;
+	(void)n;
+	if (xtSocketSetTCPCork(client, true) != XT_EOPNOTSUPP || xtSocketGetTCPCork(client, &flag) != XT_EOPNOTSUPP)
+		FAIL("xtSocketSetTCPCork()");
+	else
+		PASS("xtSocketSetTCPCork()");
+	SKIP("xtSocketTCPZeroCopyPoll()");
+#endif
+}
+
+static void udp(void)
+{
+	xtSocket tx, rx;
+	struct xtSockaddr dest, src, from[16];
+	struct xtSocketUDPMessage msgs[16];
+	char data[16][32];
+	unsigned i, n;
+	int ret = 0;
+
+	if (xtSocketCreate(&tx, XT_SOCKET_PROTO_UDP)) {
+		FAIL("xtSocketCreate() - udp");
+		return;
+	}
+	if (xtSocketCreate(&rx, XT_SOCKET_PROTO_UDP)) {
+		FAIL("xtSocketCreate() - udp");
+		goto close_tx;
+	}
+	// Bind the sender too, so that its port is known
+	if (!xtSockaddrFromString(&dest, "127.0.0.1", 0) || !xtSockaddrFromString(&src, "127.0.0.1", 0)
+		|| xtSocketBindTo(rx, &dest) || xtSocketGetLocalSocketAddress(rx, &dest) || xtSocketBindTo(tx, &src)) {
+		FAIL("xtSocketBindTo() - udp");
+		goto close_rx;
+	}
+	for (i = 0; i < 8; ++i) {
+		msgs[i].buf = data[i];
+		msgs[i].buflen = snprintf(data[i], sizeof data[i], "datagram %u", i);
+		msgs[i].addr = &dest;
+		msgs[i].segmentSize = 0;
+	}
+	if (xtSocketUDPWriteBatch(tx, msgs, 8, &n) || n != 8 || msgs[7].len != msgs[7].buflen)
+		FAIL("xtSocketUDPWriteBatch()");
+	else
+		PASS("xtSocketUDPWriteBatch()");
+
+	// Loopback delivers right away, so all datagrams are waiting
+	for (i = 0; i < 16; ++i) {
+		msgs[i].buf = data[i];
+		msgs[i].buflen = sizeof data[i];
+		msgs[i].addr = &from[i];
+	}
+	memset(data, 0, sizeof data);
+	for (unsigned got = 0; got < 8 && !(ret = xtSocketUDPReadBatch(rx, msgs + got, 16 - got, &n));)
+		got += n;
+	for (i = 0; !ret && i < 8; ++i) {
+		char expect[32];
+		size_t len = snprintf(expect, sizeof expect, "datagram %u", i);
+		if (msgs[i].len != len || memcmp(data[i], expect, len) || msgs[i].segmentSize || msgs[i].truncated
+			|| xtSockaddrGetPort(&from[i]) != xtSocketGetLocalPort(tx))
+			ret = 1;
+	}
+	if (ret)
+		FAIL("xtSocketUDPReadBatch()");
+	else
+		PASS("xtSocketUDPReadBatch()");
+
+	// One message is split into four full datagrams and a short one
+	static char seg[4 * 100 + 50], segs[5][128];
+	memset(seg, 'x', sizeof seg);
+	msgs[0].buf = seg;
+	msgs[0].buflen = sizeof seg;
+	msgs[0].addr = &dest;
+	msgs[0].segmentSize = 100;
+	ret = xtSocketUDPWriteBatch(tx, msgs, 1, &n);
+	for (i = 0; i < 5; ++i) {
+		msgs[i].buf = segs[i];
+		msgs[i].buflen = sizeof segs[i];
+		msgs[i].addr = NULL;
+	}
+	for (unsigned got = 0; !ret && got < 5; got += n)
+		ret = xtSocketUDPReadBatch(rx, msgs + got, 5 - got, &n);
+	if (ret == XT_EIO || ret == XT_EINVAL)
+		SKIP("xtSocketUDPWriteBatch() - segments");
+	else if (ret || msgs[0].len != 100 || msgs[3].len != 100 || msgs[4].len != 50)
+		FAIL("xtSocketUDPWriteBatch() - segments");
+	else
+		PASS("xtSocketUDPWriteBatch() - segments");
+
+	ret = xtSocketSetBlocking(rx, false);
+	if (ret || xtSocketUDPReadBatch(rx, msgs, 5, &n) != XT_EAGAIN || n)
+		FAIL("xtSocketUDPReadBatch() - nothing");
+	else
+		PASS("xtSocketUDPReadBatch() - nothing");
+
+	// Only the first datagram does not fit
+	for (i = 0; i < 2; ++i) {
+		msgs[i].buf = data[i];
+		msgs[i].buflen = snprintf(data[i], sizeof data[i], i ? "short" : "a long datagram");
+		msgs[i].addr = &dest;
+		msgs[i].segmentSize = 0;
+	}
+	ret = xtSocketUDPWriteBatch(tx, msgs, 2, &n);
+	for (i = 0; i < 2; ++i) {
+		msgs[i].buf = data[i];
+		msgs[i].buflen = 8;
+		msgs[i].addr = NULL;
+	}
+	for (unsigned got = 0; !ret && got < 2; got += n)
+		ret = xtSocketUDPReadBatch(rx, msgs + got, 2 - got, &n);
+	if (ret || !msgs[0].truncated || msgs[0].len != 8 || memcmp(data[0], "a long d", 8)
+		|| msgs[1].truncated || msgs[1].len != 5)
+		FAIL("xtSocketUDPReadBatch() - truncated");
+	else
+		PASS("xtSocketUDPReadBatch() - truncated");
+
+#if XT_IS_LINUX
+	// The coalesced datagrams arrive in one buffer
+	static char gro[1024];
+	if ((ret = xtSocketSetUDPGRO(rx, true))) {
+		SKIP("xtSocketSetUDPGRO()");
+		goto close_rx;
+	}
+	msgs[0].buf = seg;
+	msgs[0].buflen = sizeof seg;
+	msgs[0].addr = &dest;
+	msgs[0].segmentSize = 100;
+	ret = xtSocketUDPWriteBatch(tx, msgs, 1, &n);
+	msgs[0].buf = gro;
+	msgs[0].buflen = sizeof gro;
+	msgs[0].addr = NULL;
+	size_t total = 0;
+	for (i = 0; !ret && total < sizeof seg && i < 1000; ++i) {
+		if ((ret = xtSocketUDPReadBatch(rx, msgs, 1, &n)) == XT_EAGAIN) {
+			ret = 0;
+			xtSleepMS(1);
+			continue;
+		}
+		total += msgs[0].len;
+		if (msgs[0].len > 100 && msgs[0].segmentSize != 100)
+			ret = 1;
+	}
+	if (ret || total != sizeof seg)
+		FAIL("xtSocketSetUDPGRO()");
+	else
+		PASS("xtSocketSetUDPGRO()");
+#else
+	if (xtSocketSetUDPGRO(rx, true) != XT_EOPNOTSUPP)
+		FAIL("xtSocketSetUDPGRO()");
+	else
+		PASS("xtSocketSetUDPGRO()");
+#endif
+close_rx:
+	xtSocketClose(&rx);
+close_tx:
+	xtSocketClose(&tx);
+}
+
+int main(void)
+{
+	xtSocket client, server;
+	stats_init(&stats, "socket");
+	puts("-- SOCKET TEST");
+	if (!xtSocketInit()) {
+		FAIL("xtSocketInit()");
+		goto end;
+	}
+	big = malloc(BIG_SIZE);
+	back = malloc(BIG_SIZE);
+	if (!big || !back || loopback(&client, &server)) {
+		FAIL("xtSocketConnect()");
+		goto destruct;
+	}
+	for (unsigned i = 0; i < BIG_SIZE; ++i)
+		big[i] = i * 7;
+	big_write(client, server, false, "xtSocketTCPWriteEx()");
+	big_write(client, server, true, "xtSocketTCPWriteAll()");
+	// Small send buffers make the writer wait for room many times
+	xtSocketSetSoSendBufferSize(client, 4096);
+	if (xtSocketSetBlocking(client, false))
+		FAIL("xtSocketSetBlocking()");
+	else
+		big_write(client, server, true, "xtSocketTCPWriteAll() - non-blocking");
+	xtSocketSetBlocking(client, true);
+	vectored(client, server);
+	options(client, server);
+	xtSocketClose(&client);
+	size_t n;
+	char c;
+	if (xtSocketTCPReadExact(server, &c, 1, &n) != XT_ESHUTDOWN || n)
+		FAIL("xtSocketTCPReadExact() - shutdown");
+	else
+		PASS("xtSocketTCPReadExact() - shutdown");
+	xtSocketClose(&server);
+	udp();
+destruct:
+	free(back);
+	free(big);
+	xtSocketDestruct();
+end:
+	stats_info(&stats);
+	return stats_status(&stats);
+}
@@ -1,9 +1,11 @@
 /* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
 
+#include <xt/error.h>
 #include <xt/sort.h>
 #include <xt/time.h>
 #include <xt/os.h>
 #include <xt/string.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,6 +24,26 @@ static struct stats stats;
 
 #include "chklist.h"
 
+#define CHK_SUBTYPE LLU
+#define CHK_TYPE unsigned long long
+
+#include "chklist.h"
+
+#define CHK_SUBTYPE LLD
+#define CHK_TYPE long long
+
+#include "chklist.h"
+
+#define CHK_SUBTYPE F
+#define CHK_TYPE float
+
+#include "chklist.h"
+
+#define CHK_SUBTYPE LF
+#define CHK_TYPE double
+
+#include "chklist.h"
+
 #define ASZ 4096
 #define LARGE_ASZ (1 << 14LLU)
 
@@ -32,11 +54,15 @@ enum xtSortType types[] = {
 	XT_SORT_QUICK ,
 	XT_SORT_SELECT,
 	XT_SORT_RADIX ,
+	XT_SORT_PDQ   ,
+	XT_SORT_AUTO  ,
+	XT_SORT_TIM   ,
 };
 
 const char *names[] = {
 	"bubble", "heap", "insert",
-	"quick", "select", "radix"
+	"quick", "select", "radix",
+	"pdq", "auto", "tim"
 };
 
 #define NTYPE (sizeof types/sizeof types[0])
@@ -111,6 +137,568 @@ static void large(void)
 	free(a);
 }
 
+#define PATTERN_ASZ 100000
+
+enum pattern {
+	PATTERN_RANDOM,
+	PATTERN_SORTED,
+	PATTERN_REVERSED,
+	PATTERN_FEW_UNIQUE,
+	PATTERN_ORGAN_PIPE,
+	PATTERN_EQUAL,
+	PATTERN_MAX
+};
+
+static const char *pattern_names[] = {
+	"random", "sorted", "reversed", "few unique", "organ pipe", "equal"
+};
+
+static void pattern_fill(int *a, size_t n, enum pattern p)
+{
+	for (size_t i = 0; i < n; ++i)
+		switch (p) {
+		case PATTERN_RANDOM    : a[i] = rand() - RAND_MAX / 2; break;
+		case PATTERN_SORTED    : a[i] = i; break;
+		case PATTERN_REVERSED  : a[i] = n - i; break;
+		case PATTERN_FEW_UNIQUE: a[i] = rand() % 4; break;
+		case PATTERN_ORGAN_PIPE: a[i] = i < n / 2 ? i : n - i; break;
+		default                : a[i] = 42; break;
+		}
+}
+
+struct record {
+	int key;
+	char payload[96];
+};
+
+static int cmp_record(const void *a, const void *b)
+{
+	const struct record *x = a, *y = b;
+	return x->key < y->key ? -1 : x->key > y->key;
+}
+
+/* Sorts inputs that are known to make naive quicksorts go quadratic. */
+static void patterns(void)
+{
+	char buf[256];
+	int *a = malloc(PATTERN_ASZ * sizeof *a);
+	struct record *r = malloc(PATTERN_ASZ / 10 * sizeof *r);
+	size_t i, nr = PATTERN_ASZ / 10;
+	if (!a || !r)
+		abort();
+	for (unsigned p = 0; p < PATTERN_MAX; ++p) {
+		snprintf(buf, sizeof buf, "pdq %s", pattern_names[p]);
+		pattern_fill(a, PATTERN_ASZ, p);
+		if (xtSortD(a, PATTERN_ASZ, XT_SORT_PDQ, true))
+			FAIL("xtSortD() - pdq");
+		else
+			chklistD(a, PATTERN_ASZ, 1, buf);
+		pattern_fill(a, PATTERN_ASZ, p);
+		if (xtSortU((unsigned*)a, PATTERN_ASZ, XT_SORT_PDQ, false))
+			FAIL("xtSortU() - pdq");
+		else
+			chklistU((unsigned*)a, PATTERN_ASZ, 0, buf);
+		// Elements larger than the internal buffer of the generic sort,
+		// which auto sorts indirectly
+		for (unsigned t = 0; t < 2; ++t) {
+			pattern_fill(a, nr, p);
+			for (i = 0; i < nr; ++i) {
+				r[i].key = a[i];
+				snprintf(r[i].payload, sizeof r[i].payload, "%d", a[i]);
+			}
+			snprintf(buf, sizeof buf, "xtSortP() - %s %s", t ? "auto" : "pdq", pattern_names[p]);
+			if (xtSortP(r, nr, t ? XT_SORT_AUTO : XT_SORT_PDQ, cmp_record, true, sizeof *r)) {
+				FAIL(buf);
+				continue;
+			}
+			for (i = 1; i < nr; ++i)
+				if (r[i - 1].key > r[i].key || atoi(r[i].payload) != r[i].key)
+					break;
+			if (i == nr)
+				PASS(buf);
+			else
+				FAIL(buf);
+		}
+	}
+	free(r);
+	free(a);
+}
+
+struct pair {
+	int key, value;
+};
+
+struct wide {
+	long long key, value;
+};
+
+static int cmp_pair(const void *a, const void *b)
+{
+	const struct pair *x = a, *y = b;
+	return x->key < y->key ? -1 : x->key > y->key;
+}
+
+static int cmp_wide(const void *a, const void *b)
+{
+	const struct wide *x = a, *y = b;
+	return x->key < y->key ? -1 : x->key > y->key;
+}
+
+#define XT_SORT_TYPE struct pair
+#define XT_SORT_NAME pair_sort
+#define XT_SORT_LESS(a, b) ((a).key < (b).key)
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE struct wide
+#define XT_SORT_NAME wide_sort_desc
+#define XT_SORT_LESS(a, b) ((a).key > (b).key)
+#include <xt/sort_template.h>
+
+#define ELEM_ASZ 20000
+
+/* Sorts elements with sizes the generic sort swaps without a buffer, with and without the template. */
+static void elements(void)
+{
+	struct pair *p = malloc(ELEM_ASZ * sizeof *p);
+	struct wide *w = malloc(ELEM_ASZ * sizeof *w);
+	size_t i;
+	if (!p || !w)
+		abort();
+	for (unsigned t = 0; t < 2; ++t) {
+		for (i = 0; i < ELEM_ASZ; ++i) {
+			p[i].key = rand() % 1000;
+			p[i].value = ~p[i].key;
+			w[i].key = rand() - RAND_MAX / 2;
+			w[i].value = ~w[i].key;
+		}
+		if (t) {
+			pair_sort(p, ELEM_ASZ);
+			wide_sort_desc(w, ELEM_ASZ);
+		} else if (xtSortP(p, ELEM_ASZ, XT_SORT_PDQ, cmp_pair, true, sizeof *p)
+			|| xtSortP(w, ELEM_ASZ, XT_SORT_PDQ, cmp_wide, false, sizeof *w)) {
+			FAIL("xtSortP() - 8 and 16 byte elements");
+			continue;
+		}
+		for (i = 1; i < ELEM_ASZ; ++i)
+			if (p[i - 1].key > p[i].key || p[i].value != ~p[i].key)
+				break;
+		if (i == ELEM_ASZ)
+			PASS(t ? "sort_template.h - 8 byte elements" : "xtSortP() - 8 byte elements");
+		else
+			FAIL(t ? "sort_template.h - 8 byte elements" : "xtSortP() - 8 byte elements");
+		for (i = 1; i < ELEM_ASZ; ++i)
+			if (w[i - 1].key < w[i].key || w[i].value != ~w[i].key)
+				break;
+		if (i == ELEM_ASZ)
+			PASS(t ? "sort_template.h - 16 byte elements" : "xtSortP() - 16 byte elements");
+		else
+			FAIL(t ? "sort_template.h - 16 byte elements" : "xtSortP() - 16 byte elements");
+	}
+	free(w);
+	free(p);
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+	int x = *(const int*)a, y = *(const int*)b;
+	return x < y ? -1 : x > y;
+}
+
+static void index_sort(void)
+{
+	int a[ASZ], b[ASZ];
+	size_t index[ASZ], i;
+	bool seen[ASZ] = {false};
+	arndD(a, ASZ);
+	memcpy(b, a, sizeof a);
+	if (xtSortIndex(index, a, ASZ, cmp_int, false, sizeof *a)) {
+		FAIL("xtSortIndex()");
+		return;
+	}
+	for (i = 1; i < ASZ; ++i)
+		if (a[index[i - 1]] < a[index[i]])
+			break;
+	// Every position must occur once and the list must be left alone
+	if (i == ASZ)
+		for (i = 0; i < ASZ; ++i) {
+			if (index[i] >= ASZ || seen[index[i]])
+				break;
+			seen[index[i]] = true;
+		}
+	if (i == ASZ && !memcmp(a, b, sizeof a))
+		PASS("xtSortIndex()");
+	else
+		FAIL("xtSortIndex()");
+}
+
+/* Equal keys must keep the order of their sequence numbers in the payload. */
+static void stable_sort(void)
+{
+	char buf[256];
+	int *a = malloc(PATTERN_ASZ * sizeof *a);
+	struct record *r = malloc(PATTERN_ASZ / 10 * sizeof *r);
+	size_t i, nr = PATTERN_ASZ / 10;
+	if (!a || !r)
+		abort();
+	for (unsigned p = 0; p < PATTERN_MAX; ++p)
+		for (int ascend = 0; ascend < 2; ++ascend) {
+			pattern_fill(a, nr, p);
+			for (i = 0; i < nr; ++i) {
+				r[i].key = a[i] / 16;
+				snprintf(r[i].payload, sizeof r[i].payload, "%zu", i);
+			}
+			snprintf(buf, sizeof buf, "xtSortP() - tim %s %s", pattern_names[p], ascend ? "ascending" : "descending");
+			if (xtSortP(r, nr, XT_SORT_TIM, cmp_record, ascend, sizeof *r)) {
+				FAIL(buf);
+				continue;
+			}
+			for (i = 1; i < nr; ++i)
+				if (r[i - 1].key == r[i].key ? atoi(r[i - 1].payload) > atoi(r[i].payload) : (r[i - 1].key < r[i].key) != ascend)
+					break;
+			if (i == nr)
+				PASS(buf);
+			else
+				FAIL(buf);
+		}
+	free(r);
+	free(a);
+}
+
+static const char *words[] = {
+	"mafketel", "funny dinnur FOUR", "mah boi", "MAH BOI",
+	"Ja, de beste pornofilm", "je kan lekker niet verslaan!",
+	"p.p.p.p.pokemon!", "stomme kutkinderen", "krijg toch de pest"
+};
+
+#define NWORDS (sizeof words / sizeof words[0])
+
+static void select_nth(void)
+{
+	static const size_t pos[] = {0, 1, ASZ / 3, ASZ / 2, ASZ - 1};
+	char buf[256];
+	int a[ASZ], b[ASZ];
+	const char *w[NWORDS], *ws[NWORDS];
+	size_t i, n;
+	for (unsigned p = 0; p < sizeof pos / sizeof pos[0]; ++p)
+		for (unsigned t = 0; t < 4; ++t) {
+			bool ascend = t & 1;
+			n = pos[p];
+			snprintf(buf, sizeof buf, "xtSelectNth%s() - %zu %s", t < 2 ? "D" : "P", n, ascend ? "ascending" : "descending");
+			arndD(a, ASZ);
+			memcpy(b, a, sizeof a);
+			xtSortD(b, ASZ, XT_SORT_PDQ, ascend);
+			if (t < 2 ? xtSelectNthD(a, ASZ, n, ascend) : xtSelectNthP(a, ASZ, n, cmp_int, ascend, sizeof *a)) {
+				FAIL(buf);
+				continue;
+			}
+			// No element may be on the wrong side of the selected one
+			for (i = 0; i < ASZ; ++i)
+				if ((i < n && (ascend ? a[i] > a[n] : a[i] < a[n]))
+					|| (i > n && (ascend ? a[i] < a[n] : a[i] > a[n])))
+					break;
+			if (i == ASZ && a[n] == b[n])
+				PASS(buf);
+			else
+				FAIL(buf);
+		}
+	arndU((unsigned*)a, ASZ);
+	memcpy(b, a, sizeof a);
+	xtSortU((unsigned*)b, ASZ, XT_SORT_PDQ, false);
+	if (!xtSelectNthU((unsigned*)a, ASZ, ASZ / 2, false) && a[ASZ / 2] == b[ASZ / 2])
+		PASS("xtSelectNthU()");
+	else
+		FAIL("xtSelectNthU()");
+	memcpy(w, words, sizeof words);
+	memcpy(ws, words, sizeof words);
+	xtSortStr(ws, NWORDS, XT_SORT_PDQ, true);
+	for (n = 0; n < NWORDS; ++n)
+		if (xtSelectNthStr(w, NWORDS, n, true) || strcmp(w[n], ws[n]))
+			break;
+	if (n == NWORDS)
+		PASS("xtSelectNthStr()");
+	else
+		FAIL("xtSelectNthStr()");
+	if (xtSelectNthD(a, ASZ, ASZ, true) == XT_EINVAL)
+		PASS("xtSelectNthD() - out of bounds");
+	else
+		FAIL("xtSelectNthD() - out of bounds");
+}
+
+/* Both the bounded heap for small k and select for large k must be hit. */
+static void partial_sort(void)
+{
+	static const size_t ks[] = {0, 1, 100, PATTERN_ASZ / 4, PATTERN_ASZ, PATTERN_ASZ + 1};
+	char buf[256];
+	int *a = malloc(PATTERN_ASZ * sizeof *a), *b = malloc(PATTERN_ASZ * sizeof *b);
+	const char *w[NWORDS], *ws[NWORDS];
+	size_t k, m;
+	int ret;
+	if (!a || !b)
+		abort();
+	for (unsigned i = 0; i < sizeof ks / sizeof ks[0]; ++i)
+		for (unsigned t = 0; t < 6; ++t) {
+			bool ascend = t & 1;
+			k = ks[i];
+			m = k < PATTERN_ASZ ? k : PATTERN_ASZ;
+			snprintf(buf, sizeof buf, "xtPartialSort%s() - %zu %s", t < 2 ? "U" : t < 4 ? "D" : "P", k, ascend ? "ascending" : "descending");
+			pattern_fill(a, PATTERN_ASZ, i % 2 ? PATTERN_FEW_UNIQUE : PATTERN_RANDOM);
+			memcpy(b, a, PATTERN_ASZ * sizeof *a);
+			if (t < 2) {
+				xtSortU((unsigned*)b, PATTERN_ASZ, XT_SORT_PDQ, ascend);
+				ret = xtPartialSortU((unsigned*)a, PATTERN_ASZ, k, ascend);
+			} else {
+				xtSortD(b, PATTERN_ASZ, XT_SORT_PDQ, ascend);
+				if (t < 4)
+					ret = xtPartialSortD(a, PATTERN_ASZ, k, ascend);
+				else
+					ret = xtPartialSortP(a, PATTERN_ASZ, k, cmp_int, ascend, sizeof *a);
+			}
+			if (!ret && !memcmp(a, b, m * sizeof *a))
+				PASS(buf);
+			else
+				FAIL(buf);
+		}
+	memcpy(w, words, sizeof words);
+	memcpy(ws, words, sizeof words);
+	xtSortStr(ws, NWORDS, XT_SORT_PDQ, false);
+	if (xtPartialSortStr(w, NWORDS, 3, false) || strcmp(w[0], ws[0]) || strcmp(w[1], ws[1]) || strcmp(w[2], ws[2]))
+		FAIL("xtPartialSortStr()");
+	else
+		PASS("xtPartialSortStr()");
+	free(b);
+	free(a);
+}
+
+/* Multiples of 2 and 3 below SET_MAX, so the expected results are easy to compute. */
+#define SET_MAX 3000
+
+static void sorted_lists(void)
+{
+	unsigned u2[SET_MAX / 2], u3[SET_MAX / 3], u[2 * SET_MAX];
+	int d[SET_MAX], dk;
+	unsigned long long llu[SET_MAX];
+	const unsigned *lists[3];
+	size_t counts[3], n2 = 0, n3 = 0, n, i;
+	for (i = 0; i < SET_MAX; ++i) {
+		if (!(i % 2))
+			u2[n2++] = i;
+		if (!(i % 3))
+			u3[n3++] = i;
+	}
+	// Bounds on a list with runs of equal elements
+	for (i = 0; i < SET_MAX; ++i) {
+		d[i] = i / 4 - SET_MAX / 8;
+		llu[i] = i / 4;
+	}
+	for (dk = -SET_MAX / 8 - 1; dk < SET_MAX / 8; ++dk)
+		if (xtLowerBoundD(d, SET_MAX, dk) != (size_t)(dk < -SET_MAX / 8 ? 0 : 4 * (dk + SET_MAX / 8))
+			|| xtUpperBoundD(d, SET_MAX, dk) != (size_t)(dk < -SET_MAX / 8 ? 0 : 4 * (dk + SET_MAX / 8 + 1))
+			|| xtLowerBoundP(d, SET_MAX, &dk, cmp_int, sizeof *d) != xtLowerBoundD(d, SET_MAX, dk)
+			|| xtUpperBoundP(d, SET_MAX, &dk, cmp_int, sizeof *d) != xtUpperBoundD(d, SET_MAX, dk))
+			break;
+	if (dk == SET_MAX / 8 && xtLowerBoundLLU(llu, SET_MAX, SET_MAX) == SET_MAX && !xtUpperBoundU(u2, 0, 1))
+		PASS("xtLowerBound/xtUpperBound");
+	else
+		FAIL("xtLowerBound/xtUpperBound");
+	// Multiples of 6 are in both sets
+	n = xtIntersectU(u, u2, n2, u3, n3);
+	for (i = 0; i < n && u[i] == 6 * i; ++i)
+		;
+	if (n == (SET_MAX + 5) / 6 && i == n && xtIntersectU(u, u3, n3, u2 + n2 - 10, 10) == 3)
+		PASS("xtIntersectU()");
+	else
+		FAIL("xtIntersectU()");
+	n = xtIntersectP(u, u2, n2, u3, n3, cmp_int, sizeof *u);
+	if (n == (SET_MAX + 5) / 6 && u[n - 1] == 6 * (n - 1))
+		PASS("xtIntersectP()");
+	else
+		FAIL("xtIntersectP()");
+	n = xtUnionU(u, u2, n2, u3, n3);
+	for (i = 1; i < n && u[i - 1] < u[i] && (u[i] % 2 == 0 || u[i] % 3 == 0); ++i)
+		;
+	if (n == n2 + n3 - (SET_MAX + 5) / 6 && i == n)
+		PASS("xtUnionU()");
+	else
+		FAIL("xtUnionU()");
+	// Merging keeps duplicates, which unique removes again
+	lists[0] = u2;
+	lists[1] = u3;
+	lists[2] = u2;
+	counts[0] = n2;
+	counts[1] = n3;
+	counts[2] = n2;
+	if (xtMergeU(u, lists, counts, 3)) {
+		FAIL("xtMergeU()");
+		return;
+	}
+	chklistU(u, n2 + n3 + n2, 1, "xtMergeU()");
+	n = xtUniqueU(u, n2 + n3 + n2);
+	for (i = 1; i < n && u[i - 1] < u[i]; ++i)
+		;
+	if (n == n2 + n3 - (SET_MAX + 5) / 6 && i == n)
+		PASS("xtUniqueU()");
+	else
+		FAIL("xtUniqueU()");
+	if (xtMergeP(d, (const void *const*)lists, counts, 2, cmp_int, sizeof *d)) {
+		FAIL("xtMergeP()");
+		return;
+	}
+	n = xtUniqueP(d, n2 + n3, cmp_int, sizeof *d);
+	if (n == n2 + n3 - (SET_MAX + 5) / 6 && !memcmp(d, u, n * sizeof *d))
+		PASS("xtMergeP() - xtUniqueP()");
+	else
+		FAIL("xtMergeP() - xtUniqueP()");
+}
+
+#define PARALLEL_ASZ ((1 << 18) + 3)
+
+/* Uses more threads than there may be cores, which must work all the same. */
+static void parallel(void)
+{
+	static const unsigned threads[] = {0, 2, 3, 4, 7};
+	char buf[256];
+	int *a = malloc(PARALLEL_ASZ * sizeof *a);
+	struct pair *p = malloc(PARALLEL_ASZ * sizeof *p);
+	size_t i;
+	if (!a || !p)
+		abort();
+	for (unsigned t = 0; t < sizeof threads / sizeof threads[0]; ++t) {
+		snprintf(buf, sizeof buf, "parallel %u threads", threads[t]);
+		arndU((unsigned*)a, PARALLEL_ASZ);
+		if (xtSortParallelU((unsigned*)a, PARALLEL_ASZ, true, threads[t]))
+			FAIL("xtSortParallelU()");
+		else
+			chklistU((unsigned*)a, PARALLEL_ASZ, 1, buf);
+		arndD(a, PARALLEL_ASZ);
+		if (xtSortParallelD(a, PARALLEL_ASZ, false, threads[t]))
+			FAIL("xtSortParallelD()");
+		else
+			chklistD(a, PARALLEL_ASZ, 0, buf);
+		for (i = 0; i < PARALLEL_ASZ; ++i) {
+			p[i].key = rand() % 1000;
+			p[i].value = ~p[i].key;
+		}
+		snprintf(buf, sizeof buf, "xtSortParallelP() - %u threads", threads[t]);
+		if (xtSortParallelP(p, PARALLEL_ASZ, cmp_pair, true, sizeof *p, threads[t])) {
+			FAIL(buf);
+			continue;
+		}
+		for (i = 1; i < PARALLEL_ASZ; ++i)
+			if (p[i - 1].key > p[i].key || p[i].value != ~p[i].key)
+				break;
+		if (i == PARALLEL_ASZ)
+			PASS(buf);
+		else
+			FAIL(buf);
+	}
+	// Too small to be split
+	arndD(a, ASZ);
+	if (xtSortParallelD(a, ASZ, true, 4))
+		FAIL("xtSortParallelD()");
+	else
+		chklistD(a, ASZ, 1, "parallel small");
+	free(p);
+	free(a);
+}
+
+static unsigned long long rnd64(void)
+{
+	return (unsigned long long)rand() << 42 ^ (unsigned long long)rand() << 21 ^ rand();
+}
+
+/* Values that span all bits, including the sign bit. */
+static void wide_keys(void)
+{
+	static const enum xtSortType wide_types[] = {XT_SORT_RADIX, XT_SORT_PDQ, XT_SORT_AUTO};
+	static const char *wide_names[] = {"radix", "pdq", "auto"};
+	static unsigned long long llu[ASZ];
+	static long long lld[ASZ];
+	static float f[ASZ];
+	static double lf[ASZ];
+	char buf[256];
+	for (unsigned t = 0; t < 3; ++t)
+		for (int ascend = 0; ascend < 2; ++ascend) {
+			for (size_t i = 0; i < ASZ; ++i) {
+				llu[i] = rnd64();
+				lld[i] = rnd64();
+				f[i] = (int)rand() % 2000000 / 1000.0f - 1000;
+				lf[i] = (long long)rnd64() / 1e9;
+			}
+			// Small keys must skip the higher digits
+			if (t == 0)
+				for (size_t i = 0; i < ASZ; i += 2)
+					llu[i] = i;
+			// Just positive keys
+			if (t == 2) {
+				arndLLU(llu, ASZ);
+				arndLLD(lld, ASZ);
+				arndF(f, ASZ);
+				arndLF(lf, ASZ);
+			}
+			snprintf(buf, sizeof buf, "%s", wide_names[t]);
+			if (xtSortLLU(llu, ASZ, wide_types[t], ascend))
+				FAIL("xtSortLLU()");
+			else
+				chklistLLU(llu, ASZ, ascend, buf);
+			if (xtSortLLD(lld, ASZ, wide_types[t], ascend))
+				FAIL("xtSortLLD()");
+			else
+				chklistLLD(lld, ASZ, ascend, buf);
+			if (xtSortF(f, ASZ, wide_types[t], ascend))
+				FAIL("xtSortF()");
+			else
+				chklistF(f, ASZ, ascend, buf);
+			if (xtSortLF(lf, ASZ, wide_types[t], ascend))
+				FAIL("xtSortLF()");
+			else
+				chklistLF(lf, ASZ, ascend, buf);
+		}
+	if (xtSortLLU(llu, ASZ, XT_SORT_BUBBLE, true) == XT_EOPNOTSUPP)
+		PASS("xtSortLLU() - bubble unsupported");
+	else
+		FAIL("xtSortLLU() - bubble unsupported");
+}
+
+struct timed {
+	long long time;
+	unsigned seq;
+};
+
+/* Sorts records on a key with few distinct values, so that stability shows. */
+static void radix_records(void)
+{
+	static const unsigned threads[] = {1, 0, 4};
+	char buf[256];
+	struct timed *r = malloc(PARALLEL_ASZ * sizeof *r);
+	size_t i;
+	if (!r)
+		abort();
+	for (unsigned t = 0; t < sizeof threads / sizeof threads[0]; ++t)
+		for (int ascend = 0; ascend < 2; ++ascend) {
+			for (i = 0; i < PARALLEL_ASZ; ++i) {
+				r[i].time = rand() % 1000 - 500;
+				r[i].seq = i;
+			}
+			snprintf(buf, sizeof buf, "xtSortRadix() - %u threads %s", threads[t], ascend ? "ascending" : "descending");
+			if (xtSortRadix(r, PARALLEL_ASZ, sizeof *r, offsetof(struct timed, time), XT_SORT_KEY_LLD, ascend, threads[t])) {
+				FAIL(buf);
+				continue;
+			}
+			for (i = 1; i < PARALLEL_ASZ; ++i)
+				if (r[i - 1].time == r[i].time ? r[i - 1].seq > r[i].seq : (r[i - 1].time < r[i].time) != ascend)
+					break;
+			if (i == PARALLEL_ASZ)
+				PASS(buf);
+			else
+				FAIL(buf);
+		}
+	if (xtSortRadix(r, PARALLEL_ASZ, sizeof *r, sizeof *r - 4, XT_SORT_KEY_LLD, true, 1) == XT_EINVAL)
+		PASS("xtSortRadix() - key out of bounds");
+	else
+		FAIL("xtSortRadix() - key out of bounds");
+	free(r);
+}
+
 static void string_sort(void)
 {
 	const char *list[] = {
@@ -197,6 +785,112 @@ static void string_sort(void)
 	PASS("xtSortStr");
 }
 
+#define PREFIX_N 20000
+#define PREFIX_LEN 48
+#define LONG_N 40
+#define LONG_LEN (1 << 20)
+
+static int str_len_cmp(const char *a, size_t na, const char *b, size_t nb)
+{
+	int cmp = memcmp(a, b, na < nb ? na : nb);
+	return cmp ? cmp : (na > nb) - (na < nb);
+}
+
+static void prefix_sort(void)
+{
+	static const char *hosts[] = {
+		"https://example.com/", "https://example.com/a/", "https://example.org/",
+		"http://example.com/", "https://example.com/a/b/c/d/e/f/g/",
+	};
+	char *buf;
+	const char **list, **ref;
+	size_t *len, *orig;
+
+	buf = malloc(PREFIX_N * PREFIX_LEN);
+	list = malloc(PREFIX_N * sizeof *list);
+	ref = malloc(PREFIX_N * sizeof *ref);
+	len = malloc(PREFIX_N * sizeof *len);
+	orig = malloc(PREFIX_N * sizeof *orig);
+	if (!buf || !list || !ref || !len || !orig) {
+		FAIL("prefix_sort: out of memory");
+		goto fail;
+	}
+	/* Shared prefixes, duplicates and strings that are prefixes of others */
+	for (size_t i = 0; i < PREFIX_N; ++i) {
+		char *s = buf + i * PREFIX_LEN;
+		snprintf(s, PREFIX_LEN, "%s%u", hosts[rand() % 5], (unsigned)(rand() % (PREFIX_N / 2)) * 10);
+		list[i] = ref[i] = s;
+	}
+	for (unsigned asc = 0; asc < 2; ++asc) {
+		if (xtSortStr(list, PREFIX_N, XT_SORT_AUTO, asc)
+			|| xtSortStr(ref, PREFIX_N, XT_SORT_PDQ, asc)) {
+			FAIL("xtSortStr() - shared prefixes");
+			goto fail;
+		}
+		for (size_t i = 0; i < PREFIX_N; ++i)
+			if (strcmp(list[i], ref[i])) {
+				FAIL("xtSortStr() - shared prefixes");
+				goto fail;
+			}
+	}
+	PASS("xtSortStr() - shared prefixes");
+
+	/* Binary keys with NUL bytes, which mostly differ in their last bytes */
+	for (size_t i = 0; i < PREFIX_N; ++i) {
+		char *s = buf + i * PREFIX_LEN;
+		len[i] = orig[i] = rand() % PREFIX_LEN;
+		memset(s, 0, PREFIX_LEN);
+		for (size_t j = len[i] > 4 ? len[i] - 4 : 0; j < len[i]; ++j)
+			s[j] = rand() % 3;
+		list[i] = s;
+	}
+	for (unsigned asc = 0; asc < 2; ++asc) {
+		if (xtSortStrLen(list, len, PREFIX_N, asc)) {
+			FAIL("xtSortStrLen()");
+			goto fail;
+		}
+		for (size_t i = 0; i < PREFIX_N; ++i) {
+			int cmp = i ? str_len_cmp(list[i - 1], len[i - 1], list[i], len[i]) : 0;
+			if ((asc ? cmp > 0 : cmp < 0) || len[i] != orig[(list[i] - buf) / PREFIX_LEN]) {
+				FAIL("xtSortStrLen()");
+				goto fail;
+			}
+		}
+	}
+	PASS("xtSortStrLen()");
+
+	/* Long common prefixes must not recurse once for every 8 bytes */
+	free(buf);
+	if (!(buf = malloc(LONG_N * LONG_LEN))) {
+		SKIP("xtSortStr() - long prefixes");
+		goto fail;
+	}
+	for (size_t i = 0; i < LONG_N; ++i) {
+		char *s = buf + i * LONG_LEN;
+		memset(s, 'a', LONG_LEN - 2);
+		s[LONG_LEN - 2] = 'a' + rand() % 26;
+		s[LONG_LEN - 1] = '\0';
+		list[i] = s;
+		len[i] = LONG_LEN - 1;
+	}
+	if (xtSortStr(list, LONG_N, XT_SORT_AUTO, true) || xtSortStrLen(list, len, LONG_N, false))
+		FAIL("xtSortStr() - long prefixes");
+	else {
+		for (size_t i = 1; i < LONG_N; ++i)
+			if (strcmp(list[i - 1], list[i]) < 0) {
+				FAIL("xtSortStr() - long prefixes");
+				goto fail;
+			}
+		PASS("xtSortStr() - long prefixes");
+	}
+fail:
+	free(orig);
+	free(len);
+	free(ref);
+	free(list);
+	free(buf);
+}
+
 int main(void)
 {
 	stats_init(&stats, "sort");
@@ -209,7 +903,18 @@ int main(void)
 	sortu();
 	sortd();
 	large();
+	patterns();
+	elements();
+	index_sort();
+	stable_sort();
+	select_nth();
+	partial_sort();
+	sorted_lists();
+	parallel();
+	wide_keys();
+	radix_records();
 	string_sort();
+	prefix_sort();
 	stats_info(&stats);
 	return stats_status(&stats);
 }
@@ -8,6 +8,7 @@
 
 #include <ctype.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -281,6 +282,52 @@ static void formatTime(void)
 	puts(buf);
 }
 
+static void formatTimeCached(void)
+{
+	struct xtFormatTimeCache cache;
+	struct xtTimestamp ts;
+	char buf[64], ref[64];
+	bool ok = true;
+	memset(&cache, 0, sizeof cache);
+	// Walk across a day boundary in steps that hit and miss the cache
+	ts.sec = 1514764800U - 7200;
+	for (unsigned i = 0; i < 20000; ++i, ts.sec += i % 3 == 0) {
+		ts.nsec = (i * 7919U) % 1000000000U;
+		xtFormatTime(ref, sizeof ref, ts.sec);
+		xtsnprintf(ref + strlen(ref), sizeof ref - strlen(ref), ".%06u", ts.nsec / 1000);
+		if (!xtFormatTimeCached(buf, sizeof buf, &cache, &ts, 6) || strcmp(buf, ref)) {
+			fprintf(stderr, "expected \"%s\", but got \"%s\"\n", ref, buf);
+			ok = false;
+			break;
+		}
+	}
+	if (ok)
+		PASS("xtFormatTimeCached()");
+	else
+		FAIL("xtFormatTimeCached()");
+	if (xtFormatTimeCached(buf, sizeof buf, &cache, &ts, 0) && strlen(buf) == 19 && !xtFormatTimeCached(buf, 20, &cache, &ts, 3))
+		PASS("xtFormatTimeCached() - decimals");
+	else
+		FAIL("xtFormatTimeCached() - decimals");
+	if (xtFormatTimeNow(buf, sizeof buf, 3) && strlen(buf) == 23)
+		PASS("xtFormatTimeNow()");
+	else
+		FAIL("xtFormatTimeNow()");
+	struct xtTimestamp then, now, diff;
+	xtClockGetTime(&then, XT_CLOCK_MONOTONIC);
+	for (unsigned i = 0; i < 200000; ++i)
+		xtFormatTimePrecise(buf, sizeof buf, &ts);
+	xtClockGetTime(&now, XT_CLOCK_MONOTONIC);
+	xtTimestampDiff(&diff, &then, &now);
+	printf("xtFormatTimePrecise(): %llu ns/call\n", (diff.sec * 1000000000LLU + diff.nsec) / 200000);
+	xtClockGetTime(&then, XT_CLOCK_MONOTONIC);
+	for (unsigned i = 0; i < 200000; ++i)
+		xtFormatTimeNow(buf, sizeof buf, 3);
+	xtClockGetTime(&now, XT_CLOCK_MONOTONIC);
+	xtTimestampDiff(&diff, &then, &now);
+	printf("xtFormatTimeNow()    : %llu ns/call\n", (diff.sec * 1000000000LLU + diff.nsec) / 200000);
+}
+
 static void putString(void)
 {
 	const char *text = "Testerdetest\nWhoah, this is me, teh KING";
@@ -317,6 +364,7 @@ int main(void)
 	printFormat();
 	formatSI();
 	formatTime();
+	formatTimeCached();
 	putString();
 	stats_info(&stats);
 	return stats_status(&stats);
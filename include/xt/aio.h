@@ -0,0 +1,254 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+/**
+ * @brief Asynchronous file I/O with submission and completion queues.
+ *
+ * Requests are queued with xtAIOSubmit() and their results are reaped with
+ * xtAIOWait(), so a slow disk does not block the caller thread. On Linux the
+ * queues are the rings of io_uring and a whole batch of requests costs one
+ * system call. If io_uring is not available, a pool of threads performs the
+ * requests with blocking system calls instead.
+ *
+ * Sockets are served as well. A server accepts its connections with one
+ * multishot XT_AIO_ACCEPT request and receives with one multishot XT_AIO_RECV
+ * request per connection, which picks its buffers from a buffer ring that is
+ * registered with xtAIORegisterBufferRing(). Such requests keep producing
+ * completions until they are canceled or fail. io_uring is only used for
+ * sockets if it is created with XT_AIO_NETWORK and the kernel supports
+ * zero-copy sends (Linux 6.0). Otherwise the thread pool waits for the
+ * sockets with epoll in a thread of its own.
+ *
+ * Buffers and paths of a request must stay valid until its completion has
+ * been reaped. File descriptors are POSIX file descriptors and sockets are
+ * xtSockets, so this API is only available on Linux.
+ * @file aio.h
+ * @author Folkert van Verseveld
+ * @date 2018
+ * @copyright LGPL v3.0.
+ */
+
+#ifndef _XT_AIO_H
+#define _XT_AIO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// XT headers
+#include <xt/_base.h>
+
+// STD headers
+#include <stddef.h>
+
+/** Use the thread pool even if io_uring is available. */
+#define XT_AIO_THREADS      0x01
+/**
+ * Only use io_uring if it supports the socket operations as well. Without
+ * this flag, socket requests fail with XT_EOPNOTSUPP if io_uring is too old.
+ */
+#define XT_AIO_NETWORK      0x02
+
+/** The fd of the request is an index in the registered files. */
+#define XT_AIO_FIXED_FILE   0x01
+/** The buffer of the request lies in the registered buffer \a bufIndex. */
+#define XT_AIO_FIXED_BUFFER 0x02
+/** Only flush the data and the metadata needed to read it back. */
+#define XT_AIO_DATASYNC     0x04
+/** Keep accepting or receiving until the request is canceled or fails. */
+#define XT_AIO_MULTISHOT    0x08
+/** Receive into a buffer of the buffer ring \a bufGroup. Required for XT_AIO_MULTISHOT receives. */
+#define XT_AIO_BUFFER_SELECT 0x10
+/** Send without copying \a buf if supported, see XT_AIO_CQE_NOTIFY. */
+#define XT_AIO_ZEROCOPY     0x20
+
+/** More completions of the same request follow. */
+#define XT_AIO_CQE_MORE     0x01
+/** The buffer of a zero-copy send may be reused. This completion has no result. */
+#define XT_AIO_CQE_NOTIFY   0x02
+/** The data has been received into buffer \a bufId of the buffer ring. */
+#define XT_AIO_CQE_BUFFER   0x04
+
+/** The directory for XT_AIO_OPENAT to resolve relative paths in the working directory. */
+#define XT_AIO_CWD          (-100)
+
+/**
+ * All operations that can be performed asynchronously.
+ */
+enum xtAIOOp {
+	/** Does nothing, which is useful to wake up a waiting thread. */
+	XT_AIO_NOP,
+	/** Reads \a len bytes at \a offset from \a fd into \a buf. */
+	XT_AIO_READ,
+	/** Writes \a len bytes at \a offset from \a buf to \a fd. */
+	XT_AIO_WRITE,
+	/** Flushes \a fd to the disk. See XT_AIO_DATASYNC. */
+	XT_AIO_FSYNC,
+	/** Opens \a path relative to the directory \a fd as in openat(). */
+	XT_AIO_OPENAT,
+	/** Closes \a fd. XT_AIO_FIXED_FILE is not supported. */
+	XT_AIO_CLOSE,
+	/**
+	 * Accepts a connection on the listening socket \a fd. The result is the
+	 * new socket, which is in blocking mode. The thread pool switches \a fd
+	 * to non-blocking mode.
+	 */
+	XT_AIO_ACCEPT,
+	/** Receives up to \a len bytes from socket \a fd into \a buf. */
+	XT_AIO_RECV,
+	/** Sends \a len bytes from \a buf to socket \a fd. */
+	XT_AIO_SEND,
+	/** Sends \a msg to socket \a fd as in sendmsg(). */
+	XT_AIO_SENDMSG,
+	/**
+	 * Cancels all socket requests on \a fd, which complete with
+	 * XT_ECANCELED. The result is the number of canceled requests or the
+	 * error is XT_ENOENT if there were none.
+	 */
+	XT_AIO_CANCEL,
+};
+
+struct msghdr;
+
+/**
+ * The backend that performs the requests.
+ */
+enum xtAIOBackend {
+	XT_AIO_BACKEND_URING,
+	XT_AIO_BACKEND_THREADS,
+};
+
+/**
+ * @brief A single asynchronous operation.
+ */
+struct xtAIORequest {
+	enum xtAIOOp op;
+	/** XT_AIO_FIXED_FILE, XT_AIO_FIXED_BUFFER, XT_AIO_DATASYNC and the socket flags. */
+	unsigned flags;
+	int fd;
+	/** The registered buffer that \a buf lies in for XT_AIO_FIXED_BUFFER. */
+	unsigned bufIndex;
+	/** The buffer ring to receive into for XT_AIO_BUFFER_SELECT. */
+	unsigned bufGroup;
+	void *buf;
+	size_t len;
+	unsigned long long offset;
+	/** The path, flags and mode for XT_AIO_OPENAT as in open(). */
+	const char *path;
+	int openFlags;
+	unsigned mode;
+	/** The message for XT_AIO_SENDMSG. */
+	const struct msghdr *msg;
+	/** Passed to the completion of this request. */
+	void *userData;
+};
+
+/**
+ * @brief The result of an asynchronous operation.
+ */
+struct xtAIOCompletion {
+	/** The userData of the request. */
+	void *userData;
+	/**
+	 * The number of transferred bytes, the new file descriptor for
+	 * XT_AIO_OPENAT and XT_AIO_ACCEPT or zero. A receive of zero bytes means
+	 * that the peer has closed the connection.
+	 */
+	long long result;
+	/** Zero if the operation has succeeded, otherwise an error code. */
+	int error;
+	/**
+	 * XT_AIO_CQE_MORE, XT_AIO_CQE_NOTIFY and XT_AIO_CQE_BUFFER. A request is
+	 * finished by its first completion without XT_AIO_CQE_MORE.
+	 */
+	unsigned flags;
+	/** The buffer of the buffer ring that has been received into. */
+	unsigned bufId;
+};
+
+/**
+ * @brief Submission and completion queue for asynchronous I/O.
+ */
+struct xtAIO {
+	enum xtAIOBackend backend;
+	void *impl;
+};
+
+/**
+ * Creates the queues.
+ * @param entries - The maximum number of requests in flight.
+ * @param threads - The number of threads of the thread pool. Specify zero to
+ * use the default of four threads.
+ * @param flags - Specify XT_AIO_THREADS to always use the thread pool and
+ * XT_AIO_NETWORK to only use io_uring if it can serve sockets.
+ * @return Zero if the queues have been created, otherwise an error code.
+ */
+int xtAIOCreate(struct xtAIO *aio, unsigned entries, unsigned threads, unsigned flags);
+/**
+ * Cancels all socket requests, waits for all requests in flight and frees
+ * all resources of \a aio.
+ */
+void xtAIODestroy(struct xtAIO *aio);
+/**
+ * Registers \a count buffers for XT_AIO_FIXED_BUFFER. io_uring pins them in
+ * memory once instead of mapping them for every request. Registering replaces
+ * the previous buffers and no requests may be in flight.
+ * @return Zero if the buffers have been registered, otherwise an error code.
+ */
+int xtAIORegisterBuffers(struct xtAIO *aio, void *const *bufs, const size_t *lens, unsigned count);
+/**
+ * Registers \a count file descriptors for XT_AIO_FIXED_FILE, which saves
+ * looking them up for every request. Registering replaces the previous files
+ * and no requests may be in flight.
+ * @return Zero if the files have been registered, otherwise an error code.
+ */
+int xtAIORegisterFiles(struct xtAIO *aio, const int *fds, unsigned count);
+/**
+ * Registers buffer ring \a group with \a count buffers of \a size bytes
+ * that lie one after another at \a base. Receives with XT_AIO_BUFFER_SELECT
+ * take a buffer out of the ring and fail with XT_ENOBUFS if it is empty.
+ * Registering replaces the previous buffers of \a group, a \a count of zero
+ * unregisters it, and no requests may be in flight.
+ * @param count - The number of buffers, at most 32768.
+ * @return Zero if the buffers have been registered, otherwise an error code.
+ */
+int xtAIORegisterBufferRing(struct xtAIO *aio, unsigned group, void *base, size_t size, unsigned count);
+/**
+ * Puts buffer \a bufId back into buffer ring \a group once its data has
+ * been consumed. Must be called by the thread that reaps the completions.
+ * @return Zero if the buffer has been put back, otherwise an error code.
+ */
+int xtAIORecycleBuffer(struct xtAIO *aio, unsigned group, unsigned bufId);
+/**
+ * Queues up to \a count requests, as many as fit besides the requests in
+ * flight.
+ * @param submitted - Receives the number of queued requests.
+ * @return Zero if any request has been queued, XT_EAGAIN if the queue is
+ * full, otherwise an error code.
+ */
+int xtAIOSubmit(struct xtAIO *aio, const struct xtAIORequest *reqs, unsigned count, unsigned *submitted);
+/**
+ * Reaps up to \a max completions into \a cqes after waiting until at least
+ * \a min are available. Specify zero for \a min to only reap the completions
+ * that are ready.
+ * @param count - Receives the number of reaped completions.
+ * @return Zero on success, otherwise an error code.
+ */
+int xtAIOWait(struct xtAIO *aio, struct xtAIOCompletion *cqes, unsigned max, unsigned min, unsigned *count);
+/**
+ * Returns the number of requests in flight, whose completion has not been
+ * reaped yet.
+ */
+unsigned xtAIOPending(const struct xtAIO *aio);
+/**
+ * Returns the number of system calls that have been made to perform the
+ * requests so far. These are the io_uring_enter calls for io_uring, and the
+ * I/O and epoll calls for the thread pool. Waking up the threads of the pool
+ * is not counted.
+ */
+unsigned long long xtAIOGetSyscalls(const struct xtAIO *aio);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
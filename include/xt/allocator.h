@@ -0,0 +1,69 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+/**
+ * @brief Pluggable memory allocators.
+ *
+ * All collections accept an allocator when they are created, which they use
+ * for all of their internal memory. Specify NULL to use malloc, realloc and
+ * free. Allocators are not copied, so they must outlive the collections that
+ * use them. See xt/arena.h for an allocator that releases everything at once.
+ * @file allocator.h
+ * @author Folkert van Verseveld
+ * @date 2018
+ * @copyright LGPL v3.0.
+ */
+
+#ifndef _XT_ALLOCATOR_H
+#define _XT_ALLOCATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// XT headers
+#include <xt/_base.h>
+
+// STD headers
+#include <stddef.h>
+
+/**
+ * @brief A set of functions that manage memory.
+ *
+ * All functions receive \a arg as their first argument. The sizes of all
+ * allocations are passed back, so the allocator does not need to keep track
+ * of them.
+ */
+struct xtAllocator {
+	/** Returns \a size bytes of memory or NULL if there is not enough memory. */
+	void *(*alloc)(void *arg, size_t size);
+	/**
+	 * Resizes \a ptr of \a oldSize bytes to \a size bytes and preserves its
+	 * contents. Returns NULL and leaves \a ptr intact if there is not enough
+	 * memory.
+	 */
+	void *(*realloc)(void *arg, void *ptr, size_t oldSize, size_t size);
+	/** Releases \a ptr of \a size bytes. */
+	void (*free)(void *arg, void *ptr, size_t size);
+	void *arg;
+};
+
+/**
+ * Allocates \a size bytes with \a allocator or malloc if it is NULL.
+ */
+void *xtAllocatorAlloc(const struct xtAllocator *allocator, size_t size);
+/**
+ * Resizes \a ptr with \a allocator or realloc if it is NULL.
+ * @param ptr - The memory to resize. If this is NULL, new memory is allocated.
+ */
+void *xtAllocatorRealloc(const struct xtAllocator *allocator, void *ptr, size_t oldSize, size_t size);
+/**
+ * Releases \a ptr with \a allocator or free if it is NULL. Nothing happens if
+ * \a ptr is NULL.
+ */
+void xtAllocatorFree(const struct xtAllocator *allocator, void *ptr, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,118 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+/**
+ * @brief Bump allocator for memory that is released all at once.
+ *
+ * An arena hands out memory from big chunks by moving a pointer forward, so
+ * allocating is a few instructions and individual allocations are never
+ * freed. Instead, xtArenaReset() releases everything at once and
+ * xtArenaRewind() releases everything that has been allocated since a mark.
+ * This fits memory that lives as long as a request or a frame. Pass
+ * &arena->allocator to the collections to let them allocate in the arena as
+ * well, so destroying them becomes optional.
+ *
+ * Chunks of at least XT_ARENA_MMAP_THRESHOLD bytes are mapped directly with
+ * xtmmap(). An arena is not thread safe.
+ * @file arena.h
+ * @author Folkert van Verseveld
+ * @date 2018
+ * @copyright LGPL v3.0.
+ */
+
+#ifndef _XT_ARENA_H
+#define _XT_ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// XT headers
+#include <xt/_base.h>
+#include <xt/allocator.h>
+
+// STD headers
+#include <stddef.h>
+
+/** The default size of a chunk in bytes. */
+#define XT_ARENA_CHUNK_DEFAULT (64 * 1024)
+/** The default alignment of allocations, which suits all standard types. */
+#define XT_ARENA_ALIGN_DEFAULT 16
+/** Chunks of at least this many bytes are mapped instead of allocated. */
+#define XT_ARENA_MMAP_THRESHOLD (256 * 1024)
+
+struct xtArenaChunk;
+
+/**
+ * @brief Chunked bump allocator.
+ */
+struct xtArena {
+	/** The chunk that is allocated from. It links to the older chunks. */
+	struct xtArenaChunk *chunk;
+	/** The free space of the current chunk. */
+	char *pos, *end;
+	size_t chunkSize, align;
+	/** Allocates in this arena. Freeing only rewinds the last allocation. */
+	struct xtAllocator allocator;
+};
+
+/**
+ * @brief A position in an arena to rewind to.
+ */
+struct xtArenaMark {
+	struct xtArenaChunk *chunk;
+	char *pos;
+};
+
+/**
+ * Creates an arena and allocates its first chunk.
+ * @param chunkSize - The size of the chunks. Bigger allocations get a chunk of
+ * their own. Specify zero to use XT_ARENA_CHUNK_DEFAULT.
+ * @param align - The alignment of xtArenaAlloc(), which must be a power of
+ * two. Specify zero to use XT_ARENA_ALIGN_DEFAULT.
+ * @return Zero if the arena has been created, otherwise an error code.
+ */
+int xtArenaCreate(struct xtArena *arena, size_t chunkSize, size_t align);
+/**
+ * Releases all chunks of the arena.
+ */
+void xtArenaDestroy(struct xtArena *arena);
+/**
+ * Allocates \a size bytes with the alignment of the arena.
+ * @return The memory or NULL if there is not enough memory.
+ */
+void *xtArenaAlloc(struct xtArena *arena, size_t size);
+/**
+ * Allocates \a size bytes aligned to \a align, which must be a power of two.
+ * @return The memory or NULL if there is not enough memory or \a align is
+ * not a power of two.
+ */
+void *xtArenaAllocAligned(struct xtArena *arena, size_t size, size_t align);
+/**
+ * Resizes \a ptr of \a oldSize bytes to \a size bytes. The last allocation
+ * grows in place if it fits in its chunk, other memory is copied.
+ * @return The memory or NULL if there is not enough memory.
+ */
+void *xtArenaRealloc(struct xtArena *arena, void *ptr, size_t oldSize, size_t size);
+/**
+ * Stores the current position of \a arena in \a mark.
+ */
+void xtArenaGetMark(const struct xtArena *arena, struct xtArenaMark *mark);
+/**
+ * Releases all memory that has been allocated since \a mark was taken. Marks
+ * that have been taken after \a mark become invalid.
+ */
+void xtArenaRewind(struct xtArena *arena, const struct xtArenaMark *mark);
+/**
+ * Releases all memory of the arena. Only the first chunk is kept for reuse.
+ */
+void xtArenaReset(struct xtArena *arena);
+/**
+ * Returns the number of bytes that the chunks of the arena occupy.
+ */
+size_t xtArenaGetSize(const struct xtArena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
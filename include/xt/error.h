@@ -71,7 +71,9 @@ extern "C" {
 #define XT_ENOTSOCK        46  /* Socket operation on non-socket */
 #define XT_EXDEV           47  /* Cross-device link */
 #define XT_EUNKNOWN        48  /* Unknown error */
-#define XT_EMAXRANGE       XT_EUNKNOWN
+/* New codes come after XT_EUNKNOWN, so the existing values never change */
+#define XT_ECANCELED       49  /* Operation canceled */
+#define XT_EMAXRANGE       (XT_ECANCELED + 1)
 
 const char *xtGetErrorStr(int errnum);
 /**
@@ -0,0 +1,190 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+/**
+ * @brief Multi-threaded reactor for TCP servers.
+ *
+ * An event loop runs a number of reactor threads. Every reactor owns an
+ * xtSocketPoll, its connections and its timers, so no connection is ever
+ * touched by more than one thread and no locks are taken on the hot path.
+ * Listening sockets are sharded with SO_REUSEPORT: every reactor gets a
+ * listening socket of its own and the kernel balances the connections over
+ * them. If SO_REUSEPORT is not available, all reactors share one listening
+ * socket instead and only one of them is woken up per connection.
+ *
+ * All callbacks of a connection and all timers of a reactor are invoked by
+ * the thread of that reactor. Other threads hand work to a reactor with
+ * xtEventLoopPost(), which wakes it up through an eventfd.
+ *
+ * This API is built on epoll and eventfd, so it is only available on Linux.
+ * @file eventloop.h
+ * @author Folkert van Verseveld
+ * @date 2018
+ * @copyright LGPL v3.0.
+ */
+
+#ifndef _XT_EVENTLOOP_H
+#define _XT_EVENTLOOP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// XT headers
+#include <xt/_base.h>
+#include <xt/socket.h>
+
+// STD headers
+#include <stddef.h>
+
+/** The maximum number of connections of one reactor. */
+#define XT_EVENTLOOP_CAPACITY_DEFAULT 16384
+/** The size of the buffer that a reactor reads into. */
+#define XT_EVENTLOOP_READ_BUFFER 65536
+
+/**
+ * @brief A group of reactor threads.
+ */
+struct xtEventLoop {
+	void *impl;
+};
+
+/**
+ * @brief A connection that is owned by one reactor.
+ */
+struct xtEventLoopConn;
+
+/**
+ * @brief The callbacks of a connection.
+ *
+ * Every callback may be NULL. A connection may be written to and closed from
+ * within its callbacks.
+ */
+struct xtEventLoopConnCallbacks {
+	/**
+	 * Invoked when \a len bytes have arrived. The data is only valid during
+	 * the call.
+	 */
+	void (*data)(struct xtEventLoopConn *conn, const void *buf, size_t len, void *arg);
+	/** Invoked when all queued data has been sent. */
+	void (*drain)(struct xtEventLoopConn *conn, void *arg);
+	/**
+	 * Invoked once when the connection is closed. \a error is zero if the
+	 * peer or xtEventLoopConnClose() has closed the connection, otherwise
+	 * an error code. The connection is freed after this call.
+	 */
+	void (*close)(struct xtEventLoopConn *conn, int error, void *arg);
+};
+
+/**
+ * @brief A timer of a reactor.
+ *
+ * The memory of a timer is owned by the caller and must stay valid while the
+ * timer is running. Zero a timer before it is started for the first time.
+ * You should threat this struct as if it were opaque.
+ */
+struct xtEventLoopTimer {
+	void (*func)(struct xtEventLoopTimer *timer, void *arg);
+	void *arg;
+	struct xtEventLoopTimer *next, **pprev;
+	/* The reactor that has started the timer */
+	void *reactor;
+	unsigned long long expires;
+	unsigned interval;
+};
+
+/**
+ * Creates and starts \a loops reactor threads.
+ * @param loops - The number of reactors. Specify zero for one reactor per
+ * online processor.
+ * @param capacity - The maximum number of connections per reactor. Specify
+ * zero for XT_EVENTLOOP_CAPACITY_DEFAULT.
+ * @return Zero if the reactors are running, otherwise an error code.
+ */
+int xtEventLoopCreate(struct xtEventLoop *loop, unsigned loops, unsigned capacity);
+/**
+ * Stops all reactors and waits for them. Every reactor closes its listening
+ * sockets and connections first, so the close callbacks are still invoked.
+ * Must not be called from a reactor thread.
+ */
+void xtEventLoopDestroy(struct xtEventLoop *loop);
+/**
+ * Returns the number of reactors.
+ */
+unsigned xtEventLoopGetCount(const struct xtEventLoop *loop);
+/**
+ * Returns the index of the reactor of the caller thread, or -1 if the
+ * caller is not a reactor thread of \a loop.
+ */
+int xtEventLoopGetCurrent(const struct xtEventLoop *loop);
+/**
+ * Accepts TCP connections on \a sa in all reactors.
+ * @param sa - The address to listen on. If its port is zero, a free port is
+ * chosen and written back to \a sa.
+ * @param backlog - The backlog of every listening socket.
+ * @param func - Invoked in the reactor that accepted the connection. Assign
+ * the callbacks of the connection with xtEventLoopConnSetCallbacks() or close
+ * it right away.
+ * @return Zero if all reactors are listening, otherwise an error code.
+ */
+int xtEventLoopListen(struct xtEventLoop *loop, struct xtSockaddr *sa, unsigned backlog, void (*func)(struct xtEventLoopConn *conn, const struct xtSockaddr *peer, void *arg), void *arg);
+/**
+ * Lets reactor \a index invoke \a func as soon as possible. This may be
+ * called from any thread, and is the only way to touch the connections and
+ * timers of a reactor from another thread.
+ * @return Zero if \a func has been queued, XT_ESHUTDOWN if the reactor is
+ * stopping, otherwise an error code.
+ */
+int xtEventLoopPost(struct xtEventLoop *loop, unsigned index, void (*func)(void *arg), void *arg);
+/**
+ * Starts \a timer in the reactor of the caller thread. Running timers are
+ * restarted. The timer wheel has a resolution of one millisecond.
+ * @param ms - The milliseconds until \a func is invoked.
+ * @param interval - The milliseconds between the following invocations, or
+ * zero to invoke \a func once.
+ * @return Zero if the timer has been started, otherwise XT_EINVAL if the
+ * caller is not a reactor thread or \a timer runs in another reactor.
+ */
+int xtEventLoopTimerStart(struct xtEventLoop *loop, struct xtEventLoopTimer *timer, unsigned ms, unsigned interval, void (*func)(struct xtEventLoopTimer *timer, void *arg), void *arg);
+/**
+ * Stops \a timer if it is running. Must be called by the reactor that has
+ * started the timer, which includes the callback of the timer itself. Other
+ * threads have to use xtEventLoopPost() instead.
+ * @return Zero if the timer is not running anymore, otherwise XT_EINVAL if
+ * the caller is not a reactor thread or \a timer runs in another reactor.
+ */
+int xtEventLoopTimerStop(struct xtEventLoopTimer *timer);
+/**
+ * Assigns the callbacks of \a conn. The callbacks are copied.
+ */
+void xtEventLoopConnSetCallbacks(struct xtEventLoopConn *conn, const struct xtEventLoopConnCallbacks *cb, void *arg);
+/**
+ * Sends \a len bytes. What cannot be sent right away is queued and sent as
+ * soon as the socket is writable again.
+ * @return Zero if the data has been sent or queued, otherwise an error code.
+ * If part of the data has been sent but the rest cannot be queued, the
+ * connection is closed with XT_ENOMEM, since the stream would be incomplete.
+ */
+int xtEventLoopConnWrite(struct xtEventLoopConn *conn, const void *buf, size_t len);
+/**
+ * Closes \a conn and invokes its close callback. Queued data that has not
+ * been sent yet is discarded.
+ */
+void xtEventLoopConnClose(struct xtEventLoopConn *conn);
+/**
+ * Returns the socket of \a conn.
+ */
+xtSocket xtEventLoopConnGetSocket(const struct xtEventLoopConn *conn);
+/**
+ * Returns the number of bytes that are queued for sending.
+ */
+size_t xtEventLoopConnGetPending(const struct xtEventLoopConn *conn);
+/**
+ * Returns the index of the reactor that owns \a conn.
+ */
+unsigned xtEventLoopConnGetIndex(const struct xtEventLoopConn *conn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
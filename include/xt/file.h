@@ -90,11 +90,26 @@ enum xtFileAccessMode {
 int xtFileAccess(const char *path, enum xtFileAccessMode mode);
 /**
  * Copies the file from \a src to \a dst.
+ * On Linux the file is cloned if the file system supports it, otherwise it is
+ * copied within the kernel with copy_file_range() or sendfile() and only then
+ * through a buffer. Holes in sparse files are preserved.
  * @return Zero if the file has been copied, otherwise an error code.
  */
 int xtFileCopy(const char *restrict src, const char *restrict dst);
 /**
- * Copies the file from \a src to \dst by their handle.
+ * Copies the file from \a src to \a dst, see xtFileCopy().
+ * @param progress - Called after every chunk of at most 64MB with the number
+ * of bytes of \a src that have been copied, including holes, and the size of
+ * \a src, which is zero if the size is unknown. Return nonzero to stop
+ * copying. Specify NULL to ignore the progress.
+ * @param arg - Passed to \a progress.
+ * @return Zero if the file has been copied, XT_ECANCELED if \a progress has
+ * stopped the copy, otherwise an error code.
+ */
+int xtFileCopyProgress(const char *restrict src, const char *restrict dst, int (*progress)(unsigned long long copied, unsigned long long total, void *arg), void *arg);
+/**
+ * Copies the file from \a src to \dst by their handle, see xtFileCopy().
+ * \a dst is truncated to the size of \a src.
  * @return Zero if the file has been copied, otherwise an error code.
  * @remarks On success the stream position indicator is set to the beginning of
  * both files. On error, the position of the indicator is undefined. The file
@@ -23,6 +23,7 @@ extern "C" {
 
 // XT headers
 #include <xt/_base.h>
+#include <xt/allocator.h>
 
 // STD headers
 #include <stdbool.h>
@@ -72,6 +73,7 @@ struct xtHashmap {
 	size_t (*keyHash) (const void *key);
 	bool (*keyCompare)(const void *key1, const void *key2);
 	struct xtHashmapIterator it;
+	const struct xtAllocator *allocator;
 };
 /**
  * Adds an element to the hashmap.
@@ -92,6 +94,17 @@ int xtHashmapCreate(
 	struct xtHashmap *map, size_t capacity,
 	size_t (*keyHash) (const void*), bool (*keyCompare) (const void*, const void*)
 );
+/**
+ * Creates a hashmap whose buckets are allocated by \a allocator. See xtHashmapCreate().
+ * @param allocator - The allocator for the buckets. Specify NULL to use malloc.
+ * @remarks The keys and values are still released with free() if the hashmap is
+ * configured to free them.
+ */
+int xtHashmapCreateAllocator(
+	struct xtHashmap *map, size_t capacity,
+	size_t (*keyHash) (const void*), bool (*keyCompare) (const void*, const void*),
+	const struct xtAllocator *allocator
+);
 
 void xtHashmapDestroy(struct xtHashmap *map);
 /**
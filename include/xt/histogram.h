@@ -0,0 +1,132 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+/**
+ * @brief Latency histogram with log-linear buckets.
+ *
+ * Values are counted in buckets whose width grows with the magnitude of the
+ * value, so the relative error is bounded by the amount of significant digits
+ * while the memory usage is fixed at creation. Recording a value is O(1) and
+ * does not allocate. A histogram is not thread safe: give each thread its own
+ * histogram and merge them when the results are needed.
+ * @file histogram.h
+ * @author Folkert van Verseveld
+ * @date 2018
+ * @copyright LGPL v3.0.
+ */
+
+#ifndef _XT_HISTOGRAM_H
+#define _XT_HISTOGRAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// XT headers
+#include <xt/_base.h>
+#include <xt/time.h>
+
+// STD headers
+#include <stddef.h>
+
+/**
+ * The default highest trackable value: one hour in nanoseconds.
+ */
+#define XT_HISTOGRAM_HIGHEST_DEFAULT 3600000000000LLU
+/**
+ * The default amount of significant decimal digits.
+ */
+#define XT_HISTOGRAM_DIGITS_DEFAULT 3
+
+/**
+ * @brief Fixed size log-linear histogram.
+ *
+ * Do not modify any member directly.
+ */
+struct xtHistogram {
+	unsigned long long *counts;
+	size_t length;
+	unsigned long long highest;
+	unsigned long long count, sum, min, max;
+	unsigned bits, digits;
+};
+/**
+ * Creates a histogram that can track values from zero up to \a highest with
+ * a relative error of at most one unit in the last of \a digits significant
+ * decimal digits.
+ * @param highest - The highest trackable value. Larger values are counted in
+ * the last bucket. Specify zero to use XT_HISTOGRAM_HIGHEST_DEFAULT.
+ * @param digits - The amount of significant digits, ranging from 1 to 5.
+ * Specify zero to use XT_HISTOGRAM_DIGITS_DEFAULT.
+ * @return Zero if the histogram has been created, otherwise an error code.
+ */
+int xtHistogramCreate(struct xtHistogram *h, unsigned long long highest, unsigned digits);
+/**
+ * Releases all memory of the histogram.
+ */
+void xtHistogramDestroy(struct xtHistogram *h);
+/**
+ * Renders a summary of the histogram in the specified format. All values are
+ * treated as nanoseconds and rendered with the largest fitting unit, e.g.
+ * "850ns", "12.30us", "4.56ms" or "1.20s".
+ * The following arguments are supported:
+ * * %c - Number of recorded values
+ * * %m - Minimum value
+ * * %M - Maximum value
+ * * %a - Mean value
+ * * %p<percentile> - Value at the specified percentile, e.g. %p99.9
+ * @param format - The format string.
+ * @returns Number of written characters to buffer. Zero is returned on failure.
+ */
+unsigned xtHistogramFormat(char *buf, size_t buflen, const char *format, const struct xtHistogram *h);
+/**
+ * Returns the number of recorded values.
+ */
+unsigned long long xtHistogramGetCount(const struct xtHistogram *h);
+/**
+ * Returns the exact largest recorded value or zero if the histogram is empty.
+ */
+unsigned long long xtHistogramGetMax(const struct xtHistogram *h);
+/**
+ * Returns the exact mean of all recorded values or zero if the histogram is
+ * empty.
+ */
+double xtHistogramGetMean(const struct xtHistogram *h);
+/**
+ * Returns the exact smallest recorded value or zero if the histogram is empty.
+ */
+unsigned long long xtHistogramGetMin(const struct xtHistogram *h);
+/**
+ * Returns the value below which \a percentile percent of all recorded values
+ * fall. The value is the highest value that is equivalent to the bucket the
+ * percentile falls into, but never more than the maximum.
+ * @param percentile - The percentile ranging from 0 to 100.
+ */
+unsigned long long xtHistogramGetPercentile(const struct xtHistogram *h, double percentile);
+/**
+ * Adds all values of \a src to \a dst. Both histograms must have been
+ * created with the same amount of significant digits.
+ * @return Zero if merged, otherwise an error code.
+ */
+int xtHistogramMerge(struct xtHistogram *dst, const struct xtHistogram *src);
+/**
+ * Records a single value.
+ */
+void xtHistogramRecord(struct xtHistogram *h, unsigned long long value);
+/**
+ * Records the time elapsed between \a start and \a end in nanoseconds.
+ */
+void xtHistogramRecordDuration(struct xtHistogram *h, const struct xtTimestamp *start, const struct xtTimestamp *end);
+/**
+ * Records \a value \a count times.
+ */
+void xtHistogramRecordN(struct xtHistogram *h, unsigned long long value, unsigned long long count);
+/**
+ * Removes all recorded values.
+ */
+void xtHistogramReset(struct xtHistogram *h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
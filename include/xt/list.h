@@ -21,6 +21,7 @@ extern "C" {
 
 // XT headers
 #include <xt/_base.h>
+#include <xt/allocator.h>
 
 // STD headers
 #include <stdbool.h>
@@ -51,6 +52,7 @@ struct xtListHD {
 	size_t count, capacity;
 	int grow;
 	unsigned flags;
+	const struct xtAllocator *allocator;
 };
 
 struct xtListD {
@@ -58,6 +60,7 @@ struct xtListD {
 	size_t count, capacity;
 	int grow;
 	unsigned flags;
+	const struct xtAllocator *allocator;
 };
 
 struct xtListU {
@@ -65,6 +68,7 @@ struct xtListU {
 	size_t count, capacity;
 	int grow;
 	unsigned flags;
+	const struct xtAllocator *allocator;
 };
 
 struct xtListLU {
@@ -72,6 +76,7 @@ struct xtListLU {
 	size_t count, capacity;
 	int grow;
 	unsigned flags;
+	const struct xtAllocator *allocator;
 };
 
 struct xtListZU {
@@ -79,6 +84,7 @@ struct xtListZU {
 	size_t count, capacity;
 	int grow;
 	unsigned flags;
+	const struct xtAllocator *allocator;
 };
 
 struct xtListP {
@@ -86,6 +92,7 @@ struct xtListP {
 	size_t count, capacity;
 	int grow;
 	unsigned flags;
+	const struct xtAllocator *allocator;
 };
 /**
  * Attempts to add some data to the list.
@@ -131,6 +138,18 @@ int xtListUCreate (struct xtListU  *list, size_t capacity);
 int xtListLUCreate(struct xtListLU *list, size_t capacity);
 int xtListZUCreate(struct xtListZU *list, size_t capacity);
 int xtListPCreate (struct xtListP  *list, size_t capacity);
+/**
+ * Creates a new list whose elements are allocated by \a allocator.
+ * @param allocator - The allocator for the elements. Specify NULL to use malloc.
+ * @remarks Items of an xtListP are still released with free() if the list is
+ * configured to free them.
+ */
+int xtListHDCreateAllocator(struct xtListHD *list, size_t capacity, const struct xtAllocator *allocator);
+int xtListDCreateAllocator (struct xtListD  *list, size_t capacity, const struct xtAllocator *allocator);
+int xtListUCreateAllocator (struct xtListU  *list, size_t capacity, const struct xtAllocator *allocator);
+int xtListLUCreateAllocator(struct xtListLU *list, size_t capacity, const struct xtAllocator *allocator);
+int xtListZUCreateAllocator(struct xtListZU *list, size_t capacity, const struct xtAllocator *allocator);
+int xtListPCreateAllocator (struct xtListP  *list, size_t capacity, const struct xtAllocator *allocator);
 
 void xtListHDDestroy(struct xtListHD *list);
 void xtListDDestroy (struct xtListD  *list);
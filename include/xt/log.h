@@ -0,0 +1,119 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+/**
+ * @brief Asynchronous logging.
+ *
+ * Log calls only capture their arguments into a ring buffer that is owned by
+ * the calling thread. Formatting and writing is done by a background thread,
+ * so logging threads never contend on a lock or wait on I/O.
+ * @file log.h
+ * @author Folkert van Verseveld
+ * @date 2018
+ * @copyright LGPL v3.0.
+ */
+
+#ifndef _XT_LOG_H
+#define _XT_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// XT headers
+#include <xt/_base.h>
+#include <xt/string.h>
+
+// STD headers
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * The severity of a log message. Messages below the current log level are
+ * discarded right away.
+ */
+enum xtLogLevel {
+	XT_LOG_TRACE,
+	XT_LOG_DEBUG,
+	XT_LOG_INFO,
+	XT_LOG_WARN,
+	XT_LOG_ERROR,
+	XT_LOG_FATAL
+};
+/**
+ * The default size in bytes of the ring buffer of each thread.
+ */
+#define XT_LOG_RING_SIZE 65536
+/**
+ * The maximum number of arguments of a log message, including any '*' width
+ * and precision. Messages with more arguments are dropped.
+ */
+#define XT_LOG_MAX_ARGS 32
+/**
+ * Logs a message if \a level is at least the current log level. The first
+ * variadic argument is the format string which accepts the same conversions
+ * as xtsnprintf(), except for positional arguments. The format is compiled
+ * once per call site and narrow strings are copied, but any other pointer
+ * argument must remain valid until the message has been written.
+ * If the ring buffer of the caller thread is full, the message is dropped.
+ * Messages with a \a level that is not an xtLogLevel are discarded.
+ */
+#define xtLog(level, ...) do { \
+	static struct xtFormat *_xt_log_format; \
+	_xtLogWrite(level, &_xt_log_format, __VA_ARGS__); \
+} while (0)
+#define xtLogTrace(...) xtLog(XT_LOG_TRACE, __VA_ARGS__)
+#define xtLogDebug(...) xtLog(XT_LOG_DEBUG, __VA_ARGS__)
+#define xtLogInfo(...)  xtLog(XT_LOG_INFO, __VA_ARGS__)
+#define xtLogWarn(...)  xtLog(XT_LOG_WARN, __VA_ARGS__)
+#define xtLogError(...) xtLog(XT_LOG_ERROR, __VA_ARGS__)
+#define xtLogFatal(...) xtLog(XT_LOG_FATAL, __VA_ARGS__)
+/**
+ * Blocks until all messages that have been logged so far are written.
+ */
+void xtLogFlush(void);
+/**
+ * Returns the current log level.
+ */
+enum xtLogLevel xtLogGetLevel(void);
+/**
+ * Sets the minimum level that messages must have in order to be logged.
+ */
+void xtLogSetLevel(enum xtLogLevel level);
+/**
+ * Limits the amount of messages that each thread may log per second. Any
+ * messages beyond the limit are suppressed and only their count is reported.
+ * @param perSecond - Maximum messages per second. Specify zero to disable.
+ */
+void xtLogSetRateLimit(unsigned perSecond);
+/**
+ * Starts the background thread that writes all log messages.
+ * Each line contains a timestamp from XT_CLOCK_REALTIME_COARSE, the level and
+ * the formatted message.
+ * @param stream - The stream to write to.
+ * @param level - The minimum log level.
+ * @param ringSize - The size in bytes of the ring buffer of each thread.
+ * Specify zero to use XT_LOG_RING_SIZE.
+ * @return Zero if started, otherwise an error code.
+ */
+int xtLogStart(FILE *stream, enum xtLogLevel level, size_t ringSize);
+/**
+ * Writes all pending messages and stops the background thread. All ring
+ * buffers are released. Nothing may be logged while this function runs.
+ */
+void xtLogStop(void);
+/**
+ * Releases the ring buffer of the caller thread once all of its messages have
+ * been written. Call this before a thread that has logged terminates,
+ * otherwise its ring buffer is only released by xtLogStop().
+ */
+void xtLogThreadDetach(void);
+/**
+ * Use the xtLog macros rather than calling this directly.
+ */
+void _xtLogWrite(enum xtLogLevel level, struct xtFormat **cache, const char *format, ...);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,6 +19,9 @@
 
 #include <sys/types.h>
 
+#include <stdbool.h>
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -35,6 +38,11 @@ extern "C" {
 #define XT_MMAN_MAP_FIXED       0x10
 #define XT_MMAN_MAP_ANONYMOUS   0x20
 #define XT_MMAN_MAP_ANON        XT_MMAN_MAP_ANONYMOUS
+/* Linux only flags, which are ignored on Windows. */
+#define XT_MMAN_MAP_HUGETLB     0x40
+#define XT_MMAN_MAP_POPULATE    0x80
+#define XT_MMAN_MAP_NORESERVE   0x100
+#define XT_MMAN_MAP_LOCKED      0x200
 
 #define XT_MMAN_MAP_FAILED      ((void*)-1)
 
@@ -46,6 +54,15 @@ extern "C" {
 #define XT_MMAN_MREMAP_MAYMOVE 1
 #define XT_MMAN_MREMAP_FIXED   2
 
+/* Advice for xtmadvise. */
+#define XT_MMAN_MADV_NORMAL      0
+#define XT_MMAN_MADV_RANDOM      1
+#define XT_MMAN_MADV_SEQUENTIAL  2
+#define XT_MMAN_MADV_WILLNEED    3
+#define XT_MMAN_MADV_DONTNEED    4
+#define XT_MMAN_MADV_HUGEPAGE    5
+#define XT_MMAN_MADV_NOHUGEPAGE  6
+
 /**
  * @brief map files or devices into memory
  * Create a new mapping in the virtual address space of the calling process.
@@ -65,6 +82,113 @@ int xtmunlock(const void *addr, size_t len);
  * NOTE: Only XT_MMAN_MREMAP_MAYMOVE is accepted on Windows and any other value fails with XT_EINVAL!
  */
 void *xtmremap(void *old_address, size_t old_size, size_t new_size, int flags, ... /* void *new_address */);
+/**
+ * @brief give advice about use of memory
+ * Tells the kernel how the range is going to be accessed, so it can choose
+ * appropriate read-ahead and caching techniques.
+ * NOTE: The advice is ignored on Windows.
+ */
+int xtmadvise(void *addr, size_t len, int advice);
+/**
+ * Allocates \a size bytes of zeroed memory that is backed by huge pages if
+ * possible, which makes random access to large tables and buffers far
+ * cheaper because they need far fewer TLB entries. On Linux, reserved huge
+ * pages are used if there are enough, otherwise the memory is aligned to huge
+ * pages and transparent huge pages are requested for it. If neither is
+ * available, normal pages are used.
+ * @return The memory, or NULL if it could not be allocated.
+ */
+void *xtHugeAlloc(size_t size);
+/**
+ * Frees memory that has been allocated with xtHugeAlloc().
+ * @param size - The size that has been passed to xtHugeAlloc().
+ */
+void xtHugeFree(void *ptr, size_t size);
+
+/** Map the file for reading and writing instead of reading only. */
+#define XT_MAPPED_FILE_WRITE    0x01
+/** Create the file if it does not exist. Requires XT_MAPPED_FILE_WRITE. */
+#define XT_MAPPED_FILE_CREATE   0x02
+/** Read the whole file and fill in the page tables while mapping it. */
+#define XT_MAPPED_FILE_POPULATE 0x04
+
+/**
+ * How the mapping is going to be accessed, see xtMappedFileAdvise().
+ */
+enum xtMappedFileAdvice {
+	/** The default read-ahead. */
+	XT_MAPPED_FILE_NORMAL,
+	/** Read ahead aggressively and drop pages soon after they are read. */
+	XT_MAPPED_FILE_SEQUENTIAL,
+	/** Do not read ahead. */
+	XT_MAPPED_FILE_RANDOM,
+	/** Start reading the range in the background. */
+	XT_MAPPED_FILE_WILLNEED,
+	/** Drop the range, which is read from the file again when accessed. */
+	XT_MAPPED_FILE_DONTNEED,
+	/** Back the range with transparent huge pages if possible. */
+	XT_MAPPED_FILE_HUGEPAGE,
+};
+
+/**
+ * @brief A file that is mapped in memory as a whole.
+ */
+struct xtMappedFile {
+	/** The contents of the file, or NULL if it is empty. */
+	void *data;
+	/** The size of the file and the mapping in bytes. */
+	size_t size;
+	int fd;
+	unsigned flags;
+};
+
+/**
+ * Opens and maps the file \a path. Writes to the mapping are written back to
+ * the file. This is much cheaper than reading the file with fread(), because
+ * the pages of the page cache are mapped directly instead of being copied.
+ * @param size - The size of the mapping. Specify zero to map the whole file.
+ * If the file is smaller and XT_MAPPED_FILE_WRITE is specified, the file is
+ * grown to \a size.
+ * @param flags - Any of XT_MAPPED_FILE_WRITE, XT_MAPPED_FILE_CREATE and
+ * XT_MAPPED_FILE_POPULATE.
+ * @return Zero if the file has been mapped, XT_EINVAL if \a size exceeds the
+ * size of a read-only file, otherwise an error code.
+ * @remarks Only available on Linux.
+ */
+int xtMappedFileOpen(struct xtMappedFile *mf, const char *path, size_t size, unsigned flags);
+/**
+ * Changes the size of the file and its mapping. The mapping may move, so
+ * pointers into \a mf->data are invalidated.
+ * @return Zero if the file has been resized, otherwise an error code.
+ */
+int xtMappedFileResize(struct xtMappedFile *mf, size_t size);
+/**
+ * Tells the kernel how \a len bytes at \a offset are going to be accessed.
+ * The range is extended to whole pages.
+ * @param len - The number of bytes. Specify zero for the rest of the mapping.
+ * @return Zero on success, otherwise an error code.
+ */
+int xtMappedFileAdvise(struct xtMappedFile *mf, size_t offset, size_t len, enum xtMappedFileAdvice advice);
+/**
+ * Reads \a len bytes at \a offset into memory and fills in the page tables,
+ * so accessing them later does not fault. Unlike XT_MAPPED_FILE_WILLNEED,
+ * this waits until the pages have been read.
+ * @param len - The number of bytes. Specify zero for the rest of the mapping.
+ * @return Zero on success, otherwise an error code.
+ */
+int xtMappedFilePrefault(struct xtMappedFile *mf, size_t offset, size_t len);
+/**
+ * Writes the modified pages back to the file.
+ * @param wait - Whether to wait until they have been written.
+ * @return Zero on success, otherwise an error code.
+ */
+int xtMappedFileSync(struct xtMappedFile *mf, bool wait);
+/**
+ * Unmaps and closes the file. Modified pages are written back to the file
+ * eventually, see xtMappedFileSync().
+ * @return Zero on success, otherwise an error code.
+ */
+int xtMappedFileClose(struct xtMappedFile *mf);
 
 #ifdef __cplusplus
 }
@@ -22,6 +22,7 @@ extern "C" {
 #if defined(__gnu_linux__)
 	#define XT_IS_LINUX 1
 	#include <limits.h>
+	#include <stdint.h>
 	#if UINTPTR_MAX == 0x0FFFFFFFFFFFFFFFFLLU
 		#define XT_IS_X64 1
 	#elif UINTPTR_MAX == 0x0FFFFFFFF
@@ -0,0 +1,114 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+/**
+ * @brief Thread-safe pool of equally sized objects.
+ *
+ * A pool recycles objects of one size class, such as connections or nodes,
+ * that are allocated and freed all the time. Every thread caches objects in
+ * two magazines of its own, so most allocations and frees do not touch any
+ * shared memory. Threads exchange full and empty magazines through a
+ * lock-free depot, and only when the depot has nothing to offer, objects are
+ * carved from big slabs under a lock.
+ *
+ * The memory of a pool is never given back to the system before the pool is
+ * destroyed. Every thread that has used a pool should call
+ * xtPoolThreadDetach() before it terminates, otherwise its cached objects are
+ * only reclaimed by xtPoolDestroy().
+ * @file pool.h
+ * @author Folkert van Verseveld
+ * @date 2018
+ * @copyright LGPL v3.0.
+ */
+
+#ifndef _XT_POOL_H
+#define _XT_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// XT headers
+#include <xt/_base.h>
+
+// STD headers
+#include <stddef.h>
+
+/** The number of objects a magazine can hold. */
+#define XT_POOL_MAGAZINE_SIZE 32
+/** The maximum length of the name of a pool including the terminator. */
+#define XT_POOL_NAME_MAX 32
+
+/**
+ * @brief Pool of objects of one size class.
+ */
+struct xtPool {
+	void *impl;
+};
+
+/**
+ * @brief Usage statistics of a pool.
+ */
+struct xtPoolStats {
+	char name[XT_POOL_NAME_MAX];
+	/** The size of the objects, rounded up to their alignment. */
+	size_t objectSize;
+	/** The bytes of all slabs and magazines of the pool. */
+	size_t size;
+	/** The number of objects that have been carved from the slabs. */
+	size_t objects;
+	/** The number of objects that have been allocated and not freed yet. */
+	size_t inUse;
+	/** The number of full and empty magazines in the depot. */
+	size_t fullMagazines, emptyMagazines;
+	unsigned long long allocs, frees;
+};
+
+/**
+ * Creates a pool for objects of \a objectSize bytes.
+ * @param name - Identifies the pool in the statistics. Longer names are
+ * truncated to XT_POOL_NAME_MAX - 1 characters.
+ * @param align - The alignment of the objects, which must be a power of two.
+ * Specify zero to align them to 16 bytes.
+ * @return Zero if the pool has been created, otherwise an error code.
+ */
+int xtPoolCreate(struct xtPool *pool, const char *name, size_t objectSize, size_t align);
+/**
+ * Releases all objects and memory of the pool at once. No thread may use the
+ * pool anymore, but threads do not have to detach first.
+ */
+void xtPoolDestroy(struct xtPool *pool);
+/**
+ * Allocates an object. Its contents are undefined.
+ * @return The object or NULL if there is not enough memory.
+ */
+void *xtPoolAlloc(struct xtPool *pool);
+/**
+ * Gives \a ptr back to the pool. Any thread may free an object, not just the
+ * thread that has allocated it. Nothing happens if \a ptr is NULL.
+ */
+void xtPoolFree(struct xtPool *pool, void *ptr);
+/**
+ * Hands the cached objects of the caller thread back to the pool and releases
+ * the cache of the thread.
+ */
+void xtPoolThreadDetach(struct xtPool *pool);
+/**
+ * Retrieves the statistics of \a pool. The counters of other threads may lag
+ * slightly behind.
+ */
+void xtPoolGetStats(const struct xtPool *pool, struct xtPoolStats *stats);
+/**
+ * Retrieves the statistics of up to \a count pools of this process.
+ * @return The number of pools that exist, which may be more than \a count.
+ */
+size_t xtPoolGetAllStats(struct xtPoolStats *stats, size_t count);
+/**
+ * Returns the bytes of all slabs and magazines of all pools of this process.
+ */
+size_t xtPoolGetTotalSize(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -54,6 +54,11 @@ struct xtProcMemoryInfo {
 	unsigned long long swap;
 	/** Peak virtual memory size. */
 	unsigned long long vmPeak;
+	/**
+	 * The memory that all xtPools have reserved. This is only known for the
+	 * current process and zero otherwise.
+	 */
+	unsigned long long pool;
 };
 /**
  * All supported signals that can be sent to processes.
@@ -21,6 +21,7 @@ extern "C" {
 
 // XT headers
 #include <xt/_base.h>
+#include <xt/allocator.h>
 
 // STD headers
 #include <stdbool.h>
@@ -32,30 +33,35 @@ struct xtQueueHD {
 	short *data;
 	size_t count, capacity, front, rear;
 	int grow;
+	const struct xtAllocator *allocator;
 };
 
 struct xtQueueD {
 	int *data;
 	size_t count, capacity, front, rear;
 	int grow;
+	const struct xtAllocator *allocator;
 };
 
 struct xtQueueU {
 	unsigned *data;
 	size_t count, capacity, front, rear;
 	int grow;
+	const struct xtAllocator *allocator;
 };
 
 struct xtQueueLU {
 	unsigned long *data;
 	size_t count, capacity, front, rear;
 	int grow;
+	const struct xtAllocator *allocator;
 };
 
 struct xtQueueZU {
 	size_t *data;
 	size_t count, capacity, front, rear;
 	int grow;
+	const struct xtAllocator *allocator;
 };
 
 void xtQueueHDInit(struct xtQueueHD *queue);
@@ -69,6 +75,15 @@ int xtQueueDCreate (struct xtQueueD  *queue, size_t capacity);
 int xtQueueUCreate (struct xtQueueU  *queue, size_t capacity);
 int xtQueueLUCreate(struct xtQueueLU *queue, size_t capacity);
 int xtQueueZUCreate(struct xtQueueZU *queue, size_t capacity);
+/**
+ * Creates a new queue whose elements are allocated by \a allocator.
+ * @param allocator - The allocator for the elements. Specify NULL to use malloc.
+ */
+int xtQueueHDCreateAllocator(struct xtQueueHD *queue, size_t capacity, const struct xtAllocator *allocator);
+int xtQueueDCreateAllocator (struct xtQueueD  *queue, size_t capacity, const struct xtAllocator *allocator);
+int xtQueueUCreateAllocator (struct xtQueueU  *queue, size_t capacity, const struct xtAllocator *allocator);
+int xtQueueLUCreateAllocator(struct xtQueueLU *queue, size_t capacity, const struct xtAllocator *allocator);
+int xtQueueZUCreateAllocator(struct xtQueueZU *queue, size_t capacity, const struct xtAllocator *allocator);
 /**
  * Changes grow policy. Positive values indicate fixed growth.
  * Negative values is relative growth. Zero disables growth.
@@ -27,6 +27,7 @@ extern "C" {
 
 // XT headers
 #include <xt/_base.h>
+#include <xt/allocator.h>
 #include <xt/os_macros.h>
 
 // STD headers
@@ -136,6 +137,61 @@ enum xtSocketProto {
  * However, no normal packet should have this huge header, or a payload of this size.
  */
 #define XT_SOCKET_UDP_MAXIMUM_PAYLOAD_SIZE 65507
+/**
+ * @brief A buffer of a scatter-gather read or write.
+ *
+ * This struct is POD with the layout of struct iovec on Linux and WSABUF on Windows,
+ * so arrays of it are handed to the system as they are.
+ */
+struct xtSocketIOVec {
+#if XT_IS_LINUX
+	void *base;
+	size_t len;
+#elif XT_IS_WINDOWS
+	unsigned long len;
+	void *base;
+#endif
+};
+/**
+ * More data follows, so a partial frame may be held back until the next write (MSG_MORE).
+ * Ignored on Windows.
+ */
+#define XT_SOCKET_MSG_MORE     0x01
+/**
+ * Sends the data without copying it (MSG_ZEROCOPY). SO_ZEROCOPY must be enabled with xtSocketSetSoZeroCopy(),
+ * and the data must stay untouched until xtSocketTCPZeroCopyPoll() reports the write to be completed.
+ * Ignored on Windows.
+ */
+#define XT_SOCKET_MSG_ZEROCOPY 0x02
+/**
+ * The maximum number of datagrams that are handed to the system at once by xtSocketUDPReadBatch() and xtSocketUDPWriteBatch().
+ */
+#define XT_SOCKET_UDP_BATCH 64
+/**
+ * @brief A datagram of a batched UDP read or write.
+ */
+struct xtSocketUDPMessage {
+	void *buf;
+	/** The size of \a buf on read, the amount of bytes to send on write. */
+	size_t buflen;
+	/** Receives the amount of bytes that have been read or sent. */
+	size_t len;
+	/**
+	 * Receives the address of the sender on read, contains the address of the destination on write.
+	 * May be NULL on read, and on write for a connected UDP socket.
+	 */
+	struct xtSockaddr *addr;
+	/**
+	 * On write, the kernel splits \a buf into datagrams of this size (UDP_SEGMENT), so up to 64 datagrams are sent as one.
+	 * On read, receives the size of the datagrams that the kernel has coalesced into \a buf (UDP_GRO).
+	 * Zero means that \a buf is one datagram.
+	 */
+	unsigned segmentSize;
+	/**
+	 * Set on read if the datagram did not fit in \a buf. Only the first \a buflen bytes have been read, the rest is lost.
+	 */
+	bool truncated;
+};
 /**
  * Binds the socket to the specified interface.
  * @param port - The port to bind to. Port 0 lets the kernel pick a random port.
@@ -229,11 +285,25 @@ int xtSocketGetSoReceiveBufferSize(xtSocket sock, unsigned *size);
  * @return Zero if the property has been fetched successfully, otherwise an error code.
  */
 int xtSocketGetSoReuseAddress(const xtSocket sock, bool *flag);
+/**
+ * Tells you if the socket has it's SO_REUSEPORT option enabled or disabled.
+ * @param flag - Will receive the result of the property on success.
+ * @return Zero if the property has been fetched successfully, otherwise an error code.
+ * XT_EOPNOTSUPP is returned on Windows.
+ */
+int xtSocketGetSoReusePort(const xtSocket sock, bool *flag);
 /**
  * Tells you the current SO_SNDBUF size in bytes for the specified socket.
  * @return Zero if the property has been fetched successfully, otherwise an error code.
  */
 int xtSocketGetSoSendBufferSize(xtSocket sock, unsigned *size);
+/**
+ * Tells you if the socket has it's TCP_CORK option enabled or disabled.
+ * @param flag - Will receive the result of the property on success.
+ * @return Zero if the property has been fetched successfully, otherwise an error code.
+ * XT_EOPNOTSUPP is returned on Windows.
+ */
+int xtSocketGetTCPCork(const xtSocket sock, bool *flag);
 /**
  * Tells you if the socket has it's TCP_NODELAY option enabled or disabled.
  * @param flag - Will receive the result of the property on success.
@@ -311,6 +381,17 @@ int xtSocketSetSoReceiveBufferSize(xtSocket sock, unsigned size);
  * @remarks Execute this function PRIOR to binding the socket! Otherwise this function will have no effect.
  */
 int xtSocketSetSoReuseAddress(xtSocket sock, bool flag);
+/**
+ * Enables or disables SO_REUSEPORT.
+ * Multiple sockets that have this option enabled may be bound to the same address and port.
+ * The kernel then distributes the incoming connections or datagrams over those sockets,
+ * so that every thread can have a listening socket of its own.\n
+ * When a socket is created, this option is off by default.
+ * @return Zero if the option has been changed successfully, otherwise an error code.
+ * XT_EOPNOTSUPP is returned on Windows.
+ * @remarks Execute this function PRIOR to binding the socket! Otherwise this function will have no effect.
+ */
+int xtSocketSetSoReusePort(xtSocket sock, bool flag);
 /**
  * Sets the SO_SNDBUF option to the specified value for this socket.
  * The SO_SNDBUF option is used by the platform's networking code as a hint for the size to set the send buffer of the underlying I/O buffers.
@@ -319,6 +400,21 @@ int xtSocketSetSoReuseAddress(xtSocket sock, bool flag);
  * @remarks It is best practice to call this function before connecting or binding the socket. This prevents certain problems.
  */
 int xtSocketSetSoSendBufferSize(xtSocket sock, unsigned size);
+/**
+ * Enables or disables SO_ZEROCOPY, which allows writes with XT_SOCKET_MSG_ZEROCOPY.
+ * Zero-copy only pays off for large writes, since the completions have to be reaped with xtSocketTCPZeroCopyPoll().
+ * @return Zero if the option has been changed successfully, otherwise an error code.
+ * XT_EOPNOTSUPP is returned on Windows.
+ */
+int xtSocketSetSoZeroCopy(xtSocket sock, bool flag);
+/**
+ * Enables or disables TCP_CORK.\n
+ * \a flag = true : Only full frames are sent, so multiple writes are coalesced until the cork is removed.\n
+ * \a flag = false : Removes the cork, which sends any partial frame right away.\n
+ * @return Zero if the option has been changed successfully, otherwise an error code.
+ * XT_EOPNOTSUPP is returned on Windows.
+ */
+int xtSocketSetTCPCork(xtSocket sock, bool flag);
 /**
  * Enables or disables TCP_NODELAY.\n
  * \a flag = true : Send the data (partial frames) the moment you get them, regardless if you have enough frames for a full network packet.\n
@@ -326,6 +422,15 @@ int xtSocketSetSoSendBufferSize(xtSocket sock, unsigned size);
  * @return Zero if the option has been changed successfully, otherwise an error code.
  */
 int xtSocketSetTCPNoDelay(xtSocket sock, bool flag);
+/**
+ * Enables or disables UDP_GRO.\n
+ * \a flag = true : The kernel may coalesce datagrams of the same size from the same sender into one buffer.
+ * xtSocketUDPReadBatch() reports the size of the datagrams, so the buffers should be large enough to hold 64 KiB.\n
+ * \a flag = false : Every read returns exactly one datagram.\n
+ * @return Zero if the option has been changed successfully, otherwise an error code.
+ * XT_EOPNOTSUPP is returned on Windows.
+ */
+int xtSocketSetUDPGRO(xtSocket sock, bool flag);
 /**
  * Blocks until an incoming TCP connection is accepted or until the socket is closed, or if the socket is non-blocking,
  * it will return immediately.
@@ -347,6 +452,60 @@ int xtSocketTCPRead(xtSocket sock, void *restrict buf, uint16_t buflen, uint16_t
  * @returns Zero if the operation has succeeded, otherwise an error code.
  */
 int xtSocketTCPWrite(xtSocket sock, const void *restrict buf, uint16_t buflen, uint16_t *restrict bytesSent);
+/**
+ * Acts exactly the same as xtSocketTCPRead(), but \a buflen is not limited to 65535 bytes.
+ * @param bytesRead - Receives the amount of bytes that have been read.
+ * @returns Zero if the operation has succeeded, otherwise an error code.
+ */
+int xtSocketTCPReadEx(xtSocket sock, void *restrict buf, size_t buflen, size_t *restrict bytesRead);
+/**
+ * Acts exactly the same as xtSocketTCPWrite(), but \a buflen is not limited to 65535 bytes.
+ * @param bytesSent - Receives the amount of bytes that have been sent.
+ * @param flags - XT_SOCKET_MSG_MORE and XT_SOCKET_MSG_ZEROCOPY.
+ * @returns Zero if the operation has succeeded, otherwise an error code.
+ */
+int xtSocketTCPWriteEx(xtSocket sock, const void *restrict buf, size_t buflen, size_t *restrict bytesSent, unsigned flags);
+/**
+ * Blocks until "some" data has been read into the \a count buffers of \a iov, which are filled in order.
+ * @param bytesRead - Receives the amount of bytes that have been read.
+ * @returns Zero if the operation has succeeded, otherwise an error code.
+ */
+int xtSocketTCPReadv(xtSocket sock, const struct xtSocketIOVec *restrict iov, unsigned count, size_t *restrict bytesRead);
+/**
+ * Writes the \a count buffers of \a iov with a single system call, e.g. the headers and the body of a response.
+ * @param bytesSent - Receives the amount of bytes that have been sent.
+ * @param flags - XT_SOCKET_MSG_MORE and XT_SOCKET_MSG_ZEROCOPY.
+ * @returns Zero if the operation has succeeded, otherwise an error code.
+ */
+int xtSocketTCPWritev(xtSocket sock, const struct xtSocketIOVec *restrict iov, unsigned count, size_t *restrict bytesSent, unsigned flags);
+/**
+ * Reads until \a buf is full. Works on blocking and non-blocking sockets, since it waits for data if none is available.
+ * @param bytesRead - Receives the amount of bytes that have been read, also if an error has occurred.
+ * @returns Zero if \a buflen bytes have been read, XT_ESHUTDOWN if the connection has been closed before, otherwise an error code.
+ */
+int xtSocketTCPReadExact(xtSocket sock, void *restrict buf, size_t buflen, size_t *restrict bytesRead);
+/**
+ * Writes all of \a buf. Works on blocking and non-blocking sockets, since it waits for room if the send buffer is full.
+ * @param bytesSent - Receives the amount of bytes that have been sent, also if an error has occurred.
+ * @param flags - XT_SOCKET_MSG_MORE. XT_SOCKET_MSG_ZEROCOPY is not supported, since the number of writes is not known.
+ * @returns Zero if all data has been sent, otherwise an error code.
+ */
+int xtSocketTCPWriteAll(xtSocket sock, const void *restrict buf, size_t buflen, size_t *restrict bytesSent, unsigned flags);
+/**
+ * Writes all of the \a count buffers of \a iov, just like xtSocketTCPWriteAll().
+ * @param bytesSent - Receives the amount of bytes that have been sent, also if an error has occurred.
+ * @param flags - XT_SOCKET_MSG_MORE. XT_SOCKET_MSG_ZEROCOPY is not supported, since the number of writes is not known.
+ * @returns Zero if all data has been sent, otherwise an error code.
+ */
+int xtSocketTCPWritevAll(xtSocket sock, const struct xtSocketIOVec *restrict iov, unsigned count, size_t *restrict bytesSent, unsigned flags);
+/**
+ * Reaps the completions of the writes with XT_SOCKET_MSG_ZEROCOPY. These writes are numbered per socket, starting at zero.
+ * This function never blocks.
+ * @param completed - Receives the number of writes whose data may be reused, which are all writes up to this number.
+ * @returns Zero if a completion has been reaped, XT_EAGAIN if there was none, otherwise an error code.
+ * XT_EOPNOTSUPP is returned on Windows.
+ */
+int xtSocketTCPZeroCopyPoll(xtSocket sock, uint32_t *completed);
 /**
  * Blocks until "some" data has been read on the socket. This does not necessarily have to be the size of \a buflen.
  * @param bytesRead - Receives the amount of bytes that have been read.
@@ -361,6 +520,22 @@ int xtSocketUDPRead(xtSocket sock, void *restrict buf, uint16_t buflen, uint16_t
  * @returns Zero if the operation has succeeded, otherwise an error code.
  */
 int xtSocketUDPWrite(xtSocket sock, const void *restrict buf, uint16_t buflen, uint16_t *restrict bytesSent, const struct xtSockaddr *restrict dest);
+/**
+ * Reads up to \a count datagrams into \a msgs with as few system calls as possible (recvmmsg).
+ * Blocks until at least one datagram has been read if the socket is blocking, and never waits for more than that.
+ * @param read - Receives the amount of messages that have been filled in.
+ * @returns Zero if at least one datagram has been read, otherwise an error code.
+ * @remarks On Windows, only one datagram is read per call.
+ */
+int xtSocketUDPReadBatch(xtSocket sock, struct xtSocketUDPMessage *restrict msgs, unsigned count, unsigned *restrict read);
+/**
+ * Sends up to \a count messages with as few system calls as possible (sendmmsg).
+ * @param sent - Receives the amount of messages that have been sent. Stops early if the socket would block.
+ * @returns Zero if at least one message has been sent, otherwise an error code.
+ * @remarks On Windows, every datagram is sent with a system call of its own, so the segments of a message are not sent atomically.
+ * If a segment cannot be sent, the message is still counted in \a sent and its \a len tells how much of it has been sent.
+ */
+int xtSocketUDPWriteBatch(xtSocket sock, struct xtSocketUDPMessage *restrict msgs, unsigned count, unsigned *restrict sent);
 
 #define XT_SOCKET_POLL_CAPACITY_DEFAULT 1024
 /**
@@ -384,15 +559,34 @@ enum xtSocketPollEvent {
 	/** An error has occurred. */
 	XT_POLLERR  = 0x08,
 	/** A stream-oriented connection was either disconnected or aborted. */
-	XT_POLLHUP  = 0x10
+	XT_POLLHUP  = 0x10,
+	/**
+	 * Option: report a socket only when its state changes, instead of for as
+	 * long as it is ready. The socket must be drained until it would block.
+	 * Ignored on Windows.
+	 */
+	XT_POLLET   = 0x20,
+	/**
+	 * Option: stop monitoring the socket after it has been reported once,
+	 * until it is rearmed with xtSocketPollMod(). Ignored on Windows.
+	 */
+	XT_POLLONESHOT = 0x40,
+	/**
+	 * Option: if the socket is monitored by multiple polls, only wake up one
+	 * or some of them. Such a socket cannot be modified, only removed, and
+	 * XT_POLLONESHOT cannot be combined with it. Ignored on Windows.
+	 */
+	XT_POLLEXCLUSIVE = 0x80
 };
 /**
  * Adds a socket for monitoring.
  * After a successful call to this function, the socket will be monitored for the
  * specified events by the system.
  * XT_POLLERR and XT_POLLHUP are always added implicitly.
+ * Adding, modifying and removing sockets takes constant time on Linux.
  * @param data - The data to associate with the socket.
- * @param events - The events which are to be monitored.
+ * @param events - The events which are to be monitored, optionally combined
+ * with XT_POLLET, XT_POLLONESHOT and XT_POLLEXCLUSIVE.
  */
 int xtSocketPollAdd(struct xtSocketPoll *restrict p, xtSocket sock, void *restrict data, enum xtSocketPollEvent events);
 /**
@@ -400,6 +594,12 @@ int xtSocketPollAdd(struct xtSocketPoll *restrict p, xtSocket sock, void *restri
  * @param capacity - The amount of sockets that will fit into the structure.
  */
 int xtSocketPollCreate(struct xtSocketPoll **p, size_t capacity);
+/**
+ * Initiates the poll structure with memory of \a allocator. See xtSocketPollCreate().
+ * @param allocator - The allocator for the structure and its arrays. Specify NULL to use malloc.
+ * The allocator must stay valid until xtSocketPollDestroy() has been called.
+ */
+int xtSocketPollCreateAllocator(struct xtSocketPoll **p, size_t capacity, const struct xtAllocator *allocator);
 /**
  * Destroys the structure and cleans up all resources.
  * The structure is rendered unuseable after calling this function.
@@ -467,6 +667,8 @@ int xtSocketPollSetEvent(struct xtSocketPoll *p, xtSocket sock, enum xtSocketPol
  * All sockets are automically rearmed for the next call to this function.
  * This means that if some sockets have data waiting to be read, and you skip reading
  * it, the next call to this function will return immediately with those same sockets.
+ * Sockets that are monitored with XT_POLLET are only reported again when new data
+ * arrives, and those with XT_POLLONESHOT not until they are rearmed.
  * @param timeout - The time to wait at maximum before returning in milliseconds.
  * Different values are accepted.
  * -1: Block indefinitely.
@@ -2,6 +2,9 @@
 
 /**
  * @brief Contains various sorting algorithms.
+ *
+ * For sorting elements of one type with an inlined comparison, see
+ * xt/sort_template.h.
  * @file sort.h
  * @author Folkert van Verseveld
  * @date 2017
@@ -27,14 +30,305 @@ enum xtSortType {
 	XT_SORT_INSERT,
 	XT_SORT_QUICK ,
 	XT_SORT_SELECT,
+	/**
+	 * LSD radix sort. It is stable and runs in O(n), but it needs a buffer
+	 * as large as the list. It is not supported by xtSortP().
+	 */
 	XT_SORT_RADIX ,
+	/**
+	 * Pattern-defeating quicksort. It runs in O(n log n) in the worst case
+	 * and in O(n) on sorted, reversed and similar inputs.
+	 */
+	XT_SORT_PDQ   ,
+	/**
+	 * The best general purpose algorithm, which currently is XT_SORT_PDQ.
+	 * xtSortP() sorts large elements indirectly like xtSortIndex() and
+	 * moves every element only once afterwards. xtSortStr() uses a string
+	 * specialized multikey quicksort instead.
+	 */
+	XT_SORT_AUTO  ,
+	/**
+	 * Stable adaptive merge sort in the style of TimSort. It runs in O(n) on
+	 * input that consists of a few sorted or reversed runs and in
+	 * O(n log n) in the worst case. It needs a buffer of half the list. It
+	 * is only supported by xtSortU(), xtSortD(), xtSortP() and xtSortStr().
+	 */
+	XT_SORT_TIM   ,
+};
+
+/**
+ * The type of the key that xtSortRadix() sorts on.
+ */
+enum xtSortKey {
+	/** A 32 bit unsigned integer. */
+	XT_SORT_KEY_U,
+	/** A 32 bit signed integer. */
+	XT_SORT_KEY_D,
+	/** A 64 bit unsigned integer. */
+	XT_SORT_KEY_LLU,
+	/** A 64 bit signed integer. */
+	XT_SORT_KEY_LLD,
+	/** A float. */
+	XT_SORT_KEY_F,
+	/** A double. */
+	XT_SORT_KEY_LF,
 };
 
 int xtSortU(unsigned *list, size_t count, enum xtSortType type, bool ascend);
 int xtSortD(int *list, size_t count, enum xtSortType type, bool ascend);
+/**
+ * Sorts 64 bit unsigned integers.
+ * @return Zero if the list has been sorted, XT_EOPNOTSUPP if \a type is not
+ * XT_SORT_RADIX, XT_SORT_PDQ or XT_SORT_AUTO, otherwise an error code.
+ */
+int xtSortLLU(unsigned long long *list, size_t count, enum xtSortType type, bool ascend);
+/**
+ * Sorts 64 bit signed integers, see xtSortLLU().
+ */
+int xtSortLLD(long long *list, size_t count, enum xtSortType type, bool ascend);
+/**
+ * Sorts floats, see xtSortLLU().
+ * @remarks XT_SORT_RADIX puts NaNs with the sign bit set first and other NaNs
+ * last. The other algorithms consider all NaNs larger than any number.
+ */
+int xtSortF(float *list, size_t count, enum xtSortType type, bool ascend);
+/**
+ * Sorts doubles, see xtSortF().
+ */
+int xtSortLF(double *list, size_t count, enum xtSortType type, bool ascend);
+/**
+ * Sorts elements on a numeric key with a stable LSD radix sort. The elements
+ * are moved as a whole, so this sorts (key, payload) records directly. Every
+ * pass sorts on 11 bits of the key and passes on bits that are the same in all
+ * keys are skipped.
+ * @param keyOffset - The offset of the key in an element in bytes.
+ * @param threads - The maximum number of threads, including the caller
+ * thread. Specify zero to use one thread per logical core and one to only use
+ * the caller thread. Small lists are always sorted by the caller thread only.
+ * @return Zero if the list has been sorted, otherwise an error code.
+ * @remarks A buffer as large as the list is allocated while sorting.
+ */
+int xtSortRadix(void *list, size_t count, size_t elemSize, size_t keyOffset, enum xtSortKey key, bool ascend, unsigned threads);
 int xtSortP(void *list, size_t count, enum xtSortType type, int (*cmp)(const void*, const void*), bool ascend, size_t elemSize);
+/**
+ * Sorts NUL terminated strings. XT_SORT_AUTO uses the multikey quicksort of
+ * xtSortStrLen(), the other algorithms compare strings with strcmp().
+ * @return Zero if the list has been sorted, otherwise an error code.
+ */
 int xtSortStr(const char **list, size_t count, enum xtSortType type, bool ascend);
+/**
+ * Sorts strings with explicit lengths, which may contain NUL bytes. Strings
+ * are ordered on their bytes as unsigned chars and a string comes before any
+ * longer string that starts with it. \a lengths is rearranged along with
+ * \a list. The sort is a multikey quicksort on cached 8 byte prefixes, which
+ * reads common prefixes once per string instead of once per comparison.
+ * @param lengths - The length of every string in bytes.
+ * @return Zero if the list has been sorted, otherwise an error code.
+ * @remarks A buffer of three words per string is allocated while sorting.
+ */
+int xtSortStrLen(const char **list, size_t *lengths, size_t count, bool ascend);
+/**
+ * Rearranges \a list so that the element at position \a n is the element
+ * that would be there if the list were sorted. No element before it comes
+ * after it in sorted order and no element after it comes before it. This is
+ * introselect, which runs in O(n) on average and in O(n log n) in the worst
+ * case.
+ * @return Zero on success, XT_EINVAL if \a n is not less than \a count.
+ */
+int xtSelectNthU(unsigned *list, size_t count, size_t n, bool ascend);
+/**
+ * Selects the element at position \a n, see xtSelectNthU().
+ */
+int xtSelectNthD(int *list, size_t count, size_t n, bool ascend);
+/**
+ * Selects the element at position \a n, see xtSelectNthU().
+ */
+int xtSelectNthP(void *list, size_t count, size_t n, int (*cmp)(const void*, const void*), bool ascend, size_t elemSize);
+/**
+ * Selects the element at position \a n, see xtSelectNthU().
+ */
+int xtSelectNthStr(const char **list, size_t count, size_t n, bool ascend);
+/**
+ * Moves the first \a k elements of the sorted list to the start of \a list
+ * in sorted order, leaving the other elements in unspecified order. Sorting
+ * descending thus yields the top \a k. Small \a k are selected with a heap
+ * of \a k elements in O(n log k), larger ones with xtSelectNthU() followed by
+ * sorting the elements before it.
+ * @param k - The number of elements to sort. If it is larger than \a count,
+ * the whole list is sorted.
+ * @return Zero on success, otherwise an error code.
+ */
+int xtPartialSortU(unsigned *list, size_t count, size_t k, bool ascend);
+/**
+ * Sorts the first \a k elements, see xtPartialSortU().
+ */
+int xtPartialSortD(int *list, size_t count, size_t k, bool ascend);
+/**
+ * Sorts the first \a k elements, see xtPartialSortU().
+ */
+int xtPartialSortP(void *list, size_t count, size_t k, int (*cmp)(const void*, const void*), bool ascend, size_t elemSize);
+/**
+ * Sorts the first \a k elements, see xtPartialSortU().
+ */
+int xtPartialSortStr(const char **list, size_t count, size_t k, bool ascend);
+/**
+ * Sorts \a list indirectly without modifying it. Afterwards, \a index
+ * contains the positions of the elements of \a list in sorted order. This is
+ * useful when elements are expensive to move or when \a list has to stay in
+ * its original order. The sort is pattern-defeating quicksort.
+ * @param index - Receives \a count positions in \a list.
+ * @return Zero if the list has been sorted, otherwise an error code.
+ */
+int xtSortIndex(size_t *index, const void *list, size_t count, int (*cmp)(const void*, const void*), bool ascend, size_t elemSize);
+/**
+ * Sorts \a list with multiple threads. Every thread sorts a part of the list
+ * with pattern-defeating quicksort, after which the parts are merged in
+ * parallel. Lists that are too small to benefit from this are sorted by the
+ * caller thread only.
+ * @param threads - The maximum number of threads, including the caller
+ * thread. Specify zero to use one thread per logical core.
+ * @return Zero if the list has been sorted, otherwise an error code.
+ * @remarks A buffer as large as the list is allocated while sorting. If that
+ * fails, the list is sorted by the caller thread only.
+ */
+int xtSortParallelU(unsigned *list, size_t count, bool ascend, unsigned threads);
+/**
+ * Sorts \a list with multiple threads, see xtSortParallelU().
+ */
+int xtSortParallelD(int *list, size_t count, bool ascend, unsigned threads);
+/**
+ * Sorts \a list with multiple threads, see xtSortParallelU().
+ * @remarks \a cmp is called from multiple threads at once.
+ */
+int xtSortParallelP(void *list, size_t count, int (*cmp)(const void*, const void*), bool ascend, size_t elemSize, unsigned threads);
+
+/*
+ * The functions below operate on lists that are sorted in ascending order.
+ * Intersections and unions treat the lists as sets: an element may occur only
+ * once in each list, see xtUniqueU().
+ */
 
+/**
+ * Returns the position of the first element in \a list that is not less than
+ * \a key, or \a count if there is none. The binary search does not branch on
+ * the comparisons.
+ */
+size_t xtLowerBoundU(const unsigned *list, size_t count, unsigned key);
+/**
+ * Returns the position of the first element that is not less than \a key, see
+ * xtLowerBoundU().
+ */
+size_t xtLowerBoundD(const int *list, size_t count, int key);
+/**
+ * Returns the position of the first element that is not less than \a key, see
+ * xtLowerBoundU().
+ */
+size_t xtLowerBoundLLU(const unsigned long long *list, size_t count, unsigned long long key);
+/**
+ * Returns the position of the first element that is not less than \a key, see
+ * xtLowerBoundU().
+ */
+size_t xtLowerBoundP(const void *list, size_t count, const void *key, int (*cmp)(const void*, const void*), size_t elemSize);
+/**
+ * Returns the position of the first element in \a list that is greater than
+ * \a key, or \a count if there is none.
+ */
+size_t xtUpperBoundU(const unsigned *list, size_t count, unsigned key);
+/**
+ * Returns the position of the first element that is greater than \a key, see
+ * xtUpperBoundU().
+ */
+size_t xtUpperBoundD(const int *list, size_t count, int key);
+/**
+ * Returns the position of the first element that is greater than \a key, see
+ * xtUpperBoundU().
+ */
+size_t xtUpperBoundLLU(const unsigned long long *list, size_t count, unsigned long long key);
+/**
+ * Returns the position of the first element that is greater than \a key, see
+ * xtUpperBoundU().
+ */
+size_t xtUpperBoundP(const void *list, size_t count, const void *key, int (*cmp)(const void*, const void*), size_t elemSize);
+/**
+ * Merges \a k sorted lists into \a dest with a loser tree, which costs about
+ * log2(k) comparisons per element. Equal elements are taken from the lists in
+ * order.
+ * @param dest - Receives the sum of all \a counts elements.
+ * @param counts - The number of elements of each list.
+ * @return Zero on success, otherwise an error code.
+ */
+int xtMergeU(unsigned *dest, const unsigned *const *lists, const size_t *counts, size_t k);
+/**
+ * Merges \a k sorted lists, see xtMergeU().
+ */
+int xtMergeD(int *dest, const int *const *lists, const size_t *counts, size_t k);
+/**
+ * Merges \a k sorted lists, see xtMergeU().
+ */
+int xtMergeLLU(unsigned long long *dest, const unsigned long long *const *lists, const size_t *counts, size_t k);
+/**
+ * Merges \a k sorted lists, see xtMergeU().
+ */
+int xtMergeP(void *dest, const void *const *lists, const size_t *counts, size_t k, int (*cmp)(const void*, const void*), size_t elemSize);
+/**
+ * Stores the elements that occur in both \a a and \a b in \a dest. If one
+ * list is much longer than the other, the longer list is searched by
+ * galloping, so the cost mostly depends on the shorter list. On x86 the
+ * 32 bit variants compare blocks of elements with SSE2.
+ * @param dest - Receives up to the smallest of \a na and \a nb elements.
+ * @return The number of elements stored in \a dest.
+ */
+size_t xtIntersectU(unsigned *dest, const unsigned *a, size_t na, const unsigned *b, size_t nb);
+/**
+ * Intersects two sorted sets, see xtIntersectU().
+ */
+size_t xtIntersectD(int *dest, const int *a, size_t na, const int *b, size_t nb);
+/**
+ * Intersects two sorted sets, see xtIntersectU().
+ */
+size_t xtIntersectLLU(unsigned long long *dest, const unsigned long long *a, size_t na, const unsigned long long *b, size_t nb);
+/**
+ * Intersects two sorted sets, see xtIntersectU().
+ */
+size_t xtIntersectP(void *dest, const void *a, size_t na, const void *b, size_t nb, int (*cmp)(const void*, const void*), size_t elemSize);
+/**
+ * Stores the elements that occur in \a a, \a b or both in \a dest. Once one
+ * list provides a number of elements in a row, the end of that stretch is
+ * found by galloping and it is copied at once.
+ * @param dest - Receives up to \a na + \a nb elements.
+ * @return The number of elements stored in \a dest.
+ */
+size_t xtUnionU(unsigned *dest, const unsigned *a, size_t na, const unsigned *b, size_t nb);
+/**
+ * Unites two sorted sets, see xtUnionU().
+ */
+size_t xtUnionD(int *dest, const int *a, size_t na, const int *b, size_t nb);
+/**
+ * Unites two sorted sets, see xtUnionU().
+ */
+size_t xtUnionLLU(unsigned long long *dest, const unsigned long long *a, size_t na, const unsigned long long *b, size_t nb);
+/**
+ * Unites two sorted sets, see xtUnionU().
+ */
+size_t xtUnionP(void *dest, const void *a, size_t na, const void *b, size_t nb, int (*cmp)(const void*, const void*), size_t elemSize);
+/**
+ * Removes all but the first of every group of equal elements from the sorted
+ * \a list, keeping the order of the remaining elements.
+ * @return The number of remaining elements.
+ */
+size_t xtUniqueU(unsigned *list, size_t count);
+/**
+ * Removes duplicates from a sorted list, see xtUniqueU().
+ */
+size_t xtUniqueD(int *list, size_t count);
+/**
+ * Removes duplicates from a sorted list, see xtUniqueU().
+ */
+size_t xtUniqueLLU(unsigned long long *list, size_t count);
+/**
+ * Removes duplicates from a sorted list, see xtUniqueU().
+ */
+size_t xtUniqueP(void *list, size_t count, int (*cmp)(const void*, const void*), size_t elemSize);
 #ifdef __cplusplus
 }
 #endif
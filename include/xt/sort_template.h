@@ -0,0 +1,378 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+/**
+ * @brief Template for sorting routines with an inlined comparison.
+ *
+ * xtSortP() calls the comparator through a function pointer for every
+ * comparison and has to move elements of any size. A sort generated from this
+ * file compares and moves elements of one specific type directly, which is a
+ * lot faster for small elements. Define the following macros and include this
+ * file, which may be done multiple times for different types:
+ *
+ * - XT_SORT_TYPE: The element type.
+ * - XT_SORT_NAME: The name of the generated function.
+ * - XT_SORT_LESS(a, b): Evaluates to true if element \a a must come before
+ *   element \a b. It is invoked with lvalues of type XT_SORT_TYPE without side
+ *   effects, so it may evaluate them more than once.
+ *
+ * This defines <tt>static void XT_SORT_NAME(XT_SORT_TYPE *list, size_t count)</tt>
+ * and undefines the macros again. Example:
+ * @code
+ * #define XT_SORT_TYPE struct point
+ * #define XT_SORT_NAME point_sort
+ * #define XT_SORT_LESS(a, b) ((a).x < (b).x)
+ * #include <xt/sort_template.h>
+ * @endcode
+ *
+ * The algorithm is pattern-defeating quicksort, based on pdqsort by Orson
+ * Peters. Small ranges are insertion sorted, pivots are the median of three or
+ * the pseudo median of nine elements and partitions are computed branchless in
+ * blocks. Unbalanced partitions shuffle some elements to break up patterns and
+ * after too many of them the range is heap sorted, so the worst case is
+ * O(n log n). Already sorted ranges are detected and take O(n). The sort is
+ * not stable.
+ * @file sort_template.h
+ * @author Folkert van Verseveld
+ * @date 2018
+ * @copyright LGPL v3.0
+ */
+
+#ifndef _XT_SORT_TEMPLATE_H
+#define _XT_SORT_TEMPLATE_H
+
+// STD headers
+#include <stdbool.h>
+#include <stddef.h>
+
+#define _xt_sort_cat(a, b) a ## b
+#define _xt_sort_cate(a, b) _xt_sort_cat(a, b)
+/* Ranges smaller than this are insertion sorted. */
+#define _XT_SORT_INSERTION_THRESHOLD 24
+/* Ranges larger than this use the pseudo median of nine as pivot. */
+#define _XT_SORT_NINTHER_THRESHOLD 128
+/* The number of moves after which partial insertion sort gives up. */
+#define _XT_SORT_PARTIAL_INSERTION_LIMIT 8
+/* Number of elements that are classified at once by the block partition. */
+#define _XT_SORT_BLOCK 64
+
+#endif
+
+#if !defined(XT_SORT_TYPE) || !defined(XT_SORT_NAME) || !defined(XT_SORT_LESS)
+	#error "XT_SORT_TYPE, XT_SORT_NAME and XT_SORT_LESS must be defined"
+#endif
+
+#define _XT_SORT_FN(name) _xt_sort_cate(XT_SORT_NAME, _xt_sort_cat(_, name))
+
+static inline void _XT_SORT_FN(swap)(XT_SORT_TYPE *a, XT_SORT_TYPE *b)
+{
+	XT_SORT_TYPE tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+static inline void _XT_SORT_FN(sort2)(XT_SORT_TYPE *a, XT_SORT_TYPE *b)
+{
+	if (XT_SORT_LESS(*b, *a))
+		_XT_SORT_FN(swap)(a, b);
+}
+
+static inline void _XT_SORT_FN(sort3)(XT_SORT_TYPE *a, XT_SORT_TYPE *b, XT_SORT_TYPE *c)
+{
+	_XT_SORT_FN(sort2)(a, b);
+	_XT_SORT_FN(sort2)(b, c);
+	_XT_SORT_FN(sort2)(a, b);
+}
+
+static void _XT_SORT_FN(insertion)(XT_SORT_TYPE *begin, XT_SORT_TYPE *end)
+{
+	XT_SORT_TYPE *cur, *sift, tmp;
+	if (begin == end)
+		return;
+	for (cur = begin + 1; cur != end; ++cur) {
+		if (!XT_SORT_LESS(*cur, cur[-1]))
+			continue;
+		tmp = *cur;
+		sift = cur;
+		do {
+			*sift = sift[-1];
+		} while (--sift != begin && XT_SORT_LESS(tmp, sift[-1]));
+		*sift = tmp;
+	}
+}
+
+/* Insertion sort that assumes an element before \a begin is not larger than any in the range. */
+static void _XT_SORT_FN(unguarded_insertion)(XT_SORT_TYPE *begin, XT_SORT_TYPE *end)
+{
+	XT_SORT_TYPE *cur, *sift, tmp;
+	for (cur = begin + 1; cur < end; ++cur) {
+		if (!XT_SORT_LESS(*cur, cur[-1]))
+			continue;
+		tmp = *cur;
+		sift = cur;
+		do {
+			*sift = sift[-1];
+			--sift;
+		} while (XT_SORT_LESS(tmp, sift[-1]));
+		*sift = tmp;
+	}
+}
+
+/* Insertion sorts the range unless it takes too many moves. Returns whether the range is sorted. */
+static bool _XT_SORT_FN(partial_insertion)(XT_SORT_TYPE *begin, XT_SORT_TYPE *end)
+{
+	XT_SORT_TYPE *cur, *sift, tmp;
+	size_t limit = 0;
+	if (begin == end)
+		return true;
+	for (cur = begin + 1; cur != end; ++cur) {
+		if (!XT_SORT_LESS(*cur, cur[-1]))
+			continue;
+		tmp = *cur;
+		sift = cur;
+		do {
+			*sift = sift[-1];
+		} while (--sift != begin && XT_SORT_LESS(tmp, sift[-1]));
+		*sift = tmp;
+		limit += cur - sift;
+		if (limit > _XT_SORT_PARTIAL_INSERTION_LIMIT)
+			return false;
+	}
+	return true;
+}
+
+static void _XT_SORT_FN(sift)(XT_SORT_TYPE *a, size_t root, size_t n)
+{
+	XT_SORT_TYPE tmp = a[root];
+	size_t child;
+	while ((child = 2 * root + 1) < n) {
+		if (child + 1 < n && XT_SORT_LESS(a[child], a[child + 1]))
+			++child;
+		if (!XT_SORT_LESS(tmp, a[child]))
+			break;
+		a[root] = a[child];
+		root = child;
+	}
+	a[root] = tmp;
+}
+
+/* Fallback that guarantees O(n log n) if too many partitions are unbalanced. */
+static void _XT_SORT_FN(heap)(XT_SORT_TYPE *a, size_t n)
+{
+	size_t i;
+	for (i = n / 2; i > 0;)
+		_XT_SORT_FN(sift)(a, --i, n);
+	for (i = n; --i > 0;) {
+		_XT_SORT_FN(swap)(a, a + i);
+		_XT_SORT_FN(sift)(a, 0, i);
+	}
+}
+
+/*
+ * Partitions the range around the pivot in *begin, putting elements equal to
+ * the pivot on the left. It is used when the pivot equals the element before
+ * the range, so all of them are in place afterwards.
+ */
+static XT_SORT_TYPE *_XT_SORT_FN(partition_left)(XT_SORT_TYPE *begin, XT_SORT_TYPE *end)
+{
+	XT_SORT_TYPE pivot = *begin, *first = begin, *last = end;
+	do
+		--last;
+	while (XT_SORT_LESS(pivot, *last));
+	if (last + 1 == end)
+		while (first < last && (++first, !XT_SORT_LESS(pivot, *first)))
+			;
+	else
+		do
+			++first;
+		while (!XT_SORT_LESS(pivot, *first));
+	while (first < last) {
+		_XT_SORT_FN(swap)(first, last);
+		do
+			--last;
+		while (XT_SORT_LESS(pivot, *last));
+		do
+			++first;
+		while (!XT_SORT_LESS(pivot, *first));
+	}
+	*begin = *last;
+	*last = pivot;
+	return last;
+}
+
+/*
+ * Partitions the range around the pivot in *begin, putting elements equal to
+ * the pivot on the right. Elements on the wrong side are collected in blocks
+ * of offsets without branching on the comparisons, after which the collected
+ * elements are swapped pairwise.
+ * @param sorted - Receives whether no elements had to be moved.
+ */
+static XT_SORT_TYPE *_XT_SORT_FN(partition_right)(XT_SORT_TYPE *begin, XT_SORT_TYPE *end, bool *sorted)
+{
+	unsigned char offsets_l[_XT_SORT_BLOCK], offsets_r[_XT_SORT_BLOCK];
+	XT_SORT_TYPE pivot = *begin, *first = begin, *last = end, *base_l, *base_r, *l, *r, tmp;
+	size_t num_l = 0, num_r = 0, start_l = 0, start_r = 0, unknown, split_l, split_r, num, i;
+	do
+		++first;
+	while (XT_SORT_LESS(*first, pivot));
+	if (first - 1 == begin)
+		while (first < last && (--last, !XT_SORT_LESS(*last, pivot)))
+			;
+	else
+		do
+			--last;
+		while (!XT_SORT_LESS(*last, pivot));
+	*sorted = first >= last;
+	if (*sorted)
+		goto pivot;
+	_XT_SORT_FN(swap)(first++, last);
+	base_l = first;
+	base_r = last;
+	while (first < last) {
+		// Decide how many unclassified elements each side inspects
+		unknown = last - first;
+		split_l = num_l ? 0 : num_r ? unknown : unknown / 2;
+		split_r = num_r ? 0 : unknown - split_l;
+		if (split_l > _XT_SORT_BLOCK)
+			split_l = _XT_SORT_BLOCK;
+		if (split_r > _XT_SORT_BLOCK)
+			split_r = _XT_SORT_BLOCK;
+		for (i = 0; i < split_l; ++i) {
+			offsets_l[num_l] = i;
+			num_l += !XT_SORT_LESS(*first, pivot);
+			++first;
+		}
+		for (i = 0; i < split_r;) {
+			offsets_r[num_r] = ++i;
+			--last;
+			num_r += XT_SORT_LESS(*last, pivot);
+		}
+		// Swap as many misplaced pairs as possible
+		num = num_l < num_r ? num_l : num_r;
+		if (num_l == num_r) {
+			// Plain swaps keep descending input linear
+			for (i = 0; i < num; ++i)
+				_XT_SORT_FN(swap)(base_l + offsets_l[start_l + i], base_r - offsets_r[start_r + i]);
+		} else if (num) {
+			// A cyclic permutation needs fewer moves than swapping
+			l = base_l + offsets_l[start_l];
+			r = base_r - offsets_r[start_r];
+			tmp = *l;
+			*l = *r;
+			for (i = 1; i < num; ++i) {
+				l = base_l + offsets_l[start_l + i];
+				*r = *l;
+				r = base_r - offsets_r[start_r + i];
+				*l = *r;
+			}
+			*r = tmp;
+		}
+		num_l -= num;
+		num_r -= num;
+		start_l += num;
+		start_r += num;
+		if (!num_l) {
+			start_l = 0;
+			base_l = first;
+		}
+		if (!num_r) {
+			start_r = 0;
+			base_r = last;
+		}
+	}
+	// Move the remaining misplaced elements to the boundary
+	if (num_l) {
+		while (num_l--)
+			_XT_SORT_FN(swap)(base_l + offsets_l[start_l + num_l], --last);
+		first = last;
+	}
+	if (num_r) {
+		while (num_r--)
+			_XT_SORT_FN(swap)(base_r - offsets_r[start_r + num_r], first++);
+		last = first;
+	}
+pivot:
+	--first;
+	*begin = *first;
+	*first = pivot;
+	return first;
+}
+
+static void _XT_SORT_FN(loop)(XT_SORT_TYPE *begin, XT_SORT_TYPE *end, unsigned bad_allowed, bool leftmost)
+{
+	XT_SORT_TYPE *pivot;
+	size_t size, half, l_size, r_size;
+	bool sorted;
+	while ((size = end - begin) >= _XT_SORT_INSERTION_THRESHOLD) {
+		half = size / 2;
+		if (size > _XT_SORT_NINTHER_THRESHOLD) {
+			_XT_SORT_FN(sort3)(begin, begin + half, end - 1);
+			_XT_SORT_FN(sort3)(begin + 1, begin + (half - 1), end - 2);
+			_XT_SORT_FN(sort3)(begin + 2, begin + (half + 1), end - 3);
+			_XT_SORT_FN(sort3)(begin + (half - 1), begin + half, begin + (half + 1));
+			_XT_SORT_FN(swap)(begin, begin + half);
+		} else
+			_XT_SORT_FN(sort3)(begin + half, begin, end - 1);
+		// Equal to the element before the range: skip all elements equal to the pivot
+		if (!leftmost && !XT_SORT_LESS(begin[-1], *begin)) {
+			begin = _XT_SORT_FN(partition_left)(begin, end) + 1;
+			continue;
+		}
+		pivot = _XT_SORT_FN(partition_right)(begin, end, &sorted);
+		l_size = pivot - begin;
+		r_size = end - (pivot + 1);
+		if (l_size < size / 8 || r_size < size / 8) {
+			if (!--bad_allowed) {
+				_XT_SORT_FN(heap)(begin, size);
+				return;
+			}
+			// Shuffle some elements around to break up patterns
+			if (l_size >= _XT_SORT_INSERTION_THRESHOLD) {
+				_XT_SORT_FN(swap)(begin, begin + l_size / 4);
+				_XT_SORT_FN(swap)(pivot - 1, pivot - l_size / 4);
+				if (l_size > _XT_SORT_NINTHER_THRESHOLD) {
+					_XT_SORT_FN(swap)(begin + 1, begin + (l_size / 4 + 1));
+					_XT_SORT_FN(swap)(begin + 2, begin + (l_size / 4 + 2));
+					_XT_SORT_FN(swap)(pivot - 2, pivot - (l_size / 4 + 1));
+					_XT_SORT_FN(swap)(pivot - 3, pivot - (l_size / 4 + 2));
+				}
+			}
+			if (r_size >= _XT_SORT_INSERTION_THRESHOLD) {
+				_XT_SORT_FN(swap)(pivot + 1, pivot + (1 + r_size / 4));
+				_XT_SORT_FN(swap)(end - 1, end - r_size / 4);
+				if (r_size > _XT_SORT_NINTHER_THRESHOLD) {
+					_XT_SORT_FN(swap)(pivot + 2, pivot + (2 + r_size / 4));
+					_XT_SORT_FN(swap)(pivot + 3, pivot + (3 + r_size / 4));
+					_XT_SORT_FN(swap)(end - 2, end - (1 + r_size / 4));
+					_XT_SORT_FN(swap)(end - 3, end - (2 + r_size / 4));
+				}
+			}
+		} else if (sorted && _XT_SORT_FN(partial_insertion)(begin, pivot) && _XT_SORT_FN(partial_insertion)(pivot + 1, end))
+			return;
+		// Recurse into the smaller side to bound the stack depth by log2(n)
+		if (l_size < r_size) {
+			_XT_SORT_FN(loop)(begin, pivot, bad_allowed, leftmost);
+			begin = pivot + 1;
+			leftmost = false;
+		} else {
+			_XT_SORT_FN(loop)(pivot + 1, end, bad_allowed, false);
+			end = pivot;
+		}
+	}
+	if (leftmost)
+		_XT_SORT_FN(insertion)(begin, end);
+	else
+		_XT_SORT_FN(unguarded_insertion)(begin, end);
+}
+
+static void XT_SORT_NAME(XT_SORT_TYPE *list, size_t count)
+{
+	unsigned log2 = 0;
+	for (size_t x = count; x >>= 1;)
+		++log2;
+	_XT_SORT_FN(loop)(list, list + count, log2 + 1, true);
+}
+
+#undef _XT_SORT_FN
+#undef XT_SORT_TYPE
+#undef XT_SORT_NAME
+#undef XT_SORT_LESS
@@ -20,6 +20,7 @@ extern "C" {
 
 // XT headers
 #include <xt/_base.h>
+#include <xt/allocator.h>
 
 // STD headers
 #include <stdbool.h>
@@ -31,30 +32,35 @@ struct xtStackHD {
 	short *data;
 	size_t count, capacity;
 	int grow;
+	const struct xtAllocator *allocator;
 };
 
 struct xtStackD {
 	int *data;
 	size_t count, capacity;
 	int grow;
+	const struct xtAllocator *allocator;
 };
 
 struct xtStackU {
 	unsigned *data;
 	size_t count, capacity;
 	int grow;
+	const struct xtAllocator *allocator;
 };
 
 struct xtStackLU {
 	unsigned long *data;
 	size_t count, capacity;
 	int grow;
+	const struct xtAllocator *allocator;
 };
 
 struct xtStackZU {
 	size_t *data;
 	size_t count, capacity;
 	int grow;
+	const struct xtAllocator *allocator;
 };
 
 void xtStackHDInit(struct xtStackHD *stack);
@@ -78,6 +84,15 @@ int xtStackHDCreate(struct xtStackHD *stack, size_t capacity);
 int xtStackUCreate (struct xtStackU  *stack, size_t capacity);
 int xtStackLUCreate(struct xtStackLU *stack, size_t capacity);
 int xtStackZUCreate(struct xtStackZU *stack, size_t capacity);
+/**
+ * Creates a new stack whose elements are allocated by \a allocator.
+ * @param allocator - The allocator for the elements. Specify NULL to use malloc.
+ */
+int xtStackDCreateAllocator (struct xtStackD  *stack, size_t capacity, const struct xtAllocator *allocator);
+int xtStackHDCreateAllocator(struct xtStackHD *stack, size_t capacity, const struct xtAllocator *allocator);
+int xtStackUCreateAllocator (struct xtStackU  *stack, size_t capacity, const struct xtAllocator *allocator);
+int xtStackLUCreateAllocator(struct xtStackLU *stack, size_t capacity, const struct xtAllocator *allocator);
+int xtStackZUCreateAllocator(struct xtStackZU *stack, size_t capacity, const struct xtAllocator *allocator);
 /**
  * Changes grow policy. Positive values indicate fixed growth.
  * Negative values is relative growth. Zero disables growth.
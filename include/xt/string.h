@@ -27,6 +27,35 @@ extern "C" {
 #include <stdint.h>
 #include <stdio.h>
 
+/**
+ * A compiled format string. It consists of the literal text spans and the
+ * already parsed conversions, so it can be rendered over and over again
+ * without scanning the format string each time.
+ */
+struct xtFormat;
+/**
+ * A single argument for xtFormatRenderArgs(). Use \a i for signed integers
+ * (including characters and '*' width and precision arguments), \a u for
+ * unsigned integers, \a d for doubles, \a ld for long doubles and \a p for
+ * strings and pointers.
+ */
+union xtFormatArg {
+	long long i;
+	unsigned long long u;
+	double d;
+	long double ld;
+	const void *p;
+};
+/**
+ * Retrieves a compiled format for \a format that is compiled only once per
+ * call site. It declares the variable \a var which points to the compiled
+ * format, or NULL if it could not be compiled.
+ * E.g.: XT_FORMAT_STATIC(fmt, "%s: %d\n"); xtFormatRender(buf, sizeof buf, fmt, "answer", 42);
+ */
+#define XT_FORMAT_STATIC(var, format) \
+	static struct xtFormat *_xt_format_##var; \
+	const struct xtFormat *var = xtFormatStatic(&_xt_format_##var, format)
+
 int xtBase64Decode(void *buf, size_t buflen, const void *data, size_t datalen);
 
 int xtBase64Encode(void *buf, size_t buflen, const void *data, size_t datalen);
@@ -58,6 +87,23 @@ char *xtFormatCommasLL(char *buf, size_t buflen, long long value, int sep);
  * \a buf will receive the final string. No bounds checking is performed.
  */
 char *xtFormatCommasLLU(char *buf, size_t buflen, unsigned long long value, int sep);
+/**
+ * Compiles \a format into a format program which can be rendered any number
+ * of times using xtFormatRender(). The same conversions as xtsnprintf() are
+ * supported, except for positional arguments (e.g. %1$d).
+ * @param fmt - Will receive the compiled format.
+ * @returns Zero if compiled, otherwise an error code.
+ */
+int xtFormatCreate(struct xtFormat **fmt, const char *format);
+/**
+ * Destroys the compiled format and cleans up all resources.
+ */
+void xtFormatDestroy(struct xtFormat **fmt);
+/**
+ * Returns the number of arguments that the compiled format consumes. Any '*'
+ * width and precision are counted as well.
+ */
+size_t xtFormatGetArgCount(const struct xtFormat *fmt);
 /**
  * Format block of data as a hexadecimal string separating each byte using \a sep.
  * @param buf - Will receive the formatted buffer. Bounds checking is performed.
@@ -70,6 +116,29 @@ char *xtFormatCommasLLU(char *buf, size_t buflen, unsigned long long value, int
  * @returns A pointer to \a buf.
  */
 char *xtFormatHex(char *restrict buf, size_t buflen, const void *restrict data, size_t datalen, int sep, bool uppercase);
+/**
+ * Renders the compiled format to the buffer. It behaves exactly the same as
+ * xtsnprintf() would with the original format string.
+ * @returns Number of characters that would have been written. Negative on failure.
+ */
+int xtFormatRender(char *str, size_t size, const struct xtFormat *fmt, ...);
+int xtFormatRenderV(char *str, size_t size, const struct xtFormat *fmt, va_list args);
+/**
+ * Renders the compiled format using an argument array rather than a variable
+ * argument list. Integer arguments are narrowed according to their length
+ * modifier just like xtsnprintf() would.
+ * @param argc - The number of elements in \a args. Rendering fails if this is
+ * less than xtFormatGetArgCount().
+ * @returns Number of characters that would have been written. Negative on failure.
+ */
+int xtFormatRenderArgs(char *str, size_t size, const struct xtFormat *fmt, const union xtFormatArg *args, size_t argc);
+/**
+ * Returns the compiled format that is cached at \a cache. It is compiled on
+ * the first call. This function is thread safe. Use XT_FORMAT_STATIC rather
+ * than calling this directly.
+ * @returns The compiled format, or NULL if it could not be compiled.
+ */
+const struct xtFormat *xtFormatStatic(struct xtFormat **cache, const char *format);
 /**
  * Fills the buffer with the current time in the following format:
  * YYYY-mm-dd HH:MM:SS. The clock uses the 24 hour format.
@@ -79,6 +148,34 @@ char *xtFormatHex(char *restrict buf, size_t buflen, const void *restrict data,
  * @returns A pointer to the buffer. Null is returned on failure.
  */
 char *xtFormatTime(char *buf, size_t buflen, unsigned timestamp_secs);
+/**
+ * Cache for xtFormatTimeCached(). It holds the rendered date and time of the
+ * last formatted second, so any other timestamp within the same second only
+ * needs its fractional digits rendered. Zero initialize it before first use
+ * and do not share it between threads.
+ */
+struct xtFormatTimeCache {
+	unsigned long long sec, day;
+	char text[20];
+};
+/**
+ * Fills the buffer with the time in the following format:
+ * YYYY-mm-dd HH:MM:SS.fff where the number of fractional digits is specified
+ * by \a decimals. The clock uses the 24 hour format.
+ * @param cache - The cache to use. See struct xtFormatTimeCache.
+ * @param decimals - Number of fractional digits (0-9). Specify zero to omit
+ * the fraction.
+ * @returns A pointer to the buffer. Null is returned on failure.
+ */
+char *xtFormatTimeCached(char *buf, size_t buflen, struct xtFormatTimeCache *cache, const struct xtTimestamp *timestamp, unsigned decimals);
+/**
+ * Does the same as xtFormatTimeCached() for the current time of
+ * XT_CLOCK_REALTIME_COARSE, using a cache that is private to the caller
+ * thread. Keep in mind that the coarse clock only advances every few
+ * milliseconds.
+ * @returns A pointer to the buffer. Null is returned on failure.
+ */
+char *xtFormatTimeNow(char *buf, size_t buflen, unsigned decimals);
 /**
  * Fills the buffer with the current time in the following format:
  * YYYY-mm-dd HH:MM:SS mmm:uuu:nnn. The clock uses the 24 hour format.
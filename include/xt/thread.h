@@ -146,6 +146,13 @@ bool xtThreadIsAlive(const struct xtThread *t);
  * @return - Zero on success, otherwise an error code.
  */
 int xtThreadJoin(struct xtThread *t, void **ret);
+/**
+ * Binds the caller thread to the specified logical CPU, so the scheduler no
+ * longer migrates it to other CPUs.
+ * @param cpu - The zero based index of the logical CPU.
+ * @return Zero on success, otherwise an error code.
+ */
+int xtThreadSetAffinity(unsigned cpu);
 /**
  * Sets the name of the caller thread. The thread's name is the name that also
  * shows up in debuggers.
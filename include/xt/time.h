@@ -106,6 +106,25 @@ int xtClockGetResolution(struct xtTimestamp *timestamp, enum xtClock clock);
  * @return 0 for success, otherwise an error code.
  */
 int xtClockGetTime(struct xtTimestamp *timestamp, enum xtClock clock);
+/**
+ * Reads a fast monotonic cycle counter. This is meant for measuring short
+ * durations on hot paths, where even xtClockGetTime() is too expensive. Use
+ * xtCyclesToNs() to convert the difference between two readings.
+ * On x86 this reads the time stamp counter if it is invariant. Otherwise it
+ * falls back to the nanoseconds of XT_CLOCK_MONOTONIC.
+ */
+unsigned long long xtCycles(void);
+/**
+ * Converts a number of cycles from xtCycles() to nanoseconds.
+ * The first call calibrates the cycle counter, which busy waits for about
+ * ten milliseconds.
+ */
+unsigned long long xtCyclesToNs(unsigned long long cycles);
+/**
+ * Returns whether xtCycles() reads the time stamp counter rather than
+ * falling back to XT_CLOCK_MONOTONIC.
+ */
+bool xtCyclesIsTSC(void);
 /**
  * Returns the uptime of the device in seconds.
  */
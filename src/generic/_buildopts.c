@@ -0,0 +1,18 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+// Generated by configure
+// Do not modify this!
+
+#include <xt/utils.h>
+
+#define expr(x) #x
+#define str(x) expr(x)
+
+const struct xtBuildOptions XT_BUILD_OPTIONS = {
+	"-std=gnu99 -Wall -Wextra -pedantic",
+	"2026-10-18",
+	"v" str(XT_VERSION_MAJOR) "." str(XT_VERSION_MINOR) "." str(XT_VERSION_PATCH),
+	XT_VERSION_MAJOR,
+	XT_VERSION_MINOR,
+	XT_VERSION_PATCH
+};
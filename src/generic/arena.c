@@ -0,0 +1,220 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+// XT headers
+#include <xt/arena.h>
+#include <xt/error.h>
+#include <xt/mman.h>
+
+// STD headers
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_PAGE_SIZE 4096
+
+struct xtArenaChunk {
+	struct xtArenaChunk *prev;
+	/** The size of the whole chunk, including this header. */
+	size_t size;
+	bool mapped;
+};
+
+/* The data of a chunk starts right after the header, at the default alignment */
+#define CHUNK_HEADER_SIZE ((sizeof(struct xtArenaChunk) + XT_ARENA_ALIGN_DEFAULT - 1) & ~(size_t)(XT_ARENA_ALIGN_DEFAULT - 1))
+#define CHUNK_DATA(chunk) ((char*)(chunk) + CHUNK_HEADER_SIZE)
+#define CHUNK_END(chunk) ((char*)(chunk) + (chunk)->size)
+
+void *xtAllocatorAlloc(const struct xtAllocator *allocator, size_t size)
+{
+	if (!allocator)
+		return malloc(size);
+	return allocator->alloc(allocator->arg, size);
+}
+
+void *xtAllocatorRealloc(const struct xtAllocator *allocator, void *ptr, size_t oldSize, size_t size)
+{
+	if (!allocator)
+		return realloc(ptr, size);
+	if (!ptr)
+		return allocator->alloc(allocator->arg, size);
+	return allocator->realloc(allocator->arg, ptr, oldSize, size);
+}
+
+void xtAllocatorFree(const struct xtAllocator *allocator, void *ptr, size_t size)
+{
+	if (!allocator)
+		free(ptr);
+	else if (ptr)
+		allocator->free(allocator->arg, ptr, size);
+}
+
+static struct xtArenaChunk *chunk_alloc(size_t size)
+{
+	struct xtArenaChunk *chunk = NULL;
+	bool mapped = false;
+	if (size >= XT_ARENA_MMAP_THRESHOLD) {
+		size = (size + ARENA_PAGE_SIZE - 1) & ~(size_t)(ARENA_PAGE_SIZE - 1);
+		chunk = xtmmap(NULL, size, XT_MMAN_PROT_READ | XT_MMAN_PROT_WRITE, XT_MMAN_MAP_ANONYMOUS | XT_MMAN_MAP_PRIVATE, -1, 0);
+		if (chunk == XT_MMAN_MAP_FAILED)
+			chunk = NULL;
+		else
+			mapped = true;
+	}
+	if (!chunk && !(chunk = malloc(size)))
+		return NULL;
+	chunk->prev = NULL;
+	chunk->size = size;
+	chunk->mapped = mapped;
+	return chunk;
+}
+
+static void chunk_free(struct xtArenaChunk *chunk)
+{
+	if (chunk->mapped)
+		xtmunmap(chunk, chunk->size);
+	else
+		free(chunk);
+}
+
+static void arena_use(struct xtArena *arena, struct xtArenaChunk *chunk)
+{
+	arena->chunk = chunk;
+	arena->pos = CHUNK_DATA(chunk);
+	arena->end = CHUNK_END(chunk);
+}
+
+/* Continues in a new chunk that is big enough for the allocation */
+static void *arena_grow(struct xtArena *arena, size_t size, size_t align)
+{
+	struct xtArenaChunk *chunk;
+	size_t need = CHUNK_HEADER_SIZE + align;
+	if (size > SIZE_MAX - need)
+		return NULL;
+	need += size;
+	if (!(chunk = chunk_alloc(need > arena->chunkSize ? need : arena->chunkSize)))
+		return NULL;
+	chunk->prev = arena->chunk;
+	arena_use(arena, chunk);
+	return xtArenaAllocAligned(arena, size, align);
+}
+
+static void *arena_alloc(void *arg, size_t size)
+{
+	return xtArenaAlloc(arg, size);
+}
+
+static void *arena_realloc(void *arg, void *ptr, size_t oldSize, size_t size)
+{
+	return xtArenaRealloc(arg, ptr, oldSize, size);
+}
+
+static void arena_free(void *arg, void *ptr, size_t size)
+{
+	struct xtArena *arena = arg;
+	// Only the last allocation can be given back
+	if ((char*)ptr + size == arena->pos)
+		arena->pos = ptr;
+}
+
+int xtArenaCreate(struct xtArena *arena, size_t chunkSize, size_t align)
+{
+	struct xtArenaChunk *chunk;
+	if (!chunkSize)
+		chunkSize = XT_ARENA_CHUNK_DEFAULT;
+	if (!align)
+		align = XT_ARENA_ALIGN_DEFAULT;
+	if (align & (align - 1) || chunkSize < CHUNK_HEADER_SIZE || chunkSize > SIZE_MAX / 2)
+		return XT_EINVAL;
+	if (!(chunk = chunk_alloc(chunkSize)))
+		return XT_ENOMEM;
+	arena_use(arena, chunk);
+	arena->chunkSize = chunk->size;
+	arena->align = align;
+	arena->allocator.alloc = arena_alloc;
+	arena->allocator.realloc = arena_realloc;
+	arena->allocator.free = arena_free;
+	arena->allocator.arg = arena;
+	return 0;
+}
+
+void xtArenaDestroy(struct xtArena *arena)
+{
+	for (struct xtArenaChunk *prev, *chunk = arena->chunk; chunk; chunk = prev) {
+		prev = chunk->prev;
+		chunk_free(chunk);
+	}
+	arena->chunk = NULL;
+	arena->pos = arena->end = NULL;
+}
+
+void *xtArenaAlloc(struct xtArena *arena, size_t size)
+{
+	return xtArenaAllocAligned(arena, size, arena->align);
+}
+
+void *xtArenaAllocAligned(struct xtArena *arena, size_t size, size_t align)
+{
+	uintptr_t ptr, end = (uintptr_t)arena->end;
+	if (!align || align & (align - 1))
+		return NULL;
+	ptr = ((uintptr_t)arena->pos + align - 1) & ~(uintptr_t)(align - 1);
+	if (ptr > end || size > end - ptr)
+		return arena_grow(arena, size, align);
+	arena->pos = (char*)ptr + size;
+	return (void*)ptr;
+}
+
+void *xtArenaRealloc(struct xtArena *arena, void *ptr, size_t oldSize, size_t size)
+{
+	void *new;
+	if (!ptr)
+		return xtArenaAlloc(arena, size);
+	// Grow or shrink the last allocation in place
+	if ((char*)ptr + oldSize == arena->pos && size <= (size_t)(arena->end - (char*)ptr)) {
+		arena->pos = (char*)ptr + size;
+		return ptr;
+	}
+	if (size <= oldSize)
+		return ptr;
+	if (!(new = xtArenaAlloc(arena, size)))
+		return NULL;
+	memcpy(new, ptr, oldSize);
+	return new;
+}
+
+void xtArenaGetMark(const struct xtArena *arena, struct xtArenaMark *mark)
+{
+	mark->chunk = arena->chunk;
+	mark->pos = arena->pos;
+}
+
+void xtArenaRewind(struct xtArena *arena, const struct xtArenaMark *mark)
+{
+	while (arena->chunk != mark->chunk) {
+		struct xtArenaChunk *prev = arena->chunk->prev;
+		chunk_free(arena->chunk);
+		arena->chunk = prev;
+	}
+	arena->pos = mark->pos;
+	arena->end = CHUNK_END(arena->chunk);
+}
+
+void xtArenaReset(struct xtArena *arena)
+{
+	struct xtArenaChunk *chunk = arena->chunk;
+	while (chunk->prev) {
+		struct xtArenaChunk *prev = chunk->prev;
+		chunk_free(chunk);
+		chunk = prev;
+	}
+	arena_use(arena, chunk);
+}
+
+size_t xtArenaGetSize(const struct xtArena *arena)
+{
+	size_t size = 0;
+	for (const struct xtArenaChunk *chunk = arena->chunk; chunk; chunk = chunk->prev)
+		size += chunk->size;
+	return size;
+}
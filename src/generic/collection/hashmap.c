@@ -2,6 +2,7 @@
 
 // XT headers
 #include <xt/hashmap.h>
+#include <xt/allocator.h>
 #include <xt/error.h>
 
 // STD headers
@@ -22,7 +23,7 @@ int xtHashmapAdd(struct xtHashmap *map, void *key, void *value)
 	}
 	size_t hash;
 	struct xtHashBucket *bucket, *entry;
-	entry = malloc(sizeof *entry);
+	entry = xtAllocatorAlloc(map->allocator, sizeof *entry);
 	if (!entry)
 		return XT_ENOMEM;
 	entry->key = key;
@@ -53,11 +54,21 @@ int xtHashmapCreate(
 	bool (*keyCompare)(const void*, const void*)
 )
 {
-	map->buckets = malloc(capacity * sizeof *map->buckets);
-	if (!map->buckets)
-		return XT_ENOMEM;
+	return xtHashmapCreateAllocator(map, capacity, keyHash, keyCompare, NULL);
+}
+
+int xtHashmapCreateAllocator(
+	struct xtHashmap *map, size_t capacity,
+	size_t (*keyHash)(const void*),
+	bool (*keyCompare)(const void*, const void*),
+	const struct xtAllocator *allocator
+)
+{
 	if (capacity == 0)
 		capacity = XT_HASHMAP_CAPACITY_DEFAULT;
+	map->buckets = xtAllocatorAlloc(allocator, capacity * sizeof *map->buckets);
+	if (!map->buckets)
+		return XT_ENOMEM;
 	map->capacity = capacity;
 	map->count = 0;
 	for (size_t i = 0; i < capacity; ++i)
@@ -69,6 +80,7 @@ int xtHashmapCreate(
 	map->grow_limit = XT_HASHMAP_GROWTH_LIMIT_DEFAULT;
 	map->grow = XT_HASHMAP_GROWTH_FACTOR_DEFAULT;
 	map->flags = 0;
+	map->allocator = allocator;
 	return 0;
 }
 
@@ -79,7 +91,7 @@ static void hashmap_delete_bucket(struct xtHashmap *map, struct xtHashBucket *bu
 		free(bucket->value);
 	if (flags & XT_HASHMAP_FREE_KEY)
 		free(bucket->key);
-	free(bucket);
+	xtAllocatorFree(map->allocator, bucket, sizeof *bucket);
 }
 
 void xtHashmapDestroy(struct xtHashmap *map)
@@ -93,7 +105,7 @@ void xtHashmapDestroy(struct xtHashmap *map)
 				next = b->next;
 				hashmap_delete_bucket(map, b);
 			}
-	free(map->buckets);
+	xtAllocatorFree(map->allocator, map->buckets, capacity * sizeof *map->buckets);
 	map->buckets = NULL;
 }
 
@@ -246,7 +258,7 @@ int xtHashmapRemove(struct xtHashmap *map, void *key)
 /* Create internal copy and inherit all settings from old hashmap */
 static int hashmap_copy(struct xtHashmap *new, const struct xtHashmap *orig, size_t size)
 {
-	int ret = xtHashmapCreate(new, size, orig->keyHash, orig->keyCompare);
+	int ret = xtHashmapCreateAllocator(new, size, orig->keyHash, orig->keyCompare, orig->allocator);
 	if (ret)
 		return ret;
 	xtHashmapSetGrowthFactor(new, xtHashmapGetGrowthFactor(orig));
@@ -2,6 +2,7 @@
 
 // XT headers
 #include <xt/list.h>
+#include <xt/allocator.h>
 #include <xt/error.h>
 
 // STD headers
@@ -164,79 +165,110 @@ void xtListPClear(struct xtListP *list)
 	list->count = 0;
 }
 
-#define list_init(this, capacity) \
+#define list_init(this, capacity, alloc) \
 	this->count = 0; \
 	this->capacity = capacity; \
 	this->grow = -1; \
-	this->flags = 0;
+	this->flags = 0; \
+	this->allocator = alloc;
 
 int xtListHDCreate(struct xtListHD *list, size_t capacity)
+{
+	return xtListHDCreateAllocator(list, capacity, NULL);
+}
+
+int xtListHDCreateAllocator(struct xtListHD *list, size_t capacity, const struct xtAllocator *allocator)
 {
 	if (capacity == 0)
 		capacity = XT_LIST_CAPACITY_DEFAULT;
-	list->data = malloc(sizeof(short) * capacity);
+	list->data = xtAllocatorAlloc(allocator, sizeof(short) * capacity);
 	if (!list->data)
 		return XT_ENOMEM;
-	list_init(list, capacity);
+	list_init(list, capacity, allocator);
 	return 0;
 }
 
 int xtListDCreate(struct xtListD *list, size_t capacity)
+{
+	return xtListDCreateAllocator(list, capacity, NULL);
+}
+
+int xtListDCreateAllocator(struct xtListD *list, size_t capacity, const struct xtAllocator *allocator)
 {
 	if (capacity == 0)
 		capacity = XT_LIST_CAPACITY_DEFAULT;
-	list->data = malloc(sizeof(int) * capacity);
+	list->data = xtAllocatorAlloc(allocator, sizeof(int) * capacity);
 	if (!list->data)
 		return XT_ENOMEM;
-	list_init(list, capacity);
+	list_init(list, capacity, allocator);
 	return 0;
 }
 
 int xtListUCreate(struct xtListU *list, size_t capacity)
+{
+	return xtListUCreateAllocator(list, capacity, NULL);
+}
+
+int xtListUCreateAllocator(struct xtListU *list, size_t capacity, const struct xtAllocator *allocator)
 {
 	if (capacity == 0)
 		capacity = XT_LIST_CAPACITY_DEFAULT;
-	list->data = malloc(sizeof(unsigned) * capacity);
+	list->data = xtAllocatorAlloc(allocator, sizeof(unsigned) * capacity);
 	if (!list->data)
 		return XT_ENOMEM;
-	list_init(list, capacity);
+	list_init(list, capacity, allocator);
 	return 0;
 }
 
 int xtListLUCreate(struct xtListLU *list, size_t capacity)
+{
+	return xtListLUCreateAllocator(list, capacity, NULL);
+}
+
+int xtListLUCreateAllocator(struct xtListLU *list, size_t capacity, const struct xtAllocator *allocator)
 {
 	if (capacity == 0)
 		capacity = XT_LIST_CAPACITY_DEFAULT;
-	list->data = malloc(sizeof(unsigned long) * capacity);
+	list->data = xtAllocatorAlloc(allocator, sizeof(unsigned long) * capacity);
 	if (!list->data)
 		return XT_ENOMEM;
-	list_init(list, capacity);
+	list_init(list, capacity, allocator);
 	return 0;
 }
 
 int xtListZUCreate(struct xtListZU *list, size_t capacity)
+{
+	return xtListZUCreateAllocator(list, capacity, NULL);
+}
+
+int xtListZUCreateAllocator(struct xtListZU *list, size_t capacity, const struct xtAllocator *allocator)
 {
 	if (capacity == 0)
 		capacity = XT_LIST_CAPACITY_DEFAULT;
-	list->data = malloc(sizeof(size_t) * capacity);
+	list->data = xtAllocatorAlloc(allocator, sizeof(size_t) * capacity);
 	if (!list->data)
 		return XT_ENOMEM;
-	list_init(list, capacity);
+	list_init(list, capacity, allocator);
 	return 0;
 }
 
 int xtListPCreate(struct xtListP *list, size_t capacity)
+{
+	return xtListPCreateAllocator(list, capacity, NULL);
+}
+
+int xtListPCreateAllocator(struct xtListP *list, size_t capacity, const struct xtAllocator *allocator)
 {
 	if (capacity == 0)
 		capacity = XT_LIST_CAPACITY_DEFAULT;
-	list->data = malloc(sizeof(void*) * capacity);
+	list->data = xtAllocatorAlloc(allocator, sizeof(void*) * capacity);
 	if (!list->data)
 		return XT_ENOMEM;
-	list_init(list, capacity);
+	list_init(list, capacity, allocator);
 	return 0;
 }
 
-#define func_destroy(type) void type ## Destroy(struct type *list) { type ## Clear(list); if (list->data) { free(list->data); list->data = NULL; } }
+#define func_destroy(type) void type ## Destroy(struct type *list) { type ## Clear(list); if (list->data) { xtAllocatorFree(list->allocator, list->data, list->capacity * sizeof *list->data); list->data = NULL; } }
 
 func_destroy(xtListHD)
 func_destroy(xtListD )
@@ -457,7 +489,7 @@ int xtListPRemoveAt(struct xtListP *list, size_t index)
 int xtListHDSetCapacity(struct xtListHD *list, size_t capacity)
 {
 	short *temp;
-	if (!(temp = realloc(list->data, capacity * sizeof(short))))
+	if (!(temp = xtAllocatorRealloc(list->allocator, list->data, list->capacity * sizeof(short), capacity * sizeof(short))))
 		return XT_ENOMEM;
 	list->data = temp;
 	list->capacity = capacity;
@@ -469,7 +501,7 @@ int xtListHDSetCapacity(struct xtListHD *list, size_t capacity)
 int xtListDSetCapacity(struct xtListD *list, size_t capacity)
 {
 	int *temp;
-	if (!(temp = realloc(list->data, capacity * sizeof(int))))
+	if (!(temp = xtAllocatorRealloc(list->allocator, list->data, list->capacity * sizeof(int), capacity * sizeof(int))))
 		return XT_ENOMEM;
 	list->data = temp;
 	list->capacity = capacity;
@@ -481,7 +513,7 @@ int xtListDSetCapacity(struct xtListD *list, size_t capacity)
 int xtListUSetCapacity(struct xtListU *list, size_t capacity)
 {
 	unsigned *temp;
-	if (!(temp = realloc(list->data, capacity * sizeof(unsigned))))
+	if (!(temp = xtAllocatorRealloc(list->allocator, list->data, list->capacity * sizeof(unsigned), capacity * sizeof(unsigned))))
 		return XT_ENOMEM;
 	list->data = temp;
 	list->capacity = capacity;
@@ -493,7 +525,7 @@ int xtListUSetCapacity(struct xtListU *list, size_t capacity)
 int xtListLUSetCapacity(struct xtListLU *list, size_t capacity)
 {
 	unsigned long *temp;
-	if (!(temp = realloc(list->data, capacity * sizeof(unsigned long))))
+	if (!(temp = xtAllocatorRealloc(list->allocator, list->data, list->capacity * sizeof(unsigned long), capacity * sizeof(unsigned long))))
 		return XT_ENOMEM;
 	list->data = temp;
 	list->capacity = capacity;
@@ -505,7 +537,7 @@ int xtListLUSetCapacity(struct xtListLU *list, size_t capacity)
 int xtListZUSetCapacity(struct xtListZU *list, size_t capacity)
 {
 	size_t *temp;
-	if (!(temp = realloc(list->data, capacity * sizeof(size_t))))
+	if (!(temp = xtAllocatorRealloc(list->allocator, list->data, list->capacity * sizeof(size_t), capacity * sizeof(size_t))))
 		return XT_ENOMEM;
 	list->data = temp;
 	list->capacity = capacity;
@@ -520,7 +552,7 @@ int xtListPSetCapacity(struct xtListP *list, size_t capacity)
 	if ((list->flags & XT_LIST_FREE_ITEM) && list->count > capacity)
 		for (size_t i = capacity, n = list->count; i < n; ++i)
 			free(list->data[i]);
-	if (!(temp = realloc(list->data, capacity * sizeof(void*))))
+	if (!(temp = xtAllocatorRealloc(list->allocator, list->data, list->capacity * sizeof(void*), capacity * sizeof(void*))))
 		return XT_ENOMEM;
 	list->data = temp;
 	list->capacity = capacity;
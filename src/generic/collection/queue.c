@@ -2,12 +2,13 @@
 
 // XT headers
 #include <xt/queue.h>
+#include <xt/allocator.h>
 #include <xt/error.h>
 
 // STD headers
 #include <stdlib.h>
 
-#define func_init(type) void type ## Init(struct type *t) { t->data = NULL; }
+#define func_init(type) void type ## Init(struct type *t) { t->data = NULL; t->allocator = NULL; }
 #define func_set_grow(type) void type ## SetGrowthFactor(struct type *t, int grow) { t->grow = grow; }
 #define func_get_grow(type) int  type ## GetGrowthFactor(struct type *t) { return t->grow; }
 
@@ -29,68 +30,94 @@ func_get_grow(xtQueueU)
 func_get_grow(xtQueueLU)
 func_get_grow(xtQueueZU)
 
-#define queue_init(this, data, cap) \
+#define queue_init(this, data, cap, alloc) \
 	this->data = data; \
 	this->count = this->front = this->rear = 0; \
 	this->capacity = cap; \
-	this->grow = -2;
+	this->grow = -2; \
+	this->allocator = alloc;
 
-static inline int queue_create(void **data, size_t elemsize, size_t n)
+static inline int queue_create(void **data, size_t elemsize, size_t *n, const struct xtAllocator *allocator)
 {
-	if (!n)
-		n = XT_QUEUE_CAPACITY_DEFAULT;
-	if (!(*data = malloc(n * elemsize)))
+	if (!*n)
+		*n = XT_QUEUE_CAPACITY_DEFAULT;
+	if (!(*data = xtAllocatorAlloc(allocator, *n * elemsize)))
 		return XT_ENOMEM;
 	return 0;
 }
 
 int xtQueueHDCreate(struct xtQueueHD *this, size_t capacity)
+{
+	return xtQueueHDCreateAllocator(this, capacity, NULL);
+}
+
+int xtQueueHDCreateAllocator(struct xtQueueHD *this, size_t capacity, const struct xtAllocator *allocator)
 {
 	void *data;
-	int ret = queue_create(&data, sizeof(short), capacity);
+	int ret = queue_create(&data, sizeof(short), &capacity, allocator);
 	if (ret)
 		return ret;
-	queue_init(this, data, capacity);
+	queue_init(this, data, capacity, allocator);
 	return 0;
 }
 
 int xtQueueDCreate(struct xtQueueD *this, size_t capacity)
+{
+	return xtQueueDCreateAllocator(this, capacity, NULL);
+}
+
+int xtQueueDCreateAllocator(struct xtQueueD *this, size_t capacity, const struct xtAllocator *allocator)
 {
 	void *data;
-	int ret = queue_create(&data, sizeof(int), capacity);
+	int ret = queue_create(&data, sizeof(int), &capacity, allocator);
 	if (ret)
 		return ret;
-	queue_init(this, data, capacity);
+	queue_init(this, data, capacity, allocator);
 	return 0;
 }
 
 int xtQueueUCreate(struct xtQueueU *this, size_t capacity)
+{
+	return xtQueueUCreateAllocator(this, capacity, NULL);
+}
+
+int xtQueueUCreateAllocator(struct xtQueueU *this, size_t capacity, const struct xtAllocator *allocator)
 {
 	void *data;
-	int ret = queue_create(&data, sizeof(unsigned), capacity);
+	int ret = queue_create(&data, sizeof(unsigned), &capacity, allocator);
 	if (ret)
 		return ret;
-	queue_init(this, data, capacity);
+	queue_init(this, data, capacity, allocator);
 	return 0;
 }
 
 int xtQueueLUCreate(struct xtQueueLU *this, size_t capacity)
+{
+	return xtQueueLUCreateAllocator(this, capacity, NULL);
+}
+
+int xtQueueLUCreateAllocator(struct xtQueueLU *this, size_t capacity, const struct xtAllocator *allocator)
 {
 	void *data;
-	int ret = queue_create(&data, sizeof(unsigned long), capacity);
+	int ret = queue_create(&data, sizeof(unsigned long), &capacity, allocator);
 	if (ret)
 		return ret;
-	queue_init(this, data, capacity);
+	queue_init(this, data, capacity, allocator);
 	return 0;
 }
 
 int xtQueueZUCreate(struct xtQueueZU *this, size_t capacity)
+{
+	return xtQueueZUCreateAllocator(this, capacity, NULL);
+}
+
+int xtQueueZUCreateAllocator(struct xtQueueZU *this, size_t capacity, const struct xtAllocator *allocator)
 {
 	void *data;
-	int ret = queue_create(&data, sizeof(size_t), capacity);
+	int ret = queue_create(&data, sizeof(size_t), &capacity, allocator);
 	if (ret)
 		return ret;
-	queue_init(this, data, capacity);
+	queue_init(this, data, capacity, allocator);
 	return 0;
 }
 
@@ -225,7 +252,7 @@ bool xtQueueZUPeek(struct xtQueueZU *this, size_t *top)
 }
 
 
-#define func_free(type) void type ## Destroy(struct type *t) { if (t->data) { free(t->data); t->data = NULL; } }
+#define func_free(type) void type ## Destroy(struct type *t) { if (t->data) { xtAllocatorFree(t->allocator, t->data, t->capacity * sizeof *t->data); t->data = NULL; } }
 
 func_free(xtQueueHD)
 func_free(xtQueueD )
@@ -343,7 +370,7 @@ int xtQueueHDSetCapacity(struct xtQueueHD *queue, size_t capacity)
 	if (queue->capacity == capacity)
 		return 0;
 	struct xtQueueHD new;
-	int ret = xtQueueHDCreate(&new, capacity);
+	int ret = xtQueueHDCreateAllocator(&new, capacity, queue->allocator);
 	if (ret)
 		return ret;
 	size_t j = 0, n = queue->count;
@@ -363,7 +390,7 @@ int xtQueueDSetCapacity(struct xtQueueD *queue, size_t capacity)
 	if (queue->capacity == capacity)
 		return 0;
 	struct xtQueueD new;
-	int ret = xtQueueDCreate(&new, capacity);
+	int ret = xtQueueDCreateAllocator(&new, capacity, queue->allocator);
 	if (ret)
 		return ret;
 	size_t j = 0, n = queue->count;
@@ -383,7 +410,7 @@ int xtQueueUSetCapacity(struct xtQueueU *queue, size_t capacity)
 	if (queue->capacity == capacity)
 		return 0;
 	struct xtQueueU new;
-	int ret = xtQueueUCreate(&new, capacity);
+	int ret = xtQueueUCreateAllocator(&new, capacity, queue->allocator);
 	if (ret)
 		return ret;
 	size_t j = 0, n = queue->count;
@@ -403,7 +430,7 @@ int xtQueueLUSetCapacity(struct xtQueueLU *queue, size_t capacity)
 	if (queue->capacity == capacity)
 		return 0;
 	struct xtQueueLU new;
-	int ret = xtQueueLUCreate(&new, capacity);
+	int ret = xtQueueLUCreateAllocator(&new, capacity, queue->allocator);
 	if (ret)
 		return ret;
 	size_t j = 0, n = queue->count;
@@ -423,7 +450,7 @@ int xtQueueZUSetCapacity(struct xtQueueZU *queue, size_t capacity)
 	if (queue->capacity == capacity)
 		return 0;
 	struct xtQueueZU new;
-	int ret = xtQueueZUCreate(&new, capacity);
+	int ret = xtQueueZUCreateAllocator(&new, capacity, queue->allocator);
 	if (ret)
 		return ret;
 	size_t j = 0, n = queue->count;
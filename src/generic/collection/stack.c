@@ -2,12 +2,13 @@
 
 // XT headers
 #include <xt/stack.h>
+#include <xt/allocator.h>
 #include <xt/error.h>
 
 // STD headers
 #include <stdlib.h>
 
-#define func_init(type) void type ## Init(struct type *t) { t->data = NULL; }
+#define func_init(type) void type ## Init(struct type *t) { t->data = NULL; t->allocator = NULL; }
 #define func_set_grow(type) void type ## SetGrowthFactor(struct type *t, int grow) { t->grow = grow; }
 #define func_get_grow(type) int  type ## GetGrowthFactor(struct type *t) { return t->grow; }
 
@@ -29,72 +30,98 @@ func_get_grow(xtStackU)
 func_get_grow(xtStackLU)
 func_get_grow(xtStackZU)
 
-#define stack_init(this, data, cap) \
+#define stack_init(this, data, cap, alloc) \
 	this->data = data;\
 	this->count = 0;\
 	this->capacity = cap;\
-	this->grow = -2;
+	this->grow = -2;\
+	this->allocator = alloc;
 
-static inline int stack_create(void **data, size_t elemsize, size_t n)
+static inline int stack_create(void **data, size_t elemsize, size_t *n, const struct xtAllocator *allocator)
 {
-	if (!n)
-		n = XT_STACK_CAPACITY_DEFAULT;
-	if (!(*data = malloc(n * elemsize)))
+	if (!*n)
+		*n = XT_STACK_CAPACITY_DEFAULT;
+	if (!(*data = xtAllocatorAlloc(allocator, *n * elemsize)))
 		return XT_ENOMEM;
 	return 0;
 }
 
 int xtStackHDCreate(struct xtStackHD *this, size_t capacity)
+{
+	return xtStackHDCreateAllocator(this, capacity, NULL);
+}
+
+int xtStackHDCreateAllocator(struct xtStackHD *this, size_t capacity, const struct xtAllocator *allocator)
 {
 	void *data;
-	int ret = stack_create(&data, sizeof(short), capacity);
+	int ret = stack_create(&data, sizeof(short), &capacity, allocator);
 	if (ret)
 		return ret;
-	stack_init(this, data, capacity);
+	stack_init(this, data, capacity, allocator);
 	return 0;
 }
 
 int xtStackDCreate(struct xtStackD *this, size_t capacity)
+{
+	return xtStackDCreateAllocator(this, capacity, NULL);
+}
+
+int xtStackDCreateAllocator(struct xtStackD *this, size_t capacity, const struct xtAllocator *allocator)
 {
 	void *data;
-	int ret = stack_create(&data, sizeof(int), capacity);
+	int ret = stack_create(&data, sizeof(int), &capacity, allocator);
 	if (ret)
 		return ret;
-	stack_init(this, data, capacity)
+	stack_init(this, data, capacity, allocator);
 	return 0;
 }
 
 int xtStackUCreate(struct xtStackU *this, size_t capacity)
+{
+	return xtStackUCreateAllocator(this, capacity, NULL);
+}
+
+int xtStackUCreateAllocator(struct xtStackU *this, size_t capacity, const struct xtAllocator *allocator)
 {
 	void *data;
-	int ret = stack_create(&data, sizeof(unsigned), capacity);
+	int ret = stack_create(&data, sizeof(unsigned), &capacity, allocator);
 	if (ret)
 		return ret;
-	stack_init(this, data, capacity)
+	stack_init(this, data, capacity, allocator);
 	return 0;
 }
 
 int xtStackLUCreate(struct xtStackLU *this, size_t capacity)
+{
+	return xtStackLUCreateAllocator(this, capacity, NULL);
+}
+
+int xtStackLUCreateAllocator(struct xtStackLU *this, size_t capacity, const struct xtAllocator *allocator)
 {
 	void *data;
-	int ret = stack_create(&data, sizeof(unsigned long), capacity);
+	int ret = stack_create(&data, sizeof(unsigned long), &capacity, allocator);
 	if (ret)
 		return ret;
-	stack_init(this, data, capacity)
+	stack_init(this, data, capacity, allocator);
 	return 0;
 }
 
 int xtStackZUCreate(struct xtStackZU *this, size_t capacity)
+{
+	return xtStackZUCreateAllocator(this, capacity, NULL);
+}
+
+int xtStackZUCreateAllocator(struct xtStackZU *this, size_t capacity, const struct xtAllocator *allocator)
 {
 	void *data;
-	int ret = stack_create(&data, sizeof(size_t), capacity);
+	int ret = stack_create(&data, sizeof(size_t), &capacity, allocator);
 	if (ret)
 		return ret;
-	stack_init(this, data, capacity)
+	stack_init(this, data, capacity, allocator);
 	return 0;
 }
 
-#define func_free(type) void type ## Destroy(struct type *t) { if (t->data) { free(t->data); t->data = NULL; } }
+#define func_free(type) void type ## Destroy(struct type *t) { if (t->data) { xtAllocatorFree(t->allocator, t->data, t->capacity * sizeof *t->data); t->data = NULL; } }
 
 func_free(xtStackD )
 func_free(xtStackHD)
@@ -111,7 +138,7 @@ int xtStackHDPush(struct xtStackHD *this, short value)
 	size_t grow = this->grow > 0 ? (unsigned)this->grow : this->capacity / -(unsigned)this->grow;
 	// grow at least by one
 	if (!grow) ++grow;
-	short *tmp = realloc(this->data, (this->capacity + grow) * sizeof(short));
+	short *tmp = xtAllocatorRealloc(this->allocator, this->data, this->capacity * sizeof(short), (this->capacity + grow) * sizeof(short));
 	if (!tmp)
 		return XT_ENOMEM;
 	this->data = tmp;
@@ -130,7 +157,7 @@ int xtStackDPush(struct xtStackD *this, int value)
 	size_t grow = this->grow > 0 ? (unsigned)this->grow : this->capacity / -(unsigned)this->grow;
 	// grow at least by one
 	if (!grow) ++grow;
-	int *tmp = realloc(this->data, (this->capacity + grow) * sizeof(int));
+	int *tmp = xtAllocatorRealloc(this->allocator, this->data, this->capacity * sizeof(int), (this->capacity + grow) * sizeof(int));
 	if (!tmp)
 		return XT_ENOMEM;
 	this->data = tmp;
@@ -149,7 +176,7 @@ int xtStackUPush(struct xtStackU *this, unsigned value)
 	size_t grow = this->grow > 0 ? (unsigned)this->grow : this->capacity / -(unsigned)this->grow;
 	// grow at least by one
 	if (!grow) ++grow;
-	unsigned *tmp = realloc(this->data, (this->capacity + grow) * sizeof(unsigned));
+	unsigned *tmp = xtAllocatorRealloc(this->allocator, this->data, this->capacity * sizeof(unsigned), (this->capacity + grow) * sizeof(unsigned));
 	if (!tmp)
 		return XT_ENOMEM;
 	this->data = tmp;
@@ -168,7 +195,7 @@ int xtStackLUPush(struct xtStackLU *this, unsigned long value)
 	size_t grow = this->grow > 0 ? (unsigned)this->grow : this->capacity / -(unsigned)this->grow;
 	// grow at least by one
 	if (!grow) ++grow;
-	unsigned long *tmp = realloc(this->data, (this->capacity + grow) * sizeof(unsigned long));
+	unsigned long *tmp = xtAllocatorRealloc(this->allocator, this->data, this->capacity * sizeof(unsigned long), (this->capacity + grow) * sizeof(unsigned long));
 	if (!tmp)
 		return XT_ENOMEM;
 	this->data = tmp;
@@ -187,7 +214,7 @@ int xtStackZUPush(struct xtStackZU *this, size_t value)
 	size_t grow = this->grow > 0 ? (unsigned)this->grow : this->capacity / -(unsigned)this->grow;
 	// grow at least by one
 	if (!grow) ++grow;
-	size_t *tmp = realloc(this->data, (this->capacity + grow) * sizeof(size_t));
+	size_t *tmp = xtAllocatorRealloc(this->allocator, this->data, this->capacity * sizeof(size_t), (this->capacity + grow) * sizeof(size_t));
 	if (!tmp)
 		return XT_ENOMEM;
 	this->data = tmp;
@@ -303,7 +330,7 @@ int xtStackHDSetCapacity(struct xtStackHD *this, size_t capacity)
 {
 	if (this->capacity == capacity)
 		return 0;
-	short *new = realloc(this->data, capacity * sizeof(short));
+	short *new = xtAllocatorRealloc(this->allocator, this->data, this->capacity * sizeof(short), capacity * sizeof(short));
 	if (!new)
 		return XT_ENOMEM;
 	this->data = new;
@@ -317,7 +344,7 @@ int xtStackDSetCapacity(struct xtStackD *this, size_t capacity)
 {
 	if (this->capacity == capacity)
 		return 0;
-	int *new = realloc(this->data, capacity * sizeof(int));
+	int *new = xtAllocatorRealloc(this->allocator, this->data, this->capacity * sizeof(int), capacity * sizeof(int));
 	if (!new)
 		return XT_ENOMEM;
 	this->data = new;
@@ -331,7 +358,7 @@ int xtStackUSetCapacity(struct xtStackU *this, size_t capacity)
 {
 	if (this->capacity == capacity)
 		return 0;
-	unsigned *new = realloc(this->data, capacity * sizeof(unsigned));
+	unsigned *new = xtAllocatorRealloc(this->allocator, this->data, this->capacity * sizeof(unsigned), capacity * sizeof(unsigned));
 	if (!new)
 		return XT_ENOMEM;
 	this->data = new;
@@ -345,7 +372,7 @@ int xtStackLUSetCapacity(struct xtStackLU *this, size_t capacity)
 {
 	if (this->capacity == capacity)
 		return 0;
-	unsigned long *new = realloc(this->data, capacity * sizeof(unsigned long));
+	unsigned long *new = xtAllocatorRealloc(this->allocator, this->data, this->capacity * sizeof(unsigned long), capacity * sizeof(unsigned long));
 	if (!new)
 		return XT_ENOMEM;
 	this->data = new;
@@ -359,7 +386,7 @@ int xtStackZUSetCapacity(struct xtStackZU *this, size_t capacity)
 {
 	if (this->capacity == capacity)
 		return 0;
-	size_t *new = realloc(this->data, capacity * sizeof(size_t));
+	size_t *new = xtAllocatorRealloc(this->allocator, this->data, this->capacity * sizeof(size_t), capacity * sizeof(size_t));
 	if (!new)
 		return XT_ENOMEM;
 	this->data = new;
@@ -0,0 +1,235 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+// XT headers
+#include <xt/histogram.h>
+#include <xt/error.h>
+#include <xt/string.h>
+
+// STD headers
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Values below 2^bits have a bucket of their own. Values with their highest
+ * bit at position msb >= bits are split in 2^bits buckets of 2^(msb - bits)
+ * values each, so every bucket covers at most 1 / 2^bits of its magnitude.
+ * The index of such a bucket is ((msb - bits) << bits) + (value >> shift),
+ * which continues right after the linear buckets.
+ */
+
+static size_t hist_index(const struct xtHistogram *h, unsigned long long value)
+{
+	unsigned msb, shift;
+	if (value < (1LLU << h->bits))
+		return value;
+	msb = 63 - __builtin_clzll(value);
+	shift = msb - h->bits;
+	return ((size_t)shift << h->bits) + (value >> shift);
+}
+
+static unsigned long long hist_lowest(const struct xtHistogram *h, size_t index)
+{
+	unsigned shift;
+	if (index < (1LLU << h->bits) << 1)
+		return index;
+	shift = (index >> h->bits) - 1;
+	return (unsigned long long)(index - ((size_t)shift << h->bits)) << shift;
+}
+
+static unsigned long long hist_highest(const struct xtHistogram *h, size_t index)
+{
+	unsigned shift;
+	if (index < (1LLU << h->bits) << 1)
+		return index;
+	shift = (index >> h->bits) - 1;
+	return hist_lowest(h, index) + ((1LLU << shift) - 1);
+}
+
+static int hist_duration(char *buf, size_t buflen, double ns)
+{
+	if (ns < 1000)
+		return xtsnprintf(buf, buflen, "%.0fns", ns);
+	if (ns < 1000000)
+		return xtsnprintf(buf, buflen, "%.2fus", ns / 1000);
+	if (ns < 1000000000)
+		return xtsnprintf(buf, buflen, "%.2fms", ns / 1000000);
+	return xtsnprintf(buf, buflen, "%.2fs", ns / 1000000000);
+}
+
+int xtHistogramCreate(struct xtHistogram *h, unsigned long long highest, unsigned digits)
+{
+	unsigned long long range = 1;
+	if (!highest)
+		highest = XT_HISTOGRAM_HIGHEST_DEFAULT;
+	if (!digits)
+		digits = XT_HISTOGRAM_DIGITS_DEFAULT;
+	if (digits > 5)
+		return XT_EINVAL;
+	h->digits = digits;
+	while (digits--)
+		range *= 10;
+	for (h->bits = 0; (1LLU << h->bits) < range; ++h->bits)
+		;
+	h->highest = highest;
+	h->length = hist_index(h, highest) + 1;
+	h->counts = calloc(h->length, sizeof *h->counts);
+	if (!h->counts)
+		return XT_ENOMEM;
+	h->count = h->sum = h->min = h->max = 0;
+	return 0;
+}
+
+void xtHistogramDestroy(struct xtHistogram *h)
+{
+	free(h->counts);
+	h->counts = NULL;
+}
+
+unsigned xtHistogramFormat(char *buf, size_t buflen, const char *format, const struct xtHistogram *h)
+{
+	char *ptr = buf, *bufend = buf + buflen, *end;
+	double value;
+	int n;
+	if (!buflen)
+		return 0;
+	for (const char *fptr = format; *fptr; ++fptr) {
+		if (*fptr != '%' || fptr[1] == '%') {
+			if (ptr + 1 >= bufend)
+				goto fail;
+			*ptr++ = *fptr;
+			if (*fptr == '%')
+				++fptr;
+			continue;
+		}
+		switch (*++fptr) {
+		case 'c':
+			n = xtsnprintf(ptr, (size_t)(bufend - ptr), "%llu", h->count);
+			goto append;
+		case 'm':
+			value = xtHistogramGetMin(h);
+			break;
+		case 'M':
+			value = xtHistogramGetMax(h);
+			break;
+		case 'a':
+			value = xtHistogramGetMean(h);
+			break;
+		case 'p':
+			value = strtod(fptr + 1, &end);
+			if (end == fptr + 1)
+				goto fail;
+			fptr = end - 1;
+			value = xtHistogramGetPercentile(h, value);
+			break;
+		default:
+			goto fail;
+		}
+		n = hist_duration(ptr, (size_t)(bufend - ptr), value);
+append:
+		if (n < 0 || ptr + n >= bufend)
+			goto fail;
+		ptr += n;
+	}
+	*ptr = '\0';
+	return (unsigned)(ptr - buf);
+fail:
+	*buf = '\0';
+	return 0;
+}
+
+unsigned long long xtHistogramGetCount(const struct xtHistogram *h)
+{
+	return h->count;
+}
+
+unsigned long long xtHistogramGetMax(const struct xtHistogram *h)
+{
+	return h->max;
+}
+
+double xtHistogramGetMean(const struct xtHistogram *h)
+{
+	return h->count ? (double)h->sum / h->count : 0;
+}
+
+unsigned long long xtHistogramGetMin(const struct xtHistogram *h)
+{
+	return h->min;
+}
+
+unsigned long long xtHistogramGetPercentile(const struct xtHistogram *h, double percentile)
+{
+	unsigned long long target, seen = 0, value;
+	if (!h->count)
+		return 0;
+	if (percentile <= 0)
+		return h->min;
+	if (percentile >= 100)
+		return h->max;
+	target = (unsigned long long)(percentile / 100 * h->count + .5);
+	if (!target)
+		target = 1;
+	for (size_t i = 0; i < h->length; ++i) {
+		seen += h->counts[i];
+		if (seen >= target) {
+			value = hist_highest(h, i);
+			if (value > h->max)
+				return h->max;
+			return value < h->min ? h->min : value;
+		}
+	}
+	return h->max;
+}
+
+int xtHistogramMerge(struct xtHistogram *dst, const struct xtHistogram *src)
+{
+	size_t i, n;
+	if (dst->bits != src->bits)
+		return XT_EINVAL;
+	if (!src->count)
+		return 0;
+	// Both use the same bucket layout, so only the clamped tail differs
+	n = src->length < dst->length ? src->length : dst->length;
+	for (i = 0; i < n; ++i)
+		dst->counts[i] += src->counts[i];
+	for (; i < src->length; ++i)
+		dst->counts[dst->length - 1] += src->counts[i];
+	if (!dst->count || src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+	dst->count += src->count;
+	dst->sum += src->sum;
+	return 0;
+}
+
+void xtHistogramRecord(struct xtHistogram *h, unsigned long long value)
+{
+	xtHistogramRecordN(h, value, 1);
+}
+
+void xtHistogramRecordDuration(struct xtHistogram *h, const struct xtTimestamp *start, const struct xtTimestamp *end)
+{
+	struct xtTimestamp diff;
+	xtTimestampDiff(&diff, start, end);
+	xtHistogramRecordN(h, diff.sec * 1000000000LLU + diff.nsec, 1);
+}
+
+void xtHistogramRecordN(struct xtHistogram *h, unsigned long long value, unsigned long long count)
+{
+	if (!count)
+		return;
+	if (!h->count || value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+	h->count += count;
+	h->sum += value * count;
+	h->counts[value < h->highest ? hist_index(h, value) : h->length - 1] += count;
+}
+
+void xtHistogramReset(struct xtHistogram *h)
+{
+	memset(h->counts, 0, h->length * sizeof *h->counts);
+	h->count = h->sum = h->min = h->max = 0;
+}
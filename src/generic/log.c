@@ -0,0 +1,359 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+// XT headers
+#include <xt/log.h>
+#include <_xt/format.h>
+#include <xt/error.h>
+#include <xt/string.h>
+#include <xt/thread.h>
+#include <xt/time.h>
+
+// STD headers
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Every thread that logs gets its own single producer, single consumer ring
+ * buffer. A log call reserves a record in its ring, captures the compiled
+ * format, the timestamp and the raw arguments and publishes the record. The
+ * background thread walks all rings, renders the records into one output
+ * buffer and writes the whole batch at once.
+ *
+ * Records are always contiguous in the ring. If a record does not fit in the
+ * remainder of the ring, that remainder is filled with a padding record.
+ */
+
+/*
+ * Must be a power of two. The size of union xtFormatArg is not, e.g. it is 12
+ * bytes on i386, so it cannot be used for rounding.
+ */
+#define LOG_ALIGN 16
+#define LOG_ROUND(x) (((x) + LOG_ALIGN - 1) & ~(size_t)(LOG_ALIGN - 1))
+#define LOG_PAD 0xffff
+#define LOG_HEADER_SIZE LOG_ROUND(sizeof(struct _xt_log_record))
+#define LOG_RING_MIN 4096
+#define LOG_OUT_SIZE 65536
+
+struct _xt_log_record {
+	/** Size of the record including its arguments and strings. */
+	uint32_t size;
+	/** The log level, or LOG_PAD if this is a padding record. */
+	uint16_t level;
+	const struct xtFormat *fmt;
+	struct xtTimestamp time;
+};
+
+// Records and their arguments start at multiples of LOG_ALIGN
+typedef char _xt_log_align_check[
+	LOG_ALIGN >= __alignof__(union xtFormatArg) && LOG_ALIGN >= __alignof__(struct _xt_log_record) ? 1 : -1
+];
+
+struct _xt_log_ring {
+	char *buf;
+	size_t mask;
+	/** Producer position. Only written by the owner thread. */
+	size_t head;
+	/** Rate limiting state. Only used by the owner thread. */
+	unsigned long long rateSec;
+	unsigned rateCount;
+	/** Keep the consumer position on a different cache line. */
+	char pad[64];
+	/** Consumer position. Only written by the background thread. */
+	size_t tail;
+	size_t dropped, suppressed;
+	bool detached;
+	struct _xt_log_ring *next;
+};
+
+static const char *const log_level_names[] = {
+	"TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"
+};
+
+static xtMutex log_lock = XT_MUTEX_INIT;
+static struct _xt_log_ring *log_rings;
+static struct xtThread log_thread;
+static FILE *log_stream;
+static size_t log_ring_size;
+static int log_level;
+static unsigned log_rate_limit;
+static bool log_running;
+/** Incremented by the background thread after each pass over all rings. */
+static unsigned long log_passes;
+/** Incremented by each xtLogStart() so stale ring pointers are never used. */
+static unsigned log_generation;
+
+static __thread struct _xt_log_ring *log_ring;
+static __thread unsigned log_ring_generation;
+
+static char log_out[LOG_OUT_SIZE];
+static size_t log_outlen;
+static struct xtFormatTimeCache log_time_cache;
+
+static struct _xt_log_ring *log_ring_attach(void)
+{
+	struct _xt_log_ring *r;
+	if (!(r = malloc(sizeof *r + log_ring_size)))
+		return NULL;
+	// Touch the whole ring now, so logging never triggers a page fault
+	memset(r, 0, sizeof *r + log_ring_size);
+	r->buf = (char*)(r + 1);
+	r->mask = log_ring_size - 1;
+	xtMutexLock(&log_lock);
+	r->next = log_rings;
+	log_rings = r;
+	xtMutexUnlock(&log_lock);
+	log_ring = r;
+	log_ring_generation = __atomic_load_n(&log_generation, __ATOMIC_ACQUIRE);
+	return r;
+}
+
+void _xtLogWrite(enum xtLogLevel level, struct xtFormat **cache, const char *format, ...)
+{
+	struct _xt_log_ring *r = log_ring;
+	struct _xt_log_record *rec;
+	const struct xtFormat *fmt;
+	struct xtTimestamp now;
+	union xtFormatArg args[XT_LOG_MAX_ARGS], *argv;
+	size_t argc, strsize, size, head, tail, off, pad, ringSize;
+	unsigned limit;
+	va_list ap;
+	// Unknown levels are rejected here, as the background thread uses them as an index
+	if ((int)level < __atomic_load_n(&log_level, __ATOMIC_RELAXED) || (unsigned)level > XT_LOG_FATAL
+		|| !__atomic_load_n(&log_running, __ATOMIC_ACQUIRE))
+		return;
+	if ((!r || log_ring_generation != __atomic_load_n(&log_generation, __ATOMIC_ACQUIRE)) && !(r = log_ring_attach()))
+		return;
+	if (!(fmt = __atomic_load_n(cache, __ATOMIC_ACQUIRE)) && !(fmt = xtFormatStatic(cache, format)))
+		return;
+	xtClockGetTime(&now, XT_CLOCK_REALTIME_COARSE);
+	limit = __atomic_load_n(&log_rate_limit, __ATOMIC_RELAXED);
+	if (limit) {
+		if (now.sec != r->rateSec) {
+			r->rateSec = now.sec;
+			r->rateCount = 0;
+		}
+		if (++r->rateCount > limit) {
+			__atomic_fetch_add(&r->suppressed, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	}
+	if ((argc = xtFormatGetArgCount(fmt)) > XT_LOG_MAX_ARGS)
+		goto drop;
+	// Fetch the arguments first, so the format is only walked once
+	va_start(ap, format);
+	strsize = _xtFormatFetch(fmt, args, ap);
+	va_end(ap);
+	size = LOG_ROUND(LOG_HEADER_SIZE + argc * sizeof *args + strsize);
+	ringSize = r->mask + 1;
+	head = r->head;
+	tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+	off = head & r->mask;
+	pad = off + size > ringSize ? ringSize - off : 0;
+	if (size > UINT32_MAX || head + pad + size - tail > ringSize)
+		goto drop;
+	if (pad) {
+		rec = (struct _xt_log_record*)(r->buf + off);
+		rec->size = pad;
+		rec->level = LOG_PAD;
+		head += pad;
+		off = 0;
+	}
+	rec = (struct _xt_log_record*)(r->buf + off);
+	rec->size = size;
+	rec->level = level;
+	rec->fmt = fmt;
+	rec->time = now;
+	argv = (union xtFormatArg*)((char*)rec + LOG_HEADER_SIZE);
+	memcpy(argv, args, argc * sizeof *args);
+	_xtFormatCopyStrings(fmt, argv, (char*)(argv + argc));
+	__atomic_store_n(&r->head, head + size, __ATOMIC_RELEASE);
+	return;
+drop:
+	__atomic_fetch_add(&r->dropped, 1, __ATOMIC_RELAXED);
+}
+
+static void log_out_flush(void)
+{
+	if (!log_outlen)
+		return;
+	fwrite(log_out, 1, log_outlen, log_stream);
+	fflush(log_stream);
+	log_outlen = 0;
+}
+
+static int log_render(char *buf, size_t buflen, const struct _xt_log_record *rec)
+{
+	const union xtFormatArg *args = (const union xtFormatArg*)((const char*)rec + LOG_HEADER_SIZE);
+	char time[32];
+	int n, m;
+	if (!xtFormatTimeCached(time, sizeof time, &log_time_cache, &rec->time, 3))
+		time[0] = '\0';
+	n = xtsnprintf(buf, buflen, "%s %-5s ", time, log_level_names[rec->level]);
+	if (n < 0)
+		return n;
+	m = xtFormatRenderArgs(buflen > (size_t)n ? buf + n : NULL, buflen > (size_t)n ? buflen - n : 0, rec->fmt, args, xtFormatGetArgCount(rec->fmt));
+	if (m < 0)
+		return m;
+	if ((size_t)(n + m) < buflen)
+		buf[n + m] = '\n';
+	return n + m + 1;
+}
+
+static void log_write(const struct _xt_log_record *rec)
+{
+	size_t avail = LOG_OUT_SIZE - log_outlen;
+	char *buf;
+	int n = log_render(log_out + log_outlen, avail, rec);
+	if (n < 0)
+		return;
+	if ((size_t)n < avail) {
+		log_outlen += n;
+		return;
+	}
+	log_out_flush();
+	n = log_render(log_out, LOG_OUT_SIZE, rec);
+	if ((size_t)n < LOG_OUT_SIZE) {
+		log_outlen = n;
+		return;
+	}
+	// Huge messages bypass the output buffer
+	if (!(buf = malloc(n + 1)))
+		return;
+	log_render(buf, n + 1, rec);
+	fwrite(buf, 1, n, log_stream);
+	free(buf);
+}
+
+static void log_report(const char *what, size_t count)
+{
+	char buf[64];
+	int n = xtsnprintf(buf, sizeof buf, "xtLog: %zu messages %s\n", count, what);
+	if (log_outlen + n >= LOG_OUT_SIZE)
+		log_out_flush();
+	memcpy(log_out + log_outlen, buf, n);
+	log_outlen += n;
+}
+/**
+ * Writes all published records of all rings.
+ * @return True if anything has been written.
+ */
+static bool log_drain(void)
+{
+	struct _xt_log_ring *r, **prev;
+	const struct _xt_log_record *rec;
+	size_t head, tail, count;
+	bool detached, busy = false;
+	xtMutexLock(&log_lock);
+	for (prev = &log_rings; (r = *prev);) {
+		// The owner never touches the ring again once it is detached
+		detached = __atomic_load_n(&r->detached, __ATOMIC_ACQUIRE);
+		head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+		for (tail = r->tail; tail != head; tail += rec->size) {
+			rec = (const struct _xt_log_record*)(r->buf + (tail & r->mask));
+			if (rec->level != LOG_PAD)
+				log_write(rec);
+			busy = true;
+		}
+		__atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+		if ((count = __atomic_exchange_n(&r->dropped, 0, __ATOMIC_RELAXED)))
+			log_report("dropped", count);
+		if ((count = __atomic_exchange_n(&r->suppressed, 0, __ATOMIC_RELAXED)))
+			log_report("suppressed", count);
+		if (detached) {
+			*prev = r->next;
+			free(r);
+			continue;
+		}
+		prev = &r->next;
+	}
+	xtMutexUnlock(&log_lock);
+	log_out_flush();
+	__atomic_fetch_add(&log_passes, 1, __ATOMIC_RELEASE);
+	return busy;
+}
+
+static void *log_main(struct xtThread *t, void *arg)
+{
+	(void)t;
+	(void)arg;
+	xtThreadSetName("xtlog");
+	while (__atomic_load_n(&log_running, __ATOMIC_ACQUIRE))
+		if (!log_drain())
+			xtSleepMS(1);
+	log_drain();
+	return NULL;
+}
+
+void xtLogFlush(void)
+{
+	unsigned long pass;
+	if (!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE))
+		return;
+	// The pass after the current one is guaranteed to see everything
+	pass = __atomic_load_n(&log_passes, __ATOMIC_ACQUIRE);
+	while (__atomic_load_n(&log_passes, __ATOMIC_ACQUIRE) - pass < 2)
+		xtSleepMS(1);
+}
+
+enum xtLogLevel xtLogGetLevel(void)
+{
+	return __atomic_load_n(&log_level, __ATOMIC_RELAXED);
+}
+
+void xtLogSetLevel(enum xtLogLevel level)
+{
+	__atomic_store_n(&log_level, level, __ATOMIC_RELAXED);
+}
+
+void xtLogSetRateLimit(unsigned perSecond)
+{
+	__atomic_store_n(&log_rate_limit, perSecond, __ATOMIC_RELAXED);
+}
+
+int xtLogStart(FILE *stream, enum xtLogLevel level, size_t ringSize)
+{
+	size_t size = LOG_RING_MIN;
+	int ret;
+	if (__atomic_load_n(&log_running, __ATOMIC_ACQUIRE))
+		return XT_EALREADY;
+	if (!ringSize)
+		ringSize = XT_LOG_RING_SIZE;
+	// The ring size must be a power of two
+	while (size < ringSize)
+		size <<= 1;
+	log_stream = stream;
+	log_ring_size = size;
+	log_level = level;
+	log_outlen = 0;
+	__atomic_add_fetch(&log_generation, 1, __ATOMIC_RELEASE);
+	__atomic_store_n(&log_running, true, __ATOMIC_RELEASE);
+	if ((ret = xtThreadCreate(&log_thread, log_main, NULL, 0, 0)) != 0)
+		__atomic_store_n(&log_running, false, __ATOMIC_RELEASE);
+	return ret;
+}
+
+void xtLogStop(void)
+{
+	struct _xt_log_ring *r, *next;
+	if (!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE))
+		return;
+	__atomic_store_n(&log_running, false, __ATOMIC_RELEASE);
+	xtThreadJoin(&log_thread, NULL);
+	for (r = log_rings; r; r = next) {
+		next = r->next;
+		free(r);
+	}
+	log_rings = NULL;
+	log_ring = NULL;
+}
+
+void xtLogThreadDetach(void)
+{
+	struct _xt_log_ring *r = log_ring;
+	if (!r || log_ring_generation != __atomic_load_n(&log_generation, __ATOMIC_ACQUIRE))
+		return;
+	__atomic_store_n(&r->detached, true, __ATOMIC_RELEASE);
+	log_ring = NULL;
+}
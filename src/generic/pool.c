@@ -0,0 +1,443 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+// XT headers
+#include <xt/pool.h>
+#include <xt/error.h>
+#include <xt/thread.h>
+
+// STD headers
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * This follows the magazine layer of the Bonwick slab allocator. A thread
+ * allocates from its loaded magazine and frees into it. If that magazine is
+ * empty (or full), it swaps it with its previous magazine, and only if both
+ * are empty (or full), it exchanges the previous magazine with the depot.
+ * A thread therefore takes at least a whole magazine of operations between
+ * two visits to the depot.
+ *
+ * The depot keeps a lock-free stack of full and one of empty magazines. Each
+ * head packs a 32-bit magazine index with a 32-bit tag that changes on every
+ * update, which defeats the ABA problem. Magazines are never freed before
+ * the pool is destroyed, so a stale index always points to a valid magazine.
+ *
+ * Objects that do not fit in any magazine end up in the free list of the
+ * slab layer, which is protected by the pool lock just like the slabs.
+ */
+
+#define POOL_NIL UINT32_MAX
+#define POOL_MAGS_PER_CHUNK 64
+#define POOL_MAG_CHUNKS 1024
+#define POOL_SLAB_SIZE (64 * 1024)
+#define POOL_ALIGN_DEFAULT 16
+
+struct pool_magazine {
+	/** The next magazine in the depot. */
+	uint32_t next;
+	uint32_t index;
+	unsigned count;
+	void *objs[XT_POOL_MAGAZINE_SIZE];
+};
+
+struct pool_slab {
+	struct pool_slab *next;
+};
+
+struct pool;
+
+struct pool_cache {
+	/** The owner pool, or NULL once it has been destroyed. */
+	struct pool *pool;
+	struct pool_magazine *loaded, *previous;
+	/** Only written by the owner thread. */
+	unsigned long long allocs, frees;
+	/** The other caches of the owner thread. */
+	struct pool_cache *next;
+	/** The other caches of the pool. */
+	struct pool_cache *poolNext, **poolPrev;
+};
+
+struct pool {
+	/** The heads of the depot, on a cache line of their own. */
+	uint64_t full, empty;
+	size_t fullCount, emptyCount;
+	char pad[64];
+	xtMutex lock;
+	size_t objectSize, align;
+	char *slabPos, *slabEnd;
+	void *freeList;
+	struct pool_slab *slabs;
+	size_t size, objects;
+	/** The counters of the caches that have been detached. */
+	unsigned long long allocs, frees;
+	struct pool_cache *caches;
+	struct pool_magazine *magChunks[POOL_MAG_CHUNKS];
+	uint32_t magCount;
+	struct pool *next, **prev;
+	char name[XT_POOL_NAME_MAX];
+};
+
+static xtMutex pool_lock = XT_MUTEX_INIT;
+static struct pool *pools;
+static size_t pool_count, pool_total;
+
+static __thread struct pool_cache *pool_caches;
+
+static inline struct pool_magazine *pool_magazine(struct pool *pool, uint32_t index)
+{
+	return &pool->magChunks[index / POOL_MAGS_PER_CHUNK][index % POOL_MAGS_PER_CHUNK];
+}
+
+static void depot_push(struct pool *pool, bool full, struct pool_magazine *m)
+{
+	uint64_t *head = full ? &pool->full : &pool->empty;
+	uint64_t old = __atomic_load_n(head, __ATOMIC_ACQUIRE), new;
+	do {
+		__atomic_store_n(&m->next, (uint32_t)old, __ATOMIC_RELAXED);
+		new = ((old >> 32) + 1) << 32 | m->index;
+	} while (!__atomic_compare_exchange_n(head, &old, new, true, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+	__atomic_fetch_add(full ? &pool->fullCount : &pool->emptyCount, 1, __ATOMIC_RELAXED);
+}
+
+static struct pool_magazine *depot_pop(struct pool *pool, bool full)
+{
+	uint64_t *head = full ? &pool->full : &pool->empty;
+	uint64_t old = __atomic_load_n(head, __ATOMIC_ACQUIRE), new;
+	struct pool_magazine *m;
+	do {
+		if ((uint32_t)old == POOL_NIL)
+			return NULL;
+		m = pool_magazine(pool, (uint32_t)old);
+		new = ((old >> 32) + 1) << 32 | __atomic_load_n(&m->next, __ATOMIC_RELAXED);
+	} while (!__atomic_compare_exchange_n(head, &old, new, true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+	__atomic_fetch_sub(full ? &pool->fullCount : &pool->emptyCount, 1, __ATOMIC_RELAXED);
+	return m;
+}
+
+static void pool_grow(struct pool *pool, size_t size)
+{
+	pool->size += size;
+	__atomic_fetch_add(&pool_total, size, __ATOMIC_RELAXED);
+}
+
+/* Returns a new empty magazine, the pool lock must be held */
+static struct pool_magazine *pool_magazine_new(struct pool *pool)
+{
+	uint32_t index = pool->magCount;
+	struct pool_magazine **chunk = &pool->magChunks[index / POOL_MAGS_PER_CHUNK];
+	struct pool_magazine *m;
+	if (index / POOL_MAGS_PER_CHUNK >= POOL_MAG_CHUNKS)
+		return NULL;
+	if (!*chunk) {
+		if (!(*chunk = malloc(POOL_MAGS_PER_CHUNK * sizeof **chunk)))
+			return NULL;
+		pool_grow(pool, POOL_MAGS_PER_CHUNK * sizeof **chunk);
+	}
+	m = pool_magazine(pool, index);
+	m->index = index;
+	m->count = 0;
+	++pool->magCount;
+	return m;
+}
+
+static struct pool_magazine *pool_magazine_empty(struct pool *pool)
+{
+	struct pool_magazine *m;
+	if ((m = depot_pop(pool, false)))
+		return m;
+	xtMutexLock(&pool->lock);
+	m = pool_magazine_new(pool);
+	xtMutexUnlock(&pool->lock);
+	return m;
+}
+
+/* Carves a new slab, the pool lock must be held */
+static bool pool_slab_new(struct pool *pool)
+{
+	size_t align = pool->align;
+	size_t size = pool->objectSize * XT_POOL_MAGAZINE_SIZE + sizeof(struct pool_slab) + align;
+	struct pool_slab *slab;
+	uintptr_t pos;
+	if (size < POOL_SLAB_SIZE)
+		size = POOL_SLAB_SIZE;
+	if (!(slab = malloc(size)))
+		return false;
+	slab->next = pool->slabs;
+	pool->slabs = slab;
+	pos = ((uintptr_t)(slab + 1) + align - 1) & ~(uintptr_t)(align - 1);
+	pool->slabPos = (char*)pos;
+	pool->slabEnd = (char*)slab + size;
+	pool_grow(pool, size);
+	return true;
+}
+
+/* Fills the empty magazine m from the slab layer */
+static bool pool_fill(struct pool *pool, struct pool_magazine *m)
+{
+	void *obj;
+	xtMutexLock(&pool->lock);
+	while (m->count < XT_POOL_MAGAZINE_SIZE) {
+		if ((obj = pool->freeList))
+			pool->freeList = *(void**)obj;
+		else if ((size_t)(pool->slabEnd - pool->slabPos) >= pool->objectSize) {
+			obj = pool->slabPos;
+			pool->slabPos += pool->objectSize;
+			++pool->objects;
+		} else if (pool_slab_new(pool))
+			continue;
+		else
+			break;
+		m->objs[m->count++] = obj;
+	}
+	xtMutexUnlock(&pool->lock);
+	return m->count != 0;
+}
+
+static void pool_free_slow(struct pool *pool, void *ptr)
+{
+	xtMutexLock(&pool->lock);
+	*(void**)ptr = pool->freeList;
+	pool->freeList = ptr;
+	xtMutexUnlock(&pool->lock);
+}
+
+static struct pool_cache *pool_cache_attach(struct pool *pool)
+{
+	struct pool_cache *c;
+	if (!(c = malloc(sizeof *c)))
+		return NULL;
+	if (!(c->loaded = pool_magazine_empty(pool))) {
+		free(c);
+		return NULL;
+	}
+	if (!(c->previous = pool_magazine_empty(pool))) {
+		depot_push(pool, false, c->loaded);
+		free(c);
+		return NULL;
+	}
+	c->pool = pool;
+	c->allocs = c->frees = 0;
+	xtMutexLock(&pool->lock);
+	if ((c->poolNext = pool->caches))
+		c->poolNext->poolPrev = &c->poolNext;
+	c->poolPrev = &pool->caches;
+	pool->caches = c;
+	xtMutexUnlock(&pool->lock);
+	c->next = pool_caches;
+	pool_caches = c;
+	return c;
+}
+
+/*
+Finds the cache of the caller thread for pool. The list is kept in most
+recently used order and caches of destroyed pools are dropped on the way.
+*/
+static struct pool_cache *pool_cache(struct pool *pool)
+{
+	struct pool_cache *c = pool_caches, **prev = &pool_caches;
+	struct pool *owner;
+	if (c && __atomic_load_n(&c->pool, __ATOMIC_ACQUIRE) == pool)
+		return c;
+	while ((c = *prev)) {
+		if ((owner = __atomic_load_n(&c->pool, __ATOMIC_ACQUIRE)) == pool) {
+			*prev = c->next;
+			c->next = pool_caches;
+			pool_caches = c;
+			return c;
+		}
+		if (!owner) {
+			*prev = c->next;
+			free(c);
+			continue;
+		}
+		prev = &c->next;
+	}
+	return pool_cache_attach(pool);
+}
+
+int xtPoolCreate(struct xtPool *p, const char *name, size_t objectSize, size_t align)
+{
+	struct pool *pool;
+	if (!align)
+		align = POOL_ALIGN_DEFAULT;
+	if (align & (align - 1) || !objectSize || objectSize > SIZE_MAX / XT_POOL_MAGAZINE_SIZE / 2)
+		return XT_EINVAL;
+	// Free objects have to hold the link of the free list
+	if (objectSize < sizeof(void*))
+		objectSize = sizeof(void*);
+	objectSize = (objectSize + align - 1) & ~(align - 1);
+	if (!(pool = calloc(1, sizeof *pool)))
+		return XT_ENOMEM;
+	if (xtMutexCreate(&pool->lock)) {
+		free(pool);
+		return XT_ENOMEM;
+	}
+	pool->full = pool->empty = POOL_NIL;
+	pool->objectSize = objectSize;
+	pool->align = align;
+	if (name) {
+		strncpy(pool->name, name, XT_POOL_NAME_MAX - 1);
+		pool->name[XT_POOL_NAME_MAX - 1] = '\0';
+	}
+	xtMutexLock(&pool_lock);
+	if ((pool->next = pools))
+		pools->prev = &pool->next;
+	pool->prev = &pools;
+	pools = pool;
+	++pool_count;
+	xtMutexUnlock(&pool_lock);
+	p->impl = pool;
+	return 0;
+}
+
+void xtPoolDestroy(struct xtPool *p)
+{
+	struct pool *pool = p->impl;
+	struct pool_cache *c, *next;
+	struct pool_slab *slab, *nextSlab;
+	xtMutexLock(&pool_lock);
+	if ((*pool->prev = pool->next))
+		pool->next->prev = pool->prev;
+	--pool_count;
+	xtMutexUnlock(&pool_lock);
+	// The owner threads release the caches once they notice
+	xtMutexLock(&pool->lock);
+	for (c = pool->caches; c; c = next) {
+		next = c->poolNext;
+		__atomic_store_n(&c->pool, NULL, __ATOMIC_RELEASE);
+	}
+	xtMutexUnlock(&pool->lock);
+	for (slab = pool->slabs; slab; slab = nextSlab) {
+		nextSlab = slab->next;
+		free(slab);
+	}
+	for (unsigned i = 0; i < POOL_MAG_CHUNKS && pool->magChunks[i]; ++i)
+		free(pool->magChunks[i]);
+	__atomic_fetch_sub(&pool_total, pool->size, __ATOMIC_RELAXED);
+	xtMutexDestroy(&pool->lock);
+	free(pool);
+	p->impl = NULL;
+}
+
+void *xtPoolAlloc(struct xtPool *p)
+{
+	struct pool *pool = p->impl;
+	struct pool_cache *c;
+	struct pool_magazine *m;
+	if (!(c = pool_cache(pool)))
+		return NULL;
+	for (;;) {
+		m = c->loaded;
+		if (m->count) {
+			__atomic_store_n(&c->allocs, c->allocs + 1, __ATOMIC_RELAXED);
+			return m->objs[--m->count];
+		}
+		if (c->previous->count) {
+			c->loaded = c->previous;
+			c->previous = m;
+		} else if ((m = depot_pop(pool, true))) {
+			depot_push(pool, false, c->previous);
+			c->previous = c->loaded;
+			c->loaded = m;
+		} else if (!pool_fill(pool, c->loaded))
+			return NULL;
+	}
+}
+
+void xtPoolFree(struct xtPool *p, void *ptr)
+{
+	struct pool *pool = p->impl;
+	struct pool_cache *c;
+	struct pool_magazine *m;
+	if (!ptr)
+		return;
+	if (!(c = pool_cache(pool))) {
+		pool_free_slow(pool, ptr);
+		return;
+	}
+	__atomic_store_n(&c->frees, c->frees + 1, __ATOMIC_RELAXED);
+	for (;;) {
+		m = c->loaded;
+		if (m->count < XT_POOL_MAGAZINE_SIZE) {
+			m->objs[m->count++] = ptr;
+			return;
+		}
+		if (c->previous->count < XT_POOL_MAGAZINE_SIZE) {
+			c->loaded = c->previous;
+			c->previous = m;
+		} else if ((m = pool_magazine_empty(pool))) {
+			depot_push(pool, true, c->previous);
+			c->previous = c->loaded;
+			c->loaded = m;
+		} else {
+			pool_free_slow(pool, ptr);
+			return;
+		}
+	}
+}
+
+void xtPoolThreadDetach(struct xtPool *p)
+{
+	struct pool *pool = p->impl;
+	struct pool_cache *c, **prev;
+	if (!pool)
+		return;
+	for (prev = &pool_caches; (c = *prev); prev = &c->next)
+		if (__atomic_load_n(&c->pool, __ATOMIC_ACQUIRE) == pool)
+			break;
+	if (!c)
+		return;
+	*prev = c->next;
+	depot_push(pool, c->loaded->count != 0, c->loaded);
+	depot_push(pool, c->previous->count != 0, c->previous);
+	xtMutexLock(&pool->lock);
+	if ((*c->poolPrev = c->poolNext))
+		c->poolNext->poolPrev = c->poolPrev;
+	pool->allocs += c->allocs;
+	pool->frees += c->frees;
+	xtMutexUnlock(&pool->lock);
+	free(c);
+}
+
+static void pool_stats(struct pool *pool, struct xtPoolStats *stats)
+{
+	memcpy(stats->name, pool->name, sizeof stats->name);
+	stats->objectSize = pool->objectSize;
+	xtMutexLock(&pool->lock);
+	stats->size = pool->size;
+	stats->objects = pool->objects;
+	stats->allocs = pool->allocs;
+	stats->frees = pool->frees;
+	for (const struct pool_cache *c = pool->caches; c; c = c->poolNext) {
+		stats->allocs += __atomic_load_n(&c->allocs, __ATOMIC_RELAXED);
+		stats->frees += __atomic_load_n(&c->frees, __ATOMIC_RELAXED);
+	}
+	xtMutexUnlock(&pool->lock);
+	stats->inUse = stats->allocs > stats->frees ? stats->allocs - stats->frees : 0;
+	stats->fullMagazines = __atomic_load_n(&pool->fullCount, __ATOMIC_RELAXED);
+	stats->emptyMagazines = __atomic_load_n(&pool->emptyCount, __ATOMIC_RELAXED);
+}
+
+void xtPoolGetStats(const struct xtPool *pool, struct xtPoolStats *stats)
+{
+	pool_stats(pool->impl, stats);
+}
+
+size_t xtPoolGetAllStats(struct xtPoolStats *stats, size_t count)
+{
+	size_t n = 0;
+	xtMutexLock(&pool_lock);
+	for (struct pool *pool = pools; pool && n < count; pool = pool->next)
+		pool_stats(pool, &stats[n++]);
+	n = pool_count;
+	xtMutexUnlock(&pool_lock);
+	return n;
+}
+
+size_t xtPoolGetTotalSize(void)
+{
+	return __atomic_load_n(&pool_total, __ATOMIC_RELAXED);
+}
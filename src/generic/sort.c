@@ -1,11 +1,15 @@
 /* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
 
 // XT headers
+#include <xt/endian.h>
 #include <xt/error.h>
+#include <xt/os.h>
 #include <xt/os_macros.h>
 #include <xt/sort.h>
+#include <xt/thread.h>
 
 // STD headers
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -34,8 +38,38 @@ static inline void swap_u(unsigned *a, unsigned *b)
 	*b = tmp;
 }
 
+/*
+Both elements are loaded before either is stored, so this works if a and b are
+the same element. With a constant size the copies compile to register moves.
+*/
+#define SWAP_WORDS(a, b, n) do {\
+	uint64_t x_[(n) / 8 ? (n) / 8 : 1], y_[(n) / 8 ? (n) / 8 : 1];\
+	memcpy(x_, a, n);\
+	memcpy(y_, b, n);\
+	memcpy(a, y_, n);\
+	memcpy(b, x_, n);\
+} while (0)
+
+static inline void copy_p(void *dest, const void *src, size_t size)
+{
+	switch (size) {
+	case 4 : memcpy(dest, src,  4); return;
+	case 8 : memcpy(dest, src,  8); return;
+	case 16: memcpy(dest, src, 16); return;
+	case 32: memcpy(dest, src, 32); return;
+	}
+	memcpy(dest, src, size);
+}
+
 static inline void swap_p(void *a, void *b, void *tmp, size_t size)
 {
+	// Common element sizes are swapped without going through tmp
+	switch (size) {
+	case 4 : SWAP_WORDS(a, b,  4); return;
+	case 8 : SWAP_WORDS(a, b,  8); return;
+	case 16: SWAP_WORDS(a, b, 16); return;
+	case 32: SWAP_WORDS(a, b, 32); return;
+	}
 	memmove(tmp, a  , size);
 	memmove(a  , b  , size);
 	memmove(b  , tmp, size);
@@ -545,69 +579,1080 @@ static int selection_sort_p(void *list, size_t elemsize, size_t n, int (*cmp)(co
 	return 0;
 }
 
-#define K 10
+/*
+Some algorithms can split the work in tasks that run on multiple threads.
+Worker i runs tasks i, i + step, i + 2 * step and so on.
+*/
+struct sort_worker {
+	void (*func)(void *task);
+	char *tasks;
+	size_t size, count, first, step;
+};
 
-static int radix_sort_d(int *a, size_t n, bool ascend)
+static void *sort_work(struct xtThread *t, void *arg)
 {
-	int m, exp, bb[K], *b;
-	size_t i, j;
-	b = malloc(n * sizeof(int));
-	if (!b)
+	struct sort_worker *w = arg;
+	(void)t;
+	for (size_t i = w->first; i < w->count; i += w->step)
+		w->func(w->tasks + i * w->size);
+	return NULL;
+}
+
+/*
+Runs count tasks of size bytes each on at most nthreads threads, including the
+caller thread. The threads and workers arrays must hold nthreads elements.
+*/
+static void sort_run(void (*func)(void*), void *tasks, size_t size, size_t count, unsigned nthreads, struct xtThread *threads, struct sort_worker *workers)
+{
+	unsigned n = count < nthreads ? count : nthreads, i;
+	for (i = 0; i < n; ++i) {
+		workers[i].func = func;
+		workers[i].tasks = tasks;
+		workers[i].size = size;
+		workers[i].count = count;
+		workers[i].first = i;
+		workers[i].step = n;
+	}
+	// Tasks of threads that cannot be created are run by the caller thread
+	for (i = 1; i < n; ++i)
+		if (xtThreadCreate(&threads[i], sort_work, &workers[i], 0, 0))
+			workers[i].tasks = NULL;
+	sort_work(NULL, &workers[0]);
+	for (i = 1; i < n; ++i)
+		if (workers[i].tasks)
+			xtThreadJoin(&threads[i], NULL);
+		else {
+			workers[i].tasks = tasks;
+			sort_work(NULL, &workers[i]);
+		}
+}
+
+/* Returns the number of threads to use if zero has been specified. */
+static unsigned sort_threads(unsigned threads)
+{
+	struct xtCPUInfo info;
+	if (threads)
+		return threads;
+	xtCPUGetInfo(&info);
+	return info.logicalCores ? info.logicalCores : 1;
+}
+
+/*
+LSD radix sort on keys of 32 or 64 bits, stored anywhere in an element. Keys
+are mapped to unsigned integers with the same order: the sign bit of signed
+keys is flipped, negative floating point keys have all bits flipped and
+descending keys are inverted. The histograms of all digits are counted in a
+single pass. Digits that are the same for all keys are skipped, so sorting
+small values takes less passes.
+*/
+#define RADIX_BITS 11
+#define RADIX_SIZE (1 << RADIX_BITS)
+#define RADIX_MASK (RADIX_SIZE - 1)
+/* The scatter is only split if every thread gets at least this many elements. */
+#define RADIX_MIN_PART (1 << 16)
+
+struct radix {
+	size_t size, offset;
+	unsigned width, digits;
+	uint64_t flip;
+	bool fp;
+};
+
+/* Called with a constant width, so that only one branch remains. */
+static inline uint64_t radix_key_n(const struct radix *r, const char *elem, unsigned width)
+{
+	uint64_t k;
+	uint32_t k32;
+	if (width == 8) {
+		memcpy(&k, elem + r->offset, sizeof k);
+		if (r->fp)
+			k ^= -(k >> 63) >> 1;
+	} else {
+		memcpy(&k32, elem + r->offset, sizeof k32);
+		if (r->fp)
+			k32 ^= -(k32 >> 31) >> 1;
+		k = k32;
+	}
+	return k ^ r->flip;
+}
+
+static inline uint64_t radix_key(const struct radix *r, const char *elem)
+{
+	return r->width == 8 ? radix_key_n(r, elem, 8) : radix_key_n(r, elem, 4);
+}
+
+static void radix_init(struct radix *r, size_t size, size_t offset, enum xtSortKey key, bool ascend)
+{
+	uint64_t mask;
+	r->size = size;
+	r->offset = offset;
+	r->width = key == XT_SORT_KEY_U || key == XT_SORT_KEY_D || key == XT_SORT_KEY_F ? 4 : 8;
+	r->digits = (r->width * 8 + RADIX_BITS - 1) / RADIX_BITS;
+	r->fp = key == XT_SORT_KEY_F || key == XT_SORT_KEY_LF;
+	mask = r->width == 8 ? UINT64_MAX : UINT32_MAX;
+	r->flip = key == XT_SORT_KEY_U || key == XT_SORT_KEY_LLU ? 0 : (mask >> 1) + 1;
+	if (!ascend)
+		r->flip ^= mask;
+}
+
+static inline void radix_count_all_n(const struct radix *r, const char *src, size_t begin, size_t end, size_t *counts, unsigned width, size_t size)
+{
+	uint64_t k;
+	for (size_t i = begin; i < end; ++i) {
+		k = radix_key_n(r, src + i * size, width);
+		for (unsigned d = 0; d < r->digits; ++d)
+			++counts[d * RADIX_SIZE + ((k >> (d * RADIX_BITS)) & RADIX_MASK)];
+	}
+}
+
+/* Counts all digits of elements begin up to end of src. */
+static void radix_count_all(const struct radix *r, const char *src, size_t begin, size_t end, size_t *counts)
+{
+	memset(counts, 0, r->digits * RADIX_SIZE * sizeof *counts);
+	// Give the compiler constants for plain keys and (key, payload) pairs
+	if (r->width == 4 && r->size == 4)
+		radix_count_all_n(r, src, begin, end, counts, 4, 4);
+	else if (r->width == 8 && r->size == 8)
+		radix_count_all_n(r, src, begin, end, counts, 8, 8);
+	else if (r->width == 8 && r->size == 16)
+		radix_count_all_n(r, src, begin, end, counts, 8, 16);
+	else
+		radix_count_all_n(r, src, begin, end, counts, r->width, r->size);
+}
+
+static void radix_count(const struct radix *r, const char *src, size_t begin, size_t end, unsigned digit, size_t *counts)
+{
+	unsigned shift = digit * RADIX_BITS;
+	memset(counts, 0, RADIX_SIZE * sizeof *counts);
+	for (size_t i = begin; i < end; ++i)
+		++counts[(radix_key(r, src + i * r->size) >> shift) & RADIX_MASK];
+}
+
+static inline void radix_scatter_n(const struct radix *r, const char *src, char *dst, size_t begin, size_t end, unsigned shift, size_t *offsets, unsigned width, size_t size)
+{
+	const char *elem = src + begin * size;
+	for (size_t i = begin; i < end; ++i, elem += size)
+		copy_p(dst + offsets[(radix_key_n(r, elem, width) >> shift) & RADIX_MASK]++ * size, elem, size);
+}
+
+/* Moves elements begin up to end to the positions in offsets, which are advanced. */
+static void radix_scatter(const struct radix *r, const char *src, char *dst, size_t begin, size_t end, unsigned digit, size_t *offsets)
+{
+	unsigned shift = digit * RADIX_BITS;
+	if (r->width == 4 && r->size == 4)
+		radix_scatter_n(r, src, dst, begin, end, shift, offsets, 4, 4);
+	else if (r->width == 8 && r->size == 8)
+		radix_scatter_n(r, src, dst, begin, end, shift, offsets, 8, 8);
+	else if (r->width == 8 && r->size == 16)
+		radix_scatter_n(r, src, dst, begin, end, shift, offsets, 8, 16);
+	else
+		radix_scatter_n(r, src, dst, begin, end, shift, offsets, r->width, r->size);
+}
+
+enum radix_kind {
+	RADIX_TASK_COUNT_ALL,
+	RADIX_TASK_COUNT,
+	RADIX_TASK_SCATTER
+};
+
+struct radix_task {
+	const struct radix *r;
+	enum radix_kind kind;
+	const char *src;
+	char *dst;
+	size_t begin, end, *counts;
+	unsigned digit;
+};
+
+static void radix_exec(void *arg)
+{
+	struct radix_task *t = arg;
+	switch (t->kind) {
+	case RADIX_TASK_COUNT_ALL:
+		radix_count_all(t->r, t->src, t->begin, t->end, t->counts);
+		break;
+	case RADIX_TASK_COUNT:
+		radix_count(t->r, t->src, t->begin, t->end, t->digit, t->counts);
+		break;
+	case RADIX_TASK_SCATTER:
+		radix_scatter(t->r, t->src, t->dst, t->begin, t->end, t->digit, t->counts);
+		break;
+	}
+}
+
+/*
+Every thread counts and scatters its own part of the list. The offsets of a
+thread start after the elements with the same digit of all threads before it,
+which keeps the sort stable.
+*/
+static int radix_sort_parallel(const struct radix *r, char *list, char *buf, size_t n, unsigned nthreads)
+{
+	struct xtThread *threads;
+	struct sort_worker *workers;
+	struct radix_task *tasks;
+	size_t *counts, *total, sum, v;
+	char *src = list, *dst = buf, *swap;
+	unsigned i, d;
+	bool counted = true;
+	threads = malloc(nthreads * sizeof *threads);
+	workers = malloc(nthreads * sizeof *workers);
+	tasks = malloc(nthreads * sizeof *tasks);
+	counts = malloc((nthreads + 1) * r->digits * RADIX_SIZE * sizeof *counts);
+	if (!threads || !workers || !tasks || !counts) {
+		free(counts);
+		free(tasks);
+		free(workers);
+		free(threads);
 		return XT_ENOMEM;
-	for (m = a[0], exp = i = 1; i < n; ++i)
-		if (a[i] > m)
-			m = a[i];
-	while (m / exp > 0) {
-		memset(bb, 0, K * sizeof(int));
-		for (i = 0; i < n; ++i)
-			++bb[(a[i] / exp) % K];
-		for (i = 1; i < K; ++i)
-			bb[i] += bb[i - 1];
-		for (i = n; i > 0;) {
-			--i;
-			b[--bb[(a[i] / exp) % K]] = a[i];
-		}
-		memcpy(a, b, n * sizeof(int));
-		exp *= K;
-	}
-	if (!ascend) {
-	        for (i = 0, j = n - 1; i < n; ++i, --j)
-			b[i] = a[j];
-		memcpy(a, b, n * sizeof(int));
-	}
-	free(b);
+	}
+	total = counts + nthreads * r->digits * RADIX_SIZE;
+	for (i = 0; i < nthreads; ++i) {
+		tasks[i].r = r;
+		tasks[i].kind = RADIX_TASK_COUNT_ALL;
+		tasks[i].begin = i * n / nthreads;
+		tasks[i].end = (i + 1) * n / nthreads;
+		tasks[i].counts = counts + i * r->digits * RADIX_SIZE;
+		tasks[i].src = list;
+	}
+	sort_run(radix_exec, tasks, sizeof *tasks, nthreads, nthreads, threads, workers);
+	memset(total, 0, r->digits * RADIX_SIZE * sizeof *total);
+	for (i = 0; i < nthreads; ++i)
+		for (v = 0; v < r->digits * RADIX_SIZE; ++v)
+			total[v] += tasks[i].counts[v];
+	for (d = 0; d < r->digits; ++d) {
+		if (total[d * RADIX_SIZE + ((radix_key(r, list) >> (d * RADIX_BITS)) & RADIX_MASK)] == n)
+			continue;
+		// The counts of the first pass are still valid
+		if (!counted) {
+			for (i = 0; i < nthreads; ++i) {
+				tasks[i].kind = RADIX_TASK_COUNT;
+				tasks[i].src = src;
+				tasks[i].digit = d;
+				tasks[i].counts = counts + i * r->digits * RADIX_SIZE + d * RADIX_SIZE;
+			}
+			sort_run(radix_exec, tasks, sizeof *tasks, nthreads, nthreads, threads, workers);
+		}
+		counted = false;
+		for (sum = v = 0; v < RADIX_SIZE; ++v)
+			for (i = 0; i < nthreads; ++i) {
+				size_t *c = counts + i * r->digits * RADIX_SIZE + d * RADIX_SIZE + v, x = *c;
+				*c = sum;
+				sum += x;
+			}
+		for (i = 0; i < nthreads; ++i) {
+			tasks[i].kind = RADIX_TASK_SCATTER;
+			tasks[i].src = src;
+			tasks[i].dst = dst;
+			tasks[i].digit = d;
+			tasks[i].counts = counts + i * r->digits * RADIX_SIZE + d * RADIX_SIZE;
+		}
+		sort_run(radix_exec, tasks, sizeof *tasks, nthreads, nthreads, threads, workers);
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != list)
+		memcpy(list, src, n * r->size);
+	free(counts);
+	free(tasks);
+	free(workers);
+	free(threads);
 	return 0;
 }
 
-static int radix_sort_u(unsigned *a, size_t n, bool ascend)
+static int radix_sort(void *list, size_t n, size_t size, size_t offset, enum xtSortKey key, bool ascend, unsigned threads)
 {
-	unsigned m, exp, bb[K], *b;
-	size_t i, j;
-	b = malloc(n * sizeof(unsigned));
-	if (!b)
+	struct radix r;
+	size_t *counts, sum, x;
+	char *buf, *src = list, *dst, *swap;
+	int ret;
+	if (n < 2)
+		return 0;
+	radix_init(&r, size, offset, key, ascend);
+	if (!(buf = malloc(n * size)))
+		return XT_ENOMEM;
+	if (n / RADIX_MIN_PART < 2)
+		threads = 1;
+	else if ((threads = sort_threads(threads)) > n / RADIX_MIN_PART)
+		threads = n / RADIX_MIN_PART;
+	// Fall back to a serial sort if there is not enough memory
+	if (threads > 1 && (ret = radix_sort_parallel(&r, list, buf, n, threads)) != XT_ENOMEM)
+		goto end;
+	ret = XT_ENOMEM;
+	if (!(counts = malloc(r.digits * RADIX_SIZE * sizeof *counts)))
+		goto end;
+	radix_count_all(&r, list, 0, n, counts);
+	dst = buf;
+	for (unsigned d = 0; d < r.digits; ++d) {
+		size_t *c = counts + d * RADIX_SIZE;
+		if (c[(radix_key(&r, list) >> (d * RADIX_BITS)) & RADIX_MASK] == n)
+			continue;
+		for (sum = 0, x = 0; x < RADIX_SIZE; ++x) {
+			size_t count = c[x];
+			c[x] = sum;
+			sum += count;
+		}
+		radix_scatter(&r, src, dst, 0, n, d, c);
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != list)
+		memcpy(list, src, n * size);
+	free(counts);
+	ret = 0;
+end:
+	free(buf);
+	return ret;
+}
+
+#define XT_SORT_TYPE unsigned
+#define XT_SORT_NAME pdq_sort_u_a
+#define XT_SORT_LESS(a, b) ((a) < (b))
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE unsigned
+#define XT_SORT_NAME pdq_sort_u_d
+#define XT_SORT_LESS(a, b) ((a) > (b))
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE int
+#define XT_SORT_NAME pdq_sort_d_a
+#define XT_SORT_LESS(a, b) ((a) < (b))
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE int
+#define XT_SORT_NAME pdq_sort_d_d
+#define XT_SORT_LESS(a, b) ((a) > (b))
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE unsigned long long
+#define XT_SORT_NAME pdq_sort_llu_a
+#define XT_SORT_LESS(a, b) ((a) < (b))
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE unsigned long long
+#define XT_SORT_NAME pdq_sort_llu_d
+#define XT_SORT_LESS(a, b) ((a) > (b))
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE long long
+#define XT_SORT_NAME pdq_sort_lld_a
+#define XT_SORT_LESS(a, b) ((a) < (b))
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE long long
+#define XT_SORT_NAME pdq_sort_lld_d
+#define XT_SORT_LESS(a, b) ((a) > (b))
+#include <xt/sort_template.h>
+
+/* NaNs are larger than any number, which keeps the order strict and weak. */
+#define XT_SORT_TYPE float
+#define XT_SORT_NAME pdq_sort_f_a
+#define XT_SORT_LESS(a, b) ((a) < (b) || ((b) != (b) && (a) == (a)))
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE float
+#define XT_SORT_NAME pdq_sort_f_d
+#define XT_SORT_LESS(a, b) ((b) < (a) || ((a) != (a) && (b) == (b)))
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE double
+#define XT_SORT_NAME pdq_sort_lf_a
+#define XT_SORT_LESS(a, b) ((a) < (b) || ((b) != (b) && (a) == (a)))
+#include <xt/sort_template.h>
+
+#define XT_SORT_TYPE double
+#define XT_SORT_NAME pdq_sort_lf_d
+#define XT_SORT_LESS(a, b) ((b) < (a) || ((a) != (a) && (b) == (b)))
+#include <xt/sort_template.h>
+
+/*
+Introselect and partial sort on top of the functions of a sort template
+instance. Select only descends into the partition that contains nth and falls
+back to heapsort if too many partitions are unbalanced. The bounded heap keeps
+the best k elements seen so far with the worst of them in the root, so most
+elements cost a single comparison with the root. Partial sort uses the heap if
+k is small compared to n and selects the k-th element and sorts the elements
+before it otherwise.
+*/
+#define PARTIAL_HEAP_RATIO 16
+
+#define SELECT_LESS_A(a, b) ((a) < (b))
+#define SELECT_LESS_D(a, b) ((a) > (b))
+
+#define SELECT_DEFINE(sort, T, less) \
+static void sort##_select(T *begin, T *end, T *nth)\
+{\
+	T *pivot;\
+	size_t size, half;\
+	unsigned bad_allowed = 1;\
+	bool leftmost = true, sorted;\
+	for (size_t x = end - begin; x >>= 1;)\
+		++bad_allowed;\
+	while ((size = end - begin) >= _XT_SORT_INSERTION_THRESHOLD) {\
+		half = size / 2;\
+		if (size > _XT_SORT_NINTHER_THRESHOLD) {\
+			sort##_sort3(begin, begin + half, end - 1);\
+			sort##_sort3(begin + 1, begin + (half - 1), end - 2);\
+			sort##_sort3(begin + 2, begin + (half + 1), end - 3);\
+			sort##_sort3(begin + (half - 1), begin + half, begin + (half + 1));\
+			sort##_swap(begin, begin + half);\
+		} else\
+			sort##_sort3(begin + half, begin, end - 1);\
+		if (!leftmost && !less(begin[-1], *begin)) {\
+			begin = sort##_partition_left(begin, end) + 1;\
+			if (nth < begin)\
+				return;\
+			continue;\
+		}\
+		pivot = sort##_partition_right(begin, end, &sorted);\
+		if (pivot == nth)\
+			return;\
+		if (((size_t)(pivot - begin) < size / 8 || (size_t)(end - pivot) <= size / 8) && !--bad_allowed) {\
+			sort##_heap(begin, size);\
+			return;\
+		}\
+		if (nth < pivot)\
+			end = pivot;\
+		else {\
+			begin = pivot + 1;\
+			leftmost = false;\
+		}\
+	}\
+	sort##_insertion(begin, end);\
+}\
+\
+static void sort##_heap_partial(T *a, size_t n, size_t k)\
+{\
+	size_t i;\
+	for (i = k / 2; i > 0;)\
+		sort##_sift(a, --i, k);\
+	for (i = k; i < n; ++i)\
+		if (less(a[i], a[0])) {\
+			sort##_swap(a, a + i);\
+			sort##_sift(a, 0, k);\
+		}\
+	for (i = k; --i > 0;) {\
+		sort##_swap(a, a + i);\
+		sort##_sift(a, 0, i);\
+	}\
+}\
+\
+static void sort##_partial(T *a, size_t n, size_t k)\
+{\
+	if (k <= n / PARTIAL_HEAP_RATIO)\
+		sort##_heap_partial(a, n, k);\
+	else {\
+		sort##_select(a, a + n, a + k - 1);\
+		sort(a, k - 1);\
+	}\
+}
+
+SELECT_DEFINE(pdq_sort_u_a, unsigned, SELECT_LESS_A)
+SELECT_DEFINE(pdq_sort_u_d, unsigned, SELECT_LESS_D)
+SELECT_DEFINE(pdq_sort_d_a, int, SELECT_LESS_A)
+SELECT_DEFINE(pdq_sort_d_d, int, SELECT_LESS_D)
+
+/*
+Pattern-defeating quicksort for arbitrary elements. It works like the one in
+xt/sort_template.h, except that the pivot stays in the first element while
+partitioning and partitions are not computed in blocks, because the comparison
+is an indirect call anyway. If base is set, the sorted elements are indices in
+base and the elements they refer to are compared instead.
+*/
+struct pdq_p {
+	size_t size;
+	int (*cmp)(const void*, const void*);
+	bool ascend;
+	void *tmp;
+	const char *base;
+	size_t stride;
+};
+
+static inline bool pdq_less_p(const struct pdq_p *c, const char *a, const char *b)
+{
+	if (c->base) {
+		a = c->base + *(const size_t*)a * c->stride;
+		b = c->base + *(const size_t*)b * c->stride;
+	}
+	return c->ascend ? c->cmp(a, b) < 0 : c->cmp(b, a) < 0;
+}
+
+static inline void pdq_sort3_p(const struct pdq_p *c, char *a, char *b, char *d)
+{
+	if (pdq_less_p(c, b, a))
+		swap_p(a, b, c->tmp, c->size);
+	if (pdq_less_p(c, d, b))
+		swap_p(b, d, c->tmp, c->size);
+	if (pdq_less_p(c, b, a))
+		swap_p(a, b, c->tmp, c->size);
+}
+
+static bool pdq_insertion_p(const struct pdq_p *c, char *begin, char *end, bool guarded, size_t limit)
+{
+	size_t size = c->size, moved = 0;
+	char *cur, *sift;
+	if (begin == end)
+		return true;
+	for (cur = begin + size; cur < end; cur += size) {
+		if (!pdq_less_p(c, cur, cur - size))
+			continue;
+		sift = cur - size;
+		if (guarded)
+			while (sift != begin && pdq_less_p(c, cur, sift - size))
+				sift -= size;
+		else
+			while (pdq_less_p(c, cur, sift - size))
+				sift -= size;
+		// Rotate the element into place
+		copy_p(c->tmp, cur, size);
+		memmove(sift + size, sift, cur - sift);
+		copy_p(sift, c->tmp, size);
+		moved += (cur - sift) / size;
+		if (moved > limit)
+			return false;
+	}
+	return true;
+}
+
+static char *pdq_partition_left_p(const struct pdq_p *c, char *begin, char *end)
+{
+	size_t size = c->size;
+	char *first = begin, *last = end;
+	while (pdq_less_p(c, begin, last -= size))
+		;
+	if (last + size == end)
+		while (first < last && !pdq_less_p(c, begin, first += size))
+			;
+	else
+		while (!pdq_less_p(c, begin, first += size))
+			;
+	while (first < last) {
+		swap_p(first, last, c->tmp, size);
+		while (pdq_less_p(c, begin, last -= size))
+			;
+		while (!pdq_less_p(c, begin, first += size))
+			;
+	}
+	if (last != begin)
+		swap_p(begin, last, c->tmp, size);
+	return last;
+}
+
+static char *pdq_partition_right_p(const struct pdq_p *c, char *begin, char *end, bool *sorted)
+{
+	size_t size = c->size;
+	char *first = begin, *last = end;
+	while (pdq_less_p(c, first += size, begin))
+		;
+	if (first - size == begin)
+		while (first < last && !pdq_less_p(c, last -= size, begin))
+			;
+	else
+		while (!pdq_less_p(c, last -= size, begin))
+			;
+	*sorted = first >= last;
+	while (first < last) {
+		swap_p(first, last, c->tmp, size);
+		while (pdq_less_p(c, first += size, begin))
+			;
+		while (!pdq_less_p(c, last -= size, begin))
+			;
+	}
+	first -= size;
+	if (first != begin)
+		swap_p(begin, first, c->tmp, size);
+	return first;
+}
+
+static void pdq_sift_p(const struct pdq_p *c, char *a, size_t root, size_t n)
+{
+	size_t size = c->size, child;
+	while ((child = 2 * root + 1) < n) {
+		if (child + 1 < n && pdq_less_p(c, a + child * size, a + (child + 1) * size))
+			++child;
+		if (!pdq_less_p(c, a + root * size, a + child * size))
+			break;
+		swap_p(a + root * size, a + child * size, c->tmp, size);
+		root = child;
+	}
+}
+
+static void pdq_heap_p(const struct pdq_p *c, char *a, size_t n)
+{
+	size_t i;
+	for (i = n / 2; i > 0;)
+		pdq_sift_p(c, a, --i, n);
+	for (i = n; --i > 0;) {
+		swap_p(a, a + i * c->size, c->tmp, c->size);
+		pdq_sift_p(c, a, 0, i);
+	}
+}
+
+static void pdq_loop_p(const struct pdq_p *c, char *begin, char *end, unsigned bad_allowed, bool leftmost)
+{
+	size_t esize = c->size, size, half, l_size, r_size, q;
+	char *pivot;
+	bool sorted;
+	while ((size = (end - begin) / esize) >= _XT_SORT_INSERTION_THRESHOLD) {
+		half = size / 2;
+		if (size > _XT_SORT_NINTHER_THRESHOLD) {
+			pdq_sort3_p(c, begin, begin + half * esize, end - esize);
+			pdq_sort3_p(c, begin + esize, begin + (half - 1) * esize, end - 2 * esize);
+			pdq_sort3_p(c, begin + 2 * esize, begin + (half + 1) * esize, end - 3 * esize);
+			pdq_sort3_p(c, begin + (half - 1) * esize, begin + half * esize, begin + (half + 1) * esize);
+			swap_p(begin, begin + half * esize, c->tmp, esize);
+		} else
+			pdq_sort3_p(c, begin + half * esize, begin, end - esize);
+		if (!leftmost && !pdq_less_p(c, begin - esize, begin)) {
+			begin = pdq_partition_left_p(c, begin, end) + esize;
+			continue;
+		}
+		pivot = pdq_partition_right_p(c, begin, end, &sorted);
+		l_size = (pivot - begin) / esize;
+		r_size = (end - pivot) / esize - 1;
+		if (l_size < size / 8 || r_size < size / 8) {
+			if (!--bad_allowed) {
+				pdq_heap_p(c, begin, size);
+				return;
+			}
+			if (l_size >= _XT_SORT_INSERTION_THRESHOLD) {
+				q = l_size / 4;
+				swap_p(begin, begin + q * esize, c->tmp, esize);
+				swap_p(pivot - esize, pivot - q * esize, c->tmp, esize);
+				if (l_size > _XT_SORT_NINTHER_THRESHOLD) {
+					swap_p(begin + esize, begin + (q + 1) * esize, c->tmp, esize);
+					swap_p(begin + 2 * esize, begin + (q + 2) * esize, c->tmp, esize);
+					swap_p(pivot - 2 * esize, pivot - (q + 1) * esize, c->tmp, esize);
+					swap_p(pivot - 3 * esize, pivot - (q + 2) * esize, c->tmp, esize);
+				}
+			}
+			if (r_size >= _XT_SORT_INSERTION_THRESHOLD) {
+				q = r_size / 4;
+				swap_p(pivot + esize, pivot + (1 + q) * esize, c->tmp, esize);
+				swap_p(end - esize, end - q * esize, c->tmp, esize);
+				if (r_size > _XT_SORT_NINTHER_THRESHOLD) {
+					swap_p(pivot + 2 * esize, pivot + (2 + q) * esize, c->tmp, esize);
+					swap_p(pivot + 3 * esize, pivot + (3 + q) * esize, c->tmp, esize);
+					swap_p(end - 2 * esize, end - (1 + q) * esize, c->tmp, esize);
+					swap_p(end - 3 * esize, end - (2 + q) * esize, c->tmp, esize);
+				}
+			}
+		} else if (sorted
+			&& pdq_insertion_p(c, begin, pivot, true, _XT_SORT_PARTIAL_INSERTION_LIMIT)
+			&& pdq_insertion_p(c, pivot + esize, end, true, _XT_SORT_PARTIAL_INSERTION_LIMIT))
+			return;
+		if (l_size < r_size) {
+			pdq_loop_p(c, begin, pivot, bad_allowed, leftmost);
+			begin = pivot + esize;
+			leftmost = false;
+		} else {
+			pdq_loop_p(c, pivot + esize, end, bad_allowed, false);
+			end = pivot;
+		}
+	}
+	pdq_insertion_p(c, begin, end, leftmost, (size_t)-1);
+}
+
+static int pdq_sort_p(void *list, size_t elemsize, size_t n, int (*cmp)(const void*, const void*), bool ascend)
+{
+	unsigned char buf[64];
+	struct pdq_p c = {elemsize, cmp, ascend, buf, NULL, 0};
+	unsigned log2 = 0;
+	if (elemsize > sizeof buf && !(c.tmp = malloc(elemsize)))
+		return XT_ENOMEM;
+	for (size_t x = n; x >>= 1;)
+		++log2;
+	pdq_loop_p(&c, list, (char*)list + n * elemsize, log2 + 1, true);
+	if (c.tmp != buf)
+		free(c.tmp);
+	return 0;
+}
+
+static void pdq_sort_index(size_t *index, const void *list, size_t n, int (*cmp)(const void*, const void*), bool ascend, size_t elemsize)
+{
+	size_t tmp;
+	struct pdq_p c = {sizeof *index, cmp, ascend, &tmp, list, elemsize};
+	unsigned log2 = 0;
+	for (size_t i = 0; i < n; ++i)
+		index[i] = i;
+	for (size_t x = n; x >>= 1;)
+		++log2;
+	pdq_loop_p(&c, (char*)index, (char*)(index + n), log2 + 1, true);
+}
+
+/* Introselect for arbitrary elements, see SELECT_DEFINE. */
+static void pdq_select_p(const struct pdq_p *c, char *begin, char *end, char *nth)
+{
+	size_t esize = c->size, size, half;
+	unsigned bad_allowed = 1;
+	char *pivot;
+	bool leftmost = true, sorted;
+	for (size_t x = (end - begin) / esize; x >>= 1;)
+		++bad_allowed;
+	while ((size = (end - begin) / esize) >= _XT_SORT_INSERTION_THRESHOLD) {
+		half = size / 2;
+		if (size > _XT_SORT_NINTHER_THRESHOLD) {
+			pdq_sort3_p(c, begin, begin + half * esize, end - esize);
+			pdq_sort3_p(c, begin + esize, begin + (half - 1) * esize, end - 2 * esize);
+			pdq_sort3_p(c, begin + 2 * esize, begin + (half + 1) * esize, end - 3 * esize);
+			pdq_sort3_p(c, begin + (half - 1) * esize, begin + half * esize, begin + (half + 1) * esize);
+			swap_p(begin, begin + half * esize, c->tmp, esize);
+		} else
+			pdq_sort3_p(c, begin + half * esize, begin, end - esize);
+		if (!leftmost && !pdq_less_p(c, begin - esize, begin)) {
+			begin = pdq_partition_left_p(c, begin, end) + esize;
+			if (nth < begin)
+				return;
+			continue;
+		}
+		pivot = pdq_partition_right_p(c, begin, end, &sorted);
+		if (pivot == nth)
+			return;
+		if (((size_t)(pivot - begin) / esize < size / 8 || (size_t)(end - pivot) / esize <= size / 8) && !--bad_allowed) {
+			pdq_heap_p(c, begin, size);
+			return;
+		}
+		if (nth < pivot)
+			end = pivot;
+		else {
+			begin = pivot + esize;
+			leftmost = false;
+		}
+	}
+	pdq_insertion_p(c, begin, end, true, (size_t)-1);
+}
+
+static void pdq_heap_partial_p(const struct pdq_p *c, char *a, size_t n, size_t k)
+{
+	size_t size = c->size, i;
+	for (i = k / 2; i > 0;)
+		pdq_sift_p(c, a, --i, k);
+	for (i = k; i < n; ++i)
+		if (pdq_less_p(c, a + i * size, a)) {
+			swap_p(a, a + i * size, c->tmp, size);
+			pdq_sift_p(c, a, 0, k);
+		}
+	for (i = k; --i > 0;) {
+		swap_p(a, a + i * size, c->tmp, size);
+		pdq_sift_p(c, a, 0, i);
+	}
+}
+
+/* Selects element nth if k is zero and sorts the first k elements otherwise. */
+static int pdq_partial_p(void *list, size_t elemsize, size_t n, size_t nth, size_t k, int (*cmp)(const void*, const void*), bool ascend)
+{
+	unsigned char buf[64];
+	struct pdq_p c = {elemsize, cmp, ascend, buf, NULL, 0};
+	char *a = list;
+	unsigned log2 = 0;
+	if (elemsize > sizeof buf && !(c.tmp = malloc(elemsize)))
+		return XT_ENOMEM;
+	if (!k)
+		pdq_select_p(&c, a, a + n * elemsize, a + nth * elemsize);
+	else if (k <= n / PARTIAL_HEAP_RATIO)
+		pdq_heap_partial_p(&c, a, n, k);
+	else {
+		pdq_select_p(&c, a, a + n * elemsize, a + (k - 1) * elemsize);
+		for (size_t x = k; x >>= 1;)
+			++log2;
+		pdq_loop_p(&c, a, a + (k - 1) * elemsize, log2 + 1, true);
+	}
+	if (c.tmp != buf)
+		free(c.tmp);
+	return 0;
+}
+
+/*
+Elements larger than this are sorted by sorting their indices first, after
+which every element is moved exactly once. Otherwise, sorting moves each
+element O(log n) times. Comparing through the indices misses the cache a lot
+more, so this only pays off for really large elements.
+*/
+#define SORT_INDIRECT_SIZE 512
+
+/* Moves every element to its position in index following the cycles of the permutation. */
+static void permute_p(char *a, size_t *index, size_t n, size_t elemsize, void *tmp)
+{
+	size_t i, j, k;
+	for (i = 0; i < n; ++i) {
+		if (index[i] == i)
+			continue;
+		memcpy(tmp, a + i * elemsize, elemsize);
+		for (j = i; (k = index[j]) != i; j = k) {
+			memcpy(a + j * elemsize, a + k * elemsize, elemsize);
+			index[j] = j;
+		}
+		memcpy(a + j * elemsize, tmp, elemsize);
+		index[j] = j;
+	}
+}
+
+static int auto_sort_p(void *list, size_t elemsize, size_t n, int (*cmp)(const void*, const void*), bool ascend)
+{
+	size_t *index;
+	void *tmp;
+	if (elemsize <= SORT_INDIRECT_SIZE || n < _XT_SORT_INSERTION_THRESHOLD)
+		return pdq_sort_p(list, elemsize, n, cmp, ascend);
+	if (!(index = malloc(n * sizeof *index)))
+		return pdq_sort_p(list, elemsize, n, cmp, ascend);
+	if (!(tmp = malloc(elemsize))) {
+		free(index);
+		return XT_ENOMEM;
+	}
+	pdq_sort_index(index, list, n, cmp, ascend, elemsize);
+	permute_p(list, index, n, elemsize, tmp);
+	free(tmp);
+	free(index);
+	return 0;
+}
+
+/* Element families of the merge sorts. U and D are compared inline. */
+enum psort_family {
+	PSORT_U,
+	PSORT_D,
+	PSORT_P
+};
+
+struct psort {
+	enum psort_family family;
+	size_t size;
+	int (*cmp)(const void*, const void*);
+	bool ascend;
+};
+
+static inline bool psort_less(const struct psort *ps, const char *a, const char *b)
+{
+	switch (ps->family) {
+	case PSORT_U:
+		return ps->ascend ? *(const unsigned*)a < *(const unsigned*)b : *(const unsigned*)a > *(const unsigned*)b;
+	case PSORT_D:
+		return ps->ascend ? *(const int*)a < *(const int*)b : *(const int*)a > *(const int*)b;
+	default:
+		return ps->ascend ? ps->cmp(a, b) < 0 : ps->cmp(b, a) < 0;
+	}
+}
+
+/*
+Stable adaptive merge sort in the style of TimSort. The list is split in
+natural runs: strictly descending runs are reversed and runs shorter than
+minrun are extended with binary insertion sort. The runs are pushed on a stack
+that is merged until every run is longer than the two above it together, which
+keeps the merges balanced and the stack small. Before merging two runs, the
+elements at both ends that are in place already are skipped by galloping, so
+input that is mostly sorted is merged in close to linear time.
+*/
+#define TIM_MIN_MERGE 64
+#define TIM_MAX_RUNS 85
+
+struct tim_run {
+	char *base;
+	size_t len;
+};
+
+struct tim {
+	struct psort ps;
+	void *tmp;
+	char *buf;
+	size_t nruns;
+	struct tim_run run[TIM_MAX_RUNS];
+};
+
+/* Lists of n elements are split in runs of minrun up to 2 * minrun elements. */
+static size_t tim_minrun(size_t n)
+{
+	size_t r = 0;
+	while (n >= TIM_MIN_MERGE) {
+		r |= n & 1;
+		n >>= 1;
+	}
+	return n + r;
+}
+
+static size_t tim_count_run(const struct tim *t, char *a, size_t n)
+{
+	size_t size = t->ps.size, run = 2;
+	char *lo, *hi;
+	if (n < 2)
+		return n;
+	if (psort_less(&t->ps, a + size, a)) {
+		while (run < n && psort_less(&t->ps, a + run * size, a + (run - 1) * size))
+			++run;
+		for (lo = a, hi = a + (run - 1) * size; lo < hi; lo += size, hi -= size)
+			swap_p(lo, hi, t->tmp, size);
+	} else
+		while (run < n && !psort_less(&t->ps, a + run * size, a + (run - 1) * size))
+			++run;
+	return run;
+}
+
+/* Sorts n elements of which the first sorted elements are sorted already. */
+static void tim_insertion(const struct tim *t, char *a, size_t n, size_t sorted)
+{
+	size_t size = t->ps.size, lo, hi, mid;
+	char *cur;
+	for (; sorted < n; ++sorted) {
+		cur = a + sorted * size;
+		// Insert after equal elements to keep the sort stable
+		for (lo = 0, hi = sorted; lo < hi;) {
+			mid = lo + (hi - lo) / 2;
+			if (psort_less(&t->ps, cur, a + mid * size))
+				hi = mid;
+			else
+				lo = mid + 1;
+		}
+		if (lo == sorted)
+			continue;
+		copy_p(t->tmp, cur, size);
+		memmove(a + (lo + 1) * size, a + lo * size, (sorted - lo) * size);
+		copy_p(a + lo * size, t->tmp, size);
+	}
+}
+
+static inline bool tim_before(const struct tim *t, const char *key, const char *x, bool right)
+{
+	return right ? !psort_less(&t->ps, key, x) : psort_less(&t->ps, x, key);
+}
+
+/*
+Returns the number of elements in a that are not larger than key if right is
+set and smaller than key otherwise. The search doubles its steps from the
+start or from the end first, so it is fast if the result is close to it.
+*/
+static size_t tim_gallop(const struct tim *t, const char *key, const char *a, size_t n, bool right, bool from_end)
+{
+	size_t size = t->ps.size, lo, hi, ofs, mid;
+	if (from_end) {
+		hi = n;
+		for (ofs = 1; ofs <= n && !tim_before(t, key, a + (n - ofs) * size, right); ofs = 2 * ofs + 1)
+			hi = n - ofs;
+		lo = ofs > n ? 0 : n - ofs + 1;
+	} else {
+		lo = 0;
+		for (ofs = 1; ofs <= n && tim_before(t, key, a + (ofs - 1) * size, right); ofs = 2 * ofs + 1)
+			lo = ofs;
+		hi = ofs > n ? n : ofs - 1;
+	}
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (tim_before(t, key, a + mid * size, right))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* Merges the adjacent runs a and b, copying a to the buffer. */
+static void tim_merge_lo(const struct tim *t, char *a, size_t na, char *b, size_t nb)
+{
+	size_t size = t->ps.size;
+	char *pa = t->buf, *ea = t->buf + na * size, *pb = b, *eb = b + nb * size, *dst = a;
+	memcpy(t->buf, a, na * size);
+	while (pa < ea && pb < eb) {
+		if (psort_less(&t->ps, pb, pa)) {
+			copy_p(dst, pb, size);
+			pb += size;
+		} else {
+			copy_p(dst, pa, size);
+			pa += size;
+		}
+		dst += size;
+	}
+	memcpy(dst, pa, ea - pa);
+}
+
+/* Merges the adjacent runs a and b from the end, copying b to the buffer. */
+static void tim_merge_hi(const struct tim *t, char *a, size_t na, char *b, size_t nb)
+{
+	size_t size = t->ps.size, k = na + nb;
+	memcpy(t->buf, b, nb * size);
+	while (na && nb) {
+		if (psort_less(&t->ps, t->buf + (nb - 1) * size, a + (na - 1) * size))
+			copy_p(a + --k * size, a + --na * size, size);
+		else
+			copy_p(a + --k * size, t->buf + --nb * size, size);
+	}
+	memcpy(a, t->buf, nb * size);
+}
+
+static void tim_merge_at(struct tim *t, size_t i)
+{
+	struct tim_run *r = t->run + i;
+	size_t size = t->ps.size, na = r[0].len, nb = r[1].len, k;
+	char *a = r[0].base, *b = r[1].base;
+	r[0].len = na + nb;
+	if (i + 3 == t->nruns)
+		r[1] = r[2];
+	--t->nruns;
+	// Elements of a before the first of b and elements of b after the last of a are in place
+	k = tim_gallop(t, b, a, na, true, false);
+	a += k * size;
+	if (!(na -= k))
+		return;
+	if (!(nb = tim_gallop(t, a + (na - 1) * size, b, nb, false, true)))
+		return;
+	if (na <= nb)
+		tim_merge_lo(t, a, na, b, nb);
+	else
+		tim_merge_hi(t, a, na, b, nb);
+}
+
+static void tim_collapse(struct tim *t)
+{
+	struct tim_run *r = t->run;
+	size_t n;
+	while (t->nruns > 1) {
+		n = t->nruns - 2;
+		if ((n > 0 && r[n - 1].len <= r[n].len + r[n + 1].len) || (n > 1 && r[n - 2].len <= r[n - 1].len + r[n].len)) {
+			if (r[n - 1].len < r[n + 1].len)
+				--n;
+		} else if (r[n].len > r[n + 1].len)
+			break;
+		tim_merge_at(t, n);
+	}
+}
+
+static int tim_sort(void *list, size_t n, enum psort_family family, size_t size, int (*cmp)(const void*, const void*), bool ascend)
+{
+	unsigned char tmp[64];
+	struct tim t = {{family, size, cmp, ascend}, tmp, NULL, 0, {{NULL, 0}}};
+	size_t minrun, run, force;
+	char *a = list;
+	if (n < 2)
+		return 0;
+	if (size > sizeof tmp && !(t.tmp = malloc(size)))
 		return XT_ENOMEM;
-	for (m = a[0], exp = i = 1; i < n; ++i)
-		if (a[i] > m)
-			m = a[i];
-	while (m / exp > 0) {
-		memset(bb, 0, K * sizeof(unsigned));
-		for (i = 0; i < n; ++i)
-			++bb[(a[i] / exp) % K];
-		for (i = 1; i < K; ++i)
-			bb[i] += bb[i - 1];
-		for (i = n; i > 0;) {
-			--i;
-			b[--bb[(a[i] / exp) % K]] = a[i];
-		}
-		memcpy(a, b, n * sizeof(unsigned));
-		exp *= K;
-	}
-	if (!ascend) {
-	        for (i = 0, j = n - 1; i < n; ++i, --j)
-			b[i] = a[j];
-		memcpy(a, b, n * sizeof(unsigned));
-	}
-	free(b);
+	minrun = tim_minrun(n);
+	// Merging never needs more than the smallest of both runs
+	if (n > minrun && !(t.buf = malloc(n / 2 * size))) {
+		if (t.tmp != tmp)
+			free(t.tmp);
+		return XT_ENOMEM;
+	}
+	while (n) {
+		run = tim_count_run(&t, a, n);
+		if (run < minrun) {
+			force = n < minrun ? n : minrun;
+			tim_insertion(&t, a, force, run);
+			run = force;
+		}
+		t.run[t.nruns].base = a;
+		t.run[t.nruns++].len = run;
+		tim_collapse(&t);
+		a += run * size;
+		n -= run;
+	}
+	while (t.nruns > 1) {
+		run = t.nruns - 2;
+		if (run > 0 && t.run[run - 1].len < t.run[run + 1].len)
+			--run;
+		tim_merge_at(&t, run);
+	}
+	free(t.buf);
+	if (t.tmp != tmp)
+		free(t.tmp);
 	return 0;
 }
 
@@ -633,7 +1678,16 @@ int xtSortU(unsigned *list, size_t count, enum xtSortType type, bool ascend)
 		selection_sort_u(list, count, ascend);
 		break;
 	case XT_SORT_RADIX:
-		return radix_sort_u(list, count, ascend);
+		return radix_sort(list, count, sizeof *list, 0, XT_SORT_KEY_U, ascend, 1);
+	case XT_SORT_PDQ:
+	case XT_SORT_AUTO:
+		if (ascend)
+			pdq_sort_u_a(list, count);
+		else
+			pdq_sort_u_d(list, count);
+		break;
+	case XT_SORT_TIM:
+		return tim_sort(list, count, PSORT_U, sizeof *list, NULL, ascend);
 	default:
 		return XT_EINVAL;
 	}
@@ -662,13 +1716,127 @@ int xtSortD(int *list, size_t count, enum xtSortType type, bool ascend)
 		selection_sort_d(list, count, ascend);
 		break;
 	case XT_SORT_RADIX:
-		return radix_sort_d(list, count, ascend);
+		return radix_sort(list, count, sizeof *list, 0, XT_SORT_KEY_D, ascend, 1);
+	case XT_SORT_PDQ:
+	case XT_SORT_AUTO:
+		if (ascend)
+			pdq_sort_d_a(list, count);
+		else
+			pdq_sort_d_d(list, count);
+		break;
+	case XT_SORT_TIM:
+		return tim_sort(list, count, PSORT_D, sizeof *list, NULL, ascend);
 	default:
 		return XT_EINVAL;
 	}
 	return 0;
 }
 
+int xtSortLLU(unsigned long long *list, size_t count, enum xtSortType type, bool ascend)
+{
+	switch (type) {
+	case XT_SORT_RADIX:
+		return radix_sort(list, count, sizeof *list, 0, XT_SORT_KEY_LLU, ascend, 1);
+	case XT_SORT_PDQ:
+	case XT_SORT_AUTO:
+		if (ascend)
+			pdq_sort_llu_a(list, count);
+		else
+			pdq_sort_llu_d(list, count);
+		return 0;
+	case XT_SORT_BUBBLE:
+	case XT_SORT_HEAP:
+	case XT_SORT_INSERT:
+	case XT_SORT_QUICK:
+	case XT_SORT_SELECT:
+	case XT_SORT_TIM:
+		return XT_EOPNOTSUPP;
+	default:
+		return XT_EINVAL;
+	}
+}
+
+int xtSortLLD(long long *list, size_t count, enum xtSortType type, bool ascend)
+{
+	switch (type) {
+	case XT_SORT_RADIX:
+		return radix_sort(list, count, sizeof *list, 0, XT_SORT_KEY_LLD, ascend, 1);
+	case XT_SORT_PDQ:
+	case XT_SORT_AUTO:
+		if (ascend)
+			pdq_sort_lld_a(list, count);
+		else
+			pdq_sort_lld_d(list, count);
+		return 0;
+	case XT_SORT_BUBBLE:
+	case XT_SORT_HEAP:
+	case XT_SORT_INSERT:
+	case XT_SORT_QUICK:
+	case XT_SORT_SELECT:
+	case XT_SORT_TIM:
+		return XT_EOPNOTSUPP;
+	default:
+		return XT_EINVAL;
+	}
+}
+
+int xtSortF(float *list, size_t count, enum xtSortType type, bool ascend)
+{
+	switch (type) {
+	case XT_SORT_RADIX:
+		return radix_sort(list, count, sizeof *list, 0, XT_SORT_KEY_F, ascend, 1);
+	case XT_SORT_PDQ:
+	case XT_SORT_AUTO:
+		if (ascend)
+			pdq_sort_f_a(list, count);
+		else
+			pdq_sort_f_d(list, count);
+		return 0;
+	case XT_SORT_BUBBLE:
+	case XT_SORT_HEAP:
+	case XT_SORT_INSERT:
+	case XT_SORT_QUICK:
+	case XT_SORT_SELECT:
+	case XT_SORT_TIM:
+		return XT_EOPNOTSUPP;
+	default:
+		return XT_EINVAL;
+	}
+}
+
+int xtSortLF(double *list, size_t count, enum xtSortType type, bool ascend)
+{
+	switch (type) {
+	case XT_SORT_RADIX:
+		return radix_sort(list, count, sizeof *list, 0, XT_SORT_KEY_LF, ascend, 1);
+	case XT_SORT_PDQ:
+	case XT_SORT_AUTO:
+		if (ascend)
+			pdq_sort_lf_a(list, count);
+		else
+			pdq_sort_lf_d(list, count);
+		return 0;
+	case XT_SORT_BUBBLE:
+	case XT_SORT_HEAP:
+	case XT_SORT_INSERT:
+	case XT_SORT_QUICK:
+	case XT_SORT_SELECT:
+	case XT_SORT_TIM:
+		return XT_EOPNOTSUPP;
+	default:
+		return XT_EINVAL;
+	}
+}
+
+int xtSortRadix(void *list, size_t count, size_t elemSize, size_t keyOffset, enum xtSortKey key, bool ascend, unsigned threads)
+{
+	if (key < XT_SORT_KEY_U || key > XT_SORT_KEY_LF)
+		return XT_EINVAL;
+	if (keyOffset + (key == XT_SORT_KEY_U || key == XT_SORT_KEY_D || key == XT_SORT_KEY_F ? 4 : 8) > elemSize)
+		return XT_EINVAL;
+	return radix_sort(list, count, elemSize, keyOffset, key, ascend, threads);
+}
+
 int xtSortP(void *list, size_t count, enum xtSortType type, int (*cmp)(const void*, const void*), bool ascend, size_t elemSize)
 {
 	if (!cmp || !elemSize)
@@ -685,11 +1853,230 @@ int xtSortP(void *list, size_t count, enum xtSortType type, int (*cmp)(const voi
 	case XT_SORT_SELECT: return selection_sort_p(list, elemSize, count, cmp, ascend);
 	case XT_SORT_RADIX:
 		return XT_EOPNOTSUPP;
+	case XT_SORT_PDQ:
+		return pdq_sort_p(list, elemSize, count, cmp, ascend);
+	case XT_SORT_AUTO:
+		return auto_sort_p(list, elemSize, count, cmp, ascend);
+	case XT_SORT_TIM:
+		return tim_sort(list, count, PSORT_P, elemSize, cmp, ascend);
 	default:
 		return XT_EINVAL;
 	}
 }
 
+int xtSortIndex(size_t *index, const void *list, size_t count, int (*cmp)(const void*, const void*), bool ascend, size_t elemSize)
+{
+	if (!cmp || !elemSize)
+		return XT_EINVAL;
+	pdq_sort_index(index, list, count, cmp, ascend, elemSize);
+	return 0;
+}
+
+/*
+Multikey quicksort for strings. Every string is paired with the next 8 bytes
+at the current depth, loaded big endian so that comparing them as integers
+compares the bytes. Strings are partitioned three way on these prefixes and
+the equal part is sorted on the next 8 bytes, so common prefixes are only
+read once per string instead of once per comparison. Bytes past the end are
+loaded as zeros: a NUL terminated string has ended if its last byte is zero,
+strings with explicit lengths compare their lengths when the prefixes are
+equal.
+*/
+
+#define STR_INSERTION 16
+
+struct str_item {
+	uint64_t key;
+	const char *s;
+	size_t len;
+};
+
+static inline uint64_t str_key(const char *s, size_t depth)
+{
+	uint64_t key = 0;
+	s += depth;
+	for (unsigned i = 0; i < 8 && s[i]; ++i)
+		key |= (uint64_t)(unsigned char)s[i] << (56 - 8 * i);
+	return key;
+}
+
+static inline uint64_t str_key_len(const char *s, size_t len, size_t depth)
+{
+	uint64_t key = 0;
+	size_t n;
+	if (len <= depth)
+		return 0;
+	n = len - depth < 8 ? len - depth : 8;
+	s += depth;
+	if (n == 8) {
+		memcpy(&key, s, sizeof key);
+		return xthtonll(key);
+	}
+	for (size_t i = 0; i < n; ++i)
+		key |= (uint64_t)(unsigned char)s[i] << (56 - 8 * i);
+	return key;
+}
+
+static void str_load(struct str_item *a, size_t n, size_t depth, bool haslen)
+{
+	if (haslen)
+		for (size_t i = 0; i < n; ++i)
+			a[i].key = str_key_len(a[i].s, a[i].len, depth);
+	else
+		for (size_t i = 0; i < n; ++i)
+			a[i].key = str_key(a[i].s, depth);
+}
+
+static inline bool str_less(const struct str_item *a, const struct str_item *b, size_t depth, bool haslen)
+{
+	size_t off = depth + 8, n;
+	int cmp;
+	if (a->key != b->key)
+		return a->key < b->key;
+	if (!haslen)
+		return !(a->key & 0xff) ? false : strcmp(a->s + off, b->s + off) < 0;
+	if (a->len <= off || b->len <= off)
+		return a->len < b->len;
+	n = a->len < b->len ? a->len : b->len;
+	cmp = memcmp(a->s + off, b->s + off, n - off);
+	return cmp ? cmp < 0 : a->len < b->len;
+}
+
+static void str_insertion(struct str_item *a, size_t n, size_t depth, bool haslen)
+{
+	for (size_t i = 1; i < n; ++i) {
+		struct str_item tmp = a[i];
+		size_t j = i;
+		for (; j && str_less(&tmp, &a[j - 1], depth, haslen); --j)
+			a[j] = a[j - 1];
+		a[j] = tmp;
+	}
+}
+
+static inline void str_swap(struct str_item *a, size_t i, size_t j)
+{
+	struct str_item tmp = a[i];
+	a[i] = a[j];
+	a[j] = tmp;
+}
+
+static uint64_t str_pivot(const struct str_item *a, size_t n)
+{
+	uint64_t x = a[0].key, y = a[n / 2].key, z = a[n - 1].key;
+	if (x > y) {
+		uint64_t t = x; x = y; y = t;
+	}
+	if (y > z)
+		y = z;
+	return x > y ? x : y;
+}
+
+static void str_sort(struct str_item *a, size_t n, size_t depth, bool haslen);
+
+/*
+Moves the strings that have the same bytes up to depth + 8 and that have ended
+to the front and returns their count. NUL terminated strings that have ended
+are equal. With explicit lengths, they are ordered by their length, so the
+remaining strings can move on to the next 8 bytes.
+*/
+static size_t str_equal_ended(struct str_item *a, size_t n, size_t depth, bool haslen)
+{
+	size_t off = depth + 8, end = 0;
+	if (!haslen)
+		return a[0].key & 0xff ? 0 : n;
+	for (size_t i = 0; i < n; ++i)
+		if (a[i].len <= off)
+			str_swap(a, i, end++);
+	if (end > 1)
+		for (size_t len = depth, i = 0; len <= off; ++len)
+			for (size_t j = i; j < end; ++j)
+				if (a[j].len == len)
+					str_swap(a, j, i++);
+	return end;
+}
+
+/* Sorts strings that have the same bytes up to depth + 8. */
+static void str_sort_equal(struct str_item *a, size_t n, size_t depth, bool haslen)
+{
+	size_t end;
+	if (n < 2)
+		return;
+	end = str_equal_ended(a, n, depth, haslen);
+	if (n - end > 1)
+		str_sort(a + end, n - end, depth + 8, haslen);
+}
+
+/*
+Recurses on the two smaller of the less, equal and greater parts and loops on
+the largest one, so the stack depth stays logarithmic however long the common
+prefixes are.
+*/
+static void str_sort_keys(struct str_item *a, size_t n, size_t depth, bool haslen)
+{
+	while (n > STR_INSERTION) {
+		uint64_t pivot = str_pivot(a, n);
+		size_t lt = 0, i = 0, gt = n, end;
+		while (i < gt) {
+			if (a[i].key < pivot)
+				str_swap(a, lt++, i++);
+			else if (a[i].key > pivot)
+				str_swap(a, i, --gt);
+			else
+				++i;
+		}
+		if (gt - lt >= lt && gt - lt >= n - gt) {
+			str_sort_keys(a, lt, depth, haslen);
+			str_sort_keys(a + gt, n - gt, depth, haslen);
+			// Descend into the next 8 bytes of the equal part
+			a += lt;
+			n = gt - lt;
+			end = str_equal_ended(a, n, depth, haslen);
+			a += end;
+			n -= end;
+			depth += 8;
+			str_load(a, n, depth, haslen);
+		} else if (lt >= n - gt) {
+			str_sort_equal(a + lt, gt - lt, depth, haslen);
+			str_sort_keys(a + gt, n - gt, depth, haslen);
+			n = lt;
+		} else {
+			str_sort_equal(a + lt, gt - lt, depth, haslen);
+			str_sort_keys(a, lt, depth, haslen);
+			a += gt;
+			n -= gt;
+		}
+	}
+	str_insertion(a, n, depth, haslen);
+}
+
+static void str_sort(struct str_item *a, size_t n, size_t depth, bool haslen)
+{
+	str_load(a, n, depth, haslen);
+	str_sort_keys(a, n, depth, haslen);
+}
+
+static int str_sort_list(const char **list, size_t *lengths, size_t count, bool ascend)
+{
+	struct str_item *a;
+	if (count < 2)
+		return 0;
+	if (!(a = malloc(count * sizeof *a)))
+		return XT_ENOMEM;
+	for (size_t i = 0; i < count; ++i) {
+		a[i].s = list[i];
+		a[i].len = lengths ? lengths[i] : 0;
+	}
+	str_sort(a, count, 0, lengths != NULL);
+	for (size_t i = 0; i < count; ++i) {
+		size_t j = ascend ? i : count - 1 - i;
+		list[i] = a[j].s;
+		if (lengths)
+			lengths[i] = a[j].len;
+	}
+	free(a);
+	return 0;
+}
+
 static int sort_str_cmp(const void *a, const void *b)
 {
 	return strcmp(*(const char**)a, *(const char**)b);
@@ -697,5 +2084,369 @@ static int sort_str_cmp(const void *a, const void *b)
 
 int xtSortStr(const char **list, size_t count, enum xtSortType type, bool ascend)
 {
+	if (type == XT_SORT_AUTO && !str_sort_list(list, NULL, count, ascend))
+		return 0;
 	return xtSortP(list, count, type, sort_str_cmp, ascend, sizeof *list);
 }
+
+int xtSortStrLen(const char **list, size_t *lengths, size_t count, bool ascend)
+{
+	return str_sort_list(list, lengths, count, ascend);
+}
+
+int xtSelectNthU(unsigned *list, size_t count, size_t n, bool ascend)
+{
+	if (n >= count)
+		return XT_EINVAL;
+	if (ascend)
+		pdq_sort_u_a_select(list, list + count, list + n);
+	else
+		pdq_sort_u_d_select(list, list + count, list + n);
+	return 0;
+}
+
+int xtSelectNthD(int *list, size_t count, size_t n, bool ascend)
+{
+	if (n >= count)
+		return XT_EINVAL;
+	if (ascend)
+		pdq_sort_d_a_select(list, list + count, list + n);
+	else
+		pdq_sort_d_d_select(list, list + count, list + n);
+	return 0;
+}
+
+int xtSelectNthP(void *list, size_t count, size_t n, int (*cmp)(const void*, const void*), bool ascend, size_t elemSize)
+{
+	if (!cmp || !elemSize || n >= count)
+		return XT_EINVAL;
+	return pdq_partial_p(list, elemSize, count, n, 0, cmp, ascend);
+}
+
+int xtSelectNthStr(const char **list, size_t count, size_t n, bool ascend)
+{
+	return xtSelectNthP(list, count, n, sort_str_cmp, ascend, sizeof *list);
+}
+
+int xtPartialSortU(unsigned *list, size_t count, size_t k, bool ascend)
+{
+	if (k > count)
+		k = count;
+	if (!k)
+		return 0;
+	if (ascend)
+		pdq_sort_u_a_partial(list, count, k);
+	else
+		pdq_sort_u_d_partial(list, count, k);
+	return 0;
+}
+
+int xtPartialSortD(int *list, size_t count, size_t k, bool ascend)
+{
+	if (k > count)
+		k = count;
+	if (!k)
+		return 0;
+	if (ascend)
+		pdq_sort_d_a_partial(list, count, k);
+	else
+		pdq_sort_d_d_partial(list, count, k);
+	return 0;
+}
+
+int xtPartialSortP(void *list, size_t count, size_t k, int (*cmp)(const void*, const void*), bool ascend, size_t elemSize)
+{
+	if (!cmp || !elemSize)
+		return XT_EINVAL;
+	if (k > count)
+		k = count;
+	if (!k)
+		return 0;
+	return pdq_partial_p(list, elemSize, count, 0, k, cmp, ascend);
+}
+
+int xtPartialSortStr(const char **list, size_t count, size_t k, bool ascend)
+{
+	return xtPartialSortP(list, count, k, sort_str_cmp, ascend, sizeof *list);
+}
+
+/*
+Parallel merge sort. Every thread sorts a part of the list first. Then the
+sorted runs are merged pairwise, alternating between the list and a buffer,
+until one run is left. Each merge is split in as many pieces as there are
+threads per pair: the start of every piece in both runs is found with a binary
+search, so the pieces can be merged independently and the last rounds do not
+run on a single thread.
+*/
+
+/* Lists are only split if every thread gets at least this many elements. */
+#define PSORT_MIN_PART (1 << 15)
+
+enum psort_kind {
+	PSORT_TASK_SORT,
+	PSORT_TASK_MERGE,
+	PSORT_TASK_COPY
+};
+
+/*
+A sort and copy task covers na elements in a. A merge task produces elements
+k0 up to k1 of the merge of a and b into dst.
+*/
+struct psort_task {
+	const struct psort *ps;
+	enum psort_kind kind;
+	char *a, *b, *dst;
+	size_t na, nb, k0, k1;
+	int ret;
+};
+
+/* Merges are stable and branchless for the arithmetic types. */
+static void merge_u(const unsigned *a, size_t na, const unsigned *b, size_t nb, unsigned *dst, bool ascend)
+{
+	const unsigned *a_end = a + na, *b_end = b + nb;
+	bool take_b;
+	while (a != a_end && b != b_end) {
+		take_b = ascend ? *b < *a : *b > *a;
+		*dst++ = take_b ? *b : *a;
+		b += take_b;
+		a += !take_b;
+	}
+	memcpy(dst, a, (a_end - a) * sizeof *a);
+	memcpy(dst + (a_end - a), b, (b_end - b) * sizeof *b);
+}
+
+static void merge_d(const int *a, size_t na, const int *b, size_t nb, int *dst, bool ascend)
+{
+	const int *a_end = a + na, *b_end = b + nb;
+	bool take_b;
+	while (a != a_end && b != b_end) {
+		take_b = ascend ? *b < *a : *b > *a;
+		*dst++ = take_b ? *b : *a;
+		b += take_b;
+		a += !take_b;
+	}
+	memcpy(dst, a, (a_end - a) * sizeof *a);
+	memcpy(dst + (a_end - a), b, (b_end - b) * sizeof *b);
+}
+
+static void merge_p(const struct psort *ps, const char *a, size_t na, const char *b, size_t nb, char *dst)
+{
+	size_t size = ps->size;
+	while (na && nb) {
+		if (psort_less(ps, b, a)) {
+			copy_p(dst, b, size);
+			b += size;
+			--nb;
+		} else {
+			copy_p(dst, a, size);
+			a += size;
+			--na;
+		}
+		dst += size;
+	}
+	memcpy(dst, a, na * size);
+	memcpy(dst + na * size, b, nb * size);
+}
+
+/* Returns how many of the first k merged elements come from a. */
+static size_t psort_corank(const struct psort *ps, size_t k, const char *a, size_t na, const char *b, size_t nb)
+{
+	size_t lo = k > nb ? k - nb : 0, hi = k < na ? k : na, i;
+	while (lo < hi) {
+		i = lo + (hi - lo) / 2;
+		if (!psort_less(ps, b + (k - i - 1) * ps->size, a + i * ps->size))
+			lo = i + 1;
+		else
+			hi = i;
+	}
+	return lo;
+}
+
+static void psort_exec(void *arg)
+{
+	struct psort_task *t = arg;
+	const struct psort *ps = t->ps;
+	size_t size = ps->size, i0, i1, j0, j1;
+	switch (t->kind) {
+	case PSORT_TASK_SORT:
+		switch (ps->family) {
+		case PSORT_U:
+			if (ps->ascend)
+				pdq_sort_u_a((unsigned*)t->a, t->na);
+			else
+				pdq_sort_u_d((unsigned*)t->a, t->na);
+			break;
+		case PSORT_D:
+			if (ps->ascend)
+				pdq_sort_d_a((int*)t->a, t->na);
+			else
+				pdq_sort_d_d((int*)t->a, t->na);
+			break;
+		default:
+			t->ret = pdq_sort_p(t->a, size, t->na, ps->cmp, ps->ascend);
+			break;
+		}
+		break;
+	case PSORT_TASK_MERGE:
+		i0 = psort_corank(ps, t->k0, t->a, t->na, t->b, t->nb);
+		i1 = psort_corank(ps, t->k1, t->a, t->na, t->b, t->nb);
+		j0 = t->k0 - i0;
+		j1 = t->k1 - i1;
+		switch (ps->family) {
+		case PSORT_U:
+			merge_u((unsigned*)t->a + i0, i1 - i0, (unsigned*)t->b + j0, j1 - j0, (unsigned*)t->dst + t->k0, ps->ascend);
+			break;
+		case PSORT_D:
+			merge_d((int*)t->a + i0, i1 - i0, (int*)t->b + j0, j1 - j0, (int*)t->dst + t->k0, ps->ascend);
+			break;
+		default:
+			merge_p(ps, t->a + i0 * size, i1 - i0, t->b + j0 * size, j1 - j0, t->dst + t->k0 * size);
+			break;
+		}
+		break;
+	case PSORT_TASK_COPY:
+		memcpy(t->dst, t->a, t->na * size);
+		break;
+	}
+}
+
+/* Returns the first error of the tasks. */
+static int psort_run(struct psort_task *tasks, size_t count, unsigned nthreads, struct xtThread *threads, struct sort_worker *workers)
+{
+	sort_run(psort_exec, tasks, sizeof *tasks, count, nthreads, threads, workers);
+	for (size_t i = 0; i < count; ++i)
+		if (tasks[i].ret)
+			return tasks[i].ret;
+	return 0;
+}
+
+static int psort_sort(const struct psort *ps, char *list, size_t n, unsigned nthreads, char *buf)
+{
+	struct xtThread *threads = NULL;
+	struct sort_worker *workers = NULL;
+	struct psort_task *tasks = NULL;
+	size_t *bounds = NULL, ntasks, runs, pairs, pieces, i, q, length, size = ps->size;
+	char *src = list, *dst = buf, *swap;
+	// Nothing has been done yet, so the list can still be sorted serially
+	int ret = XT_EAGAIN;
+	threads = malloc(nthreads * sizeof *threads);
+	workers = malloc(nthreads * sizeof *workers);
+	tasks = calloc(nthreads + 1, sizeof *tasks);
+	bounds = malloc((nthreads + 1) * sizeof *bounds);
+	if (!threads || !workers || !tasks || !bounds)
+		goto end;
+	for (i = 0; i <= nthreads; ++i) {
+		bounds[i] = i * n / nthreads;
+		tasks[i].ps = ps;
+	}
+	for (i = 0; i < nthreads; ++i) {
+		tasks[i].kind = PSORT_TASK_SORT;
+		tasks[i].a = list + bounds[i] * size;
+		tasks[i].na = bounds[i + 1] - bounds[i];
+	}
+	if ((ret = psort_run(tasks, nthreads, nthreads, threads, workers)))
+		goto end;
+	for (runs = nthreads; runs > 1; runs = (runs + 1) / 2) {
+		pairs = runs / 2;
+		pieces = nthreads / pairs;
+		ntasks = 0;
+		for (i = 0; i < pairs; ++i) {
+			length = bounds[2 * i + 2] - bounds[2 * i];
+			for (q = 0; q < pieces; ++q) {
+				struct psort_task *t = &tasks[ntasks++];
+				t->kind = PSORT_TASK_MERGE;
+				t->a = src + bounds[2 * i] * size;
+				t->na = bounds[2 * i + 1] - bounds[2 * i];
+				t->b = src + bounds[2 * i + 1] * size;
+				t->nb = bounds[2 * i + 2] - bounds[2 * i + 1];
+				t->dst = dst + bounds[2 * i] * size;
+				t->k0 = q * length / pieces;
+				t->k1 = (q + 1) * length / pieces;
+			}
+		}
+		// An odd run out has nothing to merge with
+		if (runs % 2) {
+			struct psort_task *t = &tasks[ntasks++];
+			t->kind = PSORT_TASK_COPY;
+			t->a = src + bounds[runs - 1] * size;
+			t->na = bounds[runs] - bounds[runs - 1];
+			t->dst = dst + bounds[runs - 1] * size;
+		}
+		psort_run(tasks, ntasks, nthreads, threads, workers);
+		for (i = 0; i < pairs; ++i)
+			bounds[i + 1] = bounds[2 * i + 2];
+		if (runs % 2)
+			bounds[pairs + 1] = bounds[runs];
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+	if (src != list) {
+		for (i = 0; i < nthreads; ++i) {
+			tasks[i].kind = PSORT_TASK_COPY;
+			tasks[i].a = src + i * n / nthreads * size;
+			tasks[i].na = (i + 1) * n / nthreads - i * n / nthreads;
+			tasks[i].dst = list + i * n / nthreads * size;
+		}
+		psort_run(tasks, nthreads, nthreads, threads, workers);
+	}
+	ret = 0;
+end:
+	free(bounds);
+	free(tasks);
+	free(workers);
+	free(threads);
+	return ret;
+}
+
+/* Returns zero if the list has to be sorted serially. */
+static unsigned psort_threads(size_t count, unsigned threads)
+{
+	if (count / PSORT_MIN_PART < 2 || threads == 1)
+		return 0;
+	threads = sort_threads(threads);
+	if (threads > count / PSORT_MIN_PART)
+		threads = count / PSORT_MIN_PART;
+	return threads > 1 ? threads : 0;
+}
+
+/* Returns XT_EAGAIN if the list has to be sorted serially. */
+static int psort(const struct psort *ps, void *list, size_t count, unsigned threads)
+{
+	char *buf;
+	int ret;
+	if (!(threads = psort_threads(count, threads)) || !(buf = malloc(count * ps->size)))
+		return XT_EAGAIN;
+	ret = psort_sort(ps, list, count, threads, buf);
+	free(buf);
+	return ret;
+}
+
+int xtSortParallelU(unsigned *list, size_t count, bool ascend, unsigned threads)
+{
+	struct psort ps = {PSORT_U, sizeof *list, NULL, ascend};
+	int ret;
+	if ((ret = psort(&ps, list, count, threads)) == XT_EAGAIN)
+		return xtSortU(list, count, XT_SORT_PDQ, ascend);
+	return ret;
+}
+
+int xtSortParallelD(int *list, size_t count, bool ascend, unsigned threads)
+{
+	struct psort ps = {PSORT_D, sizeof *list, NULL, ascend};
+	int ret;
+	if ((ret = psort(&ps, list, count, threads)) == XT_EAGAIN)
+		return xtSortD(list, count, XT_SORT_PDQ, ascend);
+	return ret;
+}
+
+int xtSortParallelP(void *list, size_t count, int (*cmp)(const void*, const void*), bool ascend, size_t elemSize, unsigned threads)
+{
+	struct psort ps = {PSORT_P, elemSize, cmp, ascend};
+	int ret;
+	if (!cmp || !elemSize)
+		return XT_EINVAL;
+	if ((ret = psort(&ps, list, count, threads)) == XT_EAGAIN)
+		return pdq_sort_p(list, elemSize, count, cmp, ascend);
+	return ret;
+}
@@ -0,0 +1,474 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+// XT headers
+#include <xt/error.h>
+#include <xt/sort.h>
+
+// STD headers
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// System headers
+#if defined(__SSE2__)
+	#define SORTED_HAS_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+/*
+Kernels for lists that are sorted in ascending order. Intersections and unions
+treat the lists as sets, so an element may occur only once in each list, which
+the xtUnique functions take care of.
+*/
+
+/* Intersections gallop through the longest list if it is this many times longer. */
+#define SORTED_GALLOP_RATIO 32
+/* Unions gallop if one list has more than this many elements before the next of the other. */
+#define SORTED_MIN_GALLOP 8
+/* Merges of up to this many lists keep the loser tree on the stack. */
+#define SORTED_MERGE_STACK 64
+
+#define SORTED_EMPTY SIZE_MAX
+
+/*
+Intersects blocks of four elements of both lists at once. Every element of
+the block of a is compared to all rotations of the block of b and the block
+with the smallest last element is skipped afterwards. All four lanes are stored
+and only the matching ones are kept. At most three elements of the current
+block of a have been stored before, otherwise it would have been skipped, so
+this fits as long as seven elements of a are left. The positions are updated and
+the number of elements written to dest is returned, the rest of the lists is
+left for the scalar loop.
+*/
+#if SORTED_HAS_SSE2
+/* The matching lanes of every mask followed by their number. */
+static const unsigned char intersect_lanes[16][5] = {
+	{0, 0, 0, 0, 0}, {0, 0, 0, 0, 1}, {1, 0, 0, 0, 1}, {0, 1, 0, 0, 2},
+	{2, 0, 0, 0, 1}, {0, 2, 0, 0, 2}, {1, 2, 0, 0, 2}, {0, 1, 2, 0, 3},
+	{3, 0, 0, 0, 1}, {0, 3, 0, 0, 2}, {1, 3, 0, 0, 2}, {0, 1, 3, 0, 3},
+	{2, 3, 0, 0, 2}, {0, 2, 3, 0, 3}, {1, 2, 3, 0, 3}, {0, 1, 2, 3, 4},
+};
+
+#define INTERSECT_SSE2(s, T) \
+static size_t intersect_block_##s(T *dest, const T *a, size_t na, size_t *pi, const T *b, size_t nb, size_t *pj)\
+{\
+	size_t i = 0, j = 0, k = 0;\
+	__m128i va, vb, eq;\
+	unsigned mask;\
+	T amax, bmax;\
+	while (i + 7 <= na && j + 4 <= nb) {\
+		va = _mm_loadu_si128((const __m128i*)(a + i));\
+		vb = _mm_loadu_si128((const __m128i*)(b + j));\
+		eq = _mm_or_si128(\
+			_mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),\
+			_mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3))))\
+		);\
+		mask = _mm_movemask_ps(_mm_castsi128_ps(eq));\
+		dest[k    ] = a[i + intersect_lanes[mask][0]];\
+		dest[k + 1] = a[i + intersect_lanes[mask][1]];\
+		dest[k + 2] = a[i + intersect_lanes[mask][2]];\
+		dest[k + 3] = a[i + intersect_lanes[mask][3]];\
+		k += intersect_lanes[mask][4];\
+		amax = a[i + 3];\
+		bmax = b[j + 3];\
+		i += amax <= bmax ? 4 : 0;\
+		j += bmax <= amax ? 4 : 0;\
+	}\
+	*pi = i;\
+	*pj = j;\
+	return k;\
+}
+INTERSECT_SSE2(u, unsigned)
+INTERSECT_SSE2(d, int)
+#else
+#define intersect_block_u(dest, a, na, pi, b, nb, pj) 0
+#define intersect_block_d(dest, a, na, pi, b, nb, pj) 0
+#endif
+#define intersect_block_llu(dest, a, na, pi, b, nb, pj) 0
+
+/*
+Bounds are found with a binary search without branches: the range halves every
+step and its start moves by a conditional move, which does not stall on
+mispredictions. Galloping doubles its steps first, so it is fast if the bound
+is close to the start of the list.
+*/
+#define SORTED_DEFINE(S, s, T, max) \
+size_t xtLowerBound##S(const T *list, size_t count, T key)\
+{\
+	const T *base = list;\
+	size_t half;\
+	if (!count)\
+		return 0;\
+	while (count > 1) {\
+		half = count / 2;\
+		base = base[half] < key ? base + half : base;\
+		count -= half;\
+	}\
+	return base - list + (*base < key);\
+}\
+\
+size_t xtUpperBound##S(const T *list, size_t count, T key)\
+{\
+	const T *base = list;\
+	size_t half;\
+	if (!count)\
+		return 0;\
+	while (count > 1) {\
+		half = count / 2;\
+		base = key < base[half] ? base : base + half;\
+		count -= half;\
+	}\
+	return base - list + !(key < *base);\
+}\
+\
+static size_t gallop_##s(const T *list, size_t count, T key)\
+{\
+	size_t lo = 0, ofs = 1;\
+	if (!count || !(list[0] < key))\
+		return 0;\
+	while (ofs < count && list[ofs] < key) {\
+		lo = ofs;\
+		ofs = 2 * ofs + 1;\
+	}\
+	if (ofs > count)\
+		ofs = count;\
+	return lo + 1 + xtLowerBound##S(list + lo + 1, ofs - lo - 1, key);\
+}\
+\
+/* A node of the loser tree with the current element of the leaf that lost there. */\
+struct node_##s {\
+	T key;\
+	size_t leaf;\
+};\
+\
+/*\
+ * Exhausted lists provide max. It may tie with elements that are left, but\
+ * those are equal to max as well, so the output does not change.\
+ */\
+int xtMerge##S(T *dest, const T *const *lists, const size_t *counts, size_t k)\
+{\
+	struct node_##s stack[SORTED_MERGE_STACK], *tree = stack, cur, node_tmp;\
+	size_t stackpos[SORTED_MERGE_STACK], *pos = stackpos, i, n, total = 0, node;\
+	int lost;\
+	if (k > SORTED_MERGE_STACK) {\
+		tree = malloc(k * sizeof *tree);\
+		pos = malloc(k * sizeof *pos);\
+		if (!tree || !pos) {\
+			free(pos);\
+			free(tree);\
+			return XT_ENOMEM;\
+		}\
+	}\
+	for (i = 0; i < k; ++i) {\
+		pos[i] = 0;\
+		tree[i].leaf = SORTED_EMPTY;\
+		total += counts[i];\
+	}\
+	/* Every node keeps the first leaf that arrives and lets the second play */\
+	for (i = 0; i < k; ++i) {\
+		cur.key = counts[i] ? lists[i][0] : max;\
+		cur.leaf = i;\
+		for (node = (i + k) / 2; node > 0; node /= 2) {\
+			if (tree[node].leaf == SORTED_EMPTY) {\
+				tree[node] = cur;\
+				break;\
+			}\
+			if (tree[node].key < cur.key) {\
+				node_tmp = tree[node];\
+				tree[node] = cur;\
+				cur = node_tmp;\
+			}\
+		}\
+		if (!node)\
+			tree[0] = cur;\
+	}\
+	for (n = 0; n < total; ++n) {\
+		cur = tree[0];\
+		dest[n] = cur.key;\
+		i = cur.leaf;\
+		cur.key = ++pos[i] < counts[i] ? lists[i][pos[i]] : max;\
+		for (node = (i + k) / 2; node > 0; node /= 2) {\
+			node_tmp = tree[node];\
+			lost = node_tmp.key < cur.key;\
+			tree[node] = lost ? cur : node_tmp;\
+			cur = lost ? node_tmp : cur;\
+		}\
+		tree[0] = cur;\
+	}\
+	if (tree != stack) {\
+		free(pos);\
+		free(tree);\
+	}\
+	return 0;\
+}\
+\
+size_t xtIntersect##S(T *dest, const T *a, size_t na, const T *b, size_t nb)\
+{\
+	const T *list;\
+	size_t i = 0, j = 0, k, n;\
+	T x, y;\
+	/* Let a be the shortest list */\
+	if (na > nb) {\
+		list = a;\
+		a = b;\
+		b = list;\
+		n = na;\
+		na = nb;\
+		nb = n;\
+	}\
+	if (na < nb / SORTED_GALLOP_RATIO) {\
+		for (k = 0; i < na && j < nb; ++i) {\
+			j += gallop_##s(b + j, nb - j, a[i]);\
+			if (j < nb && !(a[i] < b[j]))\
+				dest[k++] = b[j++];\
+		}\
+		return k;\
+	}\
+	k = intersect_block_##s(dest, a, na, &i, b, nb, &j);\
+	/* dest has room for one more element as long as both lists have elements left */\
+	while (i < na && j < nb) {\
+		x = a[i];\
+		y = b[j];\
+		dest[k] = x;\
+		k += !(x < y) && !(y < x);\
+		i += !(y < x);\
+		j += !(x < y);\
+	}\
+	return k;\
+}\
+\
+/* The merge does not branch, unless a stretch of one list precedes the other one. */\
+size_t xtUnion##S(T *dest, const T *a, size_t na, const T *b, size_t nb)\
+{\
+	size_t i = 0, j = 0, k = 0, n;\
+	T x, y;\
+	while (i < na && j < nb) {\
+		x = a[i];\
+		y = b[j];\
+		if (na - i > SORTED_MIN_GALLOP && a[i + SORTED_MIN_GALLOP] < y) {\
+			n = gallop_##s(a + i, na - i, y);\
+			memcpy(dest + k, a + i, n * sizeof *a);\
+			i += n;\
+			k += n;\
+			continue;\
+		}\
+		if (nb - j > SORTED_MIN_GALLOP && b[j + SORTED_MIN_GALLOP] < x) {\
+			n = gallop_##s(b + j, nb - j, x);\
+			memcpy(dest + k, b + j, n * sizeof *b);\
+			j += n;\
+			k += n;\
+			continue;\
+		}\
+		dest[k++] = y < x ? y : x;\
+		i += !(y < x);\
+		j += !(x < y);\
+	}\
+	memcpy(dest + k, a + i, (na - i) * sizeof *a);\
+	k += na - i;\
+	memcpy(dest + k, b + j, (nb - j) * sizeof *b);\
+	return k + nb - j;\
+}\
+\
+size_t xtUnique##S(T *list, size_t count)\
+{\
+	size_t i, k;\
+	if (!count)\
+		return 0;\
+	for (i = k = 1; i < count; ++i) {\
+		list[k] = list[i];\
+		k += list[i] != list[k - 1];\
+	}\
+	return k;\
+}
+
+SORTED_DEFINE(U, u, unsigned, UINT_MAX)
+SORTED_DEFINE(D, d, int, INT_MAX)
+SORTED_DEFINE(LLU, llu, unsigned long long, ULLONG_MAX)
+
+size_t xtLowerBoundP(const void *list, size_t count, const void *key, int (*cmp)(const void*, const void*), size_t elemSize)
+{
+	const char *base = list;
+	size_t half;
+	if (!count)
+		return 0;
+	while (count > 1) {
+		half = count / 2;
+		base = cmp(base + half * elemSize, key) < 0 ? base + half * elemSize : base;
+		count -= half;
+	}
+	return (base - (const char*)list) / elemSize + (cmp(base, key) < 0);
+}
+
+size_t xtUpperBoundP(const void *list, size_t count, const void *key, int (*cmp)(const void*, const void*), size_t elemSize)
+{
+	const char *base = list;
+	size_t half;
+	if (!count)
+		return 0;
+	while (count > 1) {
+		half = count / 2;
+		base = cmp(key, base + half * elemSize) < 0 ? base : base + half * elemSize;
+		count -= half;
+	}
+	return (base - (const char*)list) / elemSize + (cmp(key, base) >= 0);
+}
+
+static size_t gallop_p(const char *list, size_t count, const void *key, int (*cmp)(const void*, const void*), size_t elemsize)
+{
+	size_t lo = 0, ofs = 1;
+	if (!count || cmp(list, key) >= 0)
+		return 0;
+	while (ofs < count && cmp(list + ofs * elemsize, key) < 0) {
+		lo = ofs;
+		ofs = 2 * ofs + 1;
+	}
+	if (ofs > count)
+		ofs = count;
+	return lo + 1 + xtLowerBoundP(list + (lo + 1) * elemsize, ofs - lo - 1, key, cmp, elemsize);
+}
+
+struct leaf_p {
+	const char *cur, *end;
+	size_t loser;
+};
+
+static inline int beats_p(const struct leaf_p *leaf, int (*cmp)(const void*, const void*), size_t x, size_t y)
+{
+	int c;
+	if (leaf[y].cur == leaf[y].end)
+		return 1;
+	if (leaf[x].cur == leaf[x].end)
+		return 0;
+	c = cmp(leaf[x].cur, leaf[y].cur);
+	return c < 0 || (!c && x < y);
+}
+
+int xtMergeP(void *dest, const void *const *lists, const size_t *counts, size_t k, int (*cmp)(const void*, const void*), size_t elemSize)
+{
+	struct leaf_p stack[SORTED_MERGE_STACK], *leaf = stack;
+	char *out = dest;
+	size_t i, n, total = 0, node, w, tmp;
+	if (!cmp || !elemSize)
+		return XT_EINVAL;
+	if (k > SORTED_MERGE_STACK && !(leaf = malloc(k * sizeof *leaf)))
+		return XT_ENOMEM;
+	for (i = 0; i < k; ++i) {
+		leaf[i].cur = lists[i];
+		leaf[i].end = leaf[i].cur + counts[i] * elemSize;
+		leaf[i].loser = SORTED_EMPTY;
+		total += counts[i];
+	}
+	// Every node keeps the first leaf that arrives and lets the second play
+	for (i = 0; i < k; ++i) {
+		w = i;
+		for (node = (i + k) / 2; node > 0; node /= 2) {
+			if (leaf[node].loser == SORTED_EMPTY) {
+				leaf[node].loser = w;
+				break;
+			}
+			if (beats_p(leaf, cmp, leaf[node].loser, w)) {
+				tmp = leaf[node].loser;
+				leaf[node].loser = w;
+				w = tmp;
+			}
+		}
+		if (!node)
+			leaf[0].loser = w;
+	}
+	for (n = 0; n < total; ++n, out += elemSize) {
+		w = leaf[0].loser;
+		memcpy(out, leaf[w].cur, elemSize);
+		leaf[w].cur += elemSize;
+		for (node = (w + k) / 2; node > 0; node /= 2)
+			if (beats_p(leaf, cmp, leaf[node].loser, w)) {
+				tmp = leaf[node].loser;
+				leaf[node].loser = w;
+				w = tmp;
+			}
+		leaf[0].loser = w;
+	}
+	if (leaf != stack)
+		free(leaf);
+	return 0;
+}
+
+size_t xtIntersectP(void *dest, const void *a, size_t na, const void *b, size_t nb, int (*cmp)(const void*, const void*), size_t elemSize)
+{
+	const char *pa = a, *pb = b, *list;
+	char *out = dest;
+	size_t i = 0, j = 0, k = 0, n;
+	int c;
+	// Let pa be the shortest list
+	if (na > nb) {
+		list = pa;
+		pa = pb;
+		pb = list;
+		n = na;
+		na = nb;
+		nb = n;
+	}
+	if (na < nb / SORTED_GALLOP_RATIO) {
+		for (; i < na && j < nb; ++i) {
+			j += gallop_p(pb + j * elemSize, nb - j, pa + i * elemSize, cmp, elemSize);
+			if (j < nb && !cmp(pa + i * elemSize, pb + j * elemSize))
+				memcpy(out + k++ * elemSize, pb + j++ * elemSize, elemSize);
+		}
+		return k;
+	}
+	while (i < na && j < nb) {
+		c = cmp(pa + i * elemSize, pb + j * elemSize);
+		if (!c)
+			memcpy(out + k++ * elemSize, pa + i * elemSize, elemSize);
+		i += c <= 0;
+		j += c >= 0;
+	}
+	return k;
+}
+
+size_t xtUnionP(void *dest, const void *a, size_t na, const void *b, size_t nb, int (*cmp)(const void*, const void*), size_t elemSize)
+{
+	const char *pa = a, *pb = b;
+	char *out = dest;
+	size_t i = 0, j = 0, k = 0, n;
+	int c;
+	while (i < na && j < nb) {
+		if (na - i > SORTED_MIN_GALLOP && cmp(pa + (i + SORTED_MIN_GALLOP) * elemSize, pb + j * elemSize) < 0) {
+			n = gallop_p(pa + i * elemSize, na - i, pb + j * elemSize, cmp, elemSize);
+			memcpy(out + k * elemSize, pa + i * elemSize, n * elemSize);
+			i += n;
+			k += n;
+			continue;
+		}
+		if (nb - j > SORTED_MIN_GALLOP && cmp(pb + (j + SORTED_MIN_GALLOP) * elemSize, pa + i * elemSize) < 0) {
+			n = gallop_p(pb + j * elemSize, nb - j, pa + i * elemSize, cmp, elemSize);
+			memcpy(out + k * elemSize, pb + j * elemSize, n * elemSize);
+			j += n;
+			k += n;
+			continue;
+		}
+		c = cmp(pa + i * elemSize, pb + j * elemSize);
+		memcpy(out + k++ * elemSize, c > 0 ? pb + j * elemSize : pa + i * elemSize, elemSize);
+		i += c <= 0;
+		j += c >= 0;
+	}
+	memcpy(out + k * elemSize, pa + i * elemSize, (na - i) * elemSize);
+	k += na - i;
+	memcpy(out + k * elemSize, pb + j * elemSize, (nb - j) * elemSize);
+	return k + nb - j;
+}
+
+size_t xtUniqueP(void *list, size_t count, int (*cmp)(const void*, const void*), size_t elemSize)
+{
+	char *a = list;
+	size_t i, k;
+	if (!count)
+		return 0;
+	for (i = k = 1; i < count; ++i)
+		if (cmp(a + (k - 1) * elemSize, a + i * elemSize)) {
+			if (i != k)
+				memcpy(a + k * elemSize, a + i * elemSize, elemSize);
+			++k;
+		}
+	return k;
+}
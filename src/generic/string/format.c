@@ -0,0 +1,1010 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+// XT headers
+#include <xt/error.h>
+#include <xt/os_macros.h>
+#include <xt/string.h>
+#include <_xt/format.h>
+
+// STD headers
+#include <limits.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+#define XT_PRINTF_BUFSZ 4096
+
+/*
+ * Formatting engine for the xtprintf family.
+ *
+ * Every conversion specification is parsed exactly once while walking the
+ * format string. Integers, characters and strings are converted in place
+ * directly into the output buffer. Only conversions where the libc rules are
+ * too hairy to duplicate (floats, pointers, wide characters, %m and digit
+ * grouping) are handed to snprintf, one conversion at a time.
+ */
+
+/* Conversion flags */
+#define FMT_ALT        0x001 /* '#' */
+#define FMT_ZERO       0x002 /* '0' */
+#define FMT_LEFT       0x004 /* '-' */
+#define FMT_SPACE      0x008 /* ' ' */
+#define FMT_PLUS       0x010 /* '+' */
+#define FMT_GROUP      0x020 /* '\'' */
+#define FMT_WIDTH_ARG  0x040 /* width is specified by '*' */
+#define FMT_PREC_ARG   0x080 /* precision is specified by '.*' */
+#define FMT_POSITIONAL 0x100 /* '$' argument reordering */
+
+enum _xt_fmt_len {
+	FMT_LEN_NONE,
+	FMT_LEN_HH, FMT_LEN_H, FMT_LEN_L, FMT_LEN_LL, FMT_LEN_LD,
+	FMT_LEN_J, FMT_LEN_Z, FMT_LEN_T,
+	FMT_LEN_I8, FMT_LEN_I16, FMT_LEN_I32, FMT_LEN_I64
+};
+
+struct _xt_fmt_spec {
+	unsigned flags;
+	/** Field width and precision, -1 if not specified. */
+	int width, prec;
+	enum _xt_fmt_len len;
+	/** Conversion specifier, zero if the specification is invalid. */
+	char conv;
+};
+
+struct _xt_fmt_out {
+	char *buf;
+	/** Number of characters that fit, excluding the null terminator. */
+	size_t size;
+	/** Number of characters that would have been written. */
+	size_t pos;
+};
+
+static const char fmt_digits[] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+static const char fmt_hex_lower[] = "0123456789abcdef";
+static const char fmt_hex_upper[] = "0123456789ABCDEF";
+
+static void fmt_put(struct _xt_fmt_out *o, const char *s, size_t n)
+{
+	if (o->pos < o->size) {
+		size_t avail = o->size - o->pos;
+		memcpy(o->buf + o->pos, s, n < avail ? n : avail);
+	}
+	o->pos += n;
+}
+
+static void fmt_pad(struct _xt_fmt_out *o, int c, size_t n)
+{
+	if (o->pos < o->size) {
+		size_t avail = o->size - o->pos;
+		memset(o->buf + o->pos, c, n < avail ? n : avail);
+	}
+	o->pos += n;
+}
+/**
+ * Parses the conversion specification that starts right after the '%'.
+ * @return A pointer to the first character after the specification.
+ */
+static const char *fmt_parse(const char *f, struct _xt_fmt_spec *spec)
+{
+	unsigned flags = 0;
+	int width = -1, prec = -1;
+	enum _xt_fmt_len len = FMT_LEN_NONE;
+	spec->conv = '\0';
+	for (;; ++f) {
+		switch (*f) {
+		case '#':  flags |= FMT_ALT;   continue;
+		case '0':  flags |= FMT_ZERO;  continue;
+		case '-':  flags |= FMT_LEFT;  continue;
+		case ' ':  flags |= FMT_SPACE; continue;
+		case '+':  flags |= FMT_PLUS;  continue;
+		case '\'': flags |= FMT_GROUP; continue;
+		}
+		break;
+	}
+	if (*f == '*') {
+		flags |= FMT_WIDTH_ARG;
+		++f;
+	} else if (*f >= '0' && *f <= '9') {
+		for (width = 0; *f >= '0' && *f <= '9'; ++f)
+			width = width > (INT_MAX - 9) / 10 ? INT_MAX : width * 10 + *f - '0';
+		if (*f == '$') {
+			flags |= FMT_POSITIONAL;
+			goto end;
+		}
+	}
+	if (*f == '.') {
+		++f;
+		if (*f == '*') {
+			flags |= FMT_PREC_ARG;
+			++f;
+		} else
+			for (prec = 0; *f >= '0' && *f <= '9'; ++f)
+				prec = prec > (INT_MAX - 9) / 10 ? INT_MAX : prec * 10 + *f - '0';
+	}
+	switch (*f) {
+	case 'h':
+		if (*++f == 'h') {
+			len = FMT_LEN_HH;
+			++f;
+		} else
+			len = FMT_LEN_H;
+		break;
+	case 'l':
+		if (*++f == 'l') {
+			len = FMT_LEN_LL;
+			++f;
+		} else
+			len = FMT_LEN_L;
+		break;
+	case 'L': len = FMT_LEN_LD; ++f; break;
+	case 'q': len = FMT_LEN_LL; ++f; break;
+	case 'j': len = FMT_LEN_J;  ++f; break;
+	case 'z': len = FMT_LEN_Z;  ++f; break;
+	case 't': len = FMT_LEN_T;  ++f; break;
+	case 'I':
+		if (f[1] == '8') {
+			len = FMT_LEN_I8;
+			f += 2;
+		} else if (f[1] == '1' && f[2] == '6') {
+			len = FMT_LEN_I16;
+			f += 3;
+		} else if (f[1] == '3' && f[2] == '2') {
+			len = FMT_LEN_I32;
+			f += 3;
+		} else if (f[1] == '6' && f[2] == '4') {
+			len = FMT_LEN_I64;
+			f += 3;
+		} else
+			goto end;
+		break;
+	}
+	switch (*f) {
+	case 'd': case 'i':
+	case 'o': case 'u': case 'x': case 'X':
+	case 'e': case 'E': case 'f': case 'F':
+	case 'g': case 'G': case 'a': case 'A':
+	case 'c': case 's': case 'C': case 'S':
+	case 'p': case 'n': case 'm': case '%':
+		spec->conv = *f++;
+		break;
+	}
+end:
+	spec->flags = flags;
+	spec->width = width;
+	spec->prec = prec;
+	spec->len = len;
+	return f;
+}
+
+static long long fmt_fetch_signed(enum _xt_fmt_len len, va_list *ap)
+{
+	switch (len) {
+	case FMT_LEN_HH:  return (signed char)va_arg(*ap, int);
+	case FMT_LEN_H:   return (short)va_arg(*ap, int);
+	case FMT_LEN_L:   return va_arg(*ap, long);
+	case FMT_LEN_LL:  return va_arg(*ap, long long);
+	case FMT_LEN_J:   return va_arg(*ap, intmax_t);
+	case FMT_LEN_Z:   return (ptrdiff_t)va_arg(*ap, size_t);
+	case FMT_LEN_T:   return va_arg(*ap, ptrdiff_t);
+	case FMT_LEN_I8:  return (int8_t)va_arg(*ap, int);
+	case FMT_LEN_I16: return (int16_t)va_arg(*ap, int);
+	case FMT_LEN_I32: return va_arg(*ap, int32_t);
+	case FMT_LEN_I64: return va_arg(*ap, int64_t);
+	default:          return va_arg(*ap, int);
+	}
+}
+
+static unsigned long long fmt_fetch_unsigned(enum _xt_fmt_len len, va_list *ap)
+{
+	switch (len) {
+	case FMT_LEN_HH:  return (unsigned char)va_arg(*ap, unsigned);
+	case FMT_LEN_H:   return (unsigned short)va_arg(*ap, unsigned);
+	case FMT_LEN_L:   return va_arg(*ap, unsigned long);
+	case FMT_LEN_LL:  return va_arg(*ap, unsigned long long);
+	case FMT_LEN_J:   return va_arg(*ap, uintmax_t);
+	case FMT_LEN_Z:   return va_arg(*ap, size_t);
+	case FMT_LEN_T:   return (size_t)va_arg(*ap, ptrdiff_t);
+	case FMT_LEN_I8:  return (uint8_t)va_arg(*ap, unsigned);
+	case FMT_LEN_I16: return (uint16_t)va_arg(*ap, unsigned);
+	case FMT_LEN_I32: return va_arg(*ap, uint32_t);
+	case FMT_LEN_I64: return va_arg(*ap, uint64_t);
+	default:          return va_arg(*ap, unsigned);
+	}
+}
+static void fmt_set_width(struct _xt_fmt_spec *spec, int width)
+{
+	// A negative width is taken as the '-' flag
+	if (width < 0) {
+		spec->flags |= FMT_LEFT;
+		width = width == INT_MIN ? INT_MAX : -width;
+	}
+	spec->width = width;
+}
+
+static void fmt_set_prec(struct _xt_fmt_spec *spec, int prec)
+{
+	spec->prec = prec < 0 ? -1 : prec;
+}
+/**
+ * Resolves any '*' width and precision and fetches the argument that belongs
+ * to \a spec from \a ap.
+ */
+static void fmt_fetch(struct _xt_fmt_spec *spec, union xtFormatArg *arg, va_list *ap)
+{
+	if (spec->flags & FMT_WIDTH_ARG)
+		fmt_set_width(spec, va_arg(*ap, int));
+	if (spec->flags & FMT_PREC_ARG)
+		fmt_set_prec(spec, va_arg(*ap, int));
+	switch (spec->conv) {
+	case 'd': case 'i':
+		arg->i = fmt_fetch_signed(spec->len, ap);
+		break;
+	case 'o': case 'u': case 'x': case 'X':
+		arg->u = fmt_fetch_unsigned(spec->len, ap);
+		break;
+	case 'e': case 'E': case 'f': case 'F':
+	case 'g': case 'G': case 'a': case 'A':
+		if (spec->len == FMT_LEN_LD)
+			arg->ld = va_arg(*ap, long double);
+		else
+			arg->d = va_arg(*ap, double);
+		break;
+	case 'c':
+		if (spec->len == FMT_LEN_L)
+			arg->i = va_arg(*ap, wint_t);
+		else
+			arg->i = va_arg(*ap, int);
+		break;
+	case 'C':
+		arg->i = va_arg(*ap, wint_t);
+		break;
+	case 's': case 'S': case 'p': case 'n':
+		arg->p = va_arg(*ap, const void*);
+		break;
+	default:
+		break;
+	}
+}
+
+static char *fmt_utoa10(char *end, unsigned long long v)
+{
+	while (v >= 100) {
+		unsigned i = (unsigned)(v % 100) * 2;
+		v /= 100;
+		*--end = fmt_digits[i + 1];
+		*--end = fmt_digits[i];
+	}
+	if (v >= 10) {
+		unsigned i = (unsigned)v * 2;
+		*--end = fmt_digits[i + 1];
+		*--end = fmt_digits[i];
+	} else
+		*--end = '0' + (char)v;
+	return end;
+}
+
+static char *fmt_utoa16(char *end, unsigned long long v, const char *hex)
+{
+	do
+		*--end = hex[v & 0xf];
+	while (v >>= 4);
+	return end;
+}
+
+static char *fmt_utoa8(char *end, unsigned long long v)
+{
+	do
+		*--end = '0' + (v & 07);
+	while (v >>= 3);
+	return end;
+}
+
+static void fmt_integer(struct _xt_fmt_out *o, const struct _xt_fmt_spec *spec, unsigned long long v, bool neg)
+{
+	char tmp[24], *end = tmp + sizeof tmp, *p;
+	char prefix[2];
+	size_t npre = 0, ndig, nzero = 0, total;
+	unsigned flags = spec->flags;
+	switch (spec->conv) {
+	case 'o': p = fmt_utoa8(end, v); break;
+	case 'x': p = fmt_utoa16(end, v, fmt_hex_lower); break;
+	case 'X': p = fmt_utoa16(end, v, fmt_hex_upper); break;
+	default:  p = fmt_utoa10(end, v); break;
+	}
+	// An explicit zero precision prints no digits for zero
+	if (!spec->prec && !v)
+		p = end;
+	ndig = end - p;
+	if (spec->prec > 0 && (size_t)spec->prec > ndig)
+		nzero = spec->prec - ndig;
+	switch (spec->conv) {
+	case 'd':
+	case 'i':
+		if (neg)
+			prefix[npre++] = '-';
+		else if (flags & FMT_PLUS)
+			prefix[npre++] = '+';
+		else if (flags & FMT_SPACE)
+			prefix[npre++] = ' ';
+		break;
+	case 'o':
+		if ((flags & FMT_ALT) && !nzero && (!ndig || *p != '0'))
+			nzero = 1;
+		break;
+	case 'x':
+	case 'X':
+		if ((flags & FMT_ALT) && v) {
+			prefix[npre++] = '0';
+			prefix[npre++] = spec->conv;
+		}
+		break;
+	}
+	total = npre + nzero + ndig;
+	if (spec->width > 0 && (size_t)spec->width > total) {
+		size_t pad = spec->width - total;
+		if (flags & FMT_LEFT) {
+			fmt_put(o, prefix, npre);
+			fmt_pad(o, '0', nzero);
+			fmt_put(o, p, ndig);
+			fmt_pad(o, ' ', pad);
+			return;
+		}
+		// The zero flag is ignored if a precision is specified
+		if ((flags & FMT_ZERO) && spec->prec < 0)
+			nzero += pad;
+		else
+			fmt_pad(o, ' ', pad);
+	}
+	fmt_put(o, prefix, npre);
+	fmt_pad(o, '0', nzero);
+	fmt_put(o, p, ndig);
+}
+
+static void fmt_text(struct _xt_fmt_out *o, const struct _xt_fmt_spec *spec, const char *s, size_t n)
+{
+	size_t pad = spec->width > 0 && (size_t)spec->width > n ? spec->width - n : 0;
+	if (!(spec->flags & FMT_LEFT))
+		fmt_pad(o, ' ', pad);
+	fmt_put(o, s, n);
+	if (spec->flags & FMT_LEFT)
+		fmt_pad(o, ' ', pad);
+}
+
+static int fmt_libc_arg(char *buf, size_t buflen, const char *cspec, const struct _xt_fmt_spec *spec, const union xtFormatArg *arg)
+{
+	switch (spec->conv) {
+	case 'd': case 'i':
+		return snprintf(buf, buflen, cspec, arg->i);
+	case 'o': case 'u': case 'x': case 'X':
+		return snprintf(buf, buflen, cspec, arg->u);
+	case 'e': case 'E': case 'f': case 'F':
+	case 'g': case 'G': case 'a': case 'A':
+		if (spec->len == FMT_LEN_LD)
+			return snprintf(buf, buflen, cspec, arg->ld);
+		return snprintf(buf, buflen, cspec, arg->d);
+	case 'c':
+	case 'C':
+		return snprintf(buf, buflen, cspec, (wint_t)arg->i);
+	case 'm':
+		return snprintf(buf, buflen, cspec, 0);
+	default:
+		return snprintf(buf, buflen, cspec, arg->p);
+	}
+}
+/**
+ * Formats a single conversion by handing it over to the libc snprintf. This
+ * is only used for conversions that are not performance critical or whose
+ * semantics are too platform specific to duplicate.
+ */
+static int fmt_libc(struct _xt_fmt_out *o, const struct _xt_fmt_spec *spec, const union xtFormatArg *arg)
+{
+	char cspec[48], *c = cspec, tmp[24], *p;
+	char sbuf[512], *buf = sbuf;
+	int n;
+	*c++ = '%';
+	if (spec->flags & FMT_ALT)   *c++ = '#';
+	if (spec->flags & FMT_ZERO)  *c++ = '0';
+	if (spec->flags & FMT_LEFT)  *c++ = '-';
+	if (spec->flags & FMT_SPACE) *c++ = ' ';
+	if (spec->flags & FMT_PLUS)  *c++ = '+';
+	if (spec->flags & FMT_GROUP) *c++ = '\'';
+	if (spec->width >= 0) {
+		p = fmt_utoa10(tmp + sizeof tmp, spec->width);
+		memcpy(c, p, tmp + sizeof tmp - p);
+		c += tmp + sizeof tmp - p;
+	}
+	if (spec->prec >= 0) {
+		*c++ = '.';
+		p = fmt_utoa10(tmp + sizeof tmp, spec->prec);
+		memcpy(c, p, tmp + sizeof tmp - p);
+		c += tmp + sizeof tmp - p;
+	}
+	if (spec->len == FMT_LEN_LD)
+		*c++ = 'L';
+	else if (strchr("diouxX", spec->conv)) {
+		// The argument has already been narrowed to its length modifier
+		*c++ = 'l';
+		*c++ = 'l';
+	} else if (spec->len == FMT_LEN_L && (spec->conv == 'c' || spec->conv == 's'))
+		*c++ = 'l';
+	*c++ = spec->conv;
+	*c = '\0';
+	n = fmt_libc_arg(sbuf, sizeof sbuf, cspec, spec, arg);
+	if (n < 0)
+		return n;
+	if ((size_t)n >= sizeof sbuf) {
+		if (!(buf = malloc(n + 1)))
+			return -1;
+		fmt_libc_arg(buf, n + 1, cspec, spec, arg);
+	}
+	fmt_put(o, buf, n);
+	if (buf != sbuf)
+		free(buf);
+	return 0;
+}
+
+static void fmt_store(const struct _xt_fmt_spec *spec, void *ptr, size_t count)
+{
+	if (!ptr)
+		return;
+	switch (spec->len) {
+	case FMT_LEN_HH:  *(signed char*)ptr = (signed char)count; break;
+	case FMT_LEN_H:   *(short*)ptr = (short)count; break;
+	case FMT_LEN_L:   *(long*)ptr = (long)count; break;
+	case FMT_LEN_LL:  *(long long*)ptr = (long long)count; break;
+	case FMT_LEN_J:   *(intmax_t*)ptr = (intmax_t)count; break;
+	case FMT_LEN_Z:   *(size_t*)ptr = count; break;
+	case FMT_LEN_T:   *(ptrdiff_t*)ptr = (ptrdiff_t)count; break;
+	case FMT_LEN_I8:  *(int8_t*)ptr = (int8_t)count; break;
+	case FMT_LEN_I16: *(int16_t*)ptr = (int16_t)count; break;
+	case FMT_LEN_I32: *(int32_t*)ptr = (int32_t)count; break;
+	case FMT_LEN_I64: *(int64_t*)ptr = (int64_t)count; break;
+	default:          *(int*)ptr = (int)count; break;
+	}
+}
+/**
+ * Writes the conversion \a spec for argument \a arg to \a o.
+ * @return Zero on success, negative on failure.
+ */
+static int fmt_convert(struct _xt_fmt_out *o, const struct _xt_fmt_spec *spec, const union xtFormatArg *arg)
+{
+	switch (spec->conv) {
+	case 'd':
+	case 'i':
+		// Digit grouping depends on the locale, which only libc knows about
+		if (spec->flags & FMT_GROUP)
+			break;
+		if (arg->i < 0)
+			fmt_integer(o, spec, 0ULL - (unsigned long long)arg->i, true);
+		else
+			fmt_integer(o, spec, arg->i, false);
+		return 0;
+	case 'o': case 'u': case 'x': case 'X':
+		if (spec->flags & FMT_GROUP)
+			break;
+		fmt_integer(o, spec, arg->u, false);
+		return 0;
+	case 'c':
+		if (spec->len == FMT_LEN_L)
+			break;
+		else {
+			char c = (char)arg->i;
+			fmt_text(o, spec, &c, 1);
+		}
+		return 0;
+	case 's':
+		if (spec->len == FMT_LEN_L)
+			break;
+		else {
+			const char *s = arg->p ? arg->p : "(null)";
+			size_t n;
+			if (spec->prec >= 0) {
+				const char *nul = memchr(s, '\0', spec->prec);
+				n = nul ? (size_t)(nul - s) : (size_t)spec->prec;
+			} else
+				n = strlen(s);
+			fmt_text(o, spec, s, n);
+		}
+		return 0;
+	case 'n':
+		fmt_store(spec, (void*)arg->p, o->pos);
+		return 0;
+	case '%':
+		fmt_put(o, "%", 1);
+		return 0;
+	}
+	return fmt_libc(o, spec, arg);
+}
+
+int xtprintf(const char *format, ...)
+{
+	int ret = 0;
+	va_list args;
+	va_start(args, format);
+	ret = xtvfprintf(stdout, format, args);
+	va_end(args);
+	return ret;
+}
+
+int xtvprintf(const char *format, va_list args)
+{
+	return xtvfprintf(stdout, format, args);
+}
+
+int xtfprintf(FILE *stream, const char *format, ...)
+{
+	int ret = 0;
+	va_list args;
+	va_start(args, format);
+	ret = xtvfprintf(stream, format, args);
+	va_end(args);
+	return ret;
+}
+
+int xtvfprintf(FILE *stream, const char *format, va_list args)
+{
+	char sbuf[XT_PRINTF_BUFSZ], *buf = sbuf;
+	int ret;
+	va_list copy;
+	va_copy(copy, args);
+	ret = xtvsnprintf(sbuf, sizeof sbuf, format, args);
+	// Only allocate if the output really does not fit
+	if (ret >= (int)sizeof sbuf) {
+		if (!(buf = malloc(ret + 1))) {
+			ret = -1;
+			goto end;
+		}
+		ret = xtvsnprintf(buf, ret + 1, format, copy);
+	}
+	if (ret > 0 && fwrite(buf, 1, ret, stream) != (size_t)ret)
+		ret = -1;
+	if (buf != sbuf)
+		free(buf);
+end:
+	va_end(copy);
+	return ret;
+}
+
+int xtsnprintf(char *str, size_t size, const char *format, ...)
+{
+	int ret = 0;
+	va_list args;
+	va_start(args, format);
+	ret = xtvsnprintf(str, size, format, args);
+	va_end(args);
+	return ret;
+}
+
+int xtvsnprintf(char *str, size_t size, const char *format, va_list args)
+{
+	struct _xt_fmt_out out;
+	struct _xt_fmt_spec spec;
+	union xtFormatArg arg;
+	const char *fptr = format, *next;
+	bool first = true;
+	int ret = 0;
+	va_list ap;
+	va_copy(ap, args);
+	out.buf = str;
+	out.size = size ? size - 1 : 0;
+	out.pos = 0;
+	while (*fptr) {
+		if (*fptr != '%') {
+			if (!(next = strchr(fptr, '%'))) {
+				fmt_put(&out, fptr, strlen(fptr));
+				break;
+			}
+			fmt_put(&out, fptr, next - fptr);
+			fptr = next;
+		}
+		next = fmt_parse(fptr + 1, &spec);
+		if (spec.flags & FMT_POSITIONAL) {
+			// Argument reordering cannot be mixed with normal
+			// conversions, so it is all or nothing
+			if (first) {
+				va_end(ap);
+				return vsnprintf(str, size, format, args);
+			}
+			ret = -1;
+			goto end;
+		}
+		if (!spec.conv) {
+			// Invalid specification, print it as is
+			fmt_put(&out, fptr, next - fptr);
+			fptr = next;
+			continue;
+		}
+		first = false;
+		fmt_fetch(&spec, &arg, &ap);
+		if (fmt_convert(&out, &spec, &arg)) {
+			ret = -1;
+			goto end;
+		}
+		fptr = next;
+	}
+	ret = out.pos > INT_MAX ? -1 : (int)out.pos;
+end:
+	if (size)
+		str[out.pos < out.size ? out.pos : out.size] = '\0';
+	va_end(ap);
+	return ret;
+}
+
+/*
+ * Compiled formats. The format string is parsed once into a list of
+ * operations, each being a literal text span followed by an optional
+ * conversion. Escaped percent signs and invalid specifications are folded
+ * into the literal text, so rendering never has to look at them again.
+ */
+
+struct _xt_fmt_op {
+	/** Literal text that precedes the conversion. */
+	const char *text;
+	size_t textlen;
+	/** The conversion. Its specifier is zero if there is none. */
+	struct _xt_fmt_spec spec;
+};
+
+enum _xt_fmt_type {
+	FMT_ARG_INT, FMT_ARG_UINT,
+	FMT_ARG_LONG, FMT_ARG_ULONG,
+	FMT_ARG_LLONG, FMT_ARG_ULLONG,
+	FMT_ARG_INTMAX, FMT_ARG_UINTMAX,
+	FMT_ARG_SIZE, FMT_ARG_PTRDIFF,
+	FMT_ARG_DOUBLE, FMT_ARG_LDOUBLE,
+	FMT_ARG_WINT, FMT_ARG_PTR, FMT_ARG_STR
+};
+
+#define FMT_PREC_DYNAMIC -2
+
+/** Describes how a single argument is passed. */
+struct _xt_fmt_slot {
+	enum _xt_fmt_type type;
+	/**
+	 * Precision of string arguments. It is -1 if not specified, or
+	 * FMT_PREC_DYNAMIC if it is taken from the preceding argument.
+	 */
+	int prec;
+};
+
+struct xtFormat {
+	struct _xt_fmt_op *ops;
+	size_t count;
+	/** Type of each argument consumed by all conversions. */
+	struct _xt_fmt_slot *slots;
+	size_t argc;
+	/** Whether any argument is a narrow string. */
+	bool strings;
+};
+
+static long long fmt_narrow_signed(enum _xt_fmt_len len, long long v)
+{
+	switch (len) {
+	case FMT_LEN_HH:   return (signed char)v;
+	case FMT_LEN_H:    return (short)v;
+	case FMT_LEN_L:    return (long)v;
+	case FMT_LEN_Z:    return (ptrdiff_t)v;
+	case FMT_LEN_T:    return (ptrdiff_t)v;
+	case FMT_LEN_I8:   return (int8_t)v;
+	case FMT_LEN_I16:  return (int16_t)v;
+	case FMT_LEN_I32:  return (int32_t)v;
+	case FMT_LEN_NONE: return (int)v;
+	default:           return v;
+	}
+}
+
+static unsigned long long fmt_narrow_unsigned(enum _xt_fmt_len len, unsigned long long v)
+{
+	switch (len) {
+	case FMT_LEN_HH:   return (unsigned char)v;
+	case FMT_LEN_H:    return (unsigned short)v;
+	case FMT_LEN_L:    return (unsigned long)v;
+	case FMT_LEN_Z:    return (size_t)v;
+	case FMT_LEN_T:    return (size_t)v;
+	case FMT_LEN_I8:   return (uint8_t)v;
+	case FMT_LEN_I16:  return (uint16_t)v;
+	case FMT_LEN_I32:  return (uint32_t)v;
+	case FMT_LEN_NONE: return (unsigned)v;
+	default:           return v;
+	}
+}
+/**
+ * Does the same as fmt_fetch(), but takes the arguments from an array.
+ * @return A pointer to the first argument that has not been consumed.
+ */
+static const union xtFormatArg *fmt_fetch_array(struct _xt_fmt_spec *spec, union xtFormatArg *arg, const union xtFormatArg *args)
+{
+	if (spec->flags & FMT_WIDTH_ARG)
+		fmt_set_width(spec, (int)(args++)->i);
+	if (spec->flags & FMT_PREC_ARG)
+		fmt_set_prec(spec, (int)(args++)->i);
+	switch (spec->conv) {
+	case 'd': case 'i':
+		arg->i = fmt_narrow_signed(spec->len, args->i);
+		break;
+	case 'o': case 'u': case 'x': case 'X':
+		arg->u = fmt_narrow_unsigned(spec->len, args->u);
+		break;
+	case 'm': case '%':
+		return args;
+	default:
+		*arg = *args;
+		break;
+	}
+	return args + 1;
+}
+/**
+ * Renders \a fmt to \a str. The arguments are taken from \a ap, or from
+ * \a args if \a ap is NULL.
+ */
+static int fmt_render(char *str, size_t size, const struct xtFormat *fmt, va_list *ap, const union xtFormatArg *args)
+{
+	struct _xt_fmt_out out;
+	struct _xt_fmt_spec spec;
+	union xtFormatArg arg;
+	const struct _xt_fmt_op *op = fmt->ops, *end = op + fmt->count;
+	int ret = 0;
+	out.buf = str;
+	out.size = size ? size - 1 : 0;
+	out.pos = 0;
+	for (; op < end; ++op) {
+		fmt_put(&out, op->text, op->textlen);
+		if (!op->spec.conv)
+			continue;
+		spec = op->spec;
+		if (ap)
+			fmt_fetch(&spec, &arg, ap);
+		else
+			args = fmt_fetch_array(&spec, &arg, args);
+		if (fmt_convert(&out, &spec, &arg)) {
+			ret = -1;
+			goto end;
+		}
+	}
+	ret = out.pos > INT_MAX ? -1 : (int)out.pos;
+end:
+	if (size)
+		str[out.pos < out.size ? out.pos : out.size] = '\0';
+	return ret;
+}
+
+static enum _xt_fmt_type fmt_arg_type(const struct _xt_fmt_spec *spec)
+{
+	switch (spec->conv) {
+	case 'd': case 'i':
+		switch (spec->len) {
+		case FMT_LEN_L:   return FMT_ARG_LONG;
+		case FMT_LEN_LL:  return FMT_ARG_LLONG;
+		case FMT_LEN_J:   return FMT_ARG_INTMAX;
+		case FMT_LEN_Z:   return FMT_ARG_PTRDIFF;
+		case FMT_LEN_T:   return FMT_ARG_PTRDIFF;
+		case FMT_LEN_I64: return FMT_ARG_LLONG;
+		default:          return FMT_ARG_INT;
+		}
+	case 'o': case 'u': case 'x': case 'X':
+		switch (spec->len) {
+		case FMT_LEN_L:   return FMT_ARG_ULONG;
+		case FMT_LEN_LL:  return FMT_ARG_ULLONG;
+		case FMT_LEN_J:   return FMT_ARG_UINTMAX;
+		case FMT_LEN_Z:   return FMT_ARG_SIZE;
+		case FMT_LEN_T:   return FMT_ARG_SIZE;
+		case FMT_LEN_I64: return FMT_ARG_ULLONG;
+		default:          return FMT_ARG_UINT;
+		}
+	case 'e': case 'E': case 'f': case 'F':
+	case 'g': case 'G': case 'a': case 'A':
+		return spec->len == FMT_LEN_LD ? FMT_ARG_LDOUBLE : FMT_ARG_DOUBLE;
+	case 'c':
+		return spec->len == FMT_LEN_L ? FMT_ARG_WINT : FMT_ARG_INT;
+	case 'C':
+		return FMT_ARG_WINT;
+	case 's':
+		return spec->len == FMT_LEN_L ? FMT_ARG_PTR : FMT_ARG_STR;
+	default:
+		return FMT_ARG_PTR;
+	}
+}
+
+int xtFormatCreate(struct xtFormat **fmt, const char *format)
+{
+	struct xtFormat *f;
+	struct _xt_fmt_op *op;
+	struct _xt_fmt_slot *slot;
+	struct _xt_fmt_spec spec;
+	const char *fptr, *next;
+	char *text;
+	size_t n = 1, len = strlen(format);
+	// Every conversion starts with a percent sign, so this is an upper bound
+	for (fptr = format; (fptr = strchr(fptr, '%')); ++fptr)
+		++n;
+	// Put everything in one block so rendering stays cache friendly. Each
+	// conversion takes at most three arguments.
+	if (!(f = malloc(sizeof *f + n * sizeof *op + 3 * n * sizeof *slot + len + 1)))
+		return XT_ENOMEM;
+	f->ops = op = (struct _xt_fmt_op*)(f + 1);
+	f->slots = slot = (struct _xt_fmt_slot*)(op + n);
+	f->strings = false;
+	text = (char*)(slot + 3 * n);
+	op->text = text;
+	fptr = format;
+	while (*fptr) {
+		if (*fptr != '%') {
+			if (!(next = strchr(fptr, '%')))
+				next = format + len;
+			memcpy(text, fptr, next - fptr);
+			text += next - fptr;
+			fptr = next;
+			continue;
+		}
+		next = fmt_parse(fptr + 1, &spec);
+		if (spec.flags & FMT_POSITIONAL) {
+			free(f);
+			return XT_EINVAL;
+		}
+		if (!spec.conv) {
+			// Invalid specification, print it as is
+			memcpy(text, fptr, next - fptr);
+			text += next - fptr;
+		} else if (spec.conv == '%' && !(spec.flags & (FMT_WIDTH_ARG | FMT_PREC_ARG))) {
+			*text++ = '%';
+		} else {
+			op->textlen = text - op->text;
+			op->spec = spec;
+			if (spec.flags & FMT_WIDTH_ARG)
+				(slot++)->type = FMT_ARG_INT;
+			if (spec.flags & FMT_PREC_ARG)
+				(slot++)->type = FMT_ARG_INT;
+			if (spec.conv != '%' && spec.conv != 'm') {
+				slot->type = fmt_arg_type(&spec);
+				slot->prec = spec.flags & FMT_PREC_ARG ? FMT_PREC_DYNAMIC : spec.prec;
+				if (slot->type == FMT_ARG_STR)
+					f->strings = true;
+				++slot;
+			}
+			++op;
+			op->text = text;
+		}
+		fptr = next;
+	}
+	op->textlen = text - op->text;
+	op->spec.conv = '\0';
+	f->count = op - f->ops + 1;
+	f->argc = slot - f->slots;
+	*fmt = f;
+	return 0;
+}
+
+void xtFormatDestroy(struct xtFormat **fmt)
+{
+	free(*fmt);
+	*fmt = NULL;
+}
+
+size_t xtFormatGetArgCount(const struct xtFormat *fmt)
+{
+	return fmt->argc;
+}
+
+int xtFormatRender(char *str, size_t size, const struct xtFormat *fmt, ...)
+{
+	int ret = 0;
+	va_list args;
+	va_start(args, fmt);
+	ret = xtFormatRenderV(str, size, fmt, args);
+	va_end(args);
+	return ret;
+}
+
+int xtFormatRenderV(char *str, size_t size, const struct xtFormat *fmt, va_list args)
+{
+	int ret;
+	va_list ap;
+	if (!fmt) {
+		if (size)
+			*str = '\0';
+		return -1;
+	}
+	va_copy(ap, args);
+	ret = fmt_render(str, size, fmt, &ap, NULL);
+	va_end(ap);
+	return ret;
+}
+
+int xtFormatRenderArgs(char *str, size_t size, const struct xtFormat *fmt, const union xtFormatArg *args, size_t argc)
+{
+	if (!fmt || argc < fmt->argc) {
+		if (size)
+			*str = '\0';
+		return -1;
+	}
+	return fmt_render(str, size, fmt, NULL, args);
+}
+
+static size_t fmt_strlen(const char *s, int prec)
+{
+	const char *nul;
+	if (prec < 0)
+		return strlen(s);
+	nul = memchr(s, '\0', prec);
+	return nul ? (size_t)(nul - s) : (size_t)prec;
+}
+
+size_t _xtFormatFetch(const struct xtFormat *fmt, union xtFormatArg *args, va_list ap)
+{
+	const struct _xt_fmt_slot *slot = fmt->slots, *end = slot + fmt->argc;
+	size_t n = 0;
+	va_list aq;
+	va_copy(aq, ap);
+	for (; slot < end; ++slot, ++args) {
+		switch (slot->type) {
+		case FMT_ARG_INT:     args->i = va_arg(aq, int); break;
+		case FMT_ARG_UINT:    args->u = va_arg(aq, unsigned); break;
+		case FMT_ARG_LONG:    args->i = va_arg(aq, long); break;
+		case FMT_ARG_ULONG:   args->u = va_arg(aq, unsigned long); break;
+		case FMT_ARG_LLONG:   args->i = va_arg(aq, long long); break;
+		case FMT_ARG_ULLONG:  args->u = va_arg(aq, unsigned long long); break;
+		case FMT_ARG_INTMAX:  args->i = va_arg(aq, intmax_t); break;
+		case FMT_ARG_UINTMAX: args->u = va_arg(aq, uintmax_t); break;
+		case FMT_ARG_SIZE:    args->u = va_arg(aq, size_t); break;
+		case FMT_ARG_PTRDIFF: args->i = va_arg(aq, ptrdiff_t); break;
+		case FMT_ARG_DOUBLE:  args->d = va_arg(aq, double); break;
+		case FMT_ARG_LDOUBLE: args->ld = va_arg(aq, long double); break;
+		case FMT_ARG_WINT:    args->i = va_arg(aq, wint_t); break;
+		case FMT_ARG_PTR:     args->p = va_arg(aq, const void*); break;
+		case FMT_ARG_STR:
+			if ((args->p = va_arg(aq, const char*)))
+				n += fmt_strlen(args->p, slot->prec == FMT_PREC_DYNAMIC ? (int)args[-1].i : slot->prec) + 1;
+			break;
+		}
+	}
+	va_end(aq);
+	return n;
+}
+
+void _xtFormatCopyStrings(const struct xtFormat *fmt, union xtFormatArg *args, char *strings)
+{
+	const struct _xt_fmt_slot *slot = fmt->slots, *end = slot + fmt->argc;
+	size_t len;
+	if (!fmt->strings)
+		return;
+	for (; slot < end; ++slot, ++args) {
+		if (slot->type != FMT_ARG_STR || !args->p)
+			continue;
+		len = fmt_strlen(args->p, slot->prec == FMT_PREC_DYNAMIC ? (int)args[-1].i : slot->prec);
+		memcpy(strings, args->p, len);
+		strings[len] = '\0';
+		args->p = strings;
+		strings += len + 1;
+	}
+}
+
+const struct xtFormat *xtFormatStatic(struct xtFormat **cache, const char *format)
+{
+	struct xtFormat *fmt = __atomic_load_n(cache, __ATOMIC_ACQUIRE), *old = NULL;
+	if (fmt)
+		return fmt;
+	if (xtFormatCreate(&fmt, format))
+		return NULL;
+	// Another thread may have compiled it in the meantime
+	if (!__atomic_compare_exchange_n(cache, &old, fmt, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+		xtFormatDestroy(&fmt);
+		return old;
+	}
+	return fmt;
+}
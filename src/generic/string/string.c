@@ -3,7 +3,6 @@
 // XT headers
 #include <xt/os_macros.h>
 #include <xt/error.h>
-#include "string.h"
 #include <xt/string.h>
 #include <_xt/time.h>
 
@@ -17,16 +16,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define XT_PRINTF_BUFSZ 4096
-
-#ifdef XT_PRINTF_DEBUG
-#define dbgf(f,...) printf(f, ## __VA_ARGS__)
-#define dbgs(s) puts(s)
-#else
-#define dbgf(f,...) ((void)0)
-#define dbgs(s) ((void)0)
-#endif
-
 int xtCharToDigit(char c)
 {
 	return ((c >= '0' && c <= '9') ? c - '0' : 10);
@@ -158,277 +147,6 @@ void xtRot13(void *buf, size_t buflen)
 		xbuf[i] = _xt_rot13tbl[xbuf[i]];
 }
 
-int xtprintf(const char *format, ...)
-{
-	int ret = 0;
-	va_list args;
-	va_start(args, format);
-	ret = xtvfprintf(stdout, format, args);
-	va_end(args);
-	return ret;
-}
-
-int xtvprintf(const char *format, va_list args)
-{
-	return xtvfprintf(stdout, format, args);
-}
-
-int xtfprintf(FILE *stream, const char *format, ...)
-{
-	int ret = 0;
-	va_list args;
-	va_start(args, format);
-	ret = xtvfprintf(stream, format, args);
-	va_end(args);
-	return ret;
-}
-
-int xtvfprintf(FILE *stream, const char *format, va_list args)
-{
-	char sbuf[XT_PRINTF_BUFSZ], *dbuf = NULL, *buf = sbuf;
-	size_t l;
-	int ret = 0;
-	l = strlen(format);
-	if (l > XT_PRINTF_BUFSZ - 1) {
-		dbuf = malloc(l + 1);
-		if (!dbuf)
-			goto fail;
-		buf = dbuf;
-	} else
-		l = XT_PRINTF_BUFSZ - 1;
-	ret = xtvsnprintf(buf, l + 1, format, args);
-fail:
-	if (dbuf)
-		free(dbuf);
-	if (ret)
-		fputs(buf, stream);
-	return ret;
-}
-
-int xtsnprintf(char *str, size_t size, const char *format, ...)
-{
-	int ret = 0;
-	va_list args;
-	va_start(args, format);
-	ret = xtvsnprintf(str, size, format, args);
-	va_end(args);
-	return ret;
-}
-
-int xtvsnprintf(char *str, size_t size, const char *format, va_list args)
-{
-	const char *fptr, *rep;
-	char sbuf[XT_PRINTF_BUFSZ], *dbuf = NULL, *buf = sbuf, *ptr, *end;
-	size_t l;
-	int ret = 0;
-	l = strlen(format);
-	if (l > XT_PRINTF_BUFSZ - 1) {
-		dbuf = malloc(l + 1);
-		if (!dbuf)
-			goto fail;
-		buf = dbuf;
-		end = buf + l;
-	} else
-		l = XT_PRINTF_BUFSZ - 1;
-	end = buf + XT_PRINTF_BUFSZ;
-	// safe guard termination in case snprintf fucks up
-	// (*ahum* windoze *ahum*)
-	if (size)
-		str[0] = str[size - 1] = '\0';
-	for (ptr = buf, fptr = format; *fptr; ++fptr) {
-		switch (*fptr) {
-		case '%': {
-			char *sub;
-			int ptype = -1, mod = -1, conv = -1;
-			unsigned flags = 0, prec = 0, cfw = 0;
-			int fw = 0;
-			const char *fstr = "#0- +'", *aptr = fptr + 1;
-#ifdef XT_PRINTF_DEBUG
-			const char *arg = fptr;
-#endif
-			const char *lmod[] = {
-				"hh", "h", "ll", "l", "L", "q", "j", "z", "t",
-				// XXX consider s/I/N/
-				// 9    10     11     12
-				"I8", "I16", "I32", "I64",
-			};
-			const char *cspec[] = {
-				"d", "i",
-				"o", "u", "x", "X",
-				"e", "E",
-				"f", "F",
-				"g", "G",
-				"a", "A",
-				"c", "s",
-				"C",
-				"S",
-				"p",
-				"n",
-				"m",
-				"%",
-			};
-#define LMODSZ (sizeof lmod/sizeof lmod[0])
-#define CSPECSZ (sizeof cspec/sizeof cspec[0])
-			const char *i8tbl[] = {
-				PRId8, PRIi8, PRIo8, PRIu8, PRIx8, PRIX8
-			};
-			const char *i16tbl[] = {
-				PRId16, PRIi16, PRIo16, PRIu16, PRIx16, PRIX16
-			};
-			const char *i32tbl[] = {
-				PRId32, PRIi32, PRIo32, PRIu32, PRIx32, PRIX32
-			};
-			const char *i64tbl[] = {
-				PRId64, PRIi64, PRIo64, PRIu64, PRIx64, PRIX64
-			};
-			while (*aptr && (sub = strchr(fstr, *aptr))) {
-				flags |= 1 << (sub - fstr);
-				++aptr;
-			}
-			if (!*aptr)
-				goto stat;
-			if (*aptr == '-' || isdigit(*aptr)) {
-				dbgf("aptr=%s\n", aptr);
-				cfw = 1;
-				sscanf(aptr, "%d", &fw);
-				if (*aptr == '-') ++aptr;
-				while (*aptr && isdigit(*aptr))
-					++aptr;
-			}
-			dbgf("aptr=%s\n", aptr);
-			if (!*aptr)
-				goto stat;
-			if (*aptr == '.') {
-				ptype = 0;
-				if (!aptr[1])
-					goto stat;
-				if (*++aptr == '*') {
-					ptype = 1;
-					++aptr;
-				}
-				if (isdigit(*aptr)) {
-					++ptype;
-					dbgf("precision=%s\n", aptr - 1);
-					// spec requires int, but does not make sense
-					sscanf(aptr, "%u", &prec);
-					while (*aptr && isdigit(*aptr))
-						++aptr;
-				}
-			}
-			if (!*aptr)
-				goto stat;
-			for (unsigned i = 0; i < LMODSZ; ++i)
-				if (xtStringStartsWith(aptr, lmod[i])) {
-					mod = i;
-					aptr += strlen(lmod[i]);
-					break;
-				}
-			if (!*aptr)
-				goto stat;
-			for (unsigned i = 0; i < CSPECSZ; ++i)
-				if (xtStringStartsWith(aptr, cspec[i])) {
-					conv = i;
-					aptr += strlen(cspec[i]);
-					break;
-				}
-			// interpret (u)int*_t variants
-			switch (mod) {
-			case 9:
-				rep = i8tbl[conv];
-				dbgs("int8_t");
-				goto custom_put;
-			case 10:
-				rep = i16tbl[conv];
-				dbgs("int16_t");
-				goto custom_put;
-			case 11:
-				rep = i32tbl[conv];
-				dbgs("int32_t");
-				goto custom_put;
-			case 12:
-				rep = i64tbl[conv];
-				dbgs("int64_t");
-				goto custom_put;
-			default:
-				break;
-custom_put:
-				dbgf("arglen=%u\n", (unsigned)(aptr - arg));
-				l = strlen(rep);
-				dbgf("replen=%u (%%%s)\n", (unsigned)l, rep);
-				// reconstruct flags
-				char argf[16], *argfp = argf;
-				unsigned argfn = 0;
-				argf[0] = '\0';
-				for (unsigned i = flags, j = 0; i; i >>= 1, ++j)
-					if (i & 1) {
-						*argfp++ = fstr[j];
-						++argfn;
-					}
-				argf[argfn] = '\0';
-				dbgf("argf=%s (%u): flags=%u\n", argf, argfn, flags);
-				char argfw[32];
-				unsigned argfwn = 0;
-				argfw[0] = '\0';
-				if (cfw) {
-					// reconstruct field width
-					sprintf(argfw, "%d", fw);
-					argfwn = strlen(argfw);
-				}
-				dbgf("argfw=%s (%u)\n", argfw, argfwn);
-				unsigned argsn = argfn + argfwn;
-				if (ptr + l + argsn + 1 >= end)
-					goto resize;
-				argfw[argfwn] = '\0';
-				// move format if replacement is longer OR shorter
-				int diff = 0;
-				unsigned arglen = aptr - fptr + argsn;
-				if (l >= arglen) {
-					diff = l - arglen + 1;
-					size_t n = end - aptr - 1;
-					dbgf("move: %d,%u\n", diff, (unsigned)n);
-					memmove((void*)(aptr + diff), (const void*)aptr, n);
-				}
-				dbgf("diff: %d\n", diff);
-				fptr = aptr + diff - 1;
-				*ptr++ = '%';
-				if (argfn) {
-					memcpy(ptr, argf, argfn);
-					ptr += argfn;
-				}
-				if (argfwn) {
-					memcpy(ptr, argfw, argfwn);
-					ptr += argfwn;
-				}
-				memcpy(ptr, rep, l);
-				ptr += l;
-				dbgf("fptr=%s\n", fptr);
-				dbgf("format=%s\n", format);
-				dbgf("flags=%u,fw=%d,prec=(%d,%u),mod=%d,conv=%d\n", flags, fw, ptype, prec, mod, conv);
-				continue;
-			}
-stat:
-			dbgf("flags=%u,fw=%d,prec=(%d,%u),mod=%d,conv=%d\n", flags, fw, ptype, prec, mod, conv);
-		}
-			goto put;
-put:
-		default:
-			if (ptr >= end)
-				goto resize;
-			*ptr++ = *fptr;
-			break;
-		}
-	}
-	*ptr = '\0';
-	dbgf("format=%s\n", buf);
-	ret = _xtvsnprintf(str, size, buf, end, args);
-resize:
-	// FIXME try resize for all goto statements to this label
-fail:
-	if (dbuf)
-		free(dbuf);
-	return ret;
-}
-
 char *xtstrncpy(char *restrict dest, const char *restrict src, size_t n)
 {
 	if (n) {
@@ -604,6 +322,55 @@ char *xtFormatTime(char *buf, size_t buflen, unsigned timestamp_secs)
 	return buf;
 }
 
+char *xtFormatTimeCached(char *buf, size_t buflen, struct xtFormatTimeCache *cache, const struct xtTimestamp *timestamp, unsigned decimals)
+{
+	char *ptr;
+	unsigned secs, nsec;
+	if (decimals > 9)
+		decimals = 9;
+	if (buflen < sizeof cache->text + (decimals ? decimals + 1 : 0))
+		return NULL;
+	if (timestamp->sec != cache->sec || !cache->text[0]) {
+		if (timestamp->sec / XT_DATE_DAY != cache->day || !cache->text[0]) {
+			if (!xtFormatTime(cache->text, sizeof cache->text, timestamp->sec))
+				return NULL;
+			cache->day = timestamp->sec / XT_DATE_DAY;
+		} else {
+			// Same day, so only the time of day has changed
+			secs = timestamp->sec % XT_DATE_DAY;
+			cache->text[11] = '0' + secs / XT_DATE_HOUR / 10;
+			cache->text[12] = '0' + secs / XT_DATE_HOUR % 10;
+			cache->text[14] = '0' + secs % XT_DATE_HOUR / XT_DATE_MIN / 10;
+			cache->text[15] = '0' + secs % XT_DATE_HOUR / XT_DATE_MIN % 10;
+			cache->text[17] = '0' + secs % XT_DATE_MIN / 10;
+			cache->text[18] = '0' + secs % XT_DATE_MIN % 10;
+		}
+		cache->sec = timestamp->sec;
+	}
+	memcpy(buf, cache->text, sizeof cache->text - 1);
+	ptr = buf + sizeof cache->text - 1;
+	if (decimals) {
+		*ptr++ = '.';
+		nsec = timestamp->nsec;
+		for (unsigned i = decimals; i < 9; ++i)
+			nsec /= 10;
+		for (unsigned i = decimals; i; --i, nsec /= 10)
+			ptr[i - 1] = '0' + nsec % 10;
+		ptr += decimals;
+	}
+	*ptr = '\0';
+	return buf;
+}
+
+char *xtFormatTimeNow(char *buf, size_t buflen, unsigned decimals)
+{
+	static __thread struct xtFormatTimeCache cache;
+	struct xtTimestamp now;
+	if (xtClockGetTime(&now, XT_CLOCK_REALTIME_COARSE))
+		return NULL;
+	return xtFormatTimeCached(buf, buflen, &cache, &now, decimals);
+}
+
 char *xtFormatTimePrecise(char *buf, size_t buflen, const struct xtTimestamp *timestamp)
 {
 	if (!xtFormatTime(buf, buflen, timestamp->sec))
@@ -1,8 +1,115 @@
 /* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
 
 // XT headers
+#include <xt/os_macros.h>
 #include <xt/time.h>
 
+// System headers
+#if (XT_IS_X64 || XT_IS_X86) && defined(__GNUC__)
+	#define XT_HAS_TSC 1
+	#include <cpuid.h>
+	#include <x86intrin.h>
+#endif
+
+/*
+ * Cycle counter. On x86 the time stamp counter is used if the CPU reports it
+ * as invariant, which means that it ticks at a constant rate regardless of
+ * frequency scaling and sleep states. Otherwise the cycles are simply the
+ * nanoseconds of XT_CLOCK_MONOTONIC.
+ */
+#define CYCLES_UNKNOWN   0
+#define CYCLES_RDTSCP    1
+#define CYCLES_RDTSC     2
+#define CYCLES_MONOTONIC 3
+
+#define CYCLES_CALIBRATE_NS 10000000LLU
+
+static int cycles_source;
+/** Nanoseconds per cycle, zero if not calibrated yet. */
+static double cycles_scale;
+
+static int cycles_detect(void)
+{
+#if XT_HAS_TSC
+	unsigned eax, ebx, ecx, edx;
+	if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+		return CYCLES_MONOTONIC;
+	// CPUID.80000007H:EDX[8] is the invariant TSC flag
+	__cpuid(0x80000007, eax, ebx, ecx, edx);
+	if (!(edx & (1U << 8)))
+		return CYCLES_MONOTONIC;
+	// CPUID.80000001H:EDX[27] indicates whether RDTSCP is available
+	__cpuid(0x80000001, eax, ebx, ecx, edx);
+	return edx & (1U << 27) ? CYCLES_RDTSCP : CYCLES_RDTSC;
+#else
+	return CYCLES_MONOTONIC;
+#endif
+}
+
+static int cycles_get_source(void)
+{
+	int source = __atomic_load_n(&cycles_source, __ATOMIC_RELAXED);
+	if (source == CYCLES_UNKNOWN) {
+		source = cycles_detect();
+		__atomic_store_n(&cycles_source, source, __ATOMIC_RELAXED);
+	}
+	return source;
+}
+
+unsigned long long xtCycles(void)
+{
+	struct xtTimestamp now;
+	switch (cycles_get_source()) {
+#if XT_HAS_TSC
+	case CYCLES_RDTSCP: {
+		unsigned aux;
+		return __rdtscp(&aux);
+	}
+	case CYCLES_RDTSC:
+		// Prevent the read from being executed ahead of time
+		__asm__ __volatile__("lfence" ::: "memory");
+		return __rdtsc();
+#endif
+	default:
+		xtClockGetTime(&now, XT_CLOCK_MONOTONIC);
+		return now.sec * 1000000000LLU + now.nsec;
+	}
+}
+
+static double cycles_calibrate(void)
+{
+	struct xtTimestamp start, now, diff;
+	unsigned long long begin, end, ns;
+	if (cycles_get_source() == CYCLES_MONOTONIC)
+		return 1.0;
+	// Busy wait, because sleeping may put the core in a deep sleep state
+	xtClockGetTime(&start, XT_CLOCK_MONOTONIC);
+	begin = xtCycles();
+	do {
+		xtClockGetTime(&now, XT_CLOCK_MONOTONIC);
+		xtTimestampDiff(&diff, &start, &now);
+		ns = diff.sec * 1000000000LLU + diff.nsec;
+	} while (ns < CYCLES_CALIBRATE_NS);
+	end = xtCycles();
+	return end > begin ? (double)ns / (end - begin) : 1.0;
+}
+
+unsigned long long xtCyclesToNs(unsigned long long cycles)
+{
+	double scale;
+	__atomic_load(&cycles_scale, &scale, __ATOMIC_RELAXED);
+	if (scale == 0) {
+		scale = cycles_calibrate();
+		__atomic_store(&cycles_scale, &scale, __ATOMIC_RELAXED);
+	}
+	return cycles * scale;
+}
+
+bool xtCyclesIsTSC(void)
+{
+	return cycles_get_source() != CYCLES_MONOTONIC;
+}
+
 int _xtClockGetTimeNow(struct xtTimestamp *timestamp)
 {
 	int gmtOffset, ret;
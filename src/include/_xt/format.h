@@ -0,0 +1,45 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+/**
+ * @brief Internal hooks for compiled formats.
+ *
+ * @file format.h
+ * @author Folkert van Verseveld
+ * @date 2018
+ * @copyright LGPL v3.0.
+ */
+
+#ifndef __XT_FORMAT_H
+#define __XT_FORMAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// XT headers
+#include <xt/string.h>
+
+// STD headers
+#include <stdarg.h>
+#include <stddef.h>
+
+/**
+ * Fetches all arguments for \a fmt from \a ap so they can be rendered later
+ * on with xtFormatRenderArgs().
+ * @param args - Receives xtFormatGetArgCount() arguments.
+ * @return The number of bytes needed to copy all narrow strings, including
+ * their null terminators.
+ */
+size_t _xtFormatFetch(const struct xtFormat *fmt, union xtFormatArg *args, va_list ap);
+/**
+ * Copies all narrow strings in \a args to \a strings and points the arguments
+ * to their copies, so the original strings are no longer needed.
+ * @param strings - Buffer of the size returned by _xtFormatFetch().
+ */
+void _xtFormatCopyStrings(const struct xtFormat *fmt, union xtFormatArg *args, char *strings);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
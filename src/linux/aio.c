@@ -0,0 +1,1305 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#define _GNU_SOURCE // fdatasync, openat and accept4
+
+// XT headers
+#include <xt/aio.h>
+#include <_xt/error.h>
+#include <xt/error.h>
+#include <xt/thread.h>
+
+// System headers
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// STD headers
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__has_include)
+	#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+		#include <linux/io_uring.h>
+		#define AIO_HAS_URING 1
+		// Headers of Linux 6.1 and up know zero-copy sends and buffer rings
+		#ifdef IORING_SETUP_DEFER_TASKRUN
+			#define AIO_HAS_URING_NET 1
+		#endif
+	#endif
+#endif
+
+#define AIO_DEFAULT_THREADS 4
+// The largest transfer that read() and write() perform at once
+#define AIO_MAX_RW 0x7ffff000
+// The most buffers of one buffer ring and the largest buffer ring id
+#define AIO_MAX_BUFFERS 32768
+#define AIO_MAX_GROUP 0xffff
+// The most socket events that the thread pool handles per epoll_wait
+#define AIO_NET_EVENTS 64
+// The most completions of one socket before other sockets get their turn
+#define AIO_NET_BUDGET 16
+
+static bool aio_is_net(enum xtAIOOp op)
+{
+	return op >= XT_AIO_ACCEPT;
+}
+
+/*
+A buffer ring. io_uring picks the buffers from a ring that is shared with the
+kernel, while the thread pool emulates it with a stack of free buffers.
+*/
+struct group {
+	unsigned id, count;
+	char *base;
+	size_t size;
+#if AIO_HAS_URING_NET
+	struct io_uring_buf_ring *ring;
+	size_t ring_size;
+	unsigned mask;
+#endif
+	unsigned short *free;
+	unsigned nfree;
+};
+
+static struct group *group_find(struct group *groups, unsigned ngroups, unsigned id)
+{
+	for (unsigned i = 0; i < ngroups; ++i)
+		if (groups[i].id == id)
+			return &groups[i];
+	return NULL;
+}
+
+static struct group *group_add(struct group **groups, unsigned *ngroups, unsigned id)
+{
+	struct group *g;
+	if (!(g = realloc(*groups, (*ngroups + 1) * sizeof *g)))
+		return NULL;
+	*groups = g;
+	g += (*ngroups)++;
+	memset(g, 0, sizeof *g);
+	g->id = id;
+	return g;
+}
+
+static void group_remove(struct group *groups, unsigned *ngroups, struct group *g)
+{
+	free(g->free);
+	*g = groups[--*ngroups];
+}
+
+#if AIO_HAS_URING
+
+/*
+The rings are shared with the kernel. The kernel advances the head of the
+submission ring and the tail of the completion ring, so these are loaded with
+acquire semantics and our own tail and head are stored with release semantics.
+*/
+struct uring {
+	int fd;
+	unsigned *sq_head, *sq_tail, sq_mask, sq_entries, sq_local;
+	struct io_uring_sqe *sqes;
+	unsigned *cq_head, *cq_tail, cq_mask, cq_entries;
+	struct io_uring_cqe *cqes;
+	void *sq_ring, *cq_ring;
+	size_t sq_size, cq_size;
+	unsigned inflight;
+	// Whether sockets are supported, see uring_probe
+	bool network, sendmsg_zc;
+	struct group *groups;
+	unsigned ngroups;
+	unsigned long long syscalls;
+};
+
+static int uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_enter(int fd, unsigned submit, unsigned complete, unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, submit, complete, flags, NULL, 0);
+}
+
+static int uring_register(int fd, unsigned op, const void *arg, unsigned count)
+{
+	return syscall(__NR_io_uring_register, fd, op, arg, count);
+}
+
+#if AIO_HAS_URING_NET
+/*
+Multishot receives and zero-copy sends are only known by the opcodes that were
+added with them, so SEND_ZC implies Linux 6.0.
+*/
+static void uring_probe(struct uring *r)
+{
+	struct io_uring_probe *probe;
+	if (!(probe = calloc(1, sizeof *probe + 256 * sizeof *probe->ops)))
+		return;
+	if (uring_register(r->fd, IORING_REGISTER_PROBE, probe, 256) != -1) {
+		r->network = probe->last_op >= IORING_OP_SEND_ZC && probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED;
+		r->sendmsg_zc = probe->last_op >= IORING_OP_SENDMSG_ZC && probe->ops[IORING_OP_SENDMSG_ZC].flags & IO_URING_OP_SUPPORTED;
+	}
+	free(probe);
+}
+
+static void uring_group_put(struct group *g, unsigned id)
+{
+	unsigned short tail = g->ring->tail;
+	struct io_uring_buf *buf = &g->ring->bufs[tail & g->mask];
+	// The last field of the first buffer is the tail, so it is left alone
+	buf->addr = (uintptr_t)(g->base + id * g->size);
+	buf->len = g->size;
+	buf->bid = id;
+	__atomic_store_n(&g->ring->tail, (unsigned short)(tail + 1), __ATOMIC_RELEASE);
+}
+
+static void uring_group_free(struct uring *r, struct group *g)
+{
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof reg);
+	reg.bgid = g->id;
+	uring_register(r->fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+	munmap(g->ring, g->ring_size);
+	group_remove(r->groups, &r->ngroups, g);
+}
+
+static int uring_register_group(struct uring *r, unsigned id, void *base, size_t size, unsigned count)
+{
+	struct io_uring_buf_reg reg;
+	struct group *g;
+	unsigned entries = 1;
+	int err;
+	if ((g = group_find(r->groups, r->ngroups, id)))
+		uring_group_free(r, g);
+	if (!count)
+		return 0;
+	if (!(g = group_add(&r->groups, &r->ngroups, id)))
+		return XT_ENOMEM;
+	// The ring must be a power of two
+	while (entries < count)
+		entries <<= 1;
+	g->ring_size = entries * sizeof(struct io_uring_buf);
+	g->ring = mmap(NULL, g->ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (g->ring == MAP_FAILED) {
+		err = _xtTranslateSysError(errno);
+		group_remove(r->groups, &r->ngroups, g);
+		return err;
+	}
+	memset(&reg, 0, sizeof reg);
+	reg.ring_addr = (uintptr_t)g->ring;
+	reg.ring_entries = entries;
+	reg.bgid = id;
+	if (uring_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) == -1) {
+		err = _xtTranslateSysError(errno);
+		munmap(g->ring, g->ring_size);
+		group_remove(r->groups, &r->ngroups, g);
+		return err;
+	}
+	g->mask = entries - 1;
+	g->base = base;
+	g->size = size;
+	g->count = count;
+	for (unsigned i = 0; i < count; ++i)
+		uring_group_put(g, i);
+	return 0;
+}
+#endif
+
+static void uring_free(struct uring *r)
+{
+#if AIO_HAS_URING_NET
+	while (r->ngroups)
+		uring_group_free(r, &r->groups[r->ngroups - 1]);
+#endif
+	free(r->groups);
+	if (r->sqes)
+		munmap(r->sqes, r->sq_entries * sizeof *r->sqes);
+	if (r->cq_ring && r->cq_ring != r->sq_ring)
+		munmap(r->cq_ring, r->cq_size);
+	if (r->sq_ring)
+		munmap(r->sq_ring, r->sq_size);
+	close(r->fd);
+	free(r);
+}
+
+static int uring_create(struct xtAIO *aio, unsigned entries, unsigned flags)
+{
+	struct io_uring_params p;
+	struct uring *r;
+	char *sq, *cq;
+	int err;
+	if (!(r = calloc(1, sizeof *r)))
+		return XT_ENOMEM;
+	memset(&p, 0, sizeof p);
+	if ((r->fd = uring_setup(entries, &p)) == -1) {
+		err = _xtTranslateSysError(errno);
+		free(r);
+		return err;
+	}
+	// Plain reads, writes, openat and close need at least Linux 5.6
+	if (!(p.features & IORING_FEAT_RW_CUR_POS)) {
+		err = XT_EOPNOTSUPP;
+		goto fail;
+	}
+#if AIO_HAS_URING_NET
+	uring_probe(r);
+#endif
+	if (flags & XT_AIO_NETWORK && !r->network) {
+		err = XT_EOPNOTSUPP;
+		goto fail;
+	}
+	r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP && r->cq_size > r->sq_size)
+		r->sq_size = r->cq_size;
+	r->sq_ring = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_ring == MAP_FAILED) {
+		r->sq_ring = NULL;
+		goto fail_errno;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		r->cq_ring = r->sq_ring;
+	else if ((r->cq_ring = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING)) == MAP_FAILED) {
+		r->cq_ring = NULL;
+		goto fail_errno;
+	}
+	r->sqes = mmap(NULL, p.sq_entries * sizeof *r->sqes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) {
+		r->sqes = NULL;
+		goto fail_errno;
+	}
+	sq = r->sq_ring;
+	cq = r->cq_ring;
+	r->sq_head = (unsigned*)(sq + p.sq_off.head);
+	r->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+	r->sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+	r->sq_entries = p.sq_entries;
+	r->sq_local = *r->sq_tail;
+	r->cq_head = (unsigned*)(cq + p.cq_off.head);
+	r->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+	r->cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+	r->cq_entries = p.cq_entries;
+	r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+	// Every slot refers to the entry with the same index
+	for (unsigned i = 0; i < p.sq_entries; ++i)
+		((unsigned*)(sq + p.sq_off.array))[i] = i;
+	aio->backend = XT_AIO_BACKEND_URING;
+	aio->impl = r;
+	return 0;
+fail_errno:
+	err = _xtTranslateSysError(errno);
+fail:
+	uring_free(r);
+	return err;
+}
+
+static void uring_prep(const struct uring *r, struct io_uring_sqe *sqe, const struct xtAIORequest *req)
+{
+	size_t len = req->len < AIO_MAX_RW ? req->len : AIO_MAX_RW;
+	memset(sqe, 0, sizeof *sqe);
+	sqe->fd = req->fd;
+	sqe->user_data = (uintptr_t)req->userData;
+	if (req->flags & XT_AIO_FIXED_FILE)
+		sqe->flags |= IOSQE_FIXED_FILE;
+	switch (req->op) {
+	case XT_AIO_READ:
+	case XT_AIO_WRITE:
+		if (req->flags & XT_AIO_FIXED_BUFFER) {
+			sqe->opcode = req->op == XT_AIO_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+			sqe->buf_index = req->bufIndex;
+		} else
+			sqe->opcode = req->op == XT_AIO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+		sqe->addr = (uintptr_t)req->buf;
+		sqe->len = len;
+		sqe->off = req->offset;
+		break;
+	case XT_AIO_FSYNC:
+		sqe->opcode = IORING_OP_FSYNC;
+		if (req->flags & XT_AIO_DATASYNC)
+			sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+		break;
+	case XT_AIO_OPENAT:
+		sqe->opcode = IORING_OP_OPENAT;
+		sqe->addr = (uintptr_t)req->path;
+		sqe->len = req->mode;
+		sqe->open_flags = req->openFlags;
+		break;
+	case XT_AIO_CLOSE:
+		sqe->opcode = IORING_OP_CLOSE;
+		break;
+#if AIO_HAS_URING_NET
+	case XT_AIO_ACCEPT:
+		sqe->opcode = IORING_OP_ACCEPT;
+		sqe->accept_flags = SOCK_CLOEXEC;
+		if (req->flags & XT_AIO_MULTISHOT)
+			sqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+		break;
+	case XT_AIO_RECV:
+		sqe->opcode = IORING_OP_RECV;
+		sqe->len = len;
+		if (req->flags & XT_AIO_BUFFER_SELECT) {
+			sqe->flags |= IOSQE_BUFFER_SELECT;
+			sqe->buf_group = req->bufGroup;
+		} else
+			sqe->addr = (uintptr_t)req->buf;
+		if (req->flags & XT_AIO_MULTISHOT)
+			sqe->ioprio |= IORING_RECV_MULTISHOT;
+		break;
+	case XT_AIO_SEND:
+		sqe->opcode = req->flags & XT_AIO_ZEROCOPY ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+		sqe->addr = (uintptr_t)req->buf;
+		sqe->len = len;
+		sqe->msg_flags = MSG_NOSIGNAL;
+		break;
+	case XT_AIO_SENDMSG:
+		sqe->opcode = req->flags & XT_AIO_ZEROCOPY && r->sendmsg_zc ? IORING_OP_SENDMSG_ZC : IORING_OP_SENDMSG;
+		sqe->addr = (uintptr_t)req->msg;
+		sqe->len = 1;
+		sqe->msg_flags = MSG_NOSIGNAL;
+		break;
+	case XT_AIO_CANCEL:
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->flags &= ~IOSQE_FIXED_FILE;
+		if (req->fd == -1)
+			sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+		else
+			sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+		if (req->flags & XT_AIO_FIXED_FILE)
+			sqe->cancel_flags |= IORING_ASYNC_CANCEL_FD_FIXED;
+		break;
+#endif
+	default:
+		sqe->opcode = IORING_OP_NOP;
+		break;
+	}
+}
+
+/* Passes all entries that the kernel has not consumed yet. */
+static int uring_flush(struct uring *r, unsigned complete, unsigned flags)
+{
+	unsigned submit = r->sq_local - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+	if (!submit && !complete)
+		return 0;
+	while (++r->syscalls, uring_enter(r->fd, submit, complete, flags) == -1) {
+		// The caller takes back the entries that have not been consumed
+		if (errno == EAGAIN || errno == EBUSY)
+			return complete ? XT_EAGAIN : 0;
+		if (errno != EINTR)
+			return _xtTranslateSysError(errno);
+	}
+	return 0;
+}
+
+/*
+Publishes the last \a count prepared entries and lets the kernel consume them.
+Without SQPOLL the kernel only reads the ring during io_uring_enter, so the
+entries that it has not consumed are taken back and only the consumed ones
+are in flight.
+*/
+static int uring_push(struct uring *r, unsigned count, unsigned *pushed)
+{
+	unsigned first = r->sq_local - count, consumed;
+	int ret;
+	__atomic_store_n(r->sq_tail, r->sq_local, __ATOMIC_RELEASE);
+	ret = uring_flush(r, 0, 0);
+	consumed = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) - first;
+	if (consumed < count) {
+		r->sq_local = first + consumed;
+		__atomic_store_n(r->sq_tail, r->sq_local, __ATOMIC_RELEASE);
+	} else
+		consumed = count;
+	r->inflight += consumed;
+	*pushed = consumed;
+	return consumed ? 0 : ret;
+}
+
+static int uring_submit(struct uring *r, const struct xtAIORequest *reqs, unsigned count, unsigned *submitted)
+{
+	unsigned space = r->sq_entries - (r->sq_local - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE));
+	// The completion ring must have room for every request in flight
+	if (space > r->cq_entries - r->inflight)
+		space = r->cq_entries - r->inflight;
+	if (count > space)
+		count = space;
+	for (unsigned i = 0; i < count; ++i)
+		uring_prep(r, &r->sqes[r->sq_local++ & r->sq_mask], &reqs[i]);
+	return uring_push(r, count, submitted);
+}
+
+/* Cancels all requests, including the multishot requests that never finish by themselves. */
+static void uring_cancel_all(struct uring *r)
+{
+	struct xtAIORequest req;
+	unsigned pushed;
+	if (!r->network)
+		return;
+	// The completion ring cannot overflow, so only the submission ring needs room
+	while (r->sq_local - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) == r->sq_entries)
+		if (uring_flush(r, 0, 0))
+			return;
+	memset(&req, 0, sizeof req);
+	req.op = XT_AIO_CANCEL;
+	req.fd = -1;
+	uring_prep(r, &r->sqes[r->sq_local++ & r->sq_mask], &req);
+	uring_push(r, 1, &pushed);
+}
+
+static unsigned uring_reap(struct uring *r, struct xtAIOCompletion *cqes, unsigned max)
+{
+	unsigned head = *r->cq_head, tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE), n = 0, done = 0;
+	for (; head != tail && n < max; ++head, ++n) {
+		const struct io_uring_cqe *cqe = &r->cqes[head & r->cq_mask];
+		cqes[n].userData = (void*)(uintptr_t)cqe->user_data;
+		cqes[n].result = cqe->res < 0 ? 0 : cqe->res;
+		cqes[n].error = cqe->res < 0 ? _xtTranslateSysError(-cqe->res) : 0;
+		cqes[n].flags = 0;
+		cqes[n].bufId = 0;
+#if AIO_HAS_URING_NET
+		if (cqe->flags & IORING_CQE_F_BUFFER) {
+			cqes[n].flags |= XT_AIO_CQE_BUFFER;
+			cqes[n].bufId = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+		}
+		if (cqe->flags & IORING_CQE_F_NOTIF)
+			cqes[n].flags |= XT_AIO_CQE_NOTIFY;
+		// Only the last completion of a request finishes it
+		if (cqe->flags & IORING_CQE_F_MORE)
+			cqes[n].flags |= XT_AIO_CQE_MORE;
+		else
+#endif
+			++done;
+	}
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+	r->inflight -= done;
+	return n;
+}
+
+static int uring_wait(struct uring *r, struct xtAIOCompletion *cqes, unsigned max, unsigned min, unsigned *count)
+{
+	unsigned n = uring_reap(r, cqes, max);
+	int ret = 0;
+	while (n < min) {
+		if ((ret = uring_flush(r, min - n, IORING_ENTER_GETEVENTS)) && ret != XT_EAGAIN)
+			break;
+		n += uring_reap(r, cqes + n, max - n);
+	}
+	*count = n;
+	return n < min ? ret : uring_flush(r, 0, 0);
+}
+
+static int uring_register_buffers(struct uring *r, void *const *bufs, const size_t *lens, unsigned count)
+{
+	struct iovec *iov;
+	int ret = 0;
+	uring_register(r->fd, IORING_UNREGISTER_BUFFERS, NULL, 0);
+	if (!count)
+		return 0;
+	if (!(iov = malloc(count * sizeof *iov)))
+		return XT_ENOMEM;
+	for (unsigned i = 0; i < count; ++i) {
+		iov[i].iov_base = bufs[i];
+		iov[i].iov_len = lens[i];
+	}
+	if (uring_register(r->fd, IORING_REGISTER_BUFFERS, iov, count) == -1)
+		ret = _xtTranslateSysError(errno);
+	free(iov);
+	return ret;
+}
+
+static int uring_register_files(struct uring *r, const int *fds, unsigned count)
+{
+	uring_register(r->fd, IORING_UNREGISTER_FILES, NULL, 0);
+	if (count && uring_register(r->fd, IORING_REGISTER_FILES, fds, count) == -1)
+		return _xtTranslateSysError(errno);
+	return 0;
+}
+
+static int uring_recycle(struct uring *r, unsigned id, unsigned bufId)
+{
+#if AIO_HAS_URING_NET
+	struct group *g = group_find(r->groups, r->ngroups, id);
+	if (!g || bufId >= g->count)
+		return XT_EINVAL;
+	uring_group_put(g, bufId);
+	return 0;
+#else
+	(void)r;
+	(void)id;
+	(void)bufId;
+	return XT_EOPNOTSUPP;
+#endif
+}
+
+#endif
+
+/*
+Fallback that performs the requests with blocking system calls. The requests
+are kept in a circular queue that is as large as the maximum number of requests
+in flight. The completion queue is twice as large, so multishot requests can
+post that many completions before they have to be submitted again.
+
+Socket requests are not handed to the workers, as they would block them for as
+long as the peer is silent. A thread of its own queues them per socket instead
+and performs them as soon as epoll reports the socket to be ready.
+*/
+struct net_req {
+	struct xtAIORequest req;
+	struct net_req *next;
+};
+
+/* The queues of one socket, one for reading and one for writing */
+struct net_fd {
+	struct net_req *head[2], *tail[2];
+	unsigned armed;
+	bool added;
+};
+
+struct pool {
+	pthread_mutex_t lock;
+	pthread_cond_t work, done;
+	unsigned entries, inflight;
+	struct xtAIORequest *sq;
+	unsigned sq_head, sq_count;
+	struct xtAIOCompletion *cq;
+	unsigned cq_size, cq_head, cq_count, cq_more;
+	int *files;
+	unsigned nfiles, nbufs;
+	struct group *groups;
+	unsigned ngroups;
+	unsigned long long syscalls;
+	// The socket requests that the net thread has not picked up yet
+	struct net_req *nq, **nq_tail;
+	bool net_started, net_cancel;
+	int ep, efd;
+	struct net_fd *fds;
+	unsigned nfds;
+	struct xtThread net;
+	bool stop;
+	unsigned nthreads;
+	struct xtThread threads[];
+};
+
+static void pool_count(struct pool *p, unsigned n)
+{
+	__atomic_add_fetch(&p->syscalls, n, __ATOMIC_RELAXED);
+}
+
+static long long pool_run(const struct xtAIORequest *req, int fd)
+{
+	switch (req->op) {
+	case XT_AIO_READ  : return pread(fd, req->buf, req->len < AIO_MAX_RW ? req->len : AIO_MAX_RW, req->offset);
+	case XT_AIO_WRITE : return pwrite(fd, req->buf, req->len < AIO_MAX_RW ? req->len : AIO_MAX_RW, req->offset);
+	case XT_AIO_FSYNC : return req->flags & XT_AIO_DATASYNC ? fdatasync(fd) : fsync(fd);
+	case XT_AIO_OPENAT: return openat(fd == XT_AIO_CWD ? AT_FDCWD : fd, req->path, req->openFlags, req->mode);
+	case XT_AIO_CLOSE : return close(fd);
+	default           : return 0;
+	}
+}
+
+static void pool_complete(struct pool *p, const struct xtAIORequest *req, struct xtAIOCompletion *cqe)
+{
+	long long ret;
+	int fd = req->fd;
+	memset(cqe, 0, sizeof *cqe);
+	cqe->userData = req->userData;
+	if (req->flags & XT_AIO_FIXED_FILE) {
+		if (req->op == XT_AIO_CLOSE || fd < 0 || (unsigned)fd >= p->nfiles) {
+			cqe->error = XT_EBADF;
+			return;
+		}
+		fd = p->files[fd];
+	}
+	if (req->flags & XT_AIO_FIXED_BUFFER && req->bufIndex >= p->nbufs) {
+		cqe->error = XT_EFAULT;
+		return;
+	}
+	while (pool_count(p, 1), (ret = pool_run(req, fd)) == -1 && errno == EINTR && req->op != XT_AIO_CLOSE)
+		;
+	if (ret == -1)
+		cqe->error = _xtTranslateSysError(errno);
+	else
+		cqe->result = ret;
+}
+
+/* Must be called with the lock held. */
+static void pool_push(struct pool *p, const struct xtAIOCompletion *cqe)
+{
+	p->cq[(p->cq_head + p->cq_count++) % p->cq_size] = *cqe;
+	pthread_cond_broadcast(&p->done);
+}
+
+static void *pool_worker(struct xtThread *t, void *arg)
+{
+	struct pool *p = arg;
+	struct xtAIORequest req;
+	struct xtAIOCompletion cqe;
+	(void)t;
+	pthread_mutex_lock(&p->lock);
+	while (true) {
+		while (!p->sq_count && !p->stop)
+			pthread_cond_wait(&p->work, &p->lock);
+		if (!p->sq_count)
+			break;
+		req = p->sq[p->sq_head];
+		p->sq_head = (p->sq_head + 1) % p->entries;
+		--p->sq_count;
+		pthread_mutex_unlock(&p->lock);
+		pool_complete(p, &req, &cqe);
+		pthread_mutex_lock(&p->lock);
+		pool_push(p, &cqe);
+	}
+	pthread_mutex_unlock(&p->lock);
+	return NULL;
+}
+
+/*
+Posts a completion of a socket request and returns whether the request goes
+on. A multishot request only goes on while every request in flight still has
+room for its last completion, otherwise it ends like it does in io_uring.
+*/
+static bool net_complete(struct pool *p, struct xtAIOCompletion *cqe)
+{
+	bool more;
+	pthread_mutex_lock(&p->lock);
+	more = (cqe->flags & XT_AIO_CQE_MORE) && p->cq_more + p->inflight < p->cq_size;
+	if (more)
+		++p->cq_more;
+	else
+		cqe->flags &= ~XT_AIO_CQE_MORE;
+	pool_push(p, cqe);
+	pthread_mutex_unlock(&p->lock);
+	return more;
+}
+
+static void net_finish(struct pool *p, const struct xtAIORequest *req, long long result, int error)
+{
+	struct xtAIOCompletion cqe;
+	memset(&cqe, 0, sizeof cqe);
+	cqe.userData = req->userData;
+	cqe.result = result;
+	cqe.error = error;
+	net_complete(p, &cqe);
+}
+
+/* Completes all queued requests of \a fd with \a error and returns their number. */
+static unsigned net_fail(struct pool *p, int fd, int error)
+{
+	struct net_fd *f = &p->fds[fd];
+	unsigned n = 0;
+	for (unsigned dir = 0; dir < 2; ++dir)
+		while (f->head[dir]) {
+			struct net_req *nr = f->head[dir];
+			f->head[dir] = nr->next;
+			net_finish(p, &nr->req, 0, error);
+			free(nr);
+			++n;
+		}
+	return n;
+}
+
+static unsigned net_cancel(struct pool *p, int fd)
+{
+	unsigned n = 0;
+	if (fd != -1)
+		return (unsigned)fd < p->nfds ? net_fail(p, fd, XT_ECANCELED) : 0;
+	for (unsigned i = 0; i < p->nfds; ++i)
+		n += net_fail(p, i, XT_ECANCELED);
+	return n;
+}
+
+/*
+Performs a socket request once without blocking. Returns false if the socket
+is not ready yet, otherwise the completion is filled in.
+*/
+static bool net_step(struct pool *p, const struct xtAIORequest *req, struct xtAIOCompletion *cqe)
+{
+	size_t len = req->len < AIO_MAX_RW ? req->len : AIO_MAX_RW;
+	struct group *g = NULL;
+	char *buf = req->buf;
+	unsigned id = 0;
+	ssize_t ret;
+	memset(cqe, 0, sizeof *cqe);
+	cqe->userData = req->userData;
+	if (req->flags & XT_AIO_BUFFER_SELECT) {
+		pthread_mutex_lock(&p->lock);
+		if ((g = group_find(p->groups, p->ngroups, req->bufGroup)) && g->nfree)
+			id = g->free[--g->nfree];
+		else
+			g = NULL;
+		pthread_mutex_unlock(&p->lock);
+		if (!g) {
+			cqe->error = XT_ENOBUFS;
+			return true;
+		}
+		buf = g->base + id * g->size;
+		if (!len || len > g->size)
+			len = g->size;
+	}
+	do {
+		pool_count(p, 1);
+		switch (req->op) {
+		case XT_AIO_ACCEPT: ret = accept4(req->fd, NULL, NULL, SOCK_CLOEXEC); break;
+		case XT_AIO_RECV  : ret = recv(req->fd, buf, len, MSG_DONTWAIT); break;
+		case XT_AIO_SEND  : ret = send(req->fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL); break;
+		default           : ret = sendmsg(req->fd, req->msg, MSG_DONTWAIT | MSG_NOSIGNAL); break;
+		}
+	} while (ret == -1 && errno == EINTR);
+	// The buffer is only kept if data has arrived
+	if (g && ret <= 0) {
+		pthread_mutex_lock(&p->lock);
+		g->free[g->nfree++] = id;
+		pthread_mutex_unlock(&p->lock);
+		g = NULL;
+	}
+	if (ret == -1) {
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
+			return false;
+		cqe->error = _xtTranslateSysError(errno);
+		return true;
+	}
+	cqe->result = ret;
+	if (g) {
+		cqe->flags |= XT_AIO_CQE_BUFFER;
+		cqe->bufId = id;
+	}
+	// A multishot receive ends with the stream
+	if (req->flags & XT_AIO_MULTISHOT && (req->op == XT_AIO_ACCEPT || ret > 0))
+		cqe->flags |= XT_AIO_CQE_MORE;
+	return true;
+}
+
+/* Performs the queued requests of one direction until the socket is not ready. */
+static void net_run(struct pool *p, int fd, unsigned dir)
+{
+	struct net_fd *f = &p->fds[fd];
+	struct xtAIOCompletion cqe;
+	for (unsigned budget = AIO_NET_BUDGET; f->head[dir] && budget; --budget) {
+		struct net_req *nr = f->head[dir];
+		if (!net_step(p, &nr->req, &cqe))
+			return;
+		if (net_complete(p, &cqe))
+			continue;
+		f->head[dir] = nr->next;
+		free(nr);
+	}
+}
+
+/*
+Waits for the directions that have queued requests. The sockets are armed
+with EPOLLONESHOT, so an event disarms them until they are armed again. A
+closed descriptor leaves the epoll set, so a failed EPOLL_CTL_MOD is retried
+with EPOLL_CTL_ADD.
+*/
+static void net_arm(struct pool *p, int fd)
+{
+	struct net_fd *f = &p->fds[fd];
+	struct epoll_event ev;
+	unsigned events = (f->head[0] ? EPOLLIN : 0) | (f->head[1] ? EPOLLOUT : 0);
+	if (!events || events == f->armed)
+		return;
+	ev.events = events | EPOLLONESHOT;
+	ev.data.fd = fd;
+	pool_count(p, 1);
+	if (!f->added || epoll_ctl(p->ep, EPOLL_CTL_MOD, fd, &ev)) {
+		if (f->added)
+			pool_count(p, 1);
+		if (epoll_ctl(p->ep, EPOLL_CTL_ADD, fd, &ev)) {
+			net_fail(p, fd, _xtTranslateSysError(errno));
+			return;
+		}
+	}
+	f->added = true;
+	f->armed = events;
+}
+
+static void net_queue(struct pool *p, struct net_req *nr)
+{
+	struct xtAIORequest *req = &nr->req;
+	unsigned dir = req->op == XT_AIO_SEND || req->op == XT_AIO_SENDMSG;
+	struct net_fd *f;
+	int fd, error = 0, flags;
+	if (req->flags & XT_AIO_FIXED_FILE && req->fd != -1)
+		req->fd = req->fd >= 0 && (unsigned)req->fd < p->nfiles ? p->files[req->fd] : -2;
+	if (req->op == XT_AIO_CANCEL) {
+		unsigned n = net_cancel(p, req->fd);
+		net_finish(p, req, n, n ? 0 : XT_ENOENT);
+		free(nr);
+		return;
+	}
+	if (req->fd < 0)
+		error = XT_EBADF;
+	else if (req->op == XT_AIO_RECV && req->flags & XT_AIO_MULTISHOT && !(req->flags & XT_AIO_BUFFER_SELECT))
+		error = XT_EINVAL;
+	else if ((unsigned)req->fd >= p->nfds) {
+		unsigned n = p->nfds ? p->nfds : 64;
+		while (n <= (unsigned)req->fd)
+			n *= 2;
+		if (!(f = realloc(p->fds, n * sizeof *f))) {
+			error = XT_ENOMEM;
+		} else {
+			memset(f + p->nfds, 0, (n - p->nfds) * sizeof *f);
+			p->fds = f;
+			p->nfds = n;
+		}
+	}
+	if (error) {
+		net_finish(p, req, 0, error);
+		free(nr);
+		return;
+	}
+	// accept4 has no flag to not block, so the listening socket must not block
+	if (req->op == XT_AIO_ACCEPT) {
+		pool_count(p, 1);
+		if ((flags = fcntl(req->fd, F_GETFL)) != -1 && !(flags & O_NONBLOCK)) {
+			pool_count(p, 1);
+			fcntl(req->fd, F_SETFL, flags | O_NONBLOCK);
+		}
+	}
+	fd = req->fd;
+	f = &p->fds[fd];
+	nr->next = NULL;
+	if (f->head[dir]) {
+		f->tail[dir]->next = nr;
+		f->tail[dir] = nr;
+		return;
+	}
+	f->head[dir] = f->tail[dir] = nr;
+	// The socket is often ready already, which saves waiting for it
+	net_run(p, fd, dir);
+	net_arm(p, fd);
+}
+
+/* Picks up the new socket requests and returns whether the pool is stopping. */
+static bool net_drain(struct pool *p)
+{
+	struct net_req *nr, *next;
+	bool cancel, stop;
+	uint64_t value;
+	pool_count(p, 1);
+	if (read(p->efd, &value, sizeof value) == -1 && errno != EAGAIN)
+		return true;
+	pthread_mutex_lock(&p->lock);
+	nr = p->nq;
+	p->nq = NULL;
+	p->nq_tail = &p->nq;
+	cancel = p->net_cancel;
+	p->net_cancel = false;
+	stop = p->stop;
+	pthread_mutex_unlock(&p->lock);
+	for (; nr; nr = next) {
+		next = nr->next;
+		net_queue(p, nr);
+	}
+	if (cancel || stop)
+		net_cancel(p, -1);
+	return stop;
+}
+
+static void *pool_net(struct xtThread *t, void *arg)
+{
+	struct epoll_event events[AIO_NET_EVENTS];
+	struct pool *p = arg;
+	bool stop = false;
+	int n;
+	(void)t;
+	while (!stop) {
+		pool_count(p, 1);
+		if ((n = epoll_wait(p->ep, events, AIO_NET_EVENTS, -1)) == -1) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (int i = 0; i < n; ++i) {
+			int fd = events[i].data.fd;
+			if (fd == p->efd) {
+				stop = net_drain(p);
+				continue;
+			}
+			p->fds[fd].armed = 0;
+			if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+				net_run(p, fd, 0);
+			if (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+				net_run(p, fd, 1);
+			net_arm(p, fd);
+		}
+	}
+	return NULL;
+}
+
+/* Must be called with the lock held. */
+static void net_wake(struct pool *p)
+{
+	uint64_t value = 1;
+	pool_count(p, 1);
+	while (write(p->efd, &value, sizeof value) == -1 && errno == EINTR)
+		;
+}
+
+/* Must be called with the lock held. */
+static int net_start(struct pool *p)
+{
+	struct epoll_event ev;
+	int ret;
+	if ((p->ep = epoll_create1(EPOLL_CLOEXEC)) == -1)
+		return _xtTranslateSysError(errno);
+	if ((p->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1) {
+		ret = _xtTranslateSysError(errno);
+		goto close_ep;
+	}
+	ev.events = EPOLLIN;
+	ev.data.fd = p->efd;
+	if (epoll_ctl(p->ep, EPOLL_CTL_ADD, p->efd, &ev)) {
+		ret = _xtTranslateSysError(errno);
+		goto close_efd;
+	}
+	if ((ret = xtThreadCreate(&p->net, pool_net, p, 0, 0)))
+		goto close_efd;
+	p->net_started = true;
+	return 0;
+close_efd:
+	close(p->efd);
+close_ep:
+	close(p->ep);
+	return ret;
+}
+
+static void pool_free(struct pool *p)
+{
+	pthread_mutex_lock(&p->lock);
+	p->stop = true;
+	pthread_cond_broadcast(&p->work);
+	if (p->net_started)
+		net_wake(p);
+	pthread_mutex_unlock(&p->lock);
+	for (unsigned i = 0; i < p->nthreads; ++i)
+		xtThreadJoin(&p->threads[i], NULL);
+	if (p->net_started) {
+		xtThreadJoin(&p->net, NULL);
+		close(p->efd);
+		close(p->ep);
+	}
+	while (p->ngroups)
+		group_remove(p->groups, &p->ngroups, &p->groups[p->ngroups - 1]);
+	pthread_cond_destroy(&p->done);
+	pthread_cond_destroy(&p->work);
+	pthread_mutex_destroy(&p->lock);
+	free(p->groups);
+	free(p->fds);
+	free(p->files);
+	free(p->cq);
+	free(p->sq);
+	free(p);
+}
+
+static int pool_create(struct xtAIO *aio, unsigned entries, unsigned threads)
+{
+	struct pool *p;
+	int ret;
+	if (!threads)
+		threads = AIO_DEFAULT_THREADS;
+	if (!(p = calloc(1, sizeof *p + threads * sizeof *p->threads)))
+		return XT_ENOMEM;
+	p->entries = entries;
+	p->cq_size = 2 * entries;
+	p->sq = malloc(entries * sizeof *p->sq);
+	p->cq = malloc(p->cq_size * sizeof *p->cq);
+	if (!p->sq || !p->cq) {
+		free(p->cq);
+		free(p->sq);
+		free(p);
+		return XT_ENOMEM;
+	}
+	p->nq_tail = &p->nq;
+	pthread_mutex_init(&p->lock, NULL);
+	pthread_cond_init(&p->work, NULL);
+	pthread_cond_init(&p->done, NULL);
+	for (; p->nthreads < threads; ++p->nthreads)
+		if ((ret = xtThreadCreate(&p->threads[p->nthreads], pool_worker, p, 0, 0))) {
+			pool_free(p);
+			return ret;
+		}
+	aio->backend = XT_AIO_BACKEND_THREADS;
+	aio->impl = p;
+	return 0;
+}
+
+static int pool_submit(struct pool *p, const struct xtAIORequest *reqs, unsigned count, unsigned *submitted)
+{
+	unsigned i, work = 0;
+	bool wake = false;
+	int ret = 0;
+	pthread_mutex_lock(&p->lock);
+	if (count > p->entries - p->inflight)
+		count = p->entries - p->inflight;
+	for (i = 0; i < count; ++i) {
+		struct net_req *nr;
+		if (!aio_is_net(reqs[i].op)) {
+			p->sq[(p->sq_head + p->sq_count++) % p->entries] = reqs[i];
+			++work;
+			continue;
+		}
+		if (!p->net_started && (ret = net_start(p)))
+			break;
+		if (!(nr = malloc(sizeof *nr))) {
+			ret = XT_ENOMEM;
+			break;
+		}
+		nr->req = reqs[i];
+		nr->next = NULL;
+		*p->nq_tail = nr;
+		p->nq_tail = &nr->next;
+		wake = true;
+	}
+	p->inflight += i;
+	// Only wake as many workers as there are new requests
+	for (unsigned j = 0; j < work && j < p->nthreads; ++j)
+		pthread_cond_signal(&p->work);
+	if (wake)
+		net_wake(p);
+	pthread_mutex_unlock(&p->lock);
+	*submitted = i;
+	return i ? 0 : ret;
+}
+
+static void pool_cancel_all(struct pool *p)
+{
+	pthread_mutex_lock(&p->lock);
+	if (p->net_started) {
+		p->net_cancel = true;
+		net_wake(p);
+	}
+	pthread_mutex_unlock(&p->lock);
+}
+
+static int pool_wait(struct pool *p, struct xtAIOCompletion *cqes, unsigned max, unsigned min, unsigned *count)
+{
+	unsigned n = 0, done = 0;
+	pthread_mutex_lock(&p->lock);
+	while (p->cq_count < min)
+		pthread_cond_wait(&p->done, &p->lock);
+	for (; p->cq_count && n < max; ++n, --p->cq_count) {
+		cqes[n] = p->cq[p->cq_head];
+		p->cq_head = (p->cq_head + 1) % p->cq_size;
+		if (cqes[n].flags & XT_AIO_CQE_MORE)
+			--p->cq_more;
+		else
+			++done;
+	}
+	p->inflight -= done;
+	pthread_mutex_unlock(&p->lock);
+	*count = n;
+	return 0;
+}
+
+static int pool_register_group(struct pool *p, unsigned id, void *base, size_t size, unsigned count)
+{
+	struct group *g;
+	int ret = 0;
+	pthread_mutex_lock(&p->lock);
+	if ((g = group_find(p->groups, p->ngroups, id)))
+		group_remove(p->groups, &p->ngroups, g);
+	if (!count)
+		goto unlock;
+	if (!(g = group_add(&p->groups, &p->ngroups, id))) {
+		ret = XT_ENOMEM;
+		goto unlock;
+	}
+	if (!(g->free = malloc(count * sizeof *g->free))) {
+		group_remove(p->groups, &p->ngroups, g);
+		ret = XT_ENOMEM;
+		goto unlock;
+	}
+	g->base = base;
+	g->size = size;
+	g->count = count;
+	// The first buffer is on top, like in the ring
+	while (g->nfree < count) {
+		g->free[g->nfree] = count - 1 - g->nfree;
+		++g->nfree;
+	}
+unlock:
+	pthread_mutex_unlock(&p->lock);
+	return ret;
+}
+
+static int pool_recycle(struct pool *p, unsigned id, unsigned bufId)
+{
+	struct group *g;
+	int ret = 0;
+	pthread_mutex_lock(&p->lock);
+	if (!(g = group_find(p->groups, p->ngroups, id)) || bufId >= g->count || g->nfree == g->count)
+		ret = XT_EINVAL;
+	else
+		g->free[g->nfree++] = bufId;
+	pthread_mutex_unlock(&p->lock);
+	return ret;
+}
+
+int xtAIOCreate(struct xtAIO *aio, unsigned entries, unsigned threads, unsigned flags)
+{
+	if (!entries)
+		return XT_EINVAL;
+#if AIO_HAS_URING
+	// Fall back to the thread pool if io_uring is too old, disabled or not permitted
+	if (!(flags & XT_AIO_THREADS) && !uring_create(aio, entries, flags))
+		return 0;
+#else
+	(void)flags;
+#endif
+	return pool_create(aio, entries, threads);
+}
+
+void xtAIODestroy(struct xtAIO *aio)
+{
+	struct xtAIOCompletion cqes[32];
+	unsigned n;
+	// Multishot requests never finish by themselves
+#if AIO_HAS_URING
+	if (aio->backend == XT_AIO_BACKEND_URING)
+		uring_cancel_all(aio->impl);
+	else
+#endif
+		pool_cancel_all(aio->impl);
+	while (xtAIOPending(aio))
+		if (xtAIOWait(aio, cqes, 32, 1, &n))
+			break;
+#if AIO_HAS_URING
+	if (aio->backend == XT_AIO_BACKEND_URING) {
+		uring_free(aio->impl);
+		return;
+	}
+#endif
+	pool_free(aio->impl);
+}
+
+int xtAIORegisterBuffers(struct xtAIO *aio, void *const *bufs, const size_t *lens, unsigned count)
+{
+	struct pool *p;
+	if (xtAIOPending(aio))
+		return XT_EBUSY;
+#if AIO_HAS_URING
+	if (aio->backend == XT_AIO_BACKEND_URING)
+		return uring_register_buffers(aio->impl, bufs, lens, count);
+#endif
+	// The buffers are used as they are, only their count is validated
+	p = aio->impl;
+	p->nbufs = count;
+	return 0;
+}
+
+int xtAIORegisterFiles(struct xtAIO *aio, const int *fds, unsigned count)
+{
+	struct pool *p;
+	int *files = NULL;
+	if (xtAIOPending(aio))
+		return XT_EBUSY;
+#if AIO_HAS_URING
+	if (aio->backend == XT_AIO_BACKEND_URING)
+		return uring_register_files(aio->impl, fds, count);
+#endif
+	p = aio->impl;
+	if (count && !(files = malloc(count * sizeof *files)))
+		return XT_ENOMEM;
+	if (count)
+		memcpy(files, fds, count * sizeof *files);
+	free(p->files);
+	p->files = files;
+	p->nfiles = count;
+	return 0;
+}
+
+int xtAIORegisterBufferRing(struct xtAIO *aio, unsigned group, void *base, size_t size, unsigned count)
+{
+	if (group > AIO_MAX_GROUP || count > AIO_MAX_BUFFERS || (count && (!base || !size)))
+		return XT_EINVAL;
+	if (xtAIOPending(aio))
+		return XT_EBUSY;
+#if AIO_HAS_URING
+	if (aio->backend == XT_AIO_BACKEND_URING)
+	#if AIO_HAS_URING_NET
+		return uring_register_group(aio->impl, group, base, size, count);
+	#else
+		return XT_EOPNOTSUPP;
+	#endif
+#endif
+	return pool_register_group(aio->impl, group, base, size, count);
+}
+
+int xtAIORecycleBuffer(struct xtAIO *aio, unsigned group, unsigned bufId)
+{
+#if AIO_HAS_URING
+	if (aio->backend == XT_AIO_BACKEND_URING)
+		return uring_recycle(aio->impl, group, bufId);
+#endif
+	return pool_recycle(aio->impl, group, bufId);
+}
+
+int xtAIOSubmit(struct xtAIO *aio, const struct xtAIORequest *reqs, unsigned count, unsigned *submitted)
+{
+	int ret;
+	*submitted = 0;
+	for (unsigned i = 0; i < count; ++i) {
+		if ((unsigned)reqs[i].op > XT_AIO_CANCEL)
+			return XT_EINVAL;
+#if AIO_HAS_URING
+		// Without XT_AIO_NETWORK, io_uring may be too old for sockets
+		if (aio->backend == XT_AIO_BACKEND_URING && aio_is_net(reqs[i].op)
+			&& !((const struct uring*)aio->impl)->network)
+			return XT_EOPNOTSUPP;
+#endif
+	}
+#if AIO_HAS_URING
+	if (aio->backend == XT_AIO_BACKEND_URING)
+		ret = uring_submit(aio->impl, reqs, count, submitted);
+	else
+#endif
+		ret = pool_submit(aio->impl, reqs, count, submitted);
+	return !ret && count && !*submitted ? XT_EAGAIN : ret;
+}
+
+int xtAIOWait(struct xtAIO *aio, struct xtAIOCompletion *cqes, unsigned max, unsigned min, unsigned *count)
+{
+	unsigned pending = xtAIOPending(aio);
+	// Never wait for completions of requests that have not been submitted
+	if (min > pending)
+		min = pending;
+	if (min > max)
+		min = max;
+#if AIO_HAS_URING
+	if (aio->backend == XT_AIO_BACKEND_URING)
+		return uring_wait(aio->impl, cqes, max, min, count);
+#endif
+	return pool_wait(aio->impl, cqes, max, min, count);
+}
+
+unsigned xtAIOPending(const struct xtAIO *aio)
+{
+	struct pool *p;
+	unsigned n;
+#if AIO_HAS_URING
+	if (aio->backend == XT_AIO_BACKEND_URING)
+		return ((const struct uring*)aio->impl)->inflight;
+#endif
+	p = aio->impl;
+	pthread_mutex_lock(&p->lock);
+	n = p->inflight;
+	pthread_mutex_unlock(&p->lock);
+	return n;
+}
+
+unsigned long long xtAIOGetSyscalls(const struct xtAIO *aio)
+{
+#if AIO_HAS_URING
+	if (aio->backend == XT_AIO_BACKEND_URING)
+		return ((const struct uring*)aio->impl)->syscalls;
+#endif
+	return __atomic_load_n(&((const struct pool*)aio->impl)->syscalls, __ATOMIC_RELAXED);
+}
@@ -64,7 +64,8 @@ static const xtErrorMap errorMap[] = {
 	{ "No space left on device", XT_ENOSPC },
 	{ "Socket operation on non-socket", XT_ENOTSOCK },
 	{ "Cross-device link", XT_EXDEV },
-	{ "Unknown error", XT_EUNKNOWN }
+	{ "Unknown error", XT_EUNKNOWN },
+	{ "Operation canceled", XT_ECANCELED }
 };
 
 int _xtTranslateSysError(int syserrnum)
@@ -79,6 +80,7 @@ int _xtTranslateSysError(int syserrnum)
 	case EBADFD:
 	case EBADF:                          return XT_EBADF;
 	case EBUSY:                          return XT_EBUSY;
+	case ECANCELED:                      return XT_ECANCELED;
 	case EINTR:                          return XT_EINTR;
 	case ECONNABORTED:                   return XT_ECONNABORTED;
 	case ECONNREFUSED:                   return XT_ECONNREFUSED;
@@ -0,0 +1,784 @@
+/* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
+
+#define _GNU_SOURCE // accept4
+
+// XT headers
+#include <xt/eventloop.h>
+#include <_xt/error.h>
+#include <xt/error.h>
+#include <xt/pool.h>
+#include <xt/thread.h>
+#include <xt/time.h>
+
+// System headers
+#include <errno.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// STD headers
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The number of slots of the timer wheel, which must be a power of two */
+#define WHEEL_SLOTS 512
+/* The maximum number of connections that are accepted per wakeup */
+#define ACCEPT_BATCH 64
+/* Room in the poll for the eventfd and the listening sockets */
+#define POLL_RESERVED 64
+
+/*
+Everything that is registered in the poll of a reactor starts with a handle,
+which tells the reactor what is ready.
+*/
+enum handle_kind {
+	HANDLE_WAKE,
+	HANDLE_LISTENER,
+	HANDLE_CONN,
+};
+
+struct handle {
+	enum handle_kind kind;
+};
+
+struct listener {
+	struct handle h;
+	xtSocket sock;
+	/* A shared listening socket is closed by xtEventLoopDestroy() */
+	bool shared;
+	void (*func)(struct xtEventLoopConn *conn, const struct xtSockaddr *peer, void *arg);
+	void *arg;
+	struct listener *next;
+	int ret;
+};
+
+struct task {
+	void (*func)(void *arg);
+	void *arg;
+	struct task *next;
+};
+
+struct xtEventLoopConn {
+	struct handle h;
+	struct reactor *reactor;
+	xtSocket sock;
+	struct xtEventLoopConnCallbacks cb;
+	void *arg;
+	char *out;
+	size_t outPos, outLen, outCap;
+	/* XT_POLLOUT is monitored because data is queued */
+	bool writing;
+	bool closed;
+	struct xtEventLoopConn *next, **pprev;
+};
+
+struct reactor {
+	struct eventloop *loop;
+	unsigned index;
+	struct xtThread thread;
+	struct xtSocketPoll *poll;
+	struct handle wake;
+	int wakefd;
+	/* Posted tasks in FIFO order, guarded by lock */
+	pthread_mutex_t lock;
+	struct task *tasks, **tasksTail;
+	bool stop;
+	struct listener *listeners;
+	struct xtEventLoopConn *conns;
+	/* Closed connections that are freed after the current batch of events */
+	struct xtEventLoopConn *dead;
+	struct xtEventLoopTimer *wheel[WHEEL_SLOTS];
+	unsigned timers;
+	/* The last millisecond whose slot has been processed */
+	unsigned long long tick;
+	char buf[XT_EVENTLOOP_READ_BUFFER];
+};
+
+struct eventloop {
+	struct xtPool conns;
+	xtSocket *shared;
+	unsigned sharedCount;
+	unsigned count;
+	struct reactor *reactors[];
+};
+
+/* The reactor of the caller thread */
+static __thread struct reactor *current;
+
+static unsigned long long now_ms(void)
+{
+	struct xtTimestamp ts;
+	xtClockGetTime(&ts, XT_CLOCK_MONOTONIC);
+	return xtTimestampToMS(&ts);
+}
+
+static void reactor_wake(struct reactor *r)
+{
+	uint64_t one = 1;
+	ssize_t n;
+	do
+		n = write(r->wakefd, &one, sizeof one);
+	while (n == -1 && errno == EINTR);
+}
+
+static int reactor_post(struct reactor *r, void (*func)(void *arg), void *arg)
+{
+	struct task *t = malloc(sizeof *t);
+	if (!t)
+		return XT_ENOMEM;
+	t->func = func;
+	t->arg = arg;
+	t->next = NULL;
+	pthread_mutex_lock(&r->lock);
+	// Nothing runs the task once the reactor has stopped
+	if (r->stop) {
+		pthread_mutex_unlock(&r->lock);
+		free(t);
+		return XT_ESHUTDOWN;
+	}
+	*r->tasksTail = t;
+	r->tasksTail = &t->next;
+	pthread_mutex_unlock(&r->lock);
+	reactor_wake(r);
+	return 0;
+}
+
+static void reactor_run_tasks(struct reactor *r)
+{
+	struct task *t, *next;
+	uint64_t count;
+	if (read(r->wakefd, &count, sizeof count) == -1 && errno != EAGAIN)
+		return;
+	pthread_mutex_lock(&r->lock);
+	t = r->tasks;
+	r->tasks = NULL;
+	r->tasksTail = &r->tasks;
+	pthread_mutex_unlock(&r->lock);
+	for (; t; t = next) {
+		next = t->next;
+		t->func(t->arg);
+		free(t);
+	}
+}
+
+/*
+A call waits until the reactor has invoked the function. It must not be made
+by a reactor thread, since two reactors could end up waiting for each other.
+*/
+struct call {
+	void (*func)(void *arg);
+	void *arg;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+	bool finished;
+};
+
+static void call_run(void *arg)
+{
+	struct call *c = arg;
+	c->func(c->arg);
+	pthread_mutex_lock(&c->lock);
+	c->finished = true;
+	pthread_cond_signal(&c->done);
+	pthread_mutex_unlock(&c->lock);
+}
+
+static int reactor_call(struct reactor *r, void (*func)(void *arg), void *arg)
+{
+	struct call c;
+	int ret;
+	c.func = func;
+	c.arg = arg;
+	c.finished = false;
+	pthread_mutex_init(&c.lock, NULL);
+	pthread_cond_init(&c.done, NULL);
+	if (!(ret = reactor_post(r, call_run, &c))) {
+		pthread_mutex_lock(&c.lock);
+		while (!c.finished)
+			pthread_cond_wait(&c.done, &c.lock);
+		pthread_mutex_unlock(&c.lock);
+	}
+	pthread_cond_destroy(&c.done);
+	pthread_mutex_destroy(&c.lock);
+	return ret;
+}
+
+static void timer_link(struct xtEventLoopTimer **head, struct xtEventLoopTimer *timer)
+{
+	if ((timer->next = *head))
+		timer->next->pprev = &timer->next;
+	*head = timer;
+	timer->pprev = head;
+}
+
+static void timer_unlink(struct xtEventLoopTimer *timer)
+{
+	if (timer->next)
+		timer->next->pprev = timer->pprev;
+	*timer->pprev = timer->next;
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+/* Returns the milliseconds until the next slot that holds a timer */
+static int wheel_timeout(const struct reactor *r)
+{
+	unsigned long long now;
+	if (!r->timers)
+		return -1;
+	now = now_ms();
+	for (unsigned k = 1; k <= WHEEL_SLOTS; ++k)
+		if (r->wheel[(r->tick + k) & (WHEEL_SLOTS - 1)])
+			return r->tick + k > now ? (int)(r->tick + k - now) : 0;
+	return 0;
+}
+
+/* Fires all timers that have expired since the last tick */
+static void wheel_advance(struct reactor *r, unsigned long long now)
+{
+	struct xtEventLoopTimer *fire = NULL, *t, *next;
+	unsigned long long steps = now - r->tick;
+	if (!r->timers || now <= r->tick) {
+		if (now > r->tick)
+			r->tick = now;
+		return;
+	}
+	// Timers that are more than one revolution ahead stay in their slot
+	if (steps > WHEEL_SLOTS)
+		steps = WHEEL_SLOTS;
+	for (unsigned long long k = 1; k <= steps; ++k)
+		for (t = r->wheel[(r->tick + k) & (WHEEL_SLOTS - 1)]; t; t = next) {
+			next = t->next;
+			if (t->expires <= now) {
+				timer_unlink(t);
+				timer_link(&fire, t);
+			}
+		}
+	r->tick = now;
+	// A callback may stop or restart any timer, including the ones that are about to fire
+	while ((t = fire)) {
+		timer_unlink(t);
+		if (t->interval) {
+			t->expires = now + t->interval;
+			timer_link(&r->wheel[t->expires & (WHEEL_SLOTS - 1)], t);
+		} else
+			--r->timers;
+		t->func(t, t->arg);
+	}
+}
+
+static void conn_close(struct xtEventLoopConn *conn, int error)
+{
+	struct reactor *r = conn->reactor;
+	if (conn->closed)
+		return;
+	conn->closed = true;
+	xtSocketPollRemove(r->poll, conn->sock);
+	close(conn->sock);
+	if (conn->next)
+		conn->next->pprev = conn->pprev;
+	*conn->pprev = conn->next;
+	conn->next = r->dead;
+	r->dead = conn;
+	if (conn->cb.close)
+		conn->cb.close(conn, error, conn->arg);
+}
+
+static void reactor_reap(struct reactor *r)
+{
+	struct xtEventLoopConn *conn, *next;
+	for (conn = r->dead; conn; conn = next) {
+		next = conn->next;
+		free(conn->out);
+		xtPoolFree(&r->loop->conns, conn);
+	}
+	r->dead = NULL;
+}
+
+static int conn_set_writing(struct xtEventLoopConn *conn, bool writing)
+{
+	int ret;
+	if (conn->writing == writing)
+		return 0;
+	if ((ret = xtSocketPollMod(conn->reactor->poll, conn->sock, writing ? XT_POLLIN | XT_POLLOUT : XT_POLLIN)))
+		return ret;
+	conn->writing = writing;
+	return 0;
+}
+
+static void conn_flush(struct xtEventLoopConn *conn)
+{
+	while (conn->outPos < conn->outLen) {
+		ssize_t n = send(conn->sock, conn->out + conn->outPos, conn->outLen - conn->outPos, MSG_NOSIGNAL);
+		if (n == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return;
+			if (errno != EINTR) {
+				conn_close(conn, _xtTranslateSysError(errno));
+				return;
+			}
+		} else
+			conn->outPos += n;
+	}
+	conn->outPos = conn->outLen = 0;
+	if (conn_set_writing(conn, false)) {
+		conn_close(conn, XT_EIO);
+		return;
+	}
+	if (conn->cb.drain)
+		conn->cb.drain(conn, conn->arg);
+}
+
+static void conn_read(struct xtEventLoopConn *conn)
+{
+	struct reactor *r = conn->reactor;
+	ssize_t n = recv(conn->sock, r->buf, sizeof r->buf, 0);
+	if (n > 0) {
+		if (conn->cb.data)
+			conn->cb.data(conn, r->buf, n, conn->arg);
+	} else if (n == 0)
+		conn_close(conn, 0);
+	else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+		conn_close(conn, _xtTranslateSysError(errno));
+}
+
+static void conn_ready(struct xtEventLoopConn *conn, enum xtSocketPollEvent events)
+{
+	// A connection that has reused the slot of a closed one may see its event
+	if (events & XT_POLLOUT && conn->writing)
+		conn_flush(conn);
+	if (!conn->closed && events & (XT_POLLIN | XT_POLLERR | XT_POLLHUP))
+		conn_read(conn);
+}
+
+static void listener_accept(struct reactor *r, struct listener *l)
+{
+	for (unsigned i = 0; i < ACCEPT_BATCH; ++i) {
+		struct xtEventLoopConn *conn;
+		struct xtSockaddr peer;
+		socklen_t len = sizeof(struct sockaddr_in);
+		int fd = accept4(l->sock, (struct sockaddr*)&peer, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (fd == -1)
+			return;
+		if (!(conn = xtPoolAlloc(&r->loop->conns))) {
+			close(fd);
+			continue;
+		}
+		memset(conn, 0, sizeof *conn);
+		conn->h.kind = HANDLE_CONN;
+		conn->reactor = r;
+		conn->sock = fd;
+		xtSocketSetTCPNoDelay(fd, true);
+		if (xtSocketPollAdd(r->poll, fd, conn, XT_POLLIN)) {
+			close(fd);
+			xtPoolFree(&r->loop->conns, conn);
+			continue;
+		}
+		if ((conn->next = r->conns))
+			conn->next->pprev = &conn->next;
+		r->conns = conn;
+		conn->pprev = &r->conns;
+		l->func(conn, &peer, l->arg);
+	}
+}
+
+static void reactor_shutdown(struct reactor *r)
+{
+	struct listener *l, *next;
+	for (l = r->listeners; l; l = next) {
+		next = l->next;
+		xtSocketPollRemove(r->poll, l->sock);
+		if (!l->shared)
+			close(l->sock);
+		free(l);
+	}
+	r->listeners = NULL;
+	while (r->conns)
+		conn_close(r->conns, 0);
+	reactor_reap(r);
+	xtPoolThreadDetach(&r->loop->conns);
+}
+
+static void *reactor_main(struct xtThread *t, void *arg)
+{
+	struct reactor *r = arg;
+	char name[16];
+	(void)t;
+	current = r;
+	snprintf(name, sizeof name, "eventloop %u", r->index);
+	xtThreadSetName(name);
+	r->tick = now_ms();
+	while (!__atomic_load_n(&r->stop, __ATOMIC_ACQUIRE)) {
+		size_t ready;
+		int ret = xtSocketPollWait(r->poll, wheel_timeout(r), &ready);
+		if (ret) {
+			if (ret == XT_EINTR)
+				continue;
+			break;
+		}
+		for (size_t i = 0; i < ready; ++i) {
+			struct handle *h = xtSocketPollGetReadyData(r->poll, i);
+			// Removed sockets remain in the ready array without their data
+			if (!h)
+				continue;
+			switch (h->kind) {
+			case HANDLE_WAKE:
+				reactor_run_tasks(r);
+				break;
+			case HANDLE_LISTENER:
+				listener_accept(r, (struct listener*)h);
+				break;
+			case HANDLE_CONN:
+				conn_ready((struct xtEventLoopConn*)h, xtSocketPollGetReadyEvent(r->poll, i));
+				break;
+			}
+		}
+		wheel_advance(r, now_ms());
+		reactor_reap(r);
+	}
+	// Tasks that have been queued before the reactor stopped still run, so no call waits forever
+	reactor_run_tasks(r);
+	reactor_shutdown(r);
+	current = NULL;
+	return NULL;
+}
+
+static void reactor_stop(void *arg)
+{
+	struct reactor *r = arg;
+	pthread_mutex_lock(&r->lock);
+	__atomic_store_n(&r->stop, true, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&r->lock);
+}
+
+static void reactor_free(struct reactor *r)
+{
+	struct task *t, *next;
+	for (t = r->tasks; t; t = next) {
+		next = t->next;
+		free(t);
+	}
+	xtSocketPollDestroy(&r->poll);
+	close(r->wakefd);
+	pthread_mutex_destroy(&r->lock);
+	free(r);
+}
+
+static int reactor_create(struct eventloop *loop, unsigned index, unsigned capacity)
+{
+	struct reactor *r;
+	int ret;
+	if (!(r = calloc(1, sizeof *r)))
+		return XT_ENOMEM;
+	r->loop = loop;
+	r->index = index;
+	r->wake.kind = HANDLE_WAKE;
+	r->tasksTail = &r->tasks;
+	pthread_mutex_init(&r->lock, NULL);
+	if ((r->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1) {
+		ret = _xtTranslateSysError(errno);
+		pthread_mutex_destroy(&r->lock);
+		free(r);
+		return ret;
+	}
+	if ((ret = xtSocketPollCreate(&r->poll, capacity + POLL_RESERVED))
+		|| (ret = xtSocketPollAdd(r->poll, r->wakefd, &r->wake, XT_POLLIN))) {
+		reactor_free(r);
+		return ret;
+	}
+	loop->reactors[index] = r;
+	return 0;
+}
+
+int xtEventLoopCreate(struct xtEventLoop *loop, unsigned loops, unsigned capacity)
+{
+	struct eventloop *l;
+	unsigned created = 0, started = 0;
+	int ret;
+	if (!loops) {
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		loops = cpus > 0 ? cpus : 1;
+	}
+	if (!capacity)
+		capacity = XT_EVENTLOOP_CAPACITY_DEFAULT;
+	if (capacity > INT32_MAX - POLL_RESERVED)
+		return XT_EINVAL;
+	if (!(l = calloc(1, sizeof *l + loops * sizeof *l->reactors)))
+		return XT_ENOMEM;
+	if ((ret = xtPoolCreate(&l->conns, "eventloop", sizeof(struct xtEventLoopConn), 0))) {
+		free(l);
+		return ret;
+	}
+	for (; created < loops; ++created)
+		if ((ret = reactor_create(l, created, capacity)))
+			goto error;
+	for (; started < loops; ++started)
+		if ((ret = xtThreadCreate(&l->reactors[started]->thread, reactor_main, l->reactors[started], 0, 0)))
+			goto error;
+	l->count = loops;
+	loop->impl = l;
+	return 0;
+error:
+	for (unsigned i = 0; i < started; ++i) {
+		reactor_post(l->reactors[i], reactor_stop, l->reactors[i]);
+		xtThreadJoin(&l->reactors[i]->thread, NULL);
+	}
+	for (unsigned i = 0; i < created; ++i)
+		reactor_free(l->reactors[i]);
+	xtPoolDestroy(&l->conns);
+	free(l);
+	return ret;
+}
+
+void xtEventLoopDestroy(struct xtEventLoop *loop)
+{
+	struct eventloop *l = loop->impl;
+	if (!l)
+		return;
+	for (unsigned i = 0; i < l->count; ++i) {
+		struct reactor *r = l->reactors[i];
+		// Without memory for the task, the flag is set directly, which the eventfd still makes visible
+		if (reactor_post(r, reactor_stop, r)) {
+			reactor_stop(r);
+			reactor_wake(r);
+		}
+	}
+	for (unsigned i = 0; i < l->count; ++i) {
+		xtThreadJoin(&l->reactors[i]->thread, NULL);
+		reactor_free(l->reactors[i]);
+	}
+	for (unsigned i = 0; i < l->sharedCount; ++i)
+		close(l->shared[i]);
+	free(l->shared);
+	xtPoolDestroy(&l->conns);
+	free(l);
+	loop->impl = NULL;
+}
+
+unsigned xtEventLoopGetCount(const struct xtEventLoop *loop)
+{
+	return ((const struct eventloop*)loop->impl)->count;
+}
+
+int xtEventLoopGetCurrent(const struct xtEventLoop *loop)
+{
+	if (!current || current->loop != loop->impl)
+		return -1;
+	return current->index;
+}
+
+static void listener_add(void *arg)
+{
+	struct listener *l = arg;
+	l->ret = xtSocketPollAdd(current->poll, l->sock, l, l->shared ? XT_POLLIN | XT_POLLEXCLUSIVE : XT_POLLIN);
+	if (!l->ret) {
+		l->next = current->listeners;
+		current->listeners = l;
+	}
+}
+
+static void listener_remove(void *arg)
+{
+	struct listener *l = arg, **prev;
+	for (prev = &current->listeners; *prev != l; prev = &(*prev)->next)
+		;
+	*prev = l->next;
+	xtSocketPollRemove(current->poll, l->sock);
+}
+
+static int listen_socket(xtSocket *sock, struct xtSockaddr *sa, unsigned backlog, bool reusePort)
+{
+	int ret;
+	if ((ret = xtSocketCreate(sock, XT_SOCKET_PROTO_TCP)))
+		return ret;
+	if ((ret = xtSocketSetSoReuseAddress(*sock, true))
+		|| (reusePort && (ret = xtSocketSetSoReusePort(*sock, true)))
+		|| (ret = xtSocketBindTo(*sock, sa))
+		|| (ret = xtSocketListen(*sock, backlog))
+		|| (ret = xtSocketSetBlocking(*sock, false))
+		|| (ret = xtSocketGetLocalSocketAddress(*sock, sa)))
+		xtSocketClose(sock);
+	return ret;
+}
+
+int xtEventLoopListen(struct xtEventLoop *loop, struct xtSockaddr *sa, unsigned backlog, void (*func)(struct xtEventLoopConn *conn, const struct xtSockaddr *peer, void *arg), void *arg)
+{
+	struct eventloop *l = loop->impl;
+	struct listener **ls;
+	xtSocket *shared, sock = XT_SOCKET_INVALID_FD;
+	unsigned added = 0;
+	bool reusePort = true, listening = false;
+	int ret;
+	if (current)
+		return XT_EINVAL;
+	if (!(ls = calloc(l->count, sizeof *ls)))
+		return XT_ENOMEM;
+	// Every reactor gets a listening socket of its own, or they all share one
+	if ((ret = listen_socket(&sock, sa, backlog, true))) {
+		reusePort = false;
+		if ((ret = listen_socket(&sock, sa, backlog, false)))
+			goto error;
+	}
+	if (!reusePort) {
+		if (!(shared = realloc(l->shared, (l->sharedCount + 1) * sizeof *shared))) {
+			xtSocketClose(&sock);
+			ret = XT_ENOMEM;
+			goto error;
+		}
+		l->shared = shared;
+		l->shared[l->sharedCount++] = sock;
+		listening = true;
+	}
+	for (; added < l->count; ++added) {
+		if (added && reusePort && (ret = listen_socket(&sock, sa, backlog, true)))
+			goto error;
+		if (!(ls[added] = malloc(sizeof *ls[added]))) {
+			if (reusePort)
+				xtSocketClose(&sock);
+			ret = XT_ENOMEM;
+			goto error;
+		}
+		ls[added]->h.kind = HANDLE_LISTENER;
+		ls[added]->sock = sock;
+		ls[added]->shared = !reusePort;
+		ls[added]->func = func;
+		ls[added]->arg = arg;
+		if ((ret = reactor_call(l->reactors[added], listener_add, ls[added])) || (ret = ls[added]->ret)) {
+			if (reusePort)
+				xtSocketClose(&sock);
+			free(ls[added]);
+			goto error;
+		}
+	}
+	free(ls);
+	return 0;
+error:
+	while (added) {
+		struct listener *listener = ls[--added];
+		reactor_call(l->reactors[added], listener_remove, listener);
+		if (!listener->shared)
+			close(listener->sock);
+		free(listener);
+	}
+	if (listening)
+		close(l->shared[--l->sharedCount]);
+	free(ls);
+	return ret;
+}
+
+int xtEventLoopPost(struct xtEventLoop *loop, unsigned index, void (*func)(void *arg), void *arg)
+{
+	struct eventloop *l = loop->impl;
+	if (index >= l->count)
+		return XT_EINVAL;
+	return reactor_post(l->reactors[index], func, arg);
+}
+
+int xtEventLoopTimerStart(struct xtEventLoop *loop, struct xtEventLoopTimer *timer, unsigned ms, unsigned interval, void (*func)(struct xtEventLoopTimer *timer, void *arg), void *arg)
+{
+	if (!current || current->loop != loop->impl || xtEventLoopTimerStop(timer))
+		return XT_EINVAL;
+	timer->reactor = current;
+	timer->func = func;
+	timer->arg = arg;
+	timer->interval = interval;
+	timer->expires = now_ms() + (ms ? ms : 1);
+	timer_link(&current->wheel[timer->expires & (WHEEL_SLOTS - 1)], timer);
+	++current->timers;
+	return 0;
+}
+
+int xtEventLoopTimerStop(struct xtEventLoopTimer *timer)
+{
+	// The wheel of another reactor must not be touched
+	if (!current)
+		return XT_EINVAL;
+	if (!timer->pprev)
+		return 0;
+	if (timer->reactor != current)
+		return XT_EINVAL;
+	timer_unlink(timer);
+	--current->timers;
+	return 0;
+}
+
+void xtEventLoopConnSetCallbacks(struct xtEventLoopConn *conn, const struct xtEventLoopConnCallbacks *cb, void *arg)
+{
+	conn->cb = *cb;
+	conn->arg = arg;
+}
+
+int xtEventLoopConnWrite(struct xtEventLoopConn *conn, const void *buf, size_t len)
+{
+	size_t sent = 0;
+	int ret;
+	if (conn->closed)
+		return XT_ESHUTDOWN;
+	// Only send right away if nothing is queued, otherwise the data would be reordered
+	while (conn->outPos == conn->outLen && sent < len) {
+		ssize_t n = send(conn->sock, (const char*)buf + sent, len - sent, MSG_NOSIGNAL);
+		if (n == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			if (errno != EINTR) {
+				ret = _xtTranslateSysError(errno);
+				conn_close(conn, ret);
+				return ret;
+			}
+		} else
+			sent += n;
+	}
+	if (sent == len)
+		return 0;
+	len -= sent;
+	if (conn->outLen + len > conn->outCap) {
+		size_t cap = conn->outCap ? conn->outCap : 4096;
+		char *out;
+		// Move the unsent data to the front before growing
+		if (conn->outPos) {
+			memmove(conn->out, conn->out + conn->outPos, conn->outLen - conn->outPos);
+			conn->outLen -= conn->outPos;
+			conn->outPos = 0;
+		}
+		while (cap < conn->outLen + len)
+			cap *= 2;
+		if (cap > conn->outCap) {
+			if (!(out = realloc(conn->out, cap))) {
+				// Dropping the tail of a partial send would corrupt the stream
+				if (sent)
+					conn_close(conn, XT_ENOMEM);
+				return XT_ENOMEM;
+			}
+			conn->out = out;
+			conn->outCap = cap;
+		}
+	}
+	memcpy(conn->out + conn->outLen, (const char*)buf + sent, len);
+	conn->outLen += len;
+	return conn_set_writing(conn, true);
+}
+
+void xtEventLoopConnClose(struct xtEventLoopConn *conn)
+{
+	conn_close(conn, 0);
+}
+
+xtSocket xtEventLoopConnGetSocket(const struct xtEventLoopConn *conn)
+{
+	return conn->sock;
+}
+
+size_t xtEventLoopConnGetPending(const struct xtEventLoopConn *conn)
+{
+	return conn->outLen - conn->outPos;
+}
+
+unsigned xtEventLoopConnGetIndex(const struct xtEventLoopConn *conn)
+{
+	return conn->reactor->index;
+}
@@ -1,5 +1,7 @@
 /* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
 
+#define _GNU_SOURCE // SEEK_DATA and SEEK_HOLE
+
 // XT headers
 #include <xt/file.h>
 #include <_xt/error.h>
@@ -10,8 +12,12 @@
 // System headers
 #include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <strings.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h> // for the "stat" call, to obtain a file's size
+#include <sys/syscall.h>
 #include <unistd.h> // necessary for the stat struct
 
 // STD headers
@@ -57,21 +63,229 @@ int xtFileAccess(const char *path, enum xtFileAccessMode mode)
 	return access(path, flags) == 0 ? 0 : _xtTranslateSysError(errno);
 }
 
+#ifndef FICLONE
+	#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+#define FILE_COPY_CHUNK (64 << 20)
+#define FILE_COPY_BUFFER (1 << 20)
+#define FILE_COPY_ALIGN 4096
+
+/*
+Ways to copy file data, from fastest to slowest. copy_file_range and sendfile
+copy within the kernel without passing the data through user space and
+copy_file_range may even share the blocks on file systems that support it.
+Methods that the kernel or the file systems do not support fall through to
+the next one.
+*/
+enum file_copy_method {
+	FILE_COPY_RANGE,
+	FILE_COPY_SENDFILE,
+	FILE_COPY_RW,
+};
+
+struct file_copy {
+	int in, out;
+	enum file_copy_method method;
+	unsigned long long total;
+	int (*progress)(unsigned long long copied, unsigned long long total, void *arg);
+	void *arg;
+	char *buf;
+	/** The last number of copied bytes that has been passed to progress. */
+	unsigned long long reported;
+	/** Set once progress has asked to stop, which takes effect before the next chunk. */
+	bool stop;
+};
+
+static bool file_copy_unsupported(int err)
+{
+	return err == ENOSYS || err == EXDEV || err == EINVAL || err == EOPNOTSUPP || err == EBADF;
+}
+
+static ssize_t file_copy_range(int in, int out, off_t off, size_t len)
+{
+#ifdef SYS_copy_file_range
+	long long inoff = off, outoff = off;
+	return syscall(SYS_copy_file_range, in, &inoff, out, &outoff, len, 0);
+#else
+	(void)in; (void)out; (void)off; (void)len;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+static ssize_t file_copy_sendfile(int in, int out, off_t off, size_t len)
+{
+	if (lseek(out, off, SEEK_SET) == -1)
+		return -1;
+	return sendfile(out, in, &off, len);
+}
+
+static ssize_t file_copy_rw(struct file_copy *c, off_t off, size_t len)
+{
+	ssize_t n, w;
+	if (!c->buf && posix_memalign((void**)&c->buf, FILE_COPY_ALIGN, FILE_COPY_BUFFER)) {
+		errno = ENOMEM;
+		return -1;
+	}
+	if (len > FILE_COPY_BUFFER)
+		len = FILE_COPY_BUFFER;
+	if ((n = pread(c->in, c->buf, len, off)) <= 0)
+		return n;
+	for (ssize_t done = 0; done < n; done += w)
+		if ((w = pwrite(c->out, c->buf + done, n - done, off + done)) == -1)
+			return -1;
+	return n;
+}
+
+/* Copies up to \a len bytes at \a off, returns 0 if the source has ended. */
+static ssize_t file_copy_some(struct file_copy *c, off_t off, size_t len)
+{
+	ssize_t n;
+	while (true) {
+		switch (c->method) {
+		case FILE_COPY_RANGE   : n = file_copy_range(c->in, c->out, off, len); break;
+		case FILE_COPY_SENDFILE: n = file_copy_sendfile(c->in, c->out, off, len); break;
+		default                : n = file_copy_rw(c, off, len); break;
+		}
+		if (n != -1 || errno == EINTR)
+			return n;
+		if (c->method == FILE_COPY_RW || !file_copy_unsupported(errno))
+			return -1;
+		++c->method;
+	}
+}
+
+/* Copies the data from \a off up to \a end in chunks and reports the progress. */
+static int file_copy_data(struct file_copy *c, off_t off, off_t end)
+{
+	ssize_t n;
+	while (off < end) {
+		size_t len;
+		if (c->stop)
+			return XT_ECANCELED;
+		len = end - off < FILE_COPY_CHUNK ? end - off : FILE_COPY_CHUNK;
+		for (size_t done = 0; done < len; done += n) {
+			if ((n = file_copy_some(c, off + done, len - done)) == -1) {
+				if (errno == EINTR) {
+					n = 0;
+					continue;
+				}
+				return _xtTranslateSysError(errno);
+			}
+			if (!n)
+				return 0;
+		}
+		off += len;
+		if (c->progress) {
+			// Only stop if any data remains, so a finished copy never fails
+			c->stop = c->progress(off, c->total, c->arg) != 0;
+			c->reported = off;
+		}
+	}
+	return 0;
+}
+
+/* Copies from or to pipes, devices and other files without a known size. */
+static int file_copy_stream(struct file_copy *c)
+{
+	unsigned long long copied = 0;
+	ssize_t n, w;
+	if (posix_memalign((void**)&c->buf, FILE_COPY_ALIGN, FILE_COPY_BUFFER))
+		return XT_ENOMEM;
+	while ((n = read(c->in, c->buf, FILE_COPY_BUFFER))) {
+		if (n == -1) {
+			if (errno == EINTR)
+				continue;
+			return _xtTranslateSysError(errno);
+		}
+		for (ssize_t done = 0; done < n; done += w)
+			if ((w = write(c->out, c->buf + done, n - done)) == -1) {
+				if (errno != EINTR)
+					return _xtTranslateSysError(errno);
+				w = 0;
+			}
+		copied += n;
+		if (c->progress && c->progress(copied, 0, c->arg))
+			return XT_ECANCELED;
+	}
+	return 0;
+}
+
+/*
+Makes \a out a copy of \a in. Regular files are first cloned, which shares all
+blocks on file systems such as btrfs and XFS. Otherwise only the data
+segments are copied and the holes in between are left in \a out, so sparse
+files stay sparse.
+*/
+static int file_copy_fd(int in, int out, int (*progress)(unsigned long long, unsigned long long, void*), void *arg)
+{
+	struct file_copy c = {in, out, FILE_COPY_RANGE, 0, progress, arg, NULL, 0, false};
+	struct stat st, ost;
+	off_t off = 0, data, hole;
+	int ret = 0;
+	if (fstat(in, &st) == -1 || fstat(out, &ost) == -1)
+		return _xtTranslateSysError(errno);
+	// Files in /proc and /sys report a size of zero
+	if (!S_ISREG(st.st_mode) || !S_ISREG(ost.st_mode) || !st.st_size) {
+		// Do not leave the old tail of a longer destination behind
+		if (S_ISREG(ost.st_mode) && ftruncate(out, 0) == -1)
+			return _xtTranslateSysError(errno);
+		ret = file_copy_stream(&c);
+		goto end;
+	}
+	if (ftruncate(out, 0) == -1)
+		return _xtTranslateSysError(errno);
+	c.total = st.st_size;
+	if (!ioctl(out, FICLONE, in))
+		goto done;
+	if (ftruncate(out, st.st_size) == -1)
+		return _xtTranslateSysError(errno);
+	posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+	while (off < st.st_size) {
+		if ((data = lseek(in, off, SEEK_DATA)) == -1) {
+			// Only a hole remains
+			if (errno == ENXIO)
+				break;
+			// The file system does not know about holes
+			data = off;
+			hole = st.st_size;
+		} else if ((hole = lseek(in, data, SEEK_HOLE)) == -1 || hole > st.st_size)
+			hole = st.st_size;
+		if ((ret = file_copy_data(&c, data, hole)))
+			goto end;
+		off = hole;
+	}
+done:
+	// Clones and files that end with a hole have not been reported as complete yet
+	if (progress && c.reported != c.total)
+		progress(c.total, c.total, arg);
+end:
+	free(c.buf);
+	return ret;
+}
+
 int xtFileCopy(const char *restrict src, const char *restrict dst)
+{
+	return xtFileCopyProgress(src, dst, NULL, NULL);
+}
+
+int xtFileCopyProgress(const char *restrict src, const char *restrict dst, int (*progress)(unsigned long long copied, unsigned long long total, void *arg), void *arg)
 {
 	if (!src || !dst)
 		return XT_EINVAL;
-	FILE *fsrc = fopen(src, "rb");
-	if (!fsrc)
+	int in = open(src, O_RDONLY | O_CLOEXEC);
+	if (in == -1)
 		return _xtTranslateSysError(errno);
-	FILE *fdst = fopen(dst, "w+");
-	if (!fdst) {
-		fclose(fsrc);
+	int out = open(dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (out == -1) {
+		close(in);
 		return _xtTranslateSysError(errno);
 	}
-	int ret = xtFileCopyByHandle(fsrc, fdst);
-	fclose(fsrc);
-	fclose(fdst);
+	int ret = file_copy_fd(in, out, progress, arg);
+	close(in);
+	if (close(out) == -1 && !ret)
+		ret = _xtTranslateSysError(errno);
 	return ret;
 }
 
@@ -79,20 +293,12 @@ int xtFileCopyByHandle(FILE *restrict src, FILE *restrict dst)
 {
 	if (!src || !dst)
 		return XT_EINVAL;
-	if (fseek(src, 0, SEEK_SET) != 0 || fseek(dst, 0, SEEK_SET) != 0)
+	if (fseek(src, 0, SEEK_SET) != 0 || fflush(dst) != 0 || fseek(dst, 0, SEEK_SET) != 0)
 		return _xtTranslateSysError(errno);
-	char buf[8192];
-	size_t len;
-	while (true) {
-		len = fread(buf, 1, sizeof buf, src);
-		if (len == 0)
-			break;
-		if (fwrite(buf, len, 1, dst) != 1)
-			return _xtTranslateSysError(errno);
-	}
+	int ret = file_copy_fd(fileno(src), fileno(dst), NULL, NULL);
 	fseek(dst, 0, SEEK_SET);
 	fseek(src, 0, SEEK_SET);
-	return 0;
+	return ret;
 }
 
 int xtFileCreateDir(const char *path)
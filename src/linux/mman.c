@@ -3,12 +3,20 @@
 #define _GNU_SOURCE // Absolutely necessary!
 // XT headers
 #include <xt/mman.h>
+#include <_xt/error.h>
+#include <xt/error.h>
 
 // System headers
+#include <errno.h>
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 // STD headers
 #include <stdarg.h> // va_list
+#include <stdint.h>
+#include <stdio.h>
 
 static int mmap_translate_prot(int prot)
 {
@@ -38,10 +46,46 @@ static int mmap_translate_flags(int flags)
 		mmap_flags |= MAP_SHARED;
 	if (flags & XT_MMAN_MAP_FILE)
 		mmap_flags |= MAP_FILE;
+	if (flags & XT_MMAN_MAP_HUGETLB)
+		mmap_flags |= MAP_HUGETLB;
+	if (flags & XT_MMAN_MAP_POPULATE)
+		mmap_flags |= MAP_POPULATE;
+	if (flags & XT_MMAN_MAP_NORESERVE)
+		mmap_flags |= MAP_NORESERVE;
+	if (flags & XT_MMAN_MAP_LOCKED)
+		mmap_flags |= MAP_LOCKED;
 
 	return mmap_flags;
 }
 
+static int mmap_translate_mremap_flags(int flags)
+{
+	int mremap_flags = 0;
+
+	if (flags & XT_MMAN_MREMAP_MAYMOVE)
+		mremap_flags |= MREMAP_MAYMOVE;
+	if (flags & XT_MMAN_MREMAP_FIXED)
+		mremap_flags |= MREMAP_FIXED;
+
+	return mremap_flags;
+}
+
+static int mmap_translate_advice(int advice)
+{
+	switch (advice) {
+	case XT_MMAN_MADV_NORMAL    : return MADV_NORMAL;
+	case XT_MMAN_MADV_RANDOM    : return MADV_RANDOM;
+	case XT_MMAN_MADV_SEQUENTIAL: return MADV_SEQUENTIAL;
+	case XT_MMAN_MADV_WILLNEED  : return MADV_WILLNEED;
+	case XT_MMAN_MADV_DONTNEED  : return MADV_DONTNEED;
+#ifdef MADV_HUGEPAGE
+	case XT_MMAN_MADV_HUGEPAGE  : return MADV_HUGEPAGE;
+	case XT_MMAN_MADV_NOHUGEPAGE: return MADV_NOHUGEPAGE;
+#endif
+	default                     : return -1;
+	}
+}
+
 static int mmap_translate_ms_flags(int flags)
 {
 	int mmap_flags = 0;
@@ -103,7 +147,7 @@ void *xtmremap(void *old_address, size_t old_size, size_t new_size, int flags, .
 		new = 1;
 		new_address = va_arg(args, void*);
 	}
-	flags = mmap_translate_flags(flags);
+	flags = mmap_translate_mremap_flags(flags);
 	if (new)
 		retval = mremap(old_address, old_size, new_size, flags, new_address);
 	else
@@ -113,3 +157,242 @@ void *xtmremap(void *old_address, size_t old_size, size_t new_size, int flags, .
 
 	return retval;
 }
+
+int xtmadvise(void *addr, size_t len, int advice)
+{
+	int madv = mmap_translate_advice(advice);
+	if (madv == -1) {
+		errno = EINVAL;
+		return -1;
+	}
+	return madvise(addr, len, madv);
+}
+
+/* The size of transparent huge pages, which is also used for reserved ones. */
+static size_t huge_page_size(void)
+{
+	static size_t size;
+	unsigned long long value;
+	FILE *f;
+	if (size)
+		return size;
+	size = 2 << 20;
+	if ((f = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r"))) {
+		if (fscanf(f, "%llu", &value) == 1 && value && !(value & (value - 1)))
+			size = value;
+		fclose(f);
+	}
+	return size;
+}
+
+void *xtHugeAlloc(size_t size)
+{
+	size_t huge = huge_page_size(), len, head;
+	char *map;
+	if (!size || size > SIZE_MAX - 2 * huge)
+		return NULL;
+	size = (size + huge - 1) & ~(huge - 1);
+#ifdef MAP_HUGE_SHIFT
+	/*
+	Reserved huge pages, which fails if there are not enough of them. They are
+	requested with the size of transparent ones rather than the default size,
+	which may be 1GB, so xtHugeFree() rounds both kinds of mappings alike.
+	*/
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | __builtin_ctzll(huge) << MAP_HUGE_SHIFT, -1, 0);
+	if (map != MAP_FAILED)
+		return map;
+#endif
+	/*
+	Transparent huge pages only back ranges that are aligned to them, so map
+	more and unmap the unaligned head and tail.
+	*/
+	len = size + huge - (size_t)sysconf(_SC_PAGESIZE);
+	map = xtmmap(NULL, len, XT_MMAN_PROT_READ | XT_MMAN_PROT_WRITE, XT_MMAN_MAP_PRIVATE | XT_MMAN_MAP_ANONYMOUS, -1, 0);
+	if (map == XT_MMAN_MAP_FAILED)
+		return NULL;
+	head = ((uintptr_t)map + huge - 1) / huge * huge - (uintptr_t)map;
+	if (head)
+		xtmunmap(map, head);
+	if (len - head > size)
+		xtmunmap(map + head + size, len - head - size);
+	// Not every kernel supports them, in which case normal pages are used
+	xtmadvise(map + head, size, XT_MMAN_MADV_HUGEPAGE);
+	return map + head;
+}
+
+void xtHugeFree(void *ptr, size_t size)
+{
+	// Both kinds of mappings of xtHugeAlloc() consist of whole pages of this size
+	size_t huge = huge_page_size();
+	if (ptr)
+		xtmunmap(ptr, (size + huge - 1) & ~(huge - 1));
+}
+
+static int mapped_map(struct xtMappedFile *mf, size_t size)
+{
+	int prot = XT_MMAN_PROT_READ;
+	void *map;
+	if (mf->flags & XT_MAPPED_FILE_WRITE)
+		prot |= XT_MMAN_PROT_WRITE;
+	// Empty mappings are invalid
+	if (size) {
+		map = xtmmap(NULL, size, prot, XT_MMAN_MAP_FILE | XT_MMAN_MAP_SHARED, mf->fd, 0);
+		if (map == XT_MMAN_MAP_FAILED)
+			return _xtTranslateSysError(errno);
+	} else
+		map = NULL;
+	mf->data = map;
+	mf->size = size;
+	return 0;
+}
+
+/* Extends the range to whole pages. */
+static size_t mapped_range(const struct xtMappedFile *mf, size_t offset, size_t len, char **addr)
+{
+	size_t start = offset & ~((size_t)sysconf(_SC_PAGESIZE) - 1);
+	if (offset >= mf->size)
+		return 0;
+	if (!len || len > mf->size - offset)
+		len = mf->size - offset;
+	*addr = (char*)mf->data + start;
+	return offset + len - start;
+}
+
+int xtMappedFileOpen(struct xtMappedFile *mf, const char *path, size_t size, unsigned flags)
+{
+	struct stat st;
+	int oflags = O_RDONLY, ret;
+	if (flags & XT_MAPPED_FILE_WRITE)
+		oflags = O_RDWR;
+	if (flags & XT_MAPPED_FILE_CREATE) {
+		if (!(flags & XT_MAPPED_FILE_WRITE))
+			return XT_EINVAL;
+		oflags |= O_CREAT;
+	}
+	if ((mf->fd = open(path, oflags | O_CLOEXEC, 0666)) == -1)
+		return _xtTranslateSysError(errno);
+	mf->flags = flags;
+	if (fstat(mf->fd, &st) == -1)
+		goto fail_errno;
+	if (!size)
+		size = st.st_size;
+	if (size > (unsigned long long)st.st_size) {
+		// Pages past the end of a file cannot be accessed
+		if (!(flags & XT_MAPPED_FILE_WRITE)) {
+			ret = XT_EINVAL;
+			goto fail;
+		}
+		if (ftruncate(mf->fd, size) == -1)
+			goto fail_errno;
+	}
+	if ((ret = mapped_map(mf, size)))
+		goto fail;
+	if (flags & XT_MAPPED_FILE_POPULATE && (ret = xtMappedFilePrefault(mf, 0, 0))) {
+		xtMappedFileClose(mf);
+		return ret;
+	}
+	return 0;
+fail_errno:
+	ret = _xtTranslateSysError(errno);
+fail:
+	close(mf->fd);
+	return ret;
+}
+
+int xtMappedFileResize(struct xtMappedFile *mf, size_t size)
+{
+	bool write = mf->flags & XT_MAPPED_FILE_WRITE;
+	struct stat st;
+	void *map;
+	int ret;
+	if (size == mf->size)
+		return 0;
+	if (size > mf->size) {
+		if (write && ftruncate(mf->fd, size) == -1)
+			return _xtTranslateSysError(errno);
+		if (!write && (fstat(mf->fd, &st) == -1 || (unsigned long long)st.st_size < size))
+			return XT_EINVAL;
+	}
+	if (!mf->size || !size) {
+		if (mf->size) {
+			if (xtmunmap(mf->data, mf->size))
+				return _xtTranslateSysError(errno);
+			mf->data = NULL;
+			mf->size = 0;
+		}
+		if ((ret = mapped_map(mf, size)))
+			return ret;
+	} else {
+		map = xtmremap(mf->data, mf->size, size, XT_MMAN_MREMAP_MAYMOVE);
+		if (map == XT_MMAN_MAP_FAILED)
+			return _xtTranslateSysError(errno);
+		mf->data = map;
+		mf->size = size;
+	}
+	// Shrink the file only after the pages past its end have been unmapped
+	if (write && ftruncate(mf->fd, size) == -1)
+		return _xtTranslateSysError(errno);
+	return 0;
+}
+
+int xtMappedFileAdvise(struct xtMappedFile *mf, size_t offset, size_t len, enum xtMappedFileAdvice advice)
+{
+	char *addr;
+	int madv;
+	switch (advice) {
+	case XT_MAPPED_FILE_NORMAL    : madv = XT_MMAN_MADV_NORMAL; break;
+	case XT_MAPPED_FILE_SEQUENTIAL: madv = XT_MMAN_MADV_SEQUENTIAL; break;
+	case XT_MAPPED_FILE_RANDOM    : madv = XT_MMAN_MADV_RANDOM; break;
+	case XT_MAPPED_FILE_WILLNEED  : madv = XT_MMAN_MADV_WILLNEED; break;
+	case XT_MAPPED_FILE_DONTNEED  : madv = XT_MMAN_MADV_DONTNEED; break;
+	case XT_MAPPED_FILE_HUGEPAGE  : madv = XT_MMAN_MADV_HUGEPAGE; break;
+	default                       : return XT_EINVAL;
+	}
+	if (!(len = mapped_range(mf, offset, len, &addr)))
+		return 0;
+	return xtmadvise(addr, len, madv) ? _xtTranslateSysError(errno) : 0;
+}
+
+int xtMappedFilePrefault(struct xtMappedFile *mf, size_t offset, size_t len)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+	unsigned char sum = 0;
+	char *addr;
+	if (!(len = mapped_range(mf, offset, len, &addr)))
+		return 0;
+#ifdef MADV_POPULATE_READ
+	/*
+	Writable mappings are populated for reading as well, because populating
+	them for writing would mark every page dirty.
+	*/
+	if (!madvise(addr, len, MADV_POPULATE_READ))
+		return 0;
+	// Kernels before Linux 5.14 do not know about it
+	if (errno != EINVAL)
+		return _xtTranslateSysError(errno);
+#endif
+	for (size_t i = 0; i < len; i += page)
+		sum += ((volatile unsigned char*)addr)[i];
+	(void)sum;
+	return 0;
+}
+
+int xtMappedFileSync(struct xtMappedFile *mf, bool wait)
+{
+	if (!mf->size)
+		return 0;
+	return msync(mf->data, mf->size, wait ? MS_SYNC : MS_ASYNC) ? _xtTranslateSysError(errno) : 0;
+}
+
+int xtMappedFileClose(struct xtMappedFile *mf)
+{
+	int ret = 0;
+	if (mf->size && xtmunmap(mf->data, mf->size))
+		ret = _xtTranslateSysError(errno);
+	if (close(mf->fd) == -1 && !ret)
+		ret = _xtTranslateSysError(errno);
+	mf->data = NULL;
+	mf->size = 0;
+	mf->fd = -1;
+	return ret;
+}
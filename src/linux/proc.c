@@ -2,6 +2,7 @@
 
 // XT headers
 #include <xt/proc.h>
+#include <xt/pool.h>
 #include <_xt/error.h>
 #include <xt/error.h>
 #include <xt/string.h>
@@ -97,6 +98,8 @@ int xtProcGetMemoryInfo(unsigned pid, struct xtProcMemoryInfo *info)
 		}
 	}
 	fclose(f);
+	if (pid == xtProcGetCurrentPID())
+		info->pool = xtPoolGetTotalSize();
 	return 0;
 }
 
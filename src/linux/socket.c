@@ -1,5 +1,7 @@
 /* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
 
+#define _GNU_SOURCE // recvmmsg and sendmmsg
+
 // XT headers
 #include <xt/socket.h>
 #include <xt/endian.h> // htobe16
@@ -10,10 +12,14 @@
 #include <arpa/inet.h> // sockaddr_in struct and functions to format IP addresses and ports
 #include <errno.h> // for the error macros
 #include <fcntl.h> // fcntl function
+#include <linux/errqueue.h> // sock_extended_err for zero-copy completions
 #include <netdb.h> // hostent struct, gethostbyname(), needed to convert a char* to in_addr
 #include <netinet/tcp.h> // For TCP_NODELAY and such
+#include <netinet/udp.h> // For UDP_SEGMENT and UDP_GRO
+#include <poll.h> // for waiting on non-blocking sockets
 #include <sys/epoll.h> // for epoll
 #include <sys/socket.h> // for the socket function
+#include <sys/uio.h> // readv
 #include <unistd.h> // close function
 
 // STD headers
@@ -128,6 +134,29 @@ char *xtSockaddrToString(const struct xtSockaddr *restrict sa, char *restrict bu
 // Some macros that spare us a lot of typing
 #define XT_SOCKET_LAST_ERROR errno
 
+// Zero-copy is only known by the headers of Linux 4.14 and up
+#ifndef SO_ZEROCOPY
+	#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+	#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+	#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+// UDP segmentation offload is only known by the headers of Linux 4.18 and up, and GRO by 5.0 and up
+#ifndef SOL_UDP
+	#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+	#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+	#define UDP_GRO 104
+#endif
+// The most buffers that xtSocketTCPWritevAll() passes at once
+#define XT_SOCKET_IOV_BATCH 64
+
 int xtSocketBindTo(xtSocket sock, const struct xtSockaddr *sa)
 {
 	if (bind(sock, (const struct sockaddr*)sa, sizeof(struct sockaddr_in)) == 0)
@@ -298,6 +327,17 @@ int xtSocketGetSoReuseAddress(const xtSocket sock, bool *flag)
 	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 }
 
+int xtSocketGetSoReusePort(const xtSocket sock, bool *flag)
+{
+	int val = 0;
+	socklen_t len = sizeof val;
+	if (getsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (char*)&val, &len) == 0) {
+		*flag = val;
+		return 0;
+	}
+	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+}
+
 int xtSocketGetSoSendBufferSize(xtSocket sock, unsigned *size)
 {
 	int val = 0;
@@ -309,6 +349,17 @@ int xtSocketGetSoSendBufferSize(xtSocket sock, unsigned *size)
 	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 }
 
+int xtSocketGetTCPCork(const xtSocket sock, bool *flag)
+{
+	int val;
+	socklen_t len = sizeof val;
+	if (getsockopt(sock, IPPROTO_TCP, TCP_CORK, (char*)&val, &len) == 0) {
+		*flag = val == 1;
+		return 0;
+	}
+	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+}
+
 int xtSocketGetTCPNoDelay(const xtSocket sock, bool *flag)
 {
 	int val;
@@ -391,6 +442,14 @@ int xtSocketSetSoReuseAddress(xtSocket sock, bool flag)
 	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 }
 
+int xtSocketSetSoReusePort(xtSocket sock, bool flag)
+{
+	int val = flag ? 1 : 0;
+	if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (const char*)&val, sizeof val) == 0)
+		return 0;
+	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+}
+
 int xtSocketSetSoSendBufferSize(xtSocket sock, unsigned size)
 {
 	int val = size;
@@ -399,6 +458,22 @@ int xtSocketSetSoSendBufferSize(xtSocket sock, unsigned size)
 	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 }
 
+int xtSocketSetSoZeroCopy(xtSocket sock, bool flag)
+{
+	int val = flag ? 1 : 0;
+	if (setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, (const char*)&val, sizeof val) == 0)
+		return 0;
+	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+}
+
+int xtSocketSetTCPCork(xtSocket sock, bool flag)
+{
+	int val = flag ? 1 : 0;
+	if (setsockopt(sock, IPPROTO_TCP, TCP_CORK, (const char*)&val, sizeof val) == 0)
+		return 0;
+	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+}
+
 int xtSocketSetTCPNoDelay(xtSocket sock, bool flag)
 {
 	int val = (flag) ? 1 : 0;
@@ -407,6 +482,14 @@ int xtSocketSetTCPNoDelay(xtSocket sock, bool flag)
 	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 }
 
+int xtSocketSetUDPGRO(xtSocket sock, bool flag)
+{
+	int val = flag ? 1 : 0;
+	if (setsockopt(sock, SOL_UDP, UDP_GRO, (const char*)&val, sizeof val) == 0)
+		return 0;
+	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+}
+
 int xtSocketTCPAccept(xtSocket sock, xtSocket *restrict peerSock, struct xtSockaddr *restrict peerAddr)
 {
 	socklen_t dummyLen = sizeof(struct sockaddr_in);
@@ -445,6 +528,151 @@ int xtSocketTCPWrite(xtSocket sock, const void *restrict buf, uint16_t buflen, u
 	return 0;
 }
 
+static int socket_msg_flags(unsigned flags)
+{
+	return (flags & XT_SOCKET_MSG_MORE ? MSG_MORE : 0) | (flags & XT_SOCKET_MSG_ZEROCOPY ? MSG_ZEROCOPY : 0);
+}
+
+/* Waits until a non-blocking socket is ready again. */
+static int socket_wait(xtSocket sock, bool write)
+{
+	struct pollfd pfd;
+	pfd.fd = sock;
+	pfd.events = write ? POLLOUT : POLLIN;
+	while (poll(&pfd, 1, -1) == -1)
+		if (errno != EINTR)
+			return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	return 0;
+}
+
+int xtSocketTCPReadEx(xtSocket sock, void *restrict buf, size_t buflen, size_t *restrict bytesRead)
+{
+	ssize_t ret;
+	ret = recv(sock, buf, buflen, 0);
+	if (ret == -1)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	*bytesRead = ret;
+	return ret == 0 ? XT_ESHUTDOWN : 0; // Graceful shutdown
+}
+
+int xtSocketTCPWriteEx(xtSocket sock, const void *restrict buf, size_t buflen, size_t *restrict bytesSent, unsigned flags)
+{
+	ssize_t ret;
+	ret = send(sock, buf, buflen, socket_msg_flags(flags));
+	if (ret == -1)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	*bytesSent = ret;
+	return 0;
+}
+
+int xtSocketTCPReadv(xtSocket sock, const struct xtSocketIOVec *restrict iov, unsigned count, size_t *restrict bytesRead)
+{
+	ssize_t ret;
+	ret = readv(sock, (const struct iovec*)iov, count);
+	if (ret == -1)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	*bytesRead = ret;
+	return ret == 0 ? XT_ESHUTDOWN : 0;
+}
+
+int xtSocketTCPWritev(xtSocket sock, const struct xtSocketIOVec *restrict iov, unsigned count, size_t *restrict bytesSent, unsigned flags)
+{
+	struct msghdr msg;
+	ssize_t ret;
+	memset(&msg, 0, sizeof msg);
+	msg.msg_iov = (struct iovec*)iov;
+	msg.msg_iovlen = count;
+	ret = sendmsg(sock, &msg, socket_msg_flags(flags));
+	if (ret == -1)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	*bytesSent = ret;
+	return 0;
+}
+
+int xtSocketTCPReadExact(xtSocket sock, void *restrict buf, size_t buflen, size_t *restrict bytesRead)
+{
+	size_t n = 0;
+	int ret;
+	*bytesRead = 0;
+	while (*bytesRead < buflen) {
+		ret = xtSocketTCPReadEx(sock, (char*)buf + *bytesRead, buflen - *bytesRead, &n);
+		if (ret == XT_EAGAIN)
+			ret = socket_wait(sock, false);
+		else if (!ret)
+			*bytesRead += n;
+		if (ret && ret != XT_EINTR)
+			return ret;
+	}
+	return 0;
+}
+
+int xtSocketTCPWriteAll(xtSocket sock, const void *restrict buf, size_t buflen, size_t *restrict bytesSent, unsigned flags)
+{
+	struct xtSocketIOVec iov;
+	iov.base = (void*)buf;
+	iov.len = buflen;
+	return xtSocketTCPWritevAll(sock, &iov, 1, bytesSent, flags);
+}
+
+int xtSocketTCPWritevAll(xtSocket sock, const struct xtSocketIOVec *restrict iov, unsigned count, size_t *restrict bytesSent, unsigned flags)
+{
+	struct xtSocketIOVec batch[XT_SOCKET_IOV_BATCH];
+	size_t offset = 0, n = 0;
+	unsigned i = 0, j;
+	int ret;
+	*bytesSent = 0;
+	if (flags & XT_SOCKET_MSG_ZEROCOPY)
+		return XT_EINVAL;
+	while (i < count) {
+		for (j = 0; j < XT_SOCKET_IOV_BATCH && i + j < count; ++j)
+			batch[j] = iov[i + j];
+		batch[0].base = (char*)batch[0].base + offset;
+		batch[0].len -= offset;
+		ret = xtSocketTCPWritev(sock, batch, j, &n, flags);
+		if (ret == XT_EAGAIN) {
+			ret = socket_wait(sock, true);
+		} else if (!ret) {
+			*bytesSent += n;
+			// Skip the buffers that have been sent and the sent part of the first one that has not
+			for (n += offset; i < count && n >= iov[i].len; ++i)
+				n -= iov[i].len;
+			offset = n;
+		}
+		if (ret && ret != XT_EINTR)
+			return ret;
+	}
+	return 0;
+}
+
+int xtSocketTCPZeroCopyPoll(xtSocket sock, uint32_t *completed)
+{
+	char control[128];
+	struct msghdr msg;
+	struct cmsghdr *cm;
+	bool reaped = false;
+	while (true) {
+		memset(&msg, 0, sizeof msg);
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof control;
+		if (recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return reaped ? 0 : XT_EAGAIN;
+			if (errno == EINTR)
+				continue;
+			return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+		}
+		// Every notification covers the range of writes from ee_info up to ee_data
+		for (cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+			const struct sock_extended_err *err = (const struct sock_extended_err*)CMSG_DATA(cm);
+			if (cm->cmsg_level != SOL_IP || cm->cmsg_type != IP_RECVERR || err->ee_errno || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+			if (!reaped || (int32_t)(err->ee_data + 1 - *completed) > 0)
+				*completed = err->ee_data + 1;
+			reaped = true;
+		}
+	}
+}
+
 int xtSocketUDPRead(xtSocket sock, void *restrict buf, uint16_t buflen, uint16_t *restrict bytesRead, struct xtSockaddr *restrict sender)
 {
 	socklen_t dummyLen = sizeof(struct sockaddr_in);
@@ -471,24 +699,144 @@ int xtSocketUDPWrite(xtSocket sock, const void *restrict buf, uint16_t buflen, u
 	return 0;
 }
 
+int xtSocketUDPReadBatch(xtSocket sock, struct xtSocketUDPMessage *restrict msgs, unsigned count, unsigned *restrict read)
+{
+	struct mmsghdr hdrs[XT_SOCKET_UDP_BATCH];
+	struct iovec iov[XT_SOCKET_UDP_BATCH];
+	union {
+		char buf[CMSG_SPACE(sizeof(int))];
+		size_t align; // cmsghdr starts with a size_t
+	} control[XT_SOCKET_UDP_BATCH];
+	struct cmsghdr *cm;
+	unsigned i, n;
+	int ret, flags = MSG_WAITFORONE;
+	*read = 0;
+	while (*read < count) {
+		n = count - *read < XT_SOCKET_UDP_BATCH ? count - *read : XT_SOCKET_UDP_BATCH;
+		memset(hdrs, 0, n * sizeof hdrs[0]);
+		for (i = 0; i < n; ++i) {
+			struct xtSocketUDPMessage *m = &msgs[*read + i];
+			iov[i].iov_base = m->buf;
+			iov[i].iov_len = m->buflen;
+			hdrs[i].msg_hdr.msg_name = m->addr;
+			hdrs[i].msg_hdr.msg_namelen = m->addr ? sizeof(struct sockaddr_in) : 0;
+			hdrs[i].msg_hdr.msg_iov = &iov[i];
+			hdrs[i].msg_hdr.msg_iovlen = 1;
+			hdrs[i].msg_hdr.msg_control = control[i].buf;
+			hdrs[i].msg_hdr.msg_controllen = sizeof control[i].buf;
+		}
+		ret = recvmmsg(sock, hdrs, n, flags, NULL);
+		if (ret == -1) {
+			// Running out of datagrams after the first batch is not an error
+			if (*read)
+				break;
+			return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+		}
+		for (i = 0; i < (unsigned)ret; ++i) {
+			struct xtSocketUDPMessage *m = &msgs[*read + i];
+			int size = 0;
+			m->len = hdrs[i].msg_len;
+			m->truncated = hdrs[i].msg_hdr.msg_flags & MSG_TRUNC;
+			for (cm = CMSG_FIRSTHDR(&hdrs[i].msg_hdr); cm; cm = CMSG_NXTHDR(&hdrs[i].msg_hdr, cm))
+				if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+					memcpy(&size, CMSG_DATA(cm), sizeof size);
+			// A single datagram is reported without a segment size
+			m->segmentSize = (size_t)size < m->len ? (unsigned)size : 0;
+		}
+		*read += ret;
+		if ((unsigned)ret < n)
+			break;
+		flags = MSG_DONTWAIT;
+	}
+	return 0;
+}
+
+int xtSocketUDPWriteBatch(xtSocket sock, struct xtSocketUDPMessage *restrict msgs, unsigned count, unsigned *restrict sent)
+{
+	struct mmsghdr hdrs[XT_SOCKET_UDP_BATCH];
+	struct iovec iov[XT_SOCKET_UDP_BATCH];
+	union {
+		char buf[CMSG_SPACE(sizeof(uint16_t))];
+		size_t align; // cmsghdr starts with a size_t
+	} control[XT_SOCKET_UDP_BATCH];
+	struct cmsghdr *cm;
+	unsigned i, n;
+	int ret;
+	*sent = 0;
+	for (i = 0; i < count; ++i)
+		if (msgs[i].segmentSize > UINT16_MAX)
+			return XT_EINVAL;
+	while (*sent < count) {
+		n = count - *sent < XT_SOCKET_UDP_BATCH ? count - *sent : XT_SOCKET_UDP_BATCH;
+		memset(hdrs, 0, n * sizeof hdrs[0]);
+		for (i = 0; i < n; ++i) {
+			struct xtSocketUDPMessage *m = &msgs[*sent + i];
+			iov[i].iov_base = m->buf;
+			iov[i].iov_len = m->buflen;
+			hdrs[i].msg_hdr.msg_name = m->addr;
+			hdrs[i].msg_hdr.msg_namelen = m->addr ? sizeof(struct sockaddr_in) : 0;
+			hdrs[i].msg_hdr.msg_iov = &iov[i];
+			hdrs[i].msg_hdr.msg_iovlen = 1;
+			if (m->segmentSize) {
+				uint16_t size = m->segmentSize;
+				hdrs[i].msg_hdr.msg_control = control[i].buf;
+				hdrs[i].msg_hdr.msg_controllen = sizeof control[i].buf;
+				cm = CMSG_FIRSTHDR(&hdrs[i].msg_hdr);
+				cm->cmsg_level = SOL_UDP;
+				cm->cmsg_type = UDP_SEGMENT;
+				cm->cmsg_len = CMSG_LEN(sizeof size);
+				memcpy(CMSG_DATA(cm), &size, sizeof size);
+			}
+		}
+		ret = sendmmsg(sock, hdrs, n, 0);
+		if (ret == -1) {
+			if (*sent)
+				break;
+			return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+		}
+		for (i = 0; i < (unsigned)ret; ++i)
+			msgs[*sent + i].len = hdrs[i].msg_len;
+		*sent += ret;
+		if ((unsigned)ret < n)
+			break;
+	}
+	return 0;
+}
+
+#ifndef EPOLLEXCLUSIVE
+	#define EPOLLEXCLUSIVE (1u << 28)
+#endif
+
 struct _xt_poll_data {
 	xtSocket fd;
 	void *data;
+	/** The next free slot if this slot is free, otherwise unused. */
+	int next;
 };
 
 struct xtSocketPoll {
 	struct _xt_poll_data *data;
 	struct epoll_event *events;
+	/** Maps every file descriptor to its slot in data, or -1 if it is not monitored. */
+	int *slots;
+	int slotCount;
+	/** The first free slot in data, or -1 if all slots are in use. */
+	int freeSlot;
 	int epollfd;
 	int capacity, count, socketsReady;
+	const struct xtAllocator *allocator;
 };
 /**
  * Filters out or adds flags. This is to have consistent cross platform behavior.
  */
 static uint32_t socket_poll_event_fix_sys_flags(uint32_t sysevents)
 {
-	// Always add these on Linux!
-	sysevents |= EPOLLERR | EPOLLHUP | EPOLLRDHUP;
+	// Always add these on Linux! Exclusive wakeups do not support EPOLLRDHUP
+	sysevents |= EPOLLERR | EPOLLHUP;
+	if (sysevents & EPOLLEXCLUSIVE)
+		sysevents &= ~EPOLLRDHUP;
+	else
+		sysevents |= EPOLLRDHUP;
 	return sysevents;
 }
 /**
@@ -505,6 +853,12 @@ static uint32_t socket_poll_event_flags_to_sys(enum xtSocketPollEvent events)
 		newEvents |= EPOLLERR;
 	if (events & XT_POLLHUP)
 		newEvents |= EPOLLHUP | EPOLLRDHUP;
+	if (events & XT_POLLET)
+		newEvents |= EPOLLET;
+	if (events & XT_POLLONESHOT)
+		newEvents |= EPOLLONESHOT;
+	if (events & XT_POLLEXCLUSIVE)
+		newEvents |= EPOLLEXCLUSIVE;
 	return newEvents;
 }
 /**
@@ -524,68 +878,111 @@ static enum xtSocketPollEvent socket_poll_event_sys_to_flags(uint32_t sysevents)
 	return newEvents;
 }
 
+/**
+ * Returns the slot of \a sock or -1 if the socket is not monitored.
+ */
+static int socket_poll_slot(const struct xtSocketPoll *p, xtSocket sock)
+{
+	if (sock < 0 || sock >= p->slotCount)
+		return -1;
+	return p->slots[sock];
+}
+/**
+ * Makes sure that the slot table can hold \a sock.
+ */
+static int socket_poll_reserve_slot(struct xtSocketPoll *p, xtSocket sock)
+{
+	int *slots, count = p->slotCount;
+	if (sock < count)
+		return 0;
+	count = count ? count : 64;
+	while (count <= sock)
+		count = count > INT_MAX / 2 ? INT_MAX : count * 2;
+	if (!(slots = xtAllocatorRealloc(p->allocator, p->slots, sizeof *slots * p->slotCount, sizeof *slots * count)))
+		return XT_ENOMEM;
+	for (int i = p->slotCount; i < count; ++i)
+		slots[i] = -1;
+	p->slots = slots;
+	p->slotCount = count;
+	return 0;
+}
+
 int xtSocketPollAdd(struct xtSocketPoll *p, xtSocket sock, void *restrict data, enum xtSocketPollEvent events)
 {
-	int capacity = p->capacity;
-	if (p->count == capacity)
-		return XT_ENOBUFS;
+	int index, ret;
+	bool reuse;
+	if (sock < 0)
+		return XT_EBADF;
+	if ((ret = socket_poll_reserve_slot(p, sock)))
+		return ret;
+	// A closed socket is dropped by the kernel, so its stale slot may be reused
+	index = p->slots[sock];
+	if (!(reuse = index != -1)) {
+		if (p->count == p->capacity)
+			return XT_ENOBUFS;
+		index = p->freeSlot;
+	}
 	struct epoll_event event;
 	memset(&event, 0, sizeof event); // Prevent "uninitialised value(s)" warnings in Valgrind
 	event.events = socket_poll_event_fix_sys_flags(socket_poll_event_flags_to_sys(events));
-	// Search for a free index
-	for (int i = 0; i < capacity; ++i)
-		if (p->data[i].fd == XT_SOCKET_INVALID_FD) {
-			event.data.ptr = &p->data[i];
-			if (epoll_ctl(p->epollfd, EPOLL_CTL_ADD, sock, &event) == 0) {
-				p->data[i].fd = sock;
-				p->data[i].data = data;
-				++p->count;
-				return 0;
-			}
-			break;
-		}
-	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	event.data.ptr = &p->data[index];
+	if (epoll_ctl(p->epollfd, EPOLL_CTL_ADD, sock, &event) != 0)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	if (!reuse) {
+		p->freeSlot = p->data[index].next;
+		p->slots[sock] = index;
+		++p->count;
+	}
+	p->data[index].fd = sock;
+	p->data[index].data = data;
+	return 0;
 }
 
 int xtSocketPollCreate(struct xtSocketPoll **p, size_t capacity)
 {
-	struct xtSocketPoll *sp = malloc(sizeof **p);
-	if (!sp)
-		goto error;
-	int epollfd = -1;
-	sp->data = NULL;
-	sp->events = NULL;
+	return xtSocketPollCreateAllocator(p, capacity, NULL);
+}
+
+int xtSocketPollCreateAllocator(struct xtSocketPoll **p, size_t capacity, const struct xtAllocator *allocator)
+{
+	struct xtSocketPoll *sp;
+	int ret = XT_ENOMEM;
+	*p = NULL;
 	if (capacity == 0)
 		capacity = XT_SOCKET_POLL_CAPACITY_DEFAULT;
 	else if (capacity > INT_MAX)
 		capacity = INT_MAX;
-	if (!(sp->data = malloc(sizeof *sp->data * capacity)))
+	if (!(sp = xtAllocatorAlloc(allocator, sizeof *sp)))
+		return XT_ENOMEM;
+	sp->allocator = allocator;
+	sp->events = NULL;
+	sp->slots = NULL;
+	if (!(sp->data = xtAllocatorAlloc(allocator, sizeof *sp->data * capacity)))
 		goto error;
-	if (!(sp->events = malloc(sizeof *sp->events * capacity)))
+	if (!(sp->events = xtAllocatorAlloc(allocator, sizeof *sp->events * capacity)))
 		goto error;
-	if ((epollfd = epoll_create(capacity)) == -1)
+	if ((sp->epollfd = epoll_create(capacity)) == -1) {
+		ret = _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 		goto error;
-	// Prepare the array for usage
+	}
+	// Prepare the array for usage, all slots are free
 	for (int i = 0; i < (int)capacity; ++i) {
 		sp->data[i].fd = XT_SOCKET_INVALID_FD;
 		sp->data[i].data = NULL;
+		sp->data[i].next = i + 1 < (int)capacity ? i + 1 : -1;
 	}
-	sp->epollfd = epollfd;
+	sp->slotCount = 0;
+	sp->freeSlot = 0;
 	sp->capacity = capacity;
 	sp->count = 0;
 	sp->socketsReady = 0;
 	*p = sp;
 	return 0;
 error:
-	if (sp) {
-		if (epollfd != -1)
-			close(sp->epollfd);
-		free(sp->data);
-		free(sp->events);
-		free(sp);
-	}
-	*p = NULL;
-	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	xtAllocatorFree(allocator, sp->data, sizeof *sp->data * capacity);
+	xtAllocatorFree(allocator, sp->events, sizeof *sp->events * capacity);
+	xtAllocatorFree(allocator, sp, sizeof *sp);
+	return ret;
 }
 
 void xtSocketPollDestroy(struct xtSocketPoll **p)
@@ -600,9 +997,10 @@ void xtSocketPollDestroy(struct xtSocketPoll **p)
 		sp->data[i].fd = XT_SOCKET_INVALID_FD;
 		sp->data[i].data = NULL;
 	}
-	free(sp->data);
-	free(sp->events);
-	free(sp);
+	xtAllocatorFree(sp->allocator, sp->data, sizeof *sp->data * capacity);
+	xtAllocatorFree(sp->allocator, sp->events, sizeof *sp->events * capacity);
+	xtAllocatorFree(sp->allocator, sp->slots, sizeof *sp->slots * sp->slotCount);
+	xtAllocatorFree(sp->allocator, sp, sizeof *sp);
 	*p = NULL;
 }
 
@@ -643,40 +1041,43 @@ xtSocket xtSocketPollGetSocket(const struct xtSocketPoll *p, size_t index)
 
 int xtSocketPollMod(struct xtSocketPoll *p, xtSocket sock, enum xtSocketPollEvent events)
 {
+	int index = socket_poll_slot(p, sock);
+	if (index == -1)
+		return XT_EINVAL;
 	struct epoll_event event;
 	memset(&event, 0, sizeof event);
 	event.events = socket_poll_event_fix_sys_flags(socket_poll_event_flags_to_sys(events));
-	for (int i = 0, capacity = p->capacity; i < capacity; ++i)
-		if (p->data[i].fd == sock) {
-			event.data.ptr = &p->data[i];
-			if (epoll_ctl(p->epollfd, EPOLL_CTL_MOD, sock, &event) == 0)
-				return 0;
-			break;
-		}
-	return XT_EINVAL;
+	event.data.ptr = &p->data[index];
+	if (epoll_ctl(p->epollfd, EPOLL_CTL_MOD, sock, &event) != 0)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	return 0;
 }
 
 int xtSocketPollRemove(struct xtSocketPoll *p, xtSocket sock)
 {
-	for (int i = 0, capacity = p->capacity; i < capacity; ++i)
-		if (p->data[i].fd == sock)
-			return xtSocketPollRemoveByIndex(p, i);
-	return XT_ENOENT;
+	int index = socket_poll_slot(p, sock);
+	if (index == -1)
+		return XT_ENOENT;
+	return xtSocketPollRemoveByIndex(p, index);
 }
 
 int xtSocketPollRemoveByIndex(struct xtSocketPoll *p, size_t index)
 {
-	if ((int)index >= p->capacity)
+	if (index >= (size_t)p->capacity || p->data[index].fd == XT_SOCKET_INVALID_FD)
 		return XT_EINVAL;
 	struct epoll_event event;
 	memset(&event, 0, sizeof event);
 	xtSocket sock = p->data[index].fd;
 	// Specifiying the event struct to prevent a possible bug for kernels prior to 2.6.9
-	if (epoll_ctl(p->epollfd, EPOLL_CTL_DEL, sock, &event) != 0)
+	// A closed socket has already been dropped by the kernel, so free its slot anyway
+	if (epoll_ctl(p->epollfd, EPOLL_CTL_DEL, sock, &event) != 0 && errno != EBADF && errno != ENOENT)
 		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 	// Clean up the data in the ready array
 	p->data[index].fd = XT_SOCKET_INVALID_FD;
 	p->data[index].data = NULL;
+	p->data[index].next = p->freeSlot;
+	p->freeSlot = index;
+	p->slots[sock] = -1;
 	--p->count;
 	return 0;
 }
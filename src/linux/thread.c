@@ -1,5 +1,7 @@
 /* Copyright 2014-2018 XenoTech. See LICENSE for legal details. */
 
+#define _GNU_SOURCE // CPU_SET and pthread_setaffinity_np
+
 // XT headers
 #include <xt/thread.h>
 #include <_xt/error.h>
@@ -166,6 +168,16 @@ int xtThreadJoin(struct xtThread *t, void **ret)
 	return 0;
 }
 
+int xtThreadSetAffinity(unsigned cpu)
+{
+	cpu_set_t set;
+	if (cpu >= CPU_SETSIZE)
+		return XT_EINVAL;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return _xtTranslateSysError(pthread_setaffinity_np(pthread_self(), sizeof set, &set));
+}
+
 void xtThreadSetName(const char *name)
 {
 	prctl(PR_SET_NAME, name);
@@ -71,7 +71,8 @@ static const xtErrorMap errorMap[] = {
 	{ "No space left on device", XT_ENOSPC },
 	{ "Socket operation on non-socket", XT_ENOTSOCK },
 	{ "Cross-device link", XT_EXDEV },
-	{ "Unknown error", XT_EUNKNOWN }
+	{ "Unknown error", XT_EUNKNOWN },
+	{ "Operation canceled", XT_ECANCELED }
 };
 
 int _xtTranslateSysError(int syserrnum)
@@ -91,6 +92,7 @@ int _xtTranslateSysError(int syserrnum)
 	case ERROR_LOCK_VIOLATION:
 	case ERROR_PIPE_BUSY:
 	case ERROR_SHARING_VIOLATION:           return XT_EBUSY;
+	case WSAECANCELLED:                     return XT_ECANCELED;
 	case ERROR_OPERATION_ABORTED:
 	case WSAEINTR:                          return XT_EINTR;
 	case ERROR_CONNECTION_ABORTED:
@@ -15,6 +15,7 @@
 
 // STD headers
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 int xtFileIteratorStart(
@@ -94,21 +95,59 @@ int xtFileAccess(const char *path, enum xtFileAccessMode mode)
 	}
 }
 
+#define FILE_COPY_BUFFER (1 << 20)
+
+static int file_copy_stream(FILE *restrict src, FILE *restrict dst, int (*progress)(unsigned long long, unsigned long long, void*), void *arg)
+{
+	unsigned long long copied = 0, total;
+	long long size = _filelengthi64(_fileno(src));
+	char *buf;
+	size_t len;
+	int ret = 0;
+	total = size == -1 ? 0 : size;
+	if (!(buf = malloc(FILE_COPY_BUFFER)))
+		return XT_ENOMEM;
+	while ((len = fread(buf, 1, FILE_COPY_BUFFER, src))) {
+		if (fwrite(buf, len, 1, dst) != 1) {
+			ret = _xtTranslateSysError(errno);
+			goto end;
+		}
+		copied += len;
+		if (progress && progress(copied, total, arg)) {
+			ret = XT_ECANCELED;
+			goto end;
+		}
+	}
+	if (ferror(src))
+		ret = XT_EIO;
+	else if (fflush(dst) || _chsize_s(_fileno(dst), copied))
+		ret = _xtTranslateSysError(errno);
+end:
+	free(buf);
+	return ret;
+}
+
 int xtFileCopy(const char *restrict src, const char *restrict dst)
+{
+	return xtFileCopyProgress(src, dst, NULL, NULL);
+}
+
+int xtFileCopyProgress(const char *restrict src, const char *restrict dst, int (*progress)(unsigned long long copied, unsigned long long total, void *arg), void *arg)
 {
 	if (!src || !dst)
 		return XT_EINVAL;
 	FILE *fsrc = fopen(src, "rb");
 	if (!fsrc)
 		return _xtTranslateSysError(errno);
-	FILE *fdst = fopen(dst, "w+");
+	FILE *fdst = fopen(dst, "wb");
 	if (!fdst) {
 		fclose(fsrc);
 		return _xtTranslateSysError(errno);
 	}
-	int ret = xtFileCopyByHandle(fsrc, fdst);
+	int ret = file_copy_stream(fsrc, fdst, progress, arg);
 	fclose(fsrc);
-	fclose(fdst);
+	if (fclose(fdst) && !ret)
+		ret = _xtTranslateSysError(errno);
 	return ret;
 }
 
@@ -118,18 +157,10 @@ int xtFileCopyByHandle(FILE *restrict src, FILE *restrict dst)
 		return XT_EINVAL;
 	if (fseek(src, 0, SEEK_SET) != 0 || fseek(dst, 0, SEEK_SET) != 0)
 		return _xtTranslateSysError(errno);
-	char buf[8192];
-	size_t len;
-	while (true) {
-		len = fread(buf, 1, sizeof buf, src);
-		if (len == 0)
-			break;
-		if (fwrite(buf, len, 1, dst) != 1)
-			return _xtTranslateSysError(errno);
-	}
+	int ret = file_copy_stream(src, dst, NULL, NULL);
 	fseek(dst, 0, SEEK_SET);
 	fseek(src, 0, SEEK_SET);
-	return 0;
+	return ret;
 }
 
 int xtFileCreateDir(const char *path)
@@ -12,6 +12,7 @@
 #include <io.h>
 
 // STD headers
+#include <stdint.h>
 #include <stdio.h>
 #include <stdarg.h> // va_list
 
@@ -460,3 +461,31 @@ fail:
 	}
 	return map;
 }
+
+int xtmadvise(void *addr, size_t len, int advice)
+{
+	/* Advice is only a hint, so ignore it */
+	(void)addr;
+	(void)len;
+	(void)advice;
+	return 0;
+}
+
+void *xtHugeAlloc(size_t size)
+{
+	SIZE_T large = GetLargePageMinimum();
+	void *p = NULL;
+	/* Large pages need the SeLockMemoryPrivilege, so they may be refused */
+	if (large && size <= SIZE_MAX - large)
+		p = VirtualAlloc(NULL, (size + large - 1) & ~(large - 1), MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+	if (!p)
+		p = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	return p;
+}
+
+void xtHugeFree(void *ptr, size_t size)
+{
+	(void)size;
+	if (ptr)
+		VirtualFree(ptr, 0, MEM_RELEASE);
+}
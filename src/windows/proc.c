@@ -2,6 +2,7 @@
 
 // XT headers
 #include <xt/proc.h>
+#include <xt/pool.h>
 #include <_xt/error.h>
 #include <xt/error.h>
 #include <xt/string.h>
@@ -67,6 +68,7 @@ int xtProcGetMemoryInfo(unsigned pid, struct xtProcMemoryInfo *info)
 	// doesn't work. The returned numbers are bogus so they are no use.
 	info->swap = 0;
 	info->vmPeak = 0;
+	info->pool = pid == xtProcGetCurrentPID() ? xtPoolGetTotalSize() : 0;
 	CloseHandle(handle);
 	return 0;
 error:
@@ -12,6 +12,7 @@
 #include <windows.h> // Do this after including winsock (ws2tcpip includes it for us)
 
 // STD headers
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -109,6 +110,8 @@ char *xtSockaddrToString(const struct xtSockaddr *restrict sa, char *restrict bu
 #define XT_SOCKET_LAST_ERROR WSAGetLastError()
 #define close closesocket
 #define SHUT_RDWR SD_BOTH
+// The most buffers that xtSocketTCPWritevAll() passes at once
+#define XT_SOCKET_IOV_BATCH 64
 
 int xtSocketBindTo(xtSocket sock, const struct xtSockaddr *sa)
 {
@@ -304,6 +307,13 @@ int xtSocketGetSoReuseAddress(const xtSocket sock, bool *flag)
 	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 }
 
+int xtSocketGetSoReusePort(const xtSocket sock, bool *flag)
+{
+	(void)sock;
+	(void)flag;
+	return XT_EOPNOTSUPP;
+}
+
 int xtSocketGetSoSendBufferSize(xtSocket sock, unsigned *size)
 {
 	int val = 0;
@@ -315,6 +325,13 @@ int xtSocketGetSoSendBufferSize(xtSocket sock, unsigned *size)
 	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 }
 
+int xtSocketGetTCPCork(const xtSocket sock, bool *flag)
+{
+	(void)sock;
+	(void)flag;
+	return XT_EOPNOTSUPP;
+}
+
 int xtSocketGetTCPNoDelay(const xtSocket sock, bool *flag)
 {
 	int val;
@@ -394,6 +411,13 @@ int xtSocketSetSoReuseAddress(xtSocket sock, bool flag)
 	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 }
 
+int xtSocketSetSoReusePort(xtSocket sock, bool flag)
+{
+	(void)sock;
+	(void)flag;
+	return XT_EOPNOTSUPP;
+}
+
 int xtSocketSetSoSendBufferSize(xtSocket sock, unsigned size)
 {
 	int val = size;
@@ -402,6 +426,20 @@ int xtSocketSetSoSendBufferSize(xtSocket sock, unsigned size)
 	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 }
 
+int xtSocketSetSoZeroCopy(xtSocket sock, bool flag)
+{
+	(void)sock;
+	(void)flag;
+	return XT_EOPNOTSUPP;
+}
+
+int xtSocketSetTCPCork(xtSocket sock, bool flag)
+{
+	(void)sock;
+	(void)flag;
+	return XT_EOPNOTSUPP;
+}
+
 int xtSocketSetTCPNoDelay(xtSocket sock, bool flag)
 {
 	int val = (flag) ? 1 : 0;
@@ -410,6 +448,13 @@ int xtSocketSetTCPNoDelay(xtSocket sock, bool flag)
 	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
 }
 
+int xtSocketSetUDPGRO(xtSocket sock, bool flag)
+{
+	(void)sock;
+	(void)flag;
+	return XT_EOPNOTSUPP;
+}
+
 int xtSocketTCPAccept(xtSocket sock, xtSocket *restrict peerSock, struct xtSockaddr *restrict peerAddr)
 {
 	socklen_t dummyLen = sizeof(struct sockaddr_in);
@@ -449,6 +494,131 @@ int xtSocketTCPWrite(xtSocket sock, const void *restrict buf, uint16_t buflen, u
 	return 0;
 }
 
+/* Waits until a non-blocking socket is ready again. */
+static int socket_wait(xtSocket sock, bool write)
+{
+	fd_set set;
+	FD_ZERO(&set);
+	FD_SET(sock, &set);
+	if (select(0, write ? NULL : &set, write ? &set : NULL, NULL, NULL) == SOCKET_ERROR)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	return 0;
+}
+
+int xtSocketTCPReadEx(xtSocket sock, void *restrict buf, size_t buflen, size_t *restrict bytesRead)
+{
+	int ret;
+	// Winsock takes an int, so larger buffers are filled partially
+	ret = recv(sock, buf, buflen > INT_MAX ? INT_MAX : (int)buflen, 0);
+	if (ret == SOCKET_ERROR)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	*bytesRead = ret;
+	return ret == 0 ? XT_ESHUTDOWN : 0; // Graceful shutdown
+}
+
+int xtSocketTCPWriteEx(xtSocket sock, const void *restrict buf, size_t buflen, size_t *restrict bytesSent, unsigned flags)
+{
+	int ret;
+	(void)flags;
+	ret = send(sock, (const char*)buf, buflen > INT_MAX ? INT_MAX : (int)buflen, 0);
+	if (ret == SOCKET_ERROR)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	*bytesSent = ret;
+	return 0;
+}
+
+int xtSocketTCPReadv(xtSocket sock, const struct xtSocketIOVec *restrict iov, unsigned count, size_t *restrict bytesRead)
+{
+	DWORD n, flags = 0;
+	if (WSARecv(sock, (WSABUF*)iov, count, &n, &flags, NULL, NULL) == SOCKET_ERROR)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	*bytesRead = n;
+	return n == 0 ? XT_ESHUTDOWN : 0;
+}
+
+int xtSocketTCPWritev(xtSocket sock, const struct xtSocketIOVec *restrict iov, unsigned count, size_t *restrict bytesSent, unsigned flags)
+{
+	DWORD n;
+	(void)flags;
+	if (WSASend(sock, (WSABUF*)iov, count, &n, 0, NULL, NULL) == SOCKET_ERROR)
+		return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	*bytesSent = n;
+	return 0;
+}
+
+int xtSocketTCPReadExact(xtSocket sock, void *restrict buf, size_t buflen, size_t *restrict bytesRead)
+{
+	size_t n = 0;
+	int ret;
+	*bytesRead = 0;
+	while (*bytesRead < buflen) {
+		ret = xtSocketTCPReadEx(sock, (char*)buf + *bytesRead, buflen - *bytesRead, &n);
+		if (ret == XT_EAGAIN)
+			ret = socket_wait(sock, false);
+		else if (!ret)
+			*bytesRead += n;
+		if (ret && ret != XT_EINTR)
+			return ret;
+	}
+	return 0;
+}
+
+int xtSocketTCPWriteAll(xtSocket sock, const void *restrict buf, size_t buflen, size_t *restrict bytesSent, unsigned flags)
+{
+	size_t n = 0;
+	int ret;
+	*bytesSent = 0;
+	if (flags & XT_SOCKET_MSG_ZEROCOPY)
+		return XT_EINVAL;
+	while (*bytesSent < buflen) {
+		ret = xtSocketTCPWriteEx(sock, (const char*)buf + *bytesSent, buflen - *bytesSent, &n, flags);
+		if (ret == XT_EAGAIN)
+			ret = socket_wait(sock, true);
+		else if (!ret)
+			*bytesSent += n;
+		if (ret && ret != XT_EINTR)
+			return ret;
+	}
+	return 0;
+}
+
+int xtSocketTCPWritevAll(xtSocket sock, const struct xtSocketIOVec *restrict iov, unsigned count, size_t *restrict bytesSent, unsigned flags)
+{
+	struct xtSocketIOVec batch[XT_SOCKET_IOV_BATCH];
+	size_t offset = 0, n = 0;
+	unsigned i = 0, j;
+	int ret;
+	*bytesSent = 0;
+	if (flags & XT_SOCKET_MSG_ZEROCOPY)
+		return XT_EINVAL;
+	while (i < count) {
+		for (j = 0; j < XT_SOCKET_IOV_BATCH && i + j < count; ++j)
+			batch[j] = iov[i + j];
+		batch[0].base = (char*)batch[0].base + offset;
+		batch[0].len -= offset;
+		ret = xtSocketTCPWritev(sock, batch, j, &n, flags);
+		if (ret == XT_EAGAIN) {
+			ret = socket_wait(sock, true);
+		} else if (!ret) {
+			*bytesSent += n;
+			// Skip the buffers that have been sent and the sent part of the first one that has not
+			for (n += offset; i < count && n >= iov[i].len; ++i)
+				n -= iov[i].len;
+			offset = n;
+		}
+		if (ret && ret != XT_EINTR)
+			return ret;
+	}
+	return 0;
+}
+
+int xtSocketTCPZeroCopyPoll(xtSocket sock, uint32_t *completed)
+{
+	(void)sock;
+	(void)completed;
+	return XT_EOPNOTSUPP;
+}
+
 int xtSocketUDPRead(xtSocket sock, void *restrict buf, uint16_t buflen, uint16_t *restrict bytesRead, struct xtSockaddr *restrict sender)
 {
 	socklen_t dummyLen = sizeof(struct sockaddr_in);
@@ -477,6 +647,60 @@ int xtSocketUDPWrite(xtSocket sock, const void *restrict buf, uint16_t buflen, u
 	return 0;
 }
 
+int xtSocketUDPReadBatch(xtSocket sock, struct xtSocketUDPMessage *restrict msgs, unsigned count, unsigned *restrict read)
+{
+	socklen_t dummyLen = sizeof(struct sockaddr_in);
+	int ret;
+	*read = 0;
+	if (!count)
+		return 0;
+	// There is no recvmmsg, so just read one datagram
+	ret = recvfrom(sock, msgs->buf, msgs->buflen > INT_MAX ? INT_MAX : (int)msgs->buflen, 0, (struct sockaddr*)msgs->addr, &dummyLen);
+	msgs->truncated = false;
+	if (ret == SOCKET_ERROR) {
+		// A datagram that does not fit is an error, but the buffer has been filled
+		if (XT_SOCKET_LAST_ERROR != WSAEMSGSIZE)
+			return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+		msgs->truncated = true;
+		ret = msgs->buflen > INT_MAX ? INT_MAX : (int)msgs->buflen;
+	}
+	msgs->len = ret;
+	msgs->segmentSize = 0;
+	*read = 1;
+	return 0;
+}
+
+int xtSocketUDPWriteBatch(xtSocket sock, struct xtSocketUDPMessage *restrict msgs, unsigned count, unsigned *restrict sent)
+{
+	unsigned i;
+	*sent = 0;
+	for (i = 0; i < count; ++i)
+		if (msgs[i].segmentSize > UINT16_MAX)
+			return XT_EINVAL;
+	for (; *sent < count; ++*sent) {
+		struct xtSocketUDPMessage *m = &msgs[*sent];
+		// Without UDP_SEGMENT, every segment is sent on its own
+		size_t size = m->segmentSize ? m->segmentSize : m->buflen, pos = 0;
+		do {
+			size_t n = m->buflen - pos < size ? m->buflen - pos : size;
+			int ret = sendto(sock, (const char*)m->buf + pos, n > INT_MAX ? INT_MAX : (int)n, 0, (const struct sockaddr*)m->addr, sizeof(struct sockaddr_in));
+			if (ret == SOCKET_ERROR) {
+				// Count a partly sent message, so its segments that went out are not sent again
+				if (pos) {
+					m->len = pos;
+					++*sent;
+				}
+				if (*sent)
+					return 0;
+				return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+			}
+			pos += ret;
+		} while (pos < m->buflen);
+		m->len = pos;
+	}
+	return 0;
+}
+
 struct _xt_poll_data {
 	xtSocket fd;
 	void *data;
@@ -488,6 +712,7 @@ struct xtSocketPoll {
 	struct _xt_poll_data *readyData;
 	struct pollfd *fds;
 	unsigned capacity, count, socketsReady;
+	const struct xtAllocator *allocator;
 };
 /**
  * Filters out or adds flags. This is to have consistent cross platform behavior.
@@ -548,21 +773,27 @@ int xtSocketPollAdd(struct xtSocketPoll *p, xtSocket sock, void *restrict data,
 
 int xtSocketPollCreate(struct xtSocketPoll **p, size_t capacity)
 {
-	struct xtSocketPoll *sp = malloc(sizeof **p);
-	if (!sp)
-		goto error;
-	sp->data = NULL;
-	sp->fds = NULL;
-	sp->readyData = NULL;
+	return xtSocketPollCreateAllocator(p, capacity, NULL);
+}
+
+int xtSocketPollCreateAllocator(struct xtSocketPoll **p, size_t capacity, const struct xtAllocator *allocator)
+{
+	struct xtSocketPoll *sp;
+	*p = NULL;
 	if (capacity == 0)
 		capacity = XT_SOCKET_POLL_CAPACITY_DEFAULT;
 	else if (capacity > INT_MAX)
 		capacity = INT_MAX;
-	if (!(sp->data = malloc(sizeof *sp->data * capacity)))
+	if (!(sp = xtAllocatorAlloc(allocator, sizeof *sp)))
+		return XT_ENOMEM;
+	sp->allocator = allocator;
+	sp->fds = NULL;
+	sp->readyData = NULL;
+	if (!(sp->data = xtAllocatorAlloc(allocator, sizeof *sp->data * capacity)))
 		goto error;
-	if (!(sp->fds = malloc(sizeof *sp->fds * capacity)))
+	if (!(sp->fds = xtAllocatorAlloc(allocator, sizeof *sp->fds * capacity)))
 		goto error;
-	if (!(sp->readyData = malloc(sizeof *sp->readyData * capacity)))
+	if (!(sp->readyData = xtAllocatorAlloc(allocator, sizeof *sp->readyData * capacity)))
 		goto error;
 	// Prepare the array for usage
 	for (int i = 0; i < (int)capacity; ++i) {
@@ -583,14 +814,11 @@ int xtSocketPollCreate(struct xtSocketPoll **p, size_t capacity)
 	*p = sp;
 	return 0;
 error:
-	if (sp) {
-		free(sp->data);
-		free(sp->fds);
-		free(sp->readyData);
-		free(sp);
-	}
-	*p = NULL;
-	return _xtTranslateSysError(XT_SOCKET_LAST_ERROR);
+	xtAllocatorFree(allocator, sp->data, sizeof *sp->data * capacity);
+	xtAllocatorFree(allocator, sp->fds, sizeof *sp->fds * capacity);
+	xtAllocatorFree(allocator, sp->readyData, sizeof *sp->readyData * capacity);
+	xtAllocatorFree(allocator, sp, sizeof *sp);
+	return XT_ENOMEM;
 }
 
 void xtSocketPollDestroy(struct xtSocketPoll **p)
@@ -598,10 +826,10 @@ void xtSocketPollDestroy(struct xtSocketPoll **p)
 	struct xtSocketPoll *sp = *p;
 	if (!sp)
 		return;
-	free(sp->fds);
-	free(sp->data);
-	free(sp->readyData);
-	free(sp);
+	xtAllocatorFree(sp->allocator, sp->fds, sizeof *sp->fds * sp->capacity);
+	xtAllocatorFree(sp->allocator, sp->data, sizeof *sp->data * sp->capacity);
+	xtAllocatorFree(sp->allocator, sp->readyData, sizeof *sp->readyData * sp->capacity);
+	xtAllocatorFree(sp->allocator, sp, sizeof *sp);
 	*p = NULL;
 }
 
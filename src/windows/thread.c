@@ -196,6 +196,15 @@ int xtThreadJoin(struct xtThread *t, void **ret)
 	return 0;
 }
 
+int xtThreadSetAffinity(unsigned cpu)
+{
+	if (cpu >= sizeof(DWORD_PTR) * 8)
+		return XT_EINVAL;
+	if (!SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu))
+		return _xtTranslateSysError(GetLastError());
+	return 0;
+}
+
 void xtThreadSetName(const char *name)
 {
 	size_t len = strlen(name);